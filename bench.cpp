@@ -0,0 +1,784 @@
+/*
+
+Benchmarks de la hiérarchie de matrices (matrix.h).
+
+Chaque mesure fait quelques itérations de warmup puis N itérations chronométrées une par une avec
+std::chrono::steady_clock. On rapporte le min, la médiane et le p99, ainsi que le débit (éléments/s et GB/s)
+calculé sur la médiane. Les résultats sont aussi écrits en JSON pour pouvoir comparer deux builds.
+
+Usage : tp5_bench [--warmup N] [--iterations N] [--min-size N] [--max-size N] [--max-print-size N]
+                  [--max-multiply-size N] [--threads N] [--json fichier] [--stats fichier]
+
+Avec l'option CMake TP5_STATS, les compteurs de matrix_stats.h cumulés sur tout le benchmark sont écrits en
+JSON dans le fichier de --stats (bench_stats.json par défaut).
+
+*/
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+#include "matrix.h"
+#include "matrix_expr.h"
+#include "matrix_io.h"
+#include "matrix_fixed.h"
+#include "matrix_value.h"
+#include "matrix_batch.h"
+#include "matrix_view.h"
+#include "matrix_async.h"
+
+struct bench_config {
+    std::size_t warmup = 3;
+    std::size_t iterations = 25;
+    std::size_t minSize = 256;
+    std::size_t maxSize = 2048;
+    std::size_t maxPrintSize = 512;
+    std::size_t maxMultiplySize = 512;
+    std::size_t threads = 0;
+    std::string jsonPath = "bench_output.json";
+    std::string statsPath = "bench_stats.json";
+};
+
+struct bench_result {
+    std::string name;
+    std::string type;
+    std::size_t size;
+    std::size_t iterations;
+    double minNs;
+    double medianNs;
+    double p99Ns;
+    double elements;
+    double bytes;
+    double allocations;
+};
+
+// Compteur d'allocations : on remplace l'operator new global pour vérifier qu'une opération ne touche pas au tas.
+// noinline évite que GCC voie le couple malloc/free à travers new/delete (-Wmismatched-new-delete). Le compteur
+// est atomique pour rester juste quand une opération alloue depuis plusieurs threads ; un ordre relâché suffit.
+static std::atomic<std::size_t> allocationCount{0};
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Empêche le compilateur d'éliminer un calcul dont le résultat n'est pas utilisé.
+template<typename T>
+void doNotOptimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Tampon de sortie qui jette tout : print() est mesuré sans le coût du terminal.
+class null_buffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+
+    std::streamsize xsputn(const char *, std::streamsize n) override {
+        return n;
+    }
+};
+
+template<typename T>
+struct type_name;
+
+template<>
+struct type_name<int> {
+    static const char *get() { return "int"; }
+};
+
+template<>
+struct type_name<double> {
+    static const char *get() { return "double"; }
+};
+
+template<typename F>
+bench_result runBench(const bench_config &config, const std::string &name, const std::string &type, std::size_t size,
+                      double elements, double bytes, F &&f) {
+    for (std::size_t i = 0; i < config.warmup; i++)
+        f();
+
+    std::vector<double> samples(config.iterations);
+    std::size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < config.iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        samples[i] = std::chrono::duration<double, std::nano>(end - start).count();
+    }
+    std::size_t allocationsAfter = allocationCount.load(std::memory_order_relaxed);
+    double allocations = static_cast<double>(allocationsAfter - allocationsBefore) / config.iterations;
+    std::sort(samples.begin(), samples.end());
+
+    std::size_t p99Index = static_cast<std::size_t>(std::ceil(0.99 * samples.size()));
+    p99Index = p99Index == 0 ? 0 : p99Index - 1;
+    double median = samples.size() % 2 ? samples[samples.size() / 2]
+                                       : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+
+    return {name, type, size, config.iterations, samples.front(), median, samples[p99Index], elements, bytes,
+            allocations};
+}
+
+template<typename T>
+void fill(matrix_dense<T> &m) {
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = 0; j < m.getWidth(); j++)
+            m(i, j) = static_cast<T>((i + j) % 7);
+}
+
+template<typename T>
+void fill(matrix_triangulaire_sup<T> &m) {
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = i; j < m.getWidth(); j++)
+            m(i, j) = static_cast<T>((i + j) % 7);
+}
+
+template<typename T>
+void fill(matrix_symmetric<T> &m) {
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = i; j < m.getWidth(); j++)
+            m(i, j) = static_cast<T>((i + j) % 7);
+}
+
+template<typename T>
+void fill(matrix_diag<T> &m) {
+    for (std::size_t i = 0; i < std::min(m.getHeight(), m.getWidth()); i++)
+        m(i, i) = static_cast<T>(i % 7);
+}
+
+// Matrice creuse n x n avec 8 éléments par ligne répartis sur toute la largeur.
+template<typename T>
+matrix_csr<T> makeCsr(std::size_t n) {
+    const std::size_t perRow = std::min<std::size_t>(8, n);
+    std::vector<std::size_t> rowPtr(n + 1), colIdx;
+    matrix_storage<T> values(n * perRow);
+    for (std::size_t i = 0; i < n; i++) {
+        const std::size_t first = colIdx.size();
+        for (std::size_t k = 0; k < perRow; k++)
+            colIdx.push_back((i + k * (n / perRow)) % n);
+        std::sort(colIdx.begin() + first, colIdx.end());
+        for (std::size_t k = first; k < colIdx.size(); k++)
+            values[k] = static_cast<T>((i + colIdx[k]) % 13);
+        rowPtr[i + 1] = colIdx.size();
+    }
+    return matrix_csr<T>(static_cast<int>(n), static_cast<int>(n), std::move(rowPtr), std::move(colIdx),
+                         std::move(values));
+}
+
+// Matrice tridiagonale n x n.
+template<typename T>
+matrix_band<T> makeBand(std::size_t n) {
+    matrix_band<T> m(static_cast<int>(n), static_cast<int>(n), 1, 1);
+    for (std::size_t j = 0; j < n; j++) {
+        matrix_column_segment<T> col = m.columnSegment(j);
+        for (std::size_t i = col.firstRow(); i < col.firstRow() + col.size(); i++)
+            col[i] = static_cast<T>((i + j) % 7);
+    }
+    return m;
+}
+
+template<typename T>
+void benchType(const bench_config &config, std::vector<bench_result> &results) {
+    const std::string type = type_name<T>::get();
+
+    for (std::size_t size = config.minSize; size <= config.maxSize; size *= 2) {
+        int n = static_cast<int>(size);
+        matrix_dense<T> mDense(n, n);
+        matrix_triangulaire_sup<T> mTriang(n, n, T{});
+        matrix_diag<T> mDiag(n, n, T{});
+        matrix_symmetric<T> mSym(n);
+        fill(mDense);
+        fill(mTriang);
+        fill(mDiag);
+        fill(mSym);
+        matrix_csr<T> mCsr = makeCsr<T>(size);
+        matrix_band<T> mBand = makeBand<T>(size);
+
+        std::vector<std::pair<std::string, matrix_t_<T> *>> matrices = {
+                {"dense",  &mDense},
+                {"triang", &mTriang},
+                {"diag",   &mDiag},
+                {"csr",    &mCsr},
+                {"band",   &mBand},
+                {"sym",    &mSym}
+        };
+
+        for (auto &m : matrices) {
+            double diag = static_cast<double>(std::min(m.second->getHeight(), m.second->getWidth()));
+            results.push_back(runBench(config, "trace/" + m.first, type, size, diag, diag * sizeof(T), [&]() {
+                doNotOptimize(m.second->trace());
+            }));
+        }
+
+        // Réductions de matrix_reduce.h sur les éléments stockés, dans les trois modes de sommation.
+        const std::pair<const char *, reduce::summation> summations[] = {{"fast",     reduce::summation::fast},
+                                                                          {"kahan",    reduce::summation::kahan},
+                                                                          {"pairwise", reduce::summation::pairwise}};
+        for (auto &m : matrices) {
+            const matrix_t_<T> &ref = *m.second;
+            double elements = static_cast<double>(ref.getStoredSize());
+            for (const auto &mode : summations)
+                results.push_back(runBench(config, std::string("sum-") + mode.first + "/" + m.first, type, size,
+                                           elements, elements * sizeof(T), [&]() {
+                                               doNotOptimize(ref.sum(mode.second));
+                                           }));
+            results.push_back(runBench(config, "normFrobenius/" + m.first, type, size, elements,
+                                       elements * sizeof(T), [&]() {
+                                           doNotOptimize(ref.normFrobenius());
+                                       }));
+            results.push_back(runBench(config, "norm1/" + m.first, type, size, elements, elements * sizeof(T),
+                                       [&]() {
+                                           doNotOptimize(ref.norm1());
+                                       }));
+            results.push_back(runBench(config, "dot/" + m.first + "." + m.first, type, size, elements,
+                                       2 * elements * sizeof(T), [&]() {
+                                           doNotOptimize(ref.dot(ref));
+                                       }));
+        }
+
+        for (auto &m : matrices) {
+            const matrix_t_<T> &ref = *m.second;
+            double elements = static_cast<double>(size) * size;
+            results.push_back(runBench(config, "operator()/" + m.first, type, size, elements, elements * sizeof(T),
+                                       [&]() {
+                                           T sum = {};
+                                           for (std::size_t i = 0; i < size; i++)
+                                               for (std::size_t j = 0; j < size; j++)
+                                                   sum += ref(i, j);
+                                           doNotOptimize(sum);
+                                       }));
+        }
+
+        for (auto &m : matrices) {
+            const matrix_t_<T> &ref = *m.second;
+            double elements = static_cast<double>(ref.getStoredSize());
+            results.push_back(runBench(config, "values/" + m.first, type, size, elements, elements * sizeof(T),
+                                       [&]() {
+                                           T sum = {};
+                                           for (const T &v : ref.values())
+                                               sum += v;
+                                           doNotOptimize(sum);
+                                       }));
+        }
+
+        {
+            // Dispositions row_major et tiled de matrix_dense : conversion depuis column-major, puis les
+            // opérations dont l'ordre de parcours dépend de la disposition.
+            const double elements = static_cast<double>(size) * size;
+            for (auto layout : {std::make_pair(std::string("row"), dense_layout::row_major),
+                                std::make_pair(std::string("tiled"), dense_layout::tiled)}) {
+                matrix_dense<T> converted = mDense.withLayout(layout.second), dst(n, n, layout.second);
+                std::vector<T> x(size, T(1)), y(size);
+                const std::string name = "dense-" + layout.first;
+                results.push_back(runBench(config, "convert/dense->" + name, type, size, elements,
+                                           2 * elements * sizeof(T), [&]() {
+                                               dst.copyValues(mDense);
+                                               doNotOptimize(dst(0, 0));
+                                           }));
+                results.push_back(runBench(config, "addInto/" + name + "+" + name, type, size, elements,
+                                           3 * elements * sizeof(T), [&]() {
+                                               addInto(dst, converted, converted);
+                                               doNotOptimize(dst(0, 0));
+                                           }));
+                results.push_back(runBench(config, "addInto/" + name + "+triang", type, size, elements, 0, [&]() {
+                    addInto(dst, converted, mTriang);
+                    doNotOptimize(dst(0, 0));
+                }));
+                results.push_back(runBench(config, "matvec/" + name, type, size, elements, elements * sizeof(T),
+                                           [&]() {
+                                               converted.multiplyVector(matrix_span<const T>(x.data(), size),
+                                                                        matrix_span<T>(y.data(), size));
+                                               doNotOptimize(y[0]);
+                                           }));
+                results.push_back(runBench(config, "transpose/" + name, type, size, elements,
+                                           2 * elements * sizeof(T), [&]() {
+                                               matrix_dense<T> r = converted.transposed();
+                                               doNotOptimize(r(0, 0));
+                                           }));
+                results.push_back(runBench(config, "transposeInPlace/" + name, type, size, elements,
+                                           2 * elements * sizeof(T), [&]() {
+                                               converted.transposeInPlace();
+                                               doNotOptimize(converted(0, 0));
+                                           }));
+                if (size <= config.maxMultiplySize)
+                    results.push_back(runBench(config, "multiply/" + name + "*" + name, type, size, elements, 0,
+                                               [&]() {
+                                                   std::unique_ptr<matrix_t_<T>> r = converted.multiply(converted,
+                                                                                                        converted);
+                                                   doNotOptimize(r.get());
+                                               }));
+            }
+        }
+
+        {
+            // Débit d'un produit matrice-vecteur : la matrice stockée est lue une fois, x et y en plus.
+            const std::size_t batch = 16;
+            std::vector<T> x(size, T(1)), y(size);
+            matrix_dense<T> xs(n, static_cast<int>(batch)), ys(n, static_cast<int>(batch));
+            fill(xs);
+            for (auto &m : matrices) {
+                double elements = static_cast<double>(size) * size;
+                double bytes = static_cast<double>(m.second->getStoredSize() + 2 * size) * sizeof(T);
+                results.push_back(runBench(config, "matvec/" + m.first, type, size, elements, bytes, [&]() {
+                    m.second->multiplyVector(matrix_span<const T>(x.data(), size), matrix_span<T>(y.data(), size));
+                    doNotOptimize(y[0]);
+                }));
+                bytes = static_cast<double>(m.second->getStoredSize() + 2 * size * batch) * sizeof(T);
+                results.push_back(runBench(config, "matvec-batch16/" + m.first, type, size, elements * batch, bytes,
+                                           [&]() {
+                                               m.second->multiplyVectors(xs, ys);
+                                               doNotOptimize(ys(0, 0));
+                                           }));
+            }
+        }
+
+        {
+            // Transposées : le stockage est lu une fois et le résultat écrit une fois.
+            const double elements = static_cast<double>(size) * size;
+            for (auto &m : matrices) {
+                double bytes = 2.0 * static_cast<double>(m.second->getStoredSize()) * sizeof(T);
+                results.push_back(runBench(config, "transpose/" + m.first, type, size, elements, bytes, [&]() {
+                    std::unique_ptr<matrix_t_<T>> r = m.second->transpose();
+                    doNotOptimize(r.get());
+                }));
+            }
+            matrix_dense<T> square(mDense);
+            results.push_back(runBench(config, "transposeInPlace/dense", type, size, elements,
+                                       2 * elements * sizeof(T), [&]() {
+                                           square.transposeInPlace();
+                                           doNotOptimize(square(0, 0));
+                                       }));
+        }
+
+        {
+            // Le format binaire ne couvre pas encore CSR ni les matrices bandes.
+            const std::string path = "bench_matrix.tmp";
+            for (auto &m : std::vector<std::pair<std::string, matrix_t_<T> *>>{
+                    {"dense", &mDense}, {"triang", &mTriang}, {"diag", &mDiag}}) {
+                double bytes = static_cast<double>(m.second->getStoredSize()) * sizeof(T);
+                results.push_back(runBench(config, "save/" + m.first, type, size, bytes / sizeof(T), bytes, [&]() {
+                    saveMatrix(*m.second, path);
+                }));
+                results.push_back(runBench(config, "load-mmap/" + m.first, type, size, bytes / sizeof(T), 0, [&]() {
+                    std::unique_ptr<matrix_t_<T>> r = loadMatrix<T>(path);
+                    doNotOptimize(r.get());
+                }));
+                results.push_back(runBench(config, "load-read/" + m.first, type, size, bytes / sizeof(T), bytes,
+                                           [&]() {
+                                               std::unique_ptr<matrix_t_<T>> r = loadMatrix<T>(path, false);
+                                               doNotOptimize(r.get());
+                                           }));
+            }
+            std::remove(path.c_str());
+        }
+
+        if (size <= config.maxPrintSize) {
+            null_buffer sink;
+            std::streambuf *old = std::cout.rdbuf(&sink);
+            for (auto &m : matrices) {
+                double elements = static_cast<double>(size) * size;
+                results.push_back(runBench(config, "print/" + m.first, type, size, elements, 0, [&]() {
+                    m.second->print();
+                }));
+            }
+            std::cout.rdbuf(old);
+        }
+
+        for (auto &lhs : matrices) {
+            for (auto &rhs : matrices) {
+                std::unique_ptr<matrix_t_<T>> probe = lhs.second->add(*lhs.second, *rhs.second);
+                double elements = static_cast<double>(size) * size;
+                double bytes = static_cast<double>(lhs.second->getStoredSize() + rhs.second->getStoredSize() +
+                                                   probe->getStoredSize()) * sizeof(T);
+                results.push_back(runBench(config, "add/" + lhs.first + "+" + rhs.first, type, size, elements, bytes,
+                                           [&]() {
+                                               std::unique_ptr<matrix_t_<T>> r = lhs.second->add(*lhs.second,
+                                                                                                  *rhs.second);
+                                               doNotOptimize(r.get());
+                                           }));
+            }
+        }
+
+        {
+            double elements = static_cast<double>(size) * size;
+            results.push_back(runBench(config, "add-chain/dense+triang+diag+dense", type, size, elements, 0, [&]() {
+                std::unique_ptr<matrix_t_<T>> r1 = mDense.add(mDense, mTriang);
+                std::unique_ptr<matrix_t_<T>> r2 = r1->add(*r1, mDiag);
+                std::unique_ptr<matrix_t_<T>> r3 = r2->add(*r2, mDense);
+                doNotOptimize(r3.get());
+            }));
+            results.push_back(runBench(config, "expr/dense+triang+diag+dense", type, size, elements, 0, [&]() {
+                matrix_dense<T> r = evaluate(mDense + mTriang + mDiag + mDense);
+                doNotOptimize(r(0, 0));
+            }));
+            matrix_dense<T> dst(n, n);
+            results.push_back(runBench(config, "expr-assign/dense+triang+diag+dense", type, size, elements, 0, [&]() {
+                assign(dst, mDense + mTriang + mDiag + mDense);
+                doNotOptimize(dst(0, 0));
+            }));
+            // C = alpha A + beta B : noyau fusionné contre l'expression paresseuse équivalente.
+            const T alpha = T(2), beta = T(3);
+            results.push_back(runBench(config, "axpbyInto/dense+dense", type, size, elements, 0, [&]() {
+                axpbyInto(dst, alpha, mDense, beta, mDense);
+                doNotOptimize(dst(0, 0));
+            }));
+            results.push_back(runBench(config, "axpbyInto/dense+triang", type, size, elements, 0, [&]() {
+                axpbyInto(dst, alpha, mDense, beta, mTriang);
+                doNotOptimize(dst(0, 0));
+            }));
+            results.push_back(runBench(config, "expr-assign/axpby-dense+triang", type, size, elements, 0, [&]() {
+                assign(dst, alpha * mDense + beta * mTriang);
+                doNotOptimize(dst(0, 0));
+            }));
+            matrix_triangulaire_sup<T> triangDst(n, n, T{});
+            results.push_back(runBench(config, "axpbyInto/triang+diag", type, size, elements, 0, [&]() {
+                axpbyInto(triangDst, alpha, mTriang, beta, mDiag);
+                doNotOptimize(triangDst(0, 0));
+            }));
+            results.push_back(runBench(config, "scale/dense", type, size, elements, 0, [&]() {
+                dst.scale(T(-1));
+                doNotOptimize(dst(0, 0));
+            }));
+
+            // Vues sans copie (matrix_view.h) sur le quart en haut à gauche, et copies du stockage : copy/ est
+            // une copie profonde, share/ ne fait que partager le bloc (sharedCopy()), share-write/ le recopie à la
+            // première écriture.
+            const std::size_t half = size / 2;
+            const double quarter = static_cast<double>(half) * half;
+            const matrix_dense<T> &cDense = mDense;
+            const matrix_triangulaire_sup<T> &cTriang = mTriang;
+            matrix_dense<T> halfDst(static_cast<int>(half), static_cast<int>(half));
+            results.push_back(runBench(config, "view-add/dense-block+dense", type, size, quarter, 0, [&]() {
+                assign(halfDst, cDense.block(0, 0, half, half) + cDense.block(half, half, half, half));
+                doNotOptimize(halfDst(0, 0));
+            }));
+            results.push_back(runBench(config, "view-trace/dense-block", type, size, static_cast<double>(half), 0,
+                                       [&]() { doNotOptimize(cDense.block(half, half, half, half).trace()); }));
+            results.push_back(runBench(config, "view-trace/triang-rows", type, size, static_cast<double>(half), 0,
+                                       [&]() { doNotOptimize(cTriang.rows(0, half).trace()); }));
+            results.push_back(runBench(config, "copy/dense", type, size, elements, 0, [&]() {
+                matrix_dense<T> copy = mDense;
+                doNotOptimize(copy.getStoredSize());
+            }));
+            results.push_back(runBench(config, "share/dense", type, size, elements, 0, [&]() {
+                matrix_dense<T> copy = sharedCopy(mDense);
+                doNotOptimize(copy.getStoredSize());
+            }));
+            results.push_back(runBench(config, "share-write/dense", type, size, elements, 0, [&]() {
+                matrix_dense<T> copy = sharedCopy(mDense);
+                copy(0, 0) = T(1);
+                doNotOptimize(copy(0, 0));
+            }));
+
+            // Somme et trace indépendantes (matrix_async.h) : l'une après l'autre, puis lancées ensemble.
+            results.push_back(runBench(config, "add+trace/dense+triang", type, size, elements, 0, [&]() {
+                std::unique_ptr<matrix_t_<T>> sum = mDense.add(mTriang);
+                doNotOptimize(sum.get());
+                doNotOptimize(mDense.trace());
+            }));
+            results.push_back(runBench(config, "async-add+trace/dense+triang", type, size, elements, 0, [&]() {
+                matrix_task<std::unique_ptr<matrix_t_<T>>> sum = addAsync<T>(mDense, mTriang);
+                matrix_task<T> trace = traceAsync<T>(mDense);
+                doNotOptimize(sum.get().get());
+                doNotOptimize(trace.get());
+            }));
+
+            // Matrice par blocs [[dense, diag], [vide, triang]] sur des moitiés, contre sa forme dense aplatie.
+            const int h = static_cast<int>(half);
+            matrix_block<T> mBlock({half, size - half}, {half, size - half});
+            fill(mBlock.setTile(0, 0, matrix_dense<T>(h, h)));
+            fill(mBlock.setTile(0, 1, matrix_diag<T>(h, n - h, T{})));
+            fill(mBlock.setTile(1, 1, matrix_triangulaire_sup<T>(n - h, n - h, T{})));
+            const matrix_dense<T> flat = mBlock.toDense();
+            std::unique_ptr<matrix_t_<T>> blockDst = mBlock.add(mBlock);
+            matrix_dense<T> flatDst(n, n);
+            std::vector<T> x(size, T(1)), y(size);
+            results.push_back(runBench(config, "addInto/block+block", type, size, elements, 0, [&]() {
+                addInto(*blockDst, mBlock, mBlock);
+                doNotOptimize(blockDst.get());
+            }));
+            results.push_back(runBench(config, "addInto/block-flat+block-flat", type, size, elements, 0, [&]() {
+                addInto(flatDst, flat, flat);
+                doNotOptimize(flatDst(0, 0));
+            }));
+            results.push_back(runBench(config, "trace/block", type, size, static_cast<double>(size), 0,
+                                       [&]() { doNotOptimize(mBlock.trace()); }));
+            results.push_back(runBench(config, "matvec/block", type, size, elements, 0, [&]() {
+                mBlock.multiplyVector(matrix_span<const T>(x.data(), size), matrix_span<T>(y.data(), size));
+                doNotOptimize(y[0]);
+            }));
+            results.push_back(runBench(config, "matvec/block-flat", type, size, elements, 0, [&]() {
+                flat.multiplyVector(matrix_span<const T>(x.data(), size), matrix_span<T>(y.data(), size));
+                doNotOptimize(y[0]);
+            }));
+        }
+
+        for (auto &lhs : matrices) {
+            for (auto &rhs : matrices) {
+                std::unique_ptr<matrix_t_<T>> dst = lhs.second->add(*lhs.second, *rhs.second);
+                double elements = static_cast<double>(size) * size;
+                double bytes = static_cast<double>(lhs.second->getStoredSize() + rhs.second->getStoredSize() +
+                                                   dst->getStoredSize()) * sizeof(T);
+                results.push_back(runBench(config, "addInto/" + lhs.first + "+" + rhs.first, type, size, elements,
+                                           bytes, [&]() {
+                                               addInto(*dst, *lhs.second, *rhs.second);
+                                               doNotOptimize(dst.get());
+                                           }));
+            }
+        }
+
+        if (size <= config.maxMultiplySize) {
+            for (auto &lhs : matrices) {
+                for (auto &rhs : matrices) {
+                    double elements = static_cast<double>(size) * size;
+                    results.push_back(runBench(config, "multiply/" + lhs.first + "*" + rhs.first, type, size, elements,
+                                               0, [&]() {
+                                                   std::unique_ptr<matrix_t_<T>> r = lhs.second->multiply(
+                                                           *lhs.second, *rhs.second);
+                                                   doNotOptimize(r.get());
+                                               }));
+                }
+            }
+
+            // Remontée sur 64 seconds membres, avec la triangulaire telle quelle puis avec un valInf non nul.
+            if (!std::is_integral<T>::value) {
+                matrix_triangulaire_sup<T> system(mTriang);
+                for (std::size_t i = 0; i < size; i++)
+                    system(i, i) = static_cast<T>(size + 1);
+                matrix_dense<T> rhs(n, 64), x(n, 64);
+                fill(rhs);
+                double elements = static_cast<double>(size) * size * 64 / 2;
+                for (T valInf : {T{}, T(1)}) {
+                    system.setValInf(valInf);
+                    results.push_back(runBench(config, valInf == T{} ? "solve/triang" : "solve/triang-valInf", type,
+                                               size, elements, 0, [&]() {
+                                                   x = rhs;
+                                                   system.solveInPlace(x);
+                                                   doNotOptimize(x(0, 0));
+                                               }));
+                }
+            }
+        }
+    }
+}
+
+// Petites matrices N x N : un lot de smallBatch sommes dense + triangulaire, avec les classes dynamiques
+// (appels virtuels, allocation du résultat), avec matrix_value (dispatch statique) puis avec matrix_fixed.
+constexpr std::size_t smallBatch = 4096;
+
+template<typename T, std::size_t N>
+void benchSmall(const bench_config &config, std::vector<bench_result> &results) {
+    const std::string type = type_name<T>::get();
+    std::vector<matrix_dense<T>> dense;
+    std::vector<matrix_triangulaire_sup<T>> triang;
+    std::vector<matrix_dense_fixed<T, N, N>> denseFixed(smallBatch);
+    std::vector<matrix_triangulaire_sup_fixed<T, N, N>> triangFixed(smallBatch);
+    for (std::size_t k = 0; k < smallBatch; k++) {
+        dense.emplace_back(static_cast<int>(N), static_cast<int>(N));
+        triang.emplace_back(static_cast<int>(N), static_cast<int>(N), T{});
+        fill(dense.back());
+        fill(triang.back());
+        for (std::size_t i = 0; i < N; i++)
+            for (std::size_t j = 0; j < N; j++) {
+                denseFixed[k](i, j) = dense.back()(i, j);
+                if (i <= j)
+                    triangFixed[k](i, j) = triang.back()(i, j);
+            }
+    }
+    const double elements = static_cast<double>(smallBatch) * N * N;
+
+    results.push_back(runBench(config, "small-add/dense+triang", type, N, elements, 0, [&]() {
+        for (std::size_t k = 0; k < smallBatch; k++) {
+            std::unique_ptr<matrix_t_<T>> r = dense[k].add(dense[k], triang[k]);
+            doNotOptimize(r.get());
+        }
+    }));
+    std::vector<matrix_value<T>> denseValues(dense.begin(), dense.end());
+    std::vector<matrix_value<T>> triangValues(triang.begin(), triang.end());
+    std::vector<matrix_value<T>> sums(smallBatch, matrix_dense<T>(static_cast<int>(N), static_cast<int>(N)));
+    results.push_back(runBench(config, "small-add-value/dense+triang", type, N, elements, 0, [&]() {
+        for (std::size_t k = 0; k < smallBatch; k++) {
+            matrix_value<T> r = denseValues[k] + triangValues[k];
+            doNotOptimize(r);
+        }
+    }));
+    results.push_back(runBench(config, "small-addInto-value/dense+triang", type, N, elements, 0, [&]() {
+        for (std::size_t k = 0; k < smallBatch; k++) {
+            addInto(sums[k], denseValues[k], triangValues[k]);
+            doNotOptimize(sums[k]);
+        }
+    }));
+    results.push_back(runBench(config, "small-add-fixed/dense+triang", type, N, elements, 0, [&]() {
+        for (std::size_t k = 0; k < smallBatch; k++) {
+            matrix_dense_fixed<T, N, N> r = denseFixed[k] + triangFixed[k];
+            doNotOptimize(r);
+        }
+    }));
+    results.push_back(runBench(config, "small-trace/dense", type, N, static_cast<double>(smallBatch) * N, 0, [&]() {
+        T sum = {};
+        for (std::size_t k = 0; k < smallBatch; k++)
+            sum += dense[k].trace();
+        doNotOptimize(sum);
+    }));
+    results.push_back(runBench(config, "small-trace-fixed/dense", type, N, static_cast<double>(smallBatch) * N, 0,
+                               [&]() {
+                                   T sum = {};
+                                   for (std::size_t k = 0; k < smallBatch; k++)
+                                       sum += denseFixed[k].trace();
+                                   doNotOptimize(sum);
+                               }));
+
+    matrix_dense_batch<T> denseBatch(smallBatch, static_cast<int>(N), static_cast<int>(N));
+    matrix_triangulaire_sup_batch<T> triangBatch(smallBatch, static_cast<int>(N), static_cast<int>(N));
+    matrix_dense_batch<T> sumBatch(smallBatch, static_cast<int>(N), static_cast<int>(N));
+    for (std::size_t k = 0; k < smallBatch; k++) {
+        denseBatch.set(k, dense[k]);
+        triangBatch.set(k, triang[k]);
+    }
+    results.push_back(runBench(config, "small-add-batch/dense+triang", type, N, elements, 0, [&]() {
+        addInto(sumBatch, denseBatch, triangBatch);
+        doNotOptimize(sumBatch);
+    }));
+    std::vector<T> traces(smallBatch);
+    results.push_back(runBench(config, "small-trace-batch/dense", type, N, static_cast<double>(smallBatch) * N, 0,
+                               [&]() {
+                                   denseBatch.trace({traces.data(), traces.size()});
+                                   doNotOptimize(traces);
+                               }));
+    matrix_dense_batch<T> xs(smallBatch, static_cast<int>(N), 1);
+    matrix_dense_batch<T> ys(smallBatch, static_cast<int>(N), 1);
+    for (std::size_t k = 0; k < smallBatch; k++)
+        for (std::size_t i = 0; i < N; i++)
+            xs.lane(i).data()[k] = static_cast<T>(1 + (i + k) % 7);
+    results.push_back(runBench(config, "small-matvec-batch/dense", type, N, elements, 0, [&]() {
+        denseBatch.multiplyVector(xs, ys);
+        doNotOptimize(ys);
+    }));
+}
+
+void printResult(const bench_result &r) {
+    double seconds = r.medianNs * 1e-9;
+    std::cout << r.name << "\t" << r.type << "\t" << r.size << "x" << r.size
+              << "\tmin " << r.minNs / 1000 << " µs"
+              << "\tmedian " << r.medianNs / 1000 << " µs"
+              << "\tp99 " << r.p99Ns / 1000 << " µs"
+              << "\t" << r.elements / seconds / 1e6 << " Melem/s"
+              << "\t" << r.allocations << " alloc";
+    if (r.bytes > 0)
+        std::cout << "\t" << r.bytes / seconds / 1e9 << " GB/s";
+    std::cout << "\n";
+}
+
+void writeJson(const std::string &path, const bench_config &config, const std::vector<bench_result> &results) {
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("cannot open " + path);
+
+    out << "{\n";
+    out << "  \"warmup\": " << config.warmup << ",\n";
+    out << "  \"iterations\": " << config.iterations << ",\n";
+    out << "  \"threads\": " << thread_pool::global().size() << ",\n";
+    out << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const bench_result &r = results[i];
+        double seconds = r.medianNs * 1e-9;
+        out << "    {\"name\": \"" << r.name << "\", \"type\": \"" << r.type << "\", \"size\": " << r.size
+            << ", \"iterations\": " << r.iterations
+            << ", \"min_ns\": " << r.minNs << ", \"median_ns\": " << r.medianNs << ", \"p99_ns\": " << r.p99Ns
+            << ", \"allocations\": " << r.allocations
+            << ", \"elements_per_s\": " << r.elements / seconds
+            << ", \"gb_per_s\": " << (r.bytes > 0 ? r.bytes / seconds / 1e9 : 0) << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+bench_config parseArgs(int argc, char **argv) {
+    bench_config config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::runtime_error("missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--warmup")
+            config.warmup = std::stoul(value);
+        else if (arg == "--iterations")
+            config.iterations = std::stoul(value);
+        else if (arg == "--min-size")
+            config.minSize = std::stoul(value);
+        else if (arg == "--max-size")
+            config.maxSize = std::stoul(value);
+        else if (arg == "--max-print-size")
+            config.maxPrintSize = std::stoul(value);
+        else if (arg == "--max-multiply-size")
+            config.maxMultiplySize = std::stoul(value);
+        else if (arg == "--threads")
+            config.threads = std::stoul(value);
+        else if (arg == "--json")
+            config.jsonPath = value;
+        else if (arg == "--stats")
+            config.statsPath = value;
+        else
+            throw std::runtime_error("unknown option " + arg);
+    }
+    if (config.iterations == 0 || config.minSize == 0)
+        throw std::runtime_error("iterations and sizes must be positive.");
+    return config;
+}
+
+int main(int argc, char **argv) {
+    bench_config config;
+    try {
+        config = parseArgs(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << "usage: tp5_bench [--warmup N] [--iterations N] [--min-size N] [--max-size N] "
+                     "[--max-print-size N] [--max-multiply-size N] [--threads N] [--json file] [--stats file]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    thread_pool::setGlobalThreadCount(config.threads);
+
+    std::vector<bench_result> results;
+    benchType<int>(config, results);
+    benchType<double>(config, results);
+    benchSmall<double, 3>(config, results);
+    benchSmall<double, 4>(config, results);
+
+    for (const bench_result &r : results)
+        printResult(r);
+
+    writeJson(config.jsonPath, config, results);
+    std::cout << "results written to " << config.jsonPath << std::endl;
+
+    if (matrix_stats::enabled) {
+        std::ofstream stats(config.statsPath);
+        if (!stats)
+            throw std::runtime_error("cannot open " + config.statsPath);
+        matrix_stats::writeJson(stats);
+        std::cout << "counters written to " << config.statsPath << std::endl;
+    }
+
+    return 0;
+}
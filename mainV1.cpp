@@ -39,7 +39,6 @@ un objet polymorphe depuis cette fonction membre ?
 */
 #include <iostream>
 #include <vector>
-#include <chrono>
 #include <memory>
 #include <numeric>
 #include <complex>
@@ -183,74 +182,12 @@ public:
     }
 };
 
-void testPerformance() {
-
-    for (unsigned int i = 10; i <= 14; i++) {
-        int size = std::pow(2, i);
-        matrix_dense<int> m_dense = {size, size};
-        matrix_triangulaire_sup<int> m_triang = {size, size, 0};
-        matrix_diag<int> m_diag = {size, size, 0};
-
-        std::cout << "======SIZE " << size << 'x' << size << "========" << std::endl;
-
-        auto start = std::chrono::steady_clock::now();
-        auto trace = m_dense.trace();
-        auto end = std::chrono::steady_clock::now();
-
-        std::cout << "Trace matrix dense of : " << trace << ", calculated in "
-                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-                  << " µs" << std::endl;
-
-        start = std::chrono::steady_clock::now();
-        trace = m_triang.trace();
-        end = std::chrono::steady_clock::now();
-
-        std::cout << "Trace matrix triang sup : " << trace << ", calculated in "
-                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-                  << " µs" << std::endl;
-        start = std::chrono::steady_clock::now();
-        trace = m_diag.trace();
-        end = std::chrono::steady_clock::now();
-
-        std::cout << "Trace matrix diagonal : " << trace << ", calculated in "
-                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-                  << " µs" << std::endl;
-
-        std::cout << std::endl;
-    }
-}
-
-
 int main() {
 
-    testPerformance();
-
     /*
-        ======SIZE 1024x1024========
-        Trace matrix dense of : 0, calculated in 52 µs
-        Trace matrix triang sup : 0, calculated in 29 µs
-        Trace matrix diagonal : 0, calculated in 11 µs
-
-        ======SIZE 2048x2048========
-        Trace matrix dense of : 0, calculated in 116 µs
-        Trace matrix triang sup : 0, calculated in 106 µs
-        Trace matrix diagonal : 0, calculated in 23 µs
-
-        ======SIZE 4096x4096========
-        Trace matrix dense of : 0, calculated in 214 µs
-        Trace matrix triang sup : 0, calculated in 225 µs
-        Trace matrix diagonal : 0, calculated in 45 µs
-
-        ======SIZE 8192x8192========
-        Trace matrix dense of : 0, calculated in 440 µs
-        Trace matrix triang sup : 0, calculated in 434 µs
-        Trace matrix diagonal : 0, calculated in 89 µs
-
-        ======SIZE 16384x16384========
-        Trace matrix dense of : 0, calculated in 1169 µs
-        Trace matrix triang sup : 0, calculated in 897 µs
-        Trace matrix diagonal : 0, calculated in 222 µs
-    */
+        Les mesures de performances de trace() (question 5) sont faites par la cible tp5_bench (bench.cpp), qui
+        couvre aussi print(), operator()(i,j) et add(), avec warmup, iterations repetees et export JSON.
+     */
 
     return 0;
 }
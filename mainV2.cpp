@@ -38,381 +38,17 @@ un objet polymorphe depuis cette fonction membre ?
 
 */
 #include <iostream>
-#include <vector>
-#include <chrono>
-#include <memory>
-#include <numeric>
-#include <complex>
-
-
-template<typename T>
-class matrix_dense;
-
-template<typename T>
-class matrix_triangulaire_sup;
-
-template<typename T>
-class matrix_diag;
-
-template<typename T>
-class matrix_t_ {
-protected:
-    std::size_t height;
-    std::size_t width;
-    std::vector<T> data;
-
-public:
-    matrix_t_(int height, int width) : height(height), width(width) {}
-
-    virtual T &operator()(std::size_t const &, std::size_t const &) = 0;
-
-    virtual const T &operator()(std::size_t const &, std::size_t const &) const = 0;
-
-    virtual void print() {
-        for (std::size_t i = 0; i < height; i++) {
-            for (std::size_t j = 0; j < width; j++)
-                std::cout << (*this)(i, j) << "\t";
-            std::cout << std::endl;
-        }
-    }
-
-    virtual T trace() {
-        T sum = {};
-        for (std::size_t i = 0; i < std::min(height, width); i++) {
-            sum += (*this)(i, i);
-        }
-        return sum;
-    }
-
-    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) = 0;
-
-    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const = 0;
-
-    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m) const = 0;
-
-    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m) const = 0;
-
-    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m) const = 0;
-
-    size_t getHeight() const {
-        return height;
-    }
-
-    size_t getWidth() const {
-        return width;
-    }
-};
-
-
-template<typename T>
-class matrix_dense : public matrix_t_<T> {
-
-public:
-    matrix_dense(int height, int width) : matrix_t_<T>(height, width) {
-        this->data = std::vector<T>(height * width);
-    }
-
-    T &operator()(std::size_t const &row, std::size_t const &col) override {
-        if (row < this->height && col < this->width)
-            return this->data[row + (col * this->height)];
-        else
-            throw std::out_of_range("Out of range.");
-    }
-
-    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
-        if (row < this->height && col < this->width)
-            return this->data[row + (col * this->height)];
-        else
-            throw std::out_of_range("Out of range.");
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
-        return m1.add(m2);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
-        return m.add(*this);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        matrix_dense<T> result(m1);
-        for (std::size_t i = 0; i < m1.height; i++)
-            for (std::size_t j = 0; j < m1.width; j++)
-                result(i, j) += (*this)(i, j);
-        return std::make_unique<matrix_dense<T>>(result);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        matrix_dense<T> result(this->height, this->width);
-        for (std::size_t i = 0; i < this->height; i++)
-            for (std::size_t j = 0; j < this->width; j++)
-                result(i, j) = (*this)(i, j) + (m1)(i, j);
-        return std::make_unique<matrix_dense<T>>(result);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        matrix_dense<T> result(this->height, this->width);
-        for (std::size_t i = 0; i < result.height; i++)
-            for (std::size_t j = 0; j < this->width; j++)
-                result(i, j) = (*this)(i, j) + (m1)(i, j);
-        return std::make_unique<matrix_dense<T>>(result);
-    }
-};
-
-template<typename T>
-class matrix_triangulaire_sup : public matrix_t_<T> {
-private:
-    T valInf;
-
-public:
-    matrix_triangulaire_sup(int height, int width, T valInf) : matrix_t_<T>(height, width), valInf(valInf) {
-        std::size_t size;
-        if (height >= width)
-            size = (width * (width + 1) / 2);
-        else
-            size = (width * (width + 1) / 2) - (std::abs(height - width) * ((std::abs(height - width) + 1)) / 2);
-        this->data = std::vector<T>(size);
-    }
-
-    T &operator()(std::size_t const &row, std::size_t const &col) override {
-        if (row < this->height && col < this->width) {
-            if (row > col)
-                return valInf;
-            else {
-                return this->data[col + row * this->width - (row * (row + 1)) / 2];
-            }
-        } else
-            throw std::out_of_range("Out of range.");
-    }
-
-    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
-        if (row < this->height && col < this->width) {
-            if (row > col)
-                return valInf;
-            else {
-                return this->data[col + row * this->width - (row * (row + 1)) / 2];
-            }
-        } else
-            throw std::out_of_range("Out of range.");
-    }
-
-    T trace() override {
-        T sum = {};
-        for (std::size_t i = 0, j = 0; i < std::min(this->height, this->width); j += this->width - i, i++) {
-            sum += this->data[j];
-        }
-        return sum;
-    }
-
-    void print() override {
-        for (std::size_t i = 0; i < this->height; i++) {
-            for (std::size_t j = 0; j < this->width; j++) {
-                if (i <= j)
-                    std::cout << (*this)(i, j) << "\t";
-                else
-                    std::cout << valInf << "\t";
-            }
-            std::cout << std::endl;
-        }
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
-        return m1.add(m2);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
-        return m.add(*this);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        return m1.add(*this);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        matrix_triangulaire_sup<T> result(m1);
-        for (std::size_t i = 0; i < m1.height; i++) {
-            for (std::size_t j = i; j < m1.width; j++)
-                result(i, j) += (*this)(i, j);
-        }
-        result.valInf += this->valInf;
-        return std::make_unique<matrix_triangulaire_sup<T>>(result);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        matrix_triangulaire_sup<T> result(this->height, this->width, m1.getDefaultVal());
-        for (std::size_t i = 0; i < this->height; i++) {
-            for (std::size_t j = i; j < this->width; j++)
-                result(i, j) = m1(i, j) + (*this)(i, j);
-        }
-        result.valInf += m1.getDefaultVal();
-        return std::make_unique<matrix_triangulaire_sup<T>>(result);
-    }
-};
-
-template<typename T>
-class matrix_diag : public matrix_t_<T> {
-private:
-    T defaultVal;
-
-public:
-    matrix_diag(int height, int width, T defaultVal) : matrix_t_<T>(height, width), defaultVal(defaultVal) {
-        this->data = std::vector<T>(std::min(height, width));
-    }
-
-    T &operator()(std::size_t const &row, std::size_t const &col) override {
-        if (row < this->height && col < this->width) {
-            if (row != col)
-                return defaultVal;
-            else {
-                return this->data[row];
-            }
-        } else
-            throw std::out_of_range("Out of range.");
-    }
-
-    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
-        if (row < this->height && col < this->width) {
-            if (row != col)
-                return defaultVal;
-            else {
-                return this->data[row];
-            }
-        } else
-            throw std::out_of_range("Out of range.");
-    }
-
-
-    T trace() override {
-        return std::accumulate(this->data.begin(), this->data.end(), 0);
-    }
-
-
-    void print() override {
-        for (std::size_t i = 0; i < this->height; i++) {
-            for (std::size_t j = 0; j < this->width; j++) {
-                if (i == j)
-                    std::cout << (*this)(i, j) << "\t";
-                else
-                    std::cout << defaultVal << "\t";
-            }
-            std::cout << std::endl;
-        }
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
-        return m1.add(m2);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
-        return m.add(*this);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        return m1.add(*this);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        return m1.add(*this);
-    }
-
-    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
-        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
-            throw std::runtime_error("matrix are not the same size.");
-        matrix_diag<T> result(m1);
-        for (std::size_t i = 0; i < this->data.size(); i++)
-            result.data[i] += this->data[i];
-        result.defaultVal += this->defaultVal;
-        return std::make_unique<matrix_diag<T>>(result);
-    }
-
-    T getDefaultVal() const {
-        return defaultVal;
-    }
-};
-
-void testPerformance() {
-
-    for (unsigned int i = 10; i <= 14; i++) {
-        int size = std::pow(2, i);
-        matrix_dense<int> m_dense = {size, size};
-        matrix_triangulaire_sup<int> m_triang = {size, size, 0};
-        matrix_diag<int> m_diag = {size, size, 0};
-
-        std::cout << "======SIZE " << size << 'x' << size << "========" << std::endl;
-
-        auto start = std::chrono::steady_clock::now();
-        auto trace = m_dense.trace();
-        auto end = std::chrono::steady_clock::now();
-
-        std::cout << "Trace matrix dense of : " << trace << ", calculated in "
-                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-                  << " µs" << std::endl;
-
-        start = std::chrono::steady_clock::now();
-        trace = m_triang.trace();
-        end = std::chrono::steady_clock::now();
-
-        std::cout << "Trace matrix triang sup : " << trace << ", calculated in "
-                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-                  << " µs" << std::endl;
-        start = std::chrono::steady_clock::now();
-        trace = m_diag.trace();
-        end = std::chrono::steady_clock::now();
-
-        std::cout << "Trace matrix diagonal : " << trace << ", calculated in "
-                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-                  << " µs" << std::endl;
-
-        std::cout << std::endl;
-    }
-}
 
+#include "matrix.h"
+#include "matrix_expr.h"
+#include "matrix_fixed.h"
+#include "matrix_value.h"
 
 int main() {
 
-    testPerformance();
-
     /*
-        ======SIZE 1024x1024========
-        Trace matrix dense of : 0, calculated in 51 µs
-        Trace matrix triang sup : 0, calculated in 37 µs
-        Trace matrix diagonal : 0, calculated in 11 µs
-
-        ======SIZE 2048x2048========
-        Trace matrix dense of : 0, calculated in 125 µs
-        Trace matrix triang sup : 0, calculated in 61 µs
-        Trace matrix diagonal : 0, calculated in 20 µs
-
-        ======SIZE 4096x4096========
-        Trace matrix dense of : 0, calculated in 244 µs
-        Trace matrix triang sup : 0, calculated in 133 µs
-        Trace matrix diagonal : 0, calculated in 42 µs
-
-        ======SIZE 8192x8192========
-        Trace matrix dense of : 0, calculated in 472 µs
-        Trace matrix triang sup : 0, calculated in 288 µs
-        Trace matrix diagonal : 0, calculated in 80 µs
-
-        ======SIZE 16384x16384========
-        Trace matrix dense of : 0, calculated in 1413 µs
-        Trace matrix triang sup : 0, calculated in 828 µs
-        Trace matrix diagonal : 0, calculated in 166 µs
+        Les mesures de performances de trace(), print(), operator()(i,j) et add() sont dans bench.cpp
+        (cible tp5_bench), avec warmup, iterations repetees et export JSON.
      */
 
     matrix_dense<int> mtxDense(4, 4);
@@ -499,5 +135,83 @@ int main() {
     mtxDense.add(mtxDiag, mtxDiag)->print();
     std::cout << std::endl;
 
+    std::cout << "===DENSE * DENSE===" << std::endl;
+    mtxDense.print();
+    std::cout << "\t*" << std::endl;
+    mtxDense.print();
+    std::cout << "\t=" << std::endl;
+    mtxDense.multiply(mtxDense, mtxDense)->print();
+    std::cout << std::endl;
+
+    std::cout << "===TRIANG * TRIANG===" << std::endl;
+    mtxTriangSup.print();
+    std::cout << "\t*" << std::endl;
+    mtxTriangSup.print();
+    std::cout << "\t=" << std::endl;
+    mtxDense.multiply(mtxTriangSup, mtxTriangSup)->print();
+    std::cout << std::endl;
+
+    std::cout << "===DIAG * DENSE===" << std::endl;
+    mtxDiag.print();
+    std::cout << "\t*" << std::endl;
+    mtxDense.print();
+    std::cout << "\t=" << std::endl;
+    mtxDense.multiply(mtxDiag, mtxDense)->print();
+    std::cout << std::endl;
+
+    std::cout << "===DENSE += DIAG===" << std::endl;
+    matrix_dense<int> mtxAcc(mtxDense);
+    mtxAcc += mtxDiag;
+    mtxAcc.print();
+    std::cout << std::endl;
+
+    matrix_csr<int> mtxCsr(4, 4);
+    mtxCsr(0, 3) = 1;
+    mtxCsr(2, 0) = 2;
+    mtxCsr(3, 1) = 3;
+
+    std::cout << "===CSR + DIAG===" << std::endl;
+    mtxCsr.print();
+    std::cout << "\t+" << std::endl;
+    mtxDiag.print();
+    std::cout << "\t=" << std::endl;
+    mtxDense.add(mtxCsr, mtxDiag)->print();
+    std::cout << std::endl;
+
+    matrix_band<int> mtxBand(4, 4, 1, 1);
+    for (std::size_t i = 0; i < 4; i++) {
+        mtxBand(i, i) = 2;
+        if (i > 0)
+            mtxBand(i, i - 1) = -1;
+        if (i < 3)
+            mtxBand(i, i + 1) = -1;
+    }
+
+    std::cout << "===BAND + DIAG===" << std::endl;
+    mtxBand.print();
+    std::cout << "\t+" << std::endl;
+    mtxDiag.print();
+    std::cout << "\t=" << std::endl;
+    mtxBand.add(mtxBand, mtxDiag)->print();
+    std::cout << std::endl;
+
+    constexpr auto fixedDense = matrix_dense_fixed<int, 3, 3>::fromRows({{{{1, 2, 3}}, {{4, 5, 6}}, {{7, 8, 9}}}});
+    constexpr auto fixedDiag = matrix_diag_fixed<int, 3, 3>::fromRows({{{{1, 0, 0}}, {{0, 2, 0}}, {{0, 0, 3}}}});
+    constexpr auto fixedSum = fixedDense + fixedDiag;
+    static_assert(fixedSum.trace() == 21, "the fixed-size sum is computed at compile time.");
+
+    std::cout << "===DENSE + DIAG (3x3 fixed)===" << std::endl;
+    fixedSum.print();
+    std::cout << std::endl;
+
+    std::cout << "===TRIANG + DIAG (matrix_value)===" << std::endl;
+    matrix_value<int> valueSum = matrix_value<int>(mtxTriangSup) + matrix_value<int>(mtxDiag);
+    asMatrix(valueSum).print();
+    std::cout << std::endl;
+
+    std::cout << "===DENSE + TRIANG - 2 * DIAG (expression)===" << std::endl;
+    evaluate(mtxDense + mtxTriangSup - 2 * mtxDiag).print();
+    std::cout << std::endl;
+
     return 0;
 }
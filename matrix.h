@@ -0,0 +1,5119 @@
+#ifndef TP5_MATRIX_H
+#define TP5_MATRIX_H
+
+#include <array>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <numeric>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <typeinfo>
+#include <type_traits>
+
+#include "matrix_kernels.h"
+#include "matrix_reduce.h"
+#include "matrix_span.h"
+#include "matrix_stats.h"
+#include "matrix_storage.h"
+#include "matrix_view.h"
+#include "matrix_writer.h"
+#include "thread_pool.h"
+
+template<typename T>
+class matrix_dense;
+
+template<typename T>
+class matrix_triangulaire_sup;
+
+template<typename T>
+class matrix_diag;
+
+template<typename T>
+class matrix_csr;
+
+template<typename T>
+class matrix_band;
+
+template<typename T>
+class matrix_triangulaire_inf;
+
+template<typename T>
+class matrix_symmetric;
+
+template<typename T>
+class matrix_block;
+
+// Disposition du stockage d'une matrix_dense, choisie à la construction. tiled : tuiles carrées de
+// matrix_dense<T>::layoutTile de côté, rangées tuile par tuile (colonnes de tuiles de gauche à droite, tuiles
+// de haut en bas), chacune en column-major ; les tuiles du bord droit et du bas sont tronquées.
+enum class dense_layout {
+    column_major,
+    row_major,
+    tiled
+};
+
+template<typename T>
+class matrix_t_ {
+    // Les noyaux d'une classe fille lisent directement le stockage compact de l'autre opérande.
+    template<typename> friend class matrix_dense;
+
+    template<typename> friend class matrix_triangulaire_sup;
+
+    template<typename> friend class matrix_diag;
+
+    template<typename> friend class matrix_csr;
+
+    template<typename> friend class matrix_band;
+
+    template<typename> friend class matrix_triangulaire_inf;
+
+    template<typename> friend class matrix_symmetric;
+
+    template<typename> friend class matrix_block;
+
+protected:
+    std::size_t height;
+    std::size_t width;
+    matrix_storage<T> data;
+
+public:
+    matrix_t_(int height, int width) : height(height), width(width) {}
+
+    virtual ~matrix_t_() = default;
+
+    // Le destructeur virtuel supprime le déplacement implicite : sans ces déclarations, std::move et les
+    // retours par valeur d'une matrice copieraient tout le stockage.
+    matrix_t_(const matrix_t_ &) = default;
+
+    matrix_t_(matrix_t_ &&) noexcept = default;
+
+    matrix_t_ &operator=(const matrix_t_ &) = default;
+
+    matrix_t_ &operator=(matrix_t_ &&) noexcept = default;
+
+    virtual T &operator()(std::size_t const &, std::size_t const &) = 0;
+
+    virtual const T &operator()(std::size_t const &, std::size_t const &) const = 0;
+
+    // Affiche la matrice sur std::cout, au format tsv de write().
+    virtual void print() {
+        TP5_STATS_SCOPE(matrix_stats::op::print, statsKind(*this), height * width);
+        matrix_writer out(std::cout, std::min(std::size_t{matrix_writer::defaultCapacity}, 16 * height * width));
+        out.precision(static_cast<int>(std::cout.precision()));
+        write(out, matrix_text_format::tsv);
+    }
+
+    // Écrit la matrice en texte dans out. Cette version passe par operator()(i,j) ; les classes filles
+    // écrivent directement depuis leur stockage.
+    virtual void write(matrix_writer &out, matrix_text_format format) const {
+        if (format == matrix_text_format::matrix_market) {
+            writeMarketArray(out);
+            return;
+        }
+        const char separator = separatorOf(format);
+        for (std::size_t i = 0; i < height; i++) {
+            for (std::size_t j = 0; j < width; j++) {
+                out.value((*this)(i, j));
+                out.put(separator);
+            }
+            endRow(out, format);
+        }
+    }
+
+    // Trace en somme pairwise (voir matrix_reduce.h), et traceSum() pour choisir la sommation.
+    virtual T trace() {
+        TP5_STATS_SCOPE(matrix_stats::op::trace, statsKind(*this), std::min(height, width));
+        return traceSum(reduce::summation::pairwise);
+    }
+
+    // Cette version passe par operator()(i,i) ; les classes filles lisent la diagonale dans leur stockage.
+    virtual T traceSum(reduce::summation mode) const {
+        return reduce::parallelSum<T>(std::min(height, width), traceGrain, mode,
+                                      [this](std::size_t i) { return (*this)(i, i); });
+    }
+
+    // Réductions sur tous les éléments. Seuls les éléments stockés sont parcourus : la valeur constante hors
+    // du stockage (valInf, defaultVal, valSup) compte pour toutes ses cases en O(1), et les zéros structurels
+    // des matrices creuses et bandes ne sont pas lus. Une matrice symétrique compte deux fois ses éléments
+    // stockés hors diagonale.
+    virtual T sum(reduce::summation mode = reduce::summation::pairwise) const {
+        reduce::compensated<T> result;
+        result.add(reduce::parallelSum(data.data(), data.size(), mode));
+        result.add(fillValue() * static_cast<T>(fillCount()));
+        return result.value();
+    }
+
+    // Norme de Frobenius : racine de la somme des |a(i, j)|².
+    virtual reduce::norm_t<T> normFrobenius(reduce::summation mode = reduce::summation::pairwise) const {
+        reduce::compensated<reduce::norm_t<T>> result;
+        result.add(reduce::parallelSumSquares(data.data(), data.size(), mode));
+        result.add(reduce::squaredMagnitude(fillValue()) * static_cast<reduce::norm_t<T>>(fillCount()));
+        return std::sqrt(result.value());
+    }
+
+    // Plus grand |a(i, j)|.
+    virtual reduce::norm_t<T> normMax() const {
+        const reduce::norm_t<T> stored = reduce::parallelMaxMagnitude(data.data(), data.size());
+        return fillCount() > 0 ? std::max(stored, reduce::magnitude(fillValue())) : stored;
+    }
+
+    // Norme 1 : plus grande somme des |a(i, j)| d'une colonne. Cette version passe par operator()(i,j).
+    virtual reduce::norm_t<T> norm1(reduce::summation mode = reduce::summation::pairwise) const {
+        return maxColumn([this, mode](std::size_t j) {
+            return reduce::sum<reduce::norm_t<T>>(0, height, [this, j](std::size_t i) {
+                return reduce::magnitude((*this)(i, j));
+            }, mode).value();
+        });
+    }
+
+    // Produit scalaire de Frobenius : somme des a(i, j) * m(i, j), sans conjugaison. Cette version passe par
+    // operator()(i,j) ; les classes filles ne parcourent que leurs éléments stockés, ou les stockages des deux
+    // matrices quand elles ont la même structure.
+    virtual T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const {
+        checkSameSize(m);
+        const std::size_t h = height;
+        return reduce::parallelSum<T>(height * width, thread_pool::defaultGrain, mode, [this, &m, h](std::size_t k) {
+            return (*this)(k % h, k / h) * m(k % h, k / h);
+        });
+    }
+
+    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m) const = 0;
+
+    // Variantes sans allocation : addInto(dst, m) écrit (*this) + m dans dst, qui doit avoir le type que
+    // renverrait add() (dense, triangulaire, diagonale, CSR ou bande). dst peut être l'un des deux opérandes.
+    // Une destination CSR ou bande reçoit un nouveau stockage dès que sa structure change.
+    virtual void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const = 0;
+
+    virtual void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m) const = 0;
+
+    virtual void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m) const = 0;
+
+    virtual void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m) const = 0;
+
+    virtual void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m) const = 0;
+
+    virtual void addInto(matrix_t_<T> &dst, const matrix_band<T> &m) const = 0;
+
+    matrix_t_<T> &operator+=(const matrix_t_<T> &m) {
+        m.addInto(*this, *this);
+        return *this;
+    }
+
+    // (*this) = alpha * (*this) en place, en une passe sur le stockage. Les classes qui ont une valeur hors de
+    // la partie stockée (valInf, defaultVal, valSup) la multiplient aussi.
+    virtual void scale(T alpha) {
+        T *d = data.data();
+        thread_pool::global().parallelFor(0, data.size(), thread_pool::defaultGrain,
+                                          [=](std::size_t first, std::size_t last) {
+                                              kernels::scale(alpha, d + first, last - first);
+                                          });
+    }
+
+    matrix_t_<T> &operator*=(T alpha) {
+        scale(alpha);
+        return *this;
+    }
+
+    // multiply(m1, m2) renvoie m1 * m2. Le produit n'est pas commutatif : multiply(m) calcule (*this) * m en
+    // appelant m.multiplyLeft(*this), et multiplyLeft(m) calcule m * (*this) une fois les deux types connus.
+    virtual std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m) const = 0;
+
+    virtual std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m) const = 0;
+
+    // Transposée, dans la structure propre à chaque classe (la transposée d'une triangulaire sup est une
+    // matrix_triangulaire_inf). Les classes filles ont aussi transposed(), qui renvoie le type exact.
+    virtual std::unique_ptr<matrix_t_<T>> transpose() const = 0;
+
+    // y = alpha * (*this) * x + beta * y, x ayant width éléments et y height. Avec beta nul, y n'est pas lu ;
+    // x et y ne doivent pas se recouvrir. Cette version passe par operator()(i,j) ; les classes filles
+    // parcourent directement leur stockage.
+    virtual void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const {
+        checkVectors(x.size(), y.size());
+        kernels::scale(beta, y.data(), height);
+        for (std::size_t j = 0; j < width; j++) {
+            const T xj = alpha * x[j];
+            for (std::size_t i = 0; i < height; i++)
+                y[i] += (*this)(i, j) * xj;
+        }
+    }
+
+    // Même produit pour plusieurs vecteurs à la fois : les colonnes de x (width x count) et celles de y
+    // (height x count). Les classes filles lisent la matrice une fois pour tous les vecteurs, par tuiles qui
+    // restent en cache ; par défaut, un multiplyVector() par colonne.
+    virtual void multiplyVectors(const matrix_dense<T> &x, matrix_dense<T> &y, T alpha = T(1), T beta = T{}) const {
+        checkVectorBatch(x, y);
+        if (!vectorsColumnMajor(x, y, alpha, beta))
+            return;
+        for (std::size_t c = 0; c < x.getWidth(); c++)
+            multiplyVector(x.column(c), y.column(c), alpha, beta);
+    }
+
+    size_t getHeight() const {
+        return height;
+    }
+
+    size_t getWidth() const {
+        return width;
+    }
+
+    // Nombre d'éléments stockés ; une matrix_block compte ceux de ses tuiles.
+    virtual size_t getStoredSize() const {
+        return data.size();
+    }
+
+    // Accès direct au stockage compact, dans l'ordre propre à chaque classe.
+    matrix_span<T> values() {
+        return {data.data(), data.size()};
+    }
+
+    matrix_span<const T> values() const {
+        return {data.data(), data.size()};
+    }
+
+protected:
+    // Classe concrète de m pour les compteurs de matrix_stats.h, qui ne l'évaluent qu'avec TP5_STATS.
+    static matrix_stats::kind statsKind(const matrix_t_<T> &m) {
+        if (typeid(m) == typeid(matrix_dense<T>))
+            return matrix_stats::kind::dense;
+        if (typeid(m) == typeid(matrix_triangulaire_sup<T>))
+            return matrix_stats::kind::triangulaire_sup;
+        if (typeid(m) == typeid(matrix_diag<T>))
+            return matrix_stats::kind::diag;
+        if (typeid(m) == typeid(matrix_csr<T>))
+            return matrix_stats::kind::csr;
+        if (typeid(m) == typeid(matrix_band<T>))
+            return matrix_stats::kind::band;
+        if (typeid(m) == typeid(matrix_symmetric<T>))
+            return matrix_stats::kind::symmetric;
+        if (typeid(m) == typeid(matrix_block<T>))
+            return matrix_stats::kind::block;
+        return matrix_stats::kind::triangulaire_inf;
+    }
+
+    // Un élément diagonal par ligne de cache en stockage dense : la trace se découpe en morceaux plus petits
+    // que les noyaux qui lisent des données contiguës.
+    static constexpr std::size_t traceGrain = thread_pool::defaultGrain / 8;
+
+    // out = a + b sur n éléments contigus, réparti entre les threads du pool.
+    static void addStream(const T *a, const T *b, T *out, std::size_t n) {
+        thread_pool::global().parallelFor(0, n, thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+            kernels::add(a + first, b + first, out + first, last - first);
+        });
+    }
+
+    // out = alpha * a + beta * b sur n éléments contigus, réparti entre les threads du pool.
+    static void axpbyStream(T alpha, const T *a, T beta, const T *b, T *out, std::size_t n) {
+        thread_pool::global().parallelFor(0, n, thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+            kernels::axpby(alpha, a + first, beta, b + first, out + first, last - first);
+        });
+    }
+
+    // Valeur des cases hors du stockage (valInf, defaultVal, valSup) et nombre de ces cases ; les matrices
+    // denses, creuses et bandes n'en ont pas (leurs zéros structurels ne comptent dans aucune réduction).
+    virtual T fillValue() const {
+        return T{};
+    }
+
+    virtual std::size_t fillCount() const {
+        return 0;
+    }
+
+    void checkSameSize(const matrix_t_<T> &m) const {
+        if (m.height != height || m.width != width)
+            throw std::runtime_error("matrix are not the same size.");
+    }
+
+    // Somme compensée des part(k), k dans [0, count) : part(k) renvoie la somme compensée d'une ligne ou d'une
+    // colonne, les lignes ou colonnes sont réparties entre les threads du pool.
+    template<typename F>
+    T sumOver(std::size_t count, F &&part) const {
+        const std::size_t perPart = std::max<std::size_t>(1, data.size() / std::max<std::size_t>(1, count));
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain / perPart);
+        return thread_pool::global().parallelReduce(
+                0, count, grain, reduce::compensated<T>{}, [&](std::size_t first, std::size_t last) {
+                    reduce::compensated<T> result;
+                    for (std::size_t k = first; k < last; k++)
+                        result += part(k);
+                    return result;
+                }).value();
+    }
+
+    // Plus grande valeur de column(j) sur les colonnes, réparties entre les threads du pool.
+    template<typename F>
+    reduce::norm_t<T> maxColumn(F &&column) const {
+        const std::size_t perColumn = std::max<std::size_t>(1, data.size() / std::max<std::size_t>(1, width));
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain / perColumn);
+        return thread_pool::global().parallelReduce(
+                0, width, grain, reduce::maximum<reduce::norm_t<T>>{}, [&](std::size_t first, std::size_t last) {
+                    reduce::maximum<reduce::norm_t<T>> result;
+                    for (std::size_t j = first; j < last; j++)
+                        result.value = std::max(result.value, column(j));
+                    return result;
+                }).value;
+    }
+
+    // Destination d'un addInto : elle doit être du type du résultat et de la bonne taille.
+    template<typename M>
+    static M &addDestination(matrix_t_<T> &dst, std::size_t height, std::size_t width) {
+        M *out = dynamic_cast<M *>(&dst);
+        if (out == nullptr)
+            throw std::runtime_error("destination matrix cannot hold the result.");
+        if (dst.height != height || dst.width != width)
+            throw std::runtime_error("matrix are not the same size.");
+        return *out;
+    }
+
+    void checkVectors(std::size_t xSize, std::size_t ySize) const {
+        if (xSize != width || ySize != height)
+            throw std::runtime_error("vector sizes are not compatible.");
+    }
+
+    void checkVectorBatch(const matrix_t_<T> &x, const matrix_t_<T> &y) const {
+        if (x.height != width || y.height != height || x.width != y.width)
+            throw std::runtime_error("matrix sizes are not compatible.");
+    }
+
+    // Les produits par plusieurs vecteurs lisent x et écrivent y en column-major. Si l'un des deux a une
+    // autre disposition, le produit est fait sur des copies converties et la fonction renvoie false.
+    bool vectorsColumnMajor(const matrix_dense<T> &x, matrix_dense<T> &y, T alpha, T beta) const {
+        if (x.getLayout() == dense_layout::column_major && y.getLayout() == dense_layout::column_major)
+            return true;
+        matrix_dense<T> result = y.withLayout(dense_layout::column_major);
+        multiplyVectors(x.withLayout(dense_layout::column_major), result, alpha, beta);
+        y.copyValues(result);
+        return false;
+    }
+
+    static char separatorOf(matrix_text_format format) {
+        return format == matrix_text_format::csv ? ',' : '\t';
+    }
+
+    // Fin de ligne : en CSV le séparateur qui suit le dernier élément est retiré.
+    void endRow(matrix_writer &out, matrix_text_format format) const {
+        if (format == matrix_text_format::csv && width > 0)
+            out.unput();
+        out.put('\n');
+    }
+
+    // En-tête Matrix Market ; nonZeros n'est écrit que pour le format coordinate.
+    void writeMarketHeader(matrix_writer &out, bool coordinate, std::size_t nonZeros) const {
+        out.write(coordinate ? "%%MatrixMarket matrix coordinate " : "%%MatrixMarket matrix array ");
+        out.write(text_format::market_field<T>::get());
+        out.write(" general\n");
+        out.index(height);
+        out.put(' ');
+        out.index(width);
+        if (coordinate) {
+            out.put(' ');
+            out.index(nonZeros);
+        }
+        out.put('\n');
+    }
+
+    // Matrix Market array : tous les éléments, colonne par colonne.
+    void writeMarketArray(matrix_writer &out) const {
+        writeMarketHeader(out, false, 0);
+        for (std::size_t j = 0; j < width; j++)
+            for (std::size_t i = 0; i < height; i++) {
+                out.marketValue((*this)(i, j));
+                out.put('\n');
+            }
+    }
+
+    // Produit m1 * m2 en passant par operator()(i,j), utilisé quand valInf/defaultVal est non nul et que la
+    // structure du résultat n'est plus celle des opérandes.
+    static std::unique_ptr<matrix_t_<T>> multiplyGeneric(const matrix_t_<T> &m1, const matrix_t_<T> &m2) {
+        if (m1.getWidth() != m2.getHeight())
+            throw std::runtime_error("matrix sizes are not compatible.");
+        std::size_t h = m1.getHeight(), k = m1.getWidth(), w = m2.getWidth();
+        auto result = std::make_unique<matrix_dense<T>>(h, w);
+        for (std::size_t j = 0; j < w; j++)
+            for (std::size_t l = 0; l < k; l++) {
+                T b = m2(l, j);
+                for (std::size_t i = 0; i < h; i++)
+                    (*result)(i, j) += m1(i, l) * b;
+            }
+        return result;
+    }
+};
+
+
+template<typename T>
+class matrix_dense final : public matrix_t_<T> {
+    // Blocs des produits matrice-vecteur : vectorRows éléments de y (8 Ko en double) tiennent en L1, une
+    // tuile tileRows x tileCols (128 Ko en double) en L2.
+    static constexpr std::size_t vectorRows = 1024;
+    static constexpr std::size_t tileRows = 128;
+    static constexpr std::size_t tileCols = 128;
+
+    dense_layout layout;
+
+public:
+    // Côté des tuiles de la disposition tiled. Les parcours par tuiles des autres dispositions utilisent la
+    // même taille : une tuile de doubles (32 Ko) tient en cache L1 ou L2.
+    static constexpr std::size_t layoutTile = 64;
+
+    matrix_dense(int height, int width, dense_layout layout = dense_layout::column_major)
+            : matrix_t_<T>(height, width), layout(layout) {
+        this->data = matrix_storage<T>(this->height * this->width);
+    }
+
+    // Matrice construite sur un stockage existant (par exemple projeté depuis un fichier), sans copie.
+    matrix_dense(int height, int width, matrix_storage<T> storage, dense_layout layout = dense_layout::column_major)
+            : matrix_t_<T>(height, width), layout(layout) {
+        if (storage.size() != this->height * this->width)
+            throw std::runtime_error("storage size does not match the matrix size.");
+        this->data = std::move(storage);
+    }
+
+    dense_layout getLayout() const {
+        return layout;
+    }
+
+    // Position de l'élément (row, col) dans data, selon la disposition.
+    std::size_t index(std::size_t row, std::size_t col) const {
+        switch (layout) {
+            case dense_layout::column_major:
+                return row + col * this->height;
+            case dense_layout::row_major:
+                return row * this->width + col;
+            default: {
+                const tile_view t = tileAt(row - row % layoutTile, col - col % layoutTile);
+                return t.offset + (row % layoutTile) * t.rowStride + (col % layoutTile) * t.colStride;
+            }
+        }
+    }
+
+    // Copie dans la disposition demandée, par tuiles réparties entre les threads.
+    matrix_dense<T> withLayout(dense_layout target) const {
+        matrix_dense<T> result(static_cast<int>(this->height), static_cast<int>(this->width), target);
+        result.copyValues(*this);
+        return result;
+    }
+
+    // Copie les éléments de m, de même taille et de disposition quelconque, en gardant celle de *this.
+    void copyValues(const matrix_dense<T> &m) {
+        if (m.height != this->height || m.width != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        if (&m == this)
+            return;
+        if (m.layout == layout) {
+            const T *src = m.data.data();
+            T *dst = this->data.data();
+            thread_pool::global().parallelFor(0, this->data.size(), thread_pool::defaultGrain,
+                                              [=](std::size_t first, std::size_t last) {
+                                                  std::copy(src + first, src + last, dst + first);
+                                              });
+            return;
+        }
+        assignTiles([&m](std::size_t row, std::size_t col) { return m.tileReader(row, col); });
+    }
+
+    // Transposée dans la même disposition. En column-major et en row-major, le stockage est une matrice
+    // column-major (la transposée de *this en row-major) transposée par kernels::transposeBlock() : les
+    // colonnes sont réparties entre les threads par multiples de layoutTile, et chaque morceau est découpé
+    // récursivement sans dépendre de la taille des caches. En tiled, chaque tuile est transposée vers la
+    // tuile symétrique.
+    matrix_dense<T> transposed() const {
+        const std::size_t h = this->height, w = this->width;
+        matrix_dense<T> result(static_cast<int>(w), static_cast<int>(h), layout);
+        const T *src = this->data.data();
+        T *dst = result.data.data();
+        if (layout == dense_layout::tiled) {
+            const std::size_t tiles = (w + layoutTile - 1) / layoutTile;
+            const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain /
+                                                               std::max<std::size_t>(1, h * layoutTile));
+            thread_pool::global().parallelFor(0, tiles, grain, [&](std::size_t first, std::size_t last) {
+                for (std::size_t col = first * layoutTile; col < std::min(last * layoutTile, w); col += layoutTile)
+                    for (std::size_t row = 0; row < h; row += layoutTile) {
+                        const tile_view from = tileAt(row, col), to = result.tileAt(col, row);
+                        kernels::transposeBlock(src + from.offset, from.colStride, dst + to.offset, to.colStride,
+                                                std::min(layoutTile, h - row), std::min(layoutTile, w - col));
+                    }
+            });
+            return result;
+        }
+        const bool columns = layout == dense_layout::column_major;
+        const std::size_t rows = columns ? h : w, cols = columns ? w : h;
+        const std::size_t tiles = (cols + layoutTile - 1) / layoutTile;
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain /
+                                                           std::max<std::size_t>(1, rows * layoutTile));
+        thread_pool::global().parallelFor(0, tiles, grain, [=](std::size_t first, std::size_t last) {
+            const std::size_t col = first * layoutTile, end = std::min(last * layoutTile, cols);
+            kernels::transposeBlock(src + col * rows, rows, dst + col, cols, rows, end - col);
+        });
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_dense<T>>(transposed());
+    }
+
+    // Transposition sur place d'une matrice carrée, sans allocation. Chaque morceau de colonnes [c0, c1)
+    // transpose son bloc diagonal et l'échange du rectangle au-dessus avec celui à gauche ; les morceaux
+    // sont pondérés par leur nombre d'éléments. En tiled, les tuiles (i, j) et (j, i) sont échangées.
+    void transposeInPlace() {
+        const std::size_t n = this->height;
+        if (n != this->width)
+            throw std::runtime_error("matrix must be square.");
+        T *a = this->data.data();
+        if (layout == dense_layout::tiled) {
+            const std::size_t tiles = (n + layoutTile - 1) / layoutTile;
+            thread_pool::global().parallelForWeighted(
+                    tiles, [](std::size_t tile) { return tile * (tile + 1) / 2 * layoutTile * layoutTile; },
+                    thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+                        const std::size_t end = std::min(last * layoutTile, n);
+                        for (std::size_t col = first * layoutTile; col < end; col += layoutTile) {
+                            const std::size_t cols = std::min(layoutTile, n - col);
+                            for (std::size_t row = 0; row < col; row += layoutTile) {
+                                const tile_view upper = tileAt(row, col), lower = tileAt(col, row);
+                                kernels::swapTransposed(a + upper.offset, upper.colStride, a + lower.offset,
+                                                        lower.colStride, layoutTile, cols);
+                            }
+                            kernels::transposeSquare(a + tileAt(col, col).offset, cols, cols);
+                        }
+                    });
+            return;
+        }
+        thread_pool::global().parallelForWeighted(
+                n, [](std::size_t col) { return col * (col + 1) / 2; }, thread_pool::defaultGrain,
+                [=](std::size_t first, std::size_t last) {
+                    kernels::transposeSquare(a + first + first * n, n, last - first);
+                    kernels::swapTransposed(a + first * n, n, a + first, n, first, last - first);
+                });
+    }
+
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::dense);
+        if (row < this->height && col < this->width)
+            return this->data[index(row, col)];
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::dense);
+        if (row < this->height && col < this->width)
+            return this->data[index(row, col)];
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    // Les lignes (ou les colonnes en Matrix Market) sont lues par morceaux de layoutTile éléments : dans
+    // chaque morceau, l'écart entre deux éléments est constant quelle que soit la disposition.
+    void write(matrix_writer &out, matrix_text_format format) const override {
+        const std::size_t h = this->height, w = this->width;
+        const T *d = this->data.data();
+        if (format == matrix_text_format::matrix_market) {
+            this->writeMarketHeader(out, false, 0);
+            for (std::size_t j = 0; j < w; j++)
+                for (std::size_t i0 = 0; i0 < h; i0 += layoutTile) {
+                    const tile_view t = tileAt(i0, j - j % layoutTile);
+                    const T *p = d + t.offset + (j % layoutTile) * t.colStride;
+                    for (std::size_t a = 0; a < std::min(layoutTile, h - i0); a++) {
+                        out.marketValue(p[a * t.rowStride]);
+                        out.put('\n');
+                    }
+                }
+            return;
+        }
+        const char separator = matrix_t_<T>::separatorOf(format);
+        for (std::size_t i = 0; i < h; i++) {
+            for (std::size_t j0 = 0; j0 < w; j0 += layoutTile) {
+                const tile_view t = tileAt(i - i % layoutTile, j0);
+                const T *p = d + t.offset + (i % layoutTile) * t.rowStride;
+                for (std::size_t b = 0; b < std::min(layoutTile, w - j0); b++) {
+                    out.value(p[b * t.colStride]);
+                    out.put(separator);
+                }
+            }
+            this->endRow(out, format);
+        }
+    }
+
+    // Nombre de colonnes par morceau pour le pool de threads.
+    std::size_t columnGrain() const {
+        return std::max<std::size_t>(1, thread_pool::defaultGrain / std::max<std::size_t>(1, this->height));
+    }
+
+    // Nombre de lignes par morceau pour les produits matrice-vecteur, qui lisent width éléments par ligne.
+    std::size_t rowGrain() const {
+        return std::max<std::size_t>(1, thread_pool::defaultGrain / std::max<std::size_t>(1, this->width));
+    }
+
+    // Colonne col, contiguë en column-major seulement.
+    matrix_span<T> column(std::size_t col) {
+        checkColumnMajor();
+        if (col >= this->width)
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + col * this->height, this->height};
+    }
+
+    matrix_span<const T> column(std::size_t col) const {
+        checkColumnMajor();
+        if (col >= this->width)
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + col * this->height, this->height};
+    }
+
+    // Sous-matrice de rows lignes et cols colonnes à partir de (row, col), sans copie (matrix_view.h). En tiled,
+    // les éléments d'une ligne ne sont pas à pas constant d'une tuile à l'autre : pas de vue.
+    matrix_dense_view<T> block(std::size_t row, std::size_t col, std::size_t rows, std::size_t cols) {
+        return view(this->data.exclusiveData()).block(row, col, rows, cols);
+    }
+
+    matrix_dense_view<const T> block(std::size_t row, std::size_t col, std::size_t rows, std::size_t cols) const {
+        return view(this->data.data()).block(row, col, rows, cols);
+    }
+
+    matrix_diag_view<T> diagonalView() {
+        return view(this->data.exclusiveData()).diagonalView();
+    }
+
+    matrix_diag_view<const T> diagonalView() const {
+        return view(this->data.data()).diagonalView();
+    }
+
+    stored_range<column_major_iterator<T>> stored() {
+        checkColumnMajor();
+        return {{this->data.data(), this->height, 0, 0},
+                {this->data.data() + this->data.size(), this->height, 0, this->width}};
+    }
+
+    stored_range<column_major_iterator<const T>> stored() const {
+        checkColumnMajor();
+        return {{this->data.data(), this->height, 0, 0},
+                {this->data.data() + this->data.size(), this->height, 0, this->width}};
+    }
+
+    // La diagonale est à pas constant en column-major (height + 1) et en row-major (width + 1).
+    T traceSum(reduce::summation mode) const override {
+        const T *d = this->data.data();
+        const std::size_t n = std::min(this->height, this->width);
+        if (layout == dense_layout::tiled)
+            return reduce::parallelSum<T>(n, matrix_t_<T>::traceGrain, mode,
+                                          [this, d](std::size_t i) { return d[index(i, i)]; });
+        const std::size_t step = (layout == dense_layout::column_major ? this->height : this->width) + 1;
+        return reduce::parallelSum<T>(n, matrix_t_<T>::traceGrain, mode,
+                                      [d, step](std::size_t i) { return d[i * step]; });
+    }
+
+    reduce::norm_t<T> norm1(reduce::summation mode = reduce::summation::pairwise) const override {
+        const T *d = this->data.data();
+        const std::size_t h = this->height;
+        if (layout == dense_layout::column_major)
+            return this->maxColumn([d, h, mode](std::size_t j) {
+                const T *col = d + j * h;
+                return reduce::sum<reduce::norm_t<T>>(0, h, [col](std::size_t i) {
+                    return reduce::magnitude(col[i]);
+                }, mode).value();
+            });
+        return this->maxColumn([this, d, h, mode](std::size_t j) {
+            return reduce::sum<reduce::norm_t<T>>(0, h, [this, d, j](std::size_t i) {
+                return reduce::magnitude(d[index(i, j)]);
+            }, mode).value();
+        });
+    }
+
+    // Avec une autre dense de même disposition, produit scalaire des deux stockages. Avec une matrice d'une
+    // autre classe, c'est elle qui parcourt ses éléments stockés.
+    T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const override {
+        this->checkSameSize(m);
+        const auto *other = dynamic_cast<const matrix_dense<T> *>(&m);
+        if (other == nullptr)
+            return m.dot(*this, mode);
+        const T *a = this->data.data(), *b = other->data.data();
+        if (other->layout == layout)
+            return reduce::parallelDot(a, b, this->data.size(), mode);
+        const std::size_t h = this->height;
+        return this->sumOver(this->width, [this, other, a, b, h, mode](std::size_t j) {
+            return reduce::sum<T>(0, h, [this, other, a, b, j](std::size_t i) {
+                return a[index(i, j)] * b[other->index(i, j)];
+            }, mode);
+        });
+    }
+
+    // En column-major, forme axpy : y reçoit des combinaisons de colonnes, lues dans l'ordre du stockage. Les
+    // lignes sont réparties entre les threads, et chaque morceau est traité par blocs de vectorRows lignes
+    // pour que le bloc de y reste en cache L1 pendant le parcours des colonnes. Les autres dispositions
+    // passent par multiplyTiles().
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        if (layout != dense_layout::column_major) {
+            multiplyTiles(x.data(), 0, y.data(), 0, 1, alpha, beta);
+            return;
+        }
+        const std::size_t h = this->height, w = this->width;
+        const T *a = this->data.data(), *xs = x.data();
+        T *ys = y.data();
+        thread_pool::global().parallelFor(0, h, rowGrain(), [=](std::size_t first, std::size_t last) {
+            for (std::size_t r = first; r < last; r += vectorRows) {
+                const std::size_t rows = std::min(vectorRows, last - r);
+                kernels::scale(beta, ys + r, rows);
+                kernels::multiplyColumns(a + r, h, xs, alpha, ys + r, rows, w);
+            }
+        });
+    }
+
+    // La matrice est lue par tuiles de tileRows x tileCols, chacune servant à tous les vecteurs pendant
+    // qu'elle est en cache : elle n'est parcourue qu'une fois en mémoire quel que soit le nombre de vecteurs.
+    void multiplyVectors(const matrix_dense<T> &x, matrix_dense<T> &y, T alpha = T(1),
+                         T beta = T{}) const override {
+        this->checkVectorBatch(x, y);
+        if (!this->vectorsColumnMajor(x, y, alpha, beta))
+            return;
+        const std::size_t h = this->height, w = this->width, count = x.width;
+        const T *a = this->data.data(), *xs = x.data.data();
+        T *ys = y.data.data();
+        if (layout != dense_layout::column_major) {
+            multiplyTiles(xs, w, ys, h, count, alpha, beta);
+            return;
+        }
+        thread_pool::global().parallelFor(0, h, rowGrain(), [=](std::size_t first, std::size_t last) {
+            for (std::size_t c = 0; c < count; c++)
+                kernels::scale(beta, ys + first + c * h, last - first);
+            for (std::size_t r = first; r < last; r += tileRows) {
+                const std::size_t rows = std::min(tileRows, last - r);
+                for (std::size_t j = 0; j < w; j += tileCols) {
+                    const std::size_t cols = std::min(tileCols, w - j);
+                    for (std::size_t c = 0; c < count; c++)
+                        kernels::multiplyColumns(a + r + j * h, h, xs + j + c * w, alpha, ys + r + c * h, rows, cols);
+                }
+            }
+        });
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        return m.add(*this);
+    }
+
+    // Le résultat prend la disposition de l'opérande de gauche.
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, m1.layout);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, layout);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, layout);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        m.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        if (m1.layout == layout && out.layout == layout) {
+            matrix_t_<T>::addStream(m1.data.data(), this->data.data(), out.data.data(), this->data.size());
+            return;
+        }
+        out.assignTiles([&](std::size_t row, std::size_t col) {
+            const auto a = m1.tileReader(row, col), b = tileReader(row, col);
+            return [=](std::size_t i, std::size_t j) { return a(i, j) + b(i, j); };
+        });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        const T *dense = this->data.data(), *packed = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getValInf();
+        const std::size_t h = this->height, w = this->width;
+        if (layout != dense_layout::column_major || out.layout != dense_layout::column_major) {
+            out.assignTiles([&](std::size_t row, std::size_t col) {
+                const auto a = tileReader(row, col);
+                return [=](std::size_t i, std::size_t j) {
+                    const std::size_t r = row + i, c = col + j;
+                    return a(i, j) + (r <= c ? packed[c + r * w - (r * (r + 1)) / 2] : fill);
+                };
+            });
+            return;
+        }
+        thread_pool::global().parallelFor(0, w, columnGrain(), [=](std::size_t first, std::size_t last) {
+            kernels::addDenseTriangular(dense, packed, fill, result, h, w, first, last);
+        });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        const T *dense = this->data.data(), *diag = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getDefaultVal();
+        const std::size_t h = this->height;
+        if (layout != dense_layout::column_major || out.layout != dense_layout::column_major) {
+            out.assignTiles([&](std::size_t row, std::size_t col) {
+                const auto a = tileReader(row, col);
+                return [=](std::size_t i, std::size_t j) {
+                    return a(i, j) + (row + i == col + j ? diag[row + i] : fill);
+                };
+            });
+            return;
+        }
+        thread_pool::global().parallelFor(0, this->width, columnGrain(), [=](std::size_t first, std::size_t last) {
+            kernels::addDenseDiagonal(dense, diag, fill, result, h, first, last);
+        });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::dense, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    // axpby(alpha, beta, m) renvoie alpha * (*this) + beta * m, du type que renverrait add(), en une seule passe
+    // qui lit chaque opérande une fois et écrit le résultat une fois. axpbyInto(dst, alpha, beta, m) l'écrit
+    // sans allocation dans dst, qui doit avoir ce type et peut être l'un des deux opérandes.
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_dense<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, m1.layout);
+        axpbyInto(*result, alpha, beta, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_triangulaire_sup<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, layout);
+        axpbyInto(*result, alpha, beta, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_diag<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, layout);
+        axpbyInto(*result, alpha, beta, m1);
+        return result;
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_dense<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        if (m1.layout == layout && out.layout == layout) {
+            matrix_t_<T>::axpbyStream(alpha, this->data.data(), beta, m1.data.data(), out.data.data(),
+                                      this->data.size());
+            return;
+        }
+        out.assignTiles([&](std::size_t row, std::size_t col) {
+            const auto a = tileReader(row, col), b = m1.tileReader(row, col);
+            return [=](std::size_t i, std::size_t j) { return alpha * a(i, j) + beta * b(i, j); };
+        });
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_triangulaire_sup<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        const T *dense = this->data.data(), *packed = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getValInf();
+        const std::size_t h = this->height, w = this->width;
+        if (layout != dense_layout::column_major || out.layout != dense_layout::column_major) {
+            out.assignTiles([&](std::size_t row, std::size_t col) {
+                const auto a = tileReader(row, col);
+                return [=](std::size_t i, std::size_t j) {
+                    const std::size_t r = row + i, c = col + j;
+                    return alpha * a(i, j) + beta * (r <= c ? packed[c + r * w - (r * (r + 1)) / 2] : fill);
+                };
+            });
+            return;
+        }
+        thread_pool::global().parallelFor(0, w, columnGrain(), [=](std::size_t first, std::size_t last) {
+            kernels::axpbyDenseTriangular(alpha, dense, beta, packed, fill, result, h, w, first, last);
+        });
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_diag<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        const T *dense = this->data.data(), *diag = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getDefaultVal();
+        const std::size_t h = this->height;
+        if (layout != dense_layout::column_major || out.layout != dense_layout::column_major) {
+            out.assignTiles([&](std::size_t row, std::size_t col) {
+                const auto a = tileReader(row, col);
+                return [=](std::size_t i, std::size_t j) {
+                    return alpha * a(i, j) + beta * (row + i == col + j ? diag[row + i] : fill);
+                };
+            });
+            return;
+        }
+        thread_pool::global().parallelFor(0, this->width, columnGrain(), [=](std::size_t first, std::size_t last) {
+            kernels::axpbyDenseDiagonal(alpha, dense, beta, diag, fill, result, h, first, last);
+        });
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(*this);
+    }
+
+    // m * (*this) : noyau par blocs en forme axpy (multiplyColumnMajor). En row-major, le stockage de A est
+    // celui de A^T en column-major : C^T = B^T A^T est calculé par le même noyau, sans conversion. Les
+    // autres combinaisons passent par des copies column-major, en O(n^2) devant le produit en O(n^3). Le
+    // résultat a la disposition de m.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        if (m1.width != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        const std::size_t h = m1.height, k = m1.width, w = this->width;
+        if (m1.layout == dense_layout::row_major && layout == dense_layout::row_major) {
+            matrix_dense<T> result(h, w, dense_layout::row_major);
+            multiplyColumnMajor(this->data.data(), m1.data.data(), result.data.data(), w, k, h);
+            return std::make_unique<matrix_dense<T>>(std::move(result));
+        }
+        if (m1.layout != dense_layout::column_major || layout != dense_layout::column_major) {
+            matrix_dense<T> product(h, w);
+            const matrix_dense<T> a = m1.withLayout(dense_layout::column_major);
+            const matrix_dense<T> b = withLayout(dense_layout::column_major);
+            multiplyColumnMajor(a.data.data(), b.data.data(), product.data.data(), h, k, w);
+            return std::make_unique<matrix_dense<T>>(product.withLayout(m1.layout));
+        }
+        matrix_dense<T> result(h, w);
+        multiplyColumnMajor(m1.data.data(), this->data.data(), result.data.data(), h, k, w);
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : chaque C(i,j) est le produit scalaire de la ligne i compactée de m (colonnes i..k-1)
+    // et de la colonne j de *this, toutes deux contiguës.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (layout != dense_layout::column_major)
+            return withLayout(dense_layout::column_major).multiplyLeft(m1);
+        if (m1.getValInf() != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        const std::size_t rows = std::min(h, k);
+        matrix_dense<T> result(h, w);
+        const T *a = m1.data.data();
+        for (std::size_t j = 0; j < w; j++) {
+            const T *bCol = this->data.data() + j * k;
+            T *cCol = result.data.data() + j * h;
+            for (std::size_t i = 0; i < rows; i++) {
+                const T *aRow = a + m1.rowOffset(i);
+                T sum = {};
+                for (std::size_t l = i; l < k; l++)
+                    sum += aRow[l] * bCol[l];
+                cCol[i] = sum;
+            }
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : mise à l'échelle des lignes de *this par la diagonale de m.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (layout != dense_layout::column_major)
+            return withLayout(dense_layout::column_major).multiplyLeft(m1);
+        if (m1.getDefaultVal() != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        const std::size_t rows = std::min(h, k);
+        matrix_dense<T> result(h, w);
+        const T *d = m1.data.data();
+        for (std::size_t j = 0; j < w; j++) {
+            const T *bCol = this->data.data() + j * k;
+            T *cCol = result.data.data() + j * h;
+            for (std::size_t i = 0; i < rows; i++)
+                cCol[i] = d[i] * bCol[i];
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : C(i,j) est le produit scalaire de la ligne creuse i de m et de la colonne j de *this.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (layout != dense_layout::column_major)
+            return withLayout(dense_layout::column_major).multiplyLeft(m1);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        matrix_dense<T> result(h, w);
+        const std::size_t *rowPtr = m1.rowPtr.data(), *colIdx = m1.colIdx.data();
+        const T *a = m1.data.data();
+        for (std::size_t j = 0; j < w; j++) {
+            const T *bCol = this->data.data() + j * k;
+            T *cCol = result.data.data() + j * h;
+            for (std::size_t i = 0; i < h; i++) {
+                T sum = {};
+                for (std::size_t p = rowPtr[i]; p < rowPtr[i + 1]; p++)
+                    sum += a[p] * bCol[colIdx[p]];
+                cCol[i] = sum;
+            }
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : C(:,j) += A(:,l) * B(l,j), où A(:,l) n'a que les lignes de la bande de la colonne l.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (layout != dense_layout::column_major)
+            return withLayout(dense_layout::column_major).multiplyLeft(m1);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        matrix_dense<T> result(h, w);
+        T *c = result.data.data();
+        for (std::size_t j = 0; j < w; j++)
+            for (std::size_t l = 0; l < k; l++) {
+                const T bl = this->data[l + j * k];
+                const matrix_column_segment<const T> aCol = m1.columnSegment(l);
+                T *cCol = c + j * h;
+                for (std::size_t i = aCol.firstRow(); i < aCol.firstRow() + aCol.size(); i++)
+                    cCol[i] += aCol[i] * bl;
+            }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+private:
+    // Tuile de layoutTile x layoutTile dont le coin haut gauche est (row, col), multiples de layoutTile :
+    // dans les trois dispositions, l'élément (row + i, col + j) est à offset + i * rowStride + j * colStride.
+    struct tile_view {
+        std::size_t offset;
+        std::size_t rowStride;
+        std::size_t colStride;
+    };
+
+    tile_view tileAt(std::size_t row, std::size_t col) const {
+        const std::size_t h = this->height, w = this->width;
+        switch (layout) {
+            case dense_layout::column_major:
+                return {row + col * h, 1, h};
+            case dense_layout::row_major:
+                return {row * w + col, w, 1};
+            default: {
+                const std::size_t rows = std::min(layoutTile, h - row), cols = std::min(layoutTile, w - col);
+                return {col * h + row * cols, 1, rows};
+            }
+        }
+    }
+
+    // Lecture des éléments de la tuile (row, col) par position dans la tuile.
+    auto tileReader(std::size_t row, std::size_t col) const {
+        const tile_view t = tileAt(row, col);
+        const T *p = this->data.data() + t.offset;
+        return [=](std::size_t i, std::size_t j) { return p[i * t.rowStride + j * t.colStride]; };
+    }
+
+    // (*this)(row + i, col + j) = value(row, col)(i, j) sur chaque tuile (row, col), parcourue dans l'ordre
+    // de son stockage : value(row, col) prépare la lecture des opérandes pour la tuile. Les colonnes de
+    // tuiles sont réparties entre les threads. Chaque élément n'est lu qu'à sa propre position avant d'être
+    // écrit : *this peut être l'un des opérandes.
+    template<typename F>
+    void assignTiles(F &&value) {
+        const std::size_t h = this->height, w = this->width;
+        const std::size_t tiles = (w + layoutTile - 1) / layoutTile;
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain /
+                                                           std::max<std::size_t>(1, h * layoutTile));
+        T *d = this->data.data();
+        thread_pool::global().parallelFor(0, tiles, grain, [&](std::size_t first, std::size_t last) {
+            for (std::size_t tile = first; tile < last; tile++) {
+                const std::size_t col = tile * layoutTile, cols = std::min(layoutTile, w - col);
+                for (std::size_t row = 0; row < h; row += layoutTile) {
+                    const std::size_t rows = std::min(layoutTile, h - row);
+                    const tile_view t = tileAt(row, col);
+                    const auto at = value(row, col);
+                    T *out = d + t.offset;
+                    if (t.rowStride == 1) {
+                        for (std::size_t j = 0; j < cols; j++)
+                            for (std::size_t i = 0; i < rows; i++)
+                                out[i + j * t.colStride] = at(i, j);
+                    } else {
+                        for (std::size_t i = 0; i < rows; i++)
+                            for (std::size_t j = 0; j < cols; j++)
+                                out[i * t.rowStride + j] = at(i, j);
+                    }
+                }
+            }
+        });
+    }
+
+    // Vue sur toute la matrice, d depuis data.data(), ou data.exclusiveData() pour une vue modifiable.
+    template<typename U>
+    matrix_dense_view<U> view(U *d) const {
+        if (layout == dense_layout::tiled)
+            throw std::runtime_error("a tiled matrix has no strided view.");
+        const bool columns = layout == dense_layout::column_major;
+        return {d, this->height, this->width, columns ? 1 : this->width, columns ? this->height : 1};
+    }
+
+    void checkColumnMajor() const {
+        if (layout != dense_layout::column_major)
+            throw std::runtime_error("columns are only contiguous in column-major layout.");
+    }
+
+    // y = alpha * (*this) * x + beta * y en row_major ou tiled, pour count vecteurs (x de pas ldx, y de pas
+    // ldy) : chaque tuile sert à tous les vecteurs pendant qu'elle est en cache. Une tuile dont les colonnes
+    // sont contiguës est lue en forme axpy, une tuile row-major par produits scalaires sur ses lignes. Les
+    // lignes de tuiles sont réparties entre les threads.
+    void multiplyTiles(const T *xs, std::size_t ldx, T *ys, std::size_t ldy, std::size_t count, T alpha,
+                       T beta) const {
+        const std::size_t h = this->height, w = this->width;
+        const std::size_t tiles = (h + layoutTile - 1) / layoutTile;
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain /
+                                                           std::max<std::size_t>(1, layoutTile * w * count));
+        const T *a = this->data.data();
+        thread_pool::global().parallelFor(0, tiles, grain, [=](std::size_t first, std::size_t last) {
+            for (std::size_t tile = first; tile < last; tile++) {
+                const std::size_t row = tile * layoutTile, rows = std::min(layoutTile, h - row);
+                for (std::size_t c = 0; c < count; c++)
+                    kernels::scale(beta, ys + row + c * ldy, rows);
+                for (std::size_t col = 0; col < w; col += layoutTile) {
+                    const std::size_t cols = std::min(layoutTile, w - col);
+                    const tile_view t = tileAt(row, col);
+                    for (std::size_t c = 0; c < count; c++) {
+                        const T *xc = xs + col + c * ldx;
+                        T *yc = ys + row + c * ldy;
+                        if (t.rowStride == 1)
+                            kernels::multiplyColumns(a + t.offset, t.colStride, xc, alpha, yc, rows, cols);
+                        else
+                            for (std::size_t i = 0; i < rows; i++)
+                                yc[i] += alpha * kernels::dot(a + t.offset + i * t.rowStride, xc, cols);
+                    }
+                }
+            }
+        });
+    }
+
+    // C = A B, A (h x k), B (k x w) et C en column-major, C initialisée à zéro : C(:,j) += A(:,l) * B(l,j)
+    // par blocs, en parcourant les colonnes contiguës.
+    static void multiplyColumnMajor(const T *a, const T *b, T *c, std::size_t h, std::size_t k, std::size_t w) {
+        const std::size_t blockRows = 256, blockInner = 128, blockCols = 64;
+        for (std::size_t jj = 0; jj < w; jj += blockCols)
+            for (std::size_t ll = 0; ll < k; ll += blockInner)
+                for (std::size_t ii = 0; ii < h; ii += blockRows) {
+                    const std::size_t jEnd = std::min(jj + blockCols, w);
+                    const std::size_t lEnd = std::min(ll + blockInner, k);
+                    const std::size_t iEnd = std::min(ii + blockRows, h);
+                    for (std::size_t j = jj; j < jEnd; j++)
+                        for (std::size_t l = ll; l < lEnd; l++) {
+                            const T bl = b[l + j * k];
+                            const T *aCol = a + l * h;
+                            T *cCol = c + j * h;
+                            for (std::size_t i = ii; i < iEnd; i++)
+                                cCol[i] += aCol[i] * bl;
+                        }
+                }
+    }
+};
+
+
+template<typename T>
+class matrix_triangulaire_sup final : public matrix_t_<T> {
+private:
+    T valInf;
+
+    T fillValue() const override {
+        return valInf;
+    }
+
+    std::size_t fillCount() const override {
+        return this->height * this->width - this->data.size();
+    }
+
+    // Blocs de multiplyVectors() : une tuile de tileRows x tileCols (128 Ko en double) tient en L2.
+    static constexpr std::size_t tileRows = 64;
+    static constexpr std::size_t tileCols = 256;
+
+    // Travail cumulé des lignes [0, row) pour parallelForWeighted : éléments stockés plus un par ligne.
+    auto storedBefore() const {
+        const std::size_t w = this->width, rows = std::min(this->height, w);
+        return [=](std::size_t row) {
+            const std::size_t r = std::min(row, rows);
+            return r * w - (r * (r - 1)) / 2 + row;
+        };
+    }
+
+    // x : count colonnes de hauteur n (column-major), seconds membres remplacés par les solutions.
+    void solveColumns(T *x, std::size_t count) const {
+        const std::size_t n = this->height;
+        if (n != this->width)
+            throw std::runtime_error("matrix must be square.");
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain / std::max<std::size_t>(1, n * n / 2));
+        if (valInf == T{}) {
+            const T *packed = this->data.data();
+            for (std::size_t i = 0; i < n; i++)
+                if (packed[rowOffset(i) + i] == T{})
+                    throw std::runtime_error("matrix is singular.");
+            thread_pool::global().parallelFor(0, count, grain, [=](std::size_t first, std::size_t last) {
+                kernels::solveUpperPacked(packed, n, x, first, last);
+            });
+            return;
+        }
+
+        // Ligne i moins ligne i - 1 : les valInf s'annulent sous la sous-diagonale, il reste une Hessenberg
+        // supérieure, gardée dans le même format compact plus la sous-diagonale.
+        std::vector<T> packed(this->data.begin(), this->data.end()), sub(n);
+        for (std::size_t i = n; i-- > 1;) {
+            T *row = packed.data() + rowOffset(i);
+            const T *previous = packed.data() + rowOffset(i - 1);
+            sub[i] = valInf - previous[i - 1];
+            for (std::size_t j = i; j < n; j++)
+                row[j] -= previous[j];
+        }
+        std::vector<unsigned char> swapped(n);
+        std::vector<T> factor(n);
+        kernels::reduceHessenberg(packed.data(), sub.data(), n, swapped.data(), factor.data());
+        for (std::size_t i = 0; i < n; i++)
+            if (packed[rowOffset(i) + i] == T{})
+                throw std::runtime_error("matrix is singular.");
+        const T *r = packed.data(), *f = factor.data();
+        const unsigned char *s = swapped.data();
+        thread_pool::global().parallelFor(0, count, grain, [=](std::size_t first, std::size_t last) {
+            for (std::size_t c = first; c < last; c++) {
+                T *xc = x + c * n;
+                for (std::size_t i = n; i-- > 1;)
+                    xc[i] -= xc[i - 1];
+            }
+            kernels::applyHessenberg(s, f, n, x, first, last);
+            kernels::solveUpperPacked(r, n, x, first, last);
+        });
+    }
+
+public:
+    matrix_triangulaire_sup(int height, int width, T valInf) : matrix_t_<T>(height, width), valInf(valInf) {
+        this->data = matrix_storage<T>(packedSize(height, width));
+    }
+
+    matrix_triangulaire_sup(int height, int width, T valInf, matrix_storage<T> storage)
+            : matrix_t_<T>(height, width), valInf(valInf) {
+        if (storage.size() != packedSize(height, width))
+            throw std::runtime_error("storage size does not match the matrix size.");
+        this->data = std::move(storage);
+    }
+
+    // Nombre d'éléments stockés pour une matrice height x width.
+    static std::size_t packedSize(std::size_t height, std::size_t width) {
+        if (height >= width)
+            return (width * (width + 1) / 2);
+        else
+            return (width * (width + 1) / 2) - ((width - height) * (width - height + 1) / 2);
+    }
+
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::triangulaire_sup);
+        if (row < this->height && col < this->width) {
+            if (row > col)
+                return valInf;
+            else {
+                return this->data[col + row * this->width - (row * (row + 1)) / 2];
+            }
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::triangulaire_sup);
+        if (row < this->height && col < this->width) {
+            if (row > col)
+                return valInf;
+            else {
+                return this->data[col + row * this->width - (row * (row + 1)) / 2];
+            }
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    // Partie stockée de la ligne row : colonnes row..width-1, contiguës dans le stockage compact.
+    matrix_row_segment<T> rowSegment(std::size_t row) {
+        if (row >= std::min(this->height, this->width))
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + rowOffset(row) + row, row, this->width - row};
+    }
+
+    matrix_row_segment<const T> rowSegment(std::size_t row) const {
+        if (row >= std::min(this->height, this->width))
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + rowOffset(row) + row, row, this->width - row};
+    }
+
+    // Lignes [first, last) sur toute la largeur, sans copie (matrix_view.h).
+    matrix_triangulaire_sup_view<T> rows(std::size_t first, std::size_t last) {
+        if (first > last || last > this->height)
+            throw std::out_of_range("Out of range.");
+        return {this->data.exclusiveData(), first, last - first, this->width, valInf};
+    }
+
+    matrix_triangulaire_sup_view<const T> rows(std::size_t first, std::size_t last) const {
+        if (first > last || last > this->height)
+            throw std::out_of_range("Out of range.");
+        return {this->data.data(), first, last - first, this->width, valInf};
+    }
+
+    stored_range<packed_upper_iterator<T>> stored() {
+        return {{this->data.data(), this->width, 0, 0},
+                {this->data.data() + this->data.size(), this->width, 0, 0}};
+    }
+
+    stored_range<packed_upper_iterator<const T>> stored() const {
+        return {{this->data.data(), this->width, 0, 0},
+                {this->data.data() + this->data.size(), this->width, 0, 0}};
+    }
+
+    // Un produit scalaire par ligne compactée : seule la moitié stockée est lue. Sous la diagonale, la
+    // contribution de valInf est valInf * (x[0] + ... + x[i - 1]), cumulée au fil des lignes. Les morceaux de
+    // lignes sont répartis entre les threads selon le nombre d'éléments stockés.
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        const std::size_t w = this->width, rows = std::min(this->height, w);
+        const T *packed = this->data.data(), *xs = x.data();
+        T *ys = y.data();
+        const T lower = valInf;
+        thread_pool::global().parallelForWeighted(this->height, storedBefore(), thread_pool::defaultGrain,
+                                                  [=](std::size_t first, std::size_t last) {
+            T prefix = lower == T{} ? T{} : std::accumulate(xs, xs + std::min(first, w), T{});
+            for (std::size_t i = first; i < last; i++) {
+                T sum = lower * prefix;
+                if (i < rows)
+                    sum += kernels::dot(packed + i * w - (i * (i + 1)) / 2 + i, xs + i, w - i);
+                if (i < w)
+                    prefix += xs[i];
+                ys[i] = beta == T{} ? alpha * sum : alpha * sum + beta * ys[i];
+            }
+        });
+    }
+
+    // Les lignes sont prises par blocs de tileRows et la partie stockée du bloc par tuiles de tileCols
+    // colonnes : une tuile sert à tous les vecteurs pendant qu'elle est en cache.
+    void multiplyVectors(const matrix_dense<T> &x, matrix_dense<T> &y, T alpha = T(1),
+                         T beta = T{}) const override {
+        this->checkVectorBatch(x, y);
+        if (!this->vectorsColumnMajor(x, y, alpha, beta))
+            return;
+        const std::size_t h = this->height, w = this->width, rows = std::min(h, w), count = x.getWidth();
+        const T *packed = this->data.data(), *xs = x.values().data();
+        T *ys = y.values().data();
+        const T lower = valInf;
+        thread_pool::global().parallelForWeighted(h, storedBefore(), thread_pool::defaultGrain,
+                                                  [=](std::size_t first, std::size_t last) {
+            for (std::size_t c = 0; c < count; c++)
+                kernels::scale(beta, ys + first + c * h, last - first);
+            for (std::size_t r = first; r < std::min(last, rows); r += tileRows) {
+                const std::size_t rEnd = std::min({r + tileRows, last, rows});
+                for (std::size_t j = r; j < w; j += tileCols) {
+                    const std::size_t jEnd = std::min(j + tileCols, w);
+                    for (std::size_t c = 0; c < count; c++) {
+                        const T *xc = xs + c * w;
+                        T *yc = ys + c * h;
+                        for (std::size_t i = r; i < rEnd; i++) {
+                            const std::size_t start = std::max(i, j);
+                            if (start < jEnd)
+                                yc[i] += alpha * kernels::dot(packed + i * w - (i * (i + 1)) / 2 + start, xc + start,
+                                                              jEnd - start);
+                        }
+                    }
+                }
+            }
+            if (lower == T{})
+                return;
+            for (std::size_t c = 0; c < count; c++) {
+                const T *xc = xs + c * w;
+                T *yc = ys + c * h;
+                T prefix = std::accumulate(xc, xc + std::min(first, w), T{});
+                for (std::size_t i = first; i < last; i++) {
+                    yc[i] += alpha * lower * prefix;
+                    if (i < w)
+                        prefix += xc[i];
+                }
+            }
+        });
+    }
+
+    T traceSum(reduce::summation mode) const override {
+        const T *packed = this->data.data();
+        return reduce::parallelSum<T>(std::min(this->height, this->width), matrix_t_<T>::traceGrain, mode,
+                                      [this, packed](std::size_t i) { return packed[rowOffset(i) + i]; });
+    }
+
+    // Colonne j : les éléments stockés des lignes 0..j, un par ligne compactée, puis valInf sur le reste.
+    reduce::norm_t<T> norm1(reduce::summation mode = reduce::summation::pairwise) const override {
+        const T *packed = this->data.data();
+        const std::size_t h = this->height, w = this->width;
+        const reduce::norm_t<T> fill = reduce::magnitude(valInf);
+        return this->maxColumn([packed, h, w, fill, mode](std::size_t j) {
+            const std::size_t upper = std::min(j + 1, h);
+            reduce::compensated<reduce::norm_t<T>> column = reduce::sum<reduce::norm_t<T>>(
+                    0, upper, [packed, j, w](std::size_t i) {
+                        return reduce::magnitude(packed[j + i * w - (i * (i + 1)) / 2]);
+                    }, mode);
+            column.add(fill * static_cast<reduce::norm_t<T>>(h - upper));
+            return column.value();
+        });
+    }
+
+    // Avec une autre triangulaire sup, produit scalaire des stockages plus valInf * valInf par case sous la
+    // diagonale. Sinon, lignes compactées contre m, et la partie sous la diagonale de m seulement si valInf
+    // est non nul.
+    T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const override {
+        this->checkSameSize(m);
+        const T *packed = this->data.data();
+        if (const auto *other = dynamic_cast<const matrix_triangulaire_sup<T> *>(&m)) {
+            reduce::compensated<T> result;
+            result.add(reduce::parallelDot(packed, other->data.data(), this->data.size(), mode));
+            result.add(valInf * other->valInf * static_cast<T>(fillCount()));
+            return result.value();
+        }
+        const std::size_t w = this->width;
+        const T fill = valInf;
+        return this->sumOver(this->height, [this, &m, packed, w, fill, mode](std::size_t i) {
+            reduce::compensated<T> row;
+            if (i < w)
+                row = reduce::sum<T>(i, w, [this, &m, packed, i](std::size_t j) {
+                    return packed[rowOffset(i) + j] * m(i, j);
+                }, mode);
+            if (fill != T{}) {
+                reduce::compensated<T> lower = reduce::sum<T>(0, std::min(i, w), [&m, i](std::size_t j) {
+                    return m(i, j);
+                }, mode);
+                row.add(fill * lower.sum);
+                row.add(fill * lower.correction);
+            }
+            return row;
+        });
+    }
+
+    // Sous la diagonale, chaque ligne commence par une suite de valInf copiée d'un seul bloc. En Matrix Market,
+    // une triangulaire à valInf nul est écrite au format coordinate (éléments stockés seulement).
+    void write(matrix_writer &out, matrix_text_format format) const override {
+        const std::size_t h = this->height, w = this->width;
+        if (format == matrix_text_format::matrix_market) {
+            if (valInf != T{}) {
+                this->writeMarketArray(out);
+                return;
+            }
+            this->writeMarketHeader(out, true, this->data.size());
+            for (std::size_t i = 0; i < std::min(h, w); i++) {
+                const T *row = this->data.data() + rowOffset(i);
+                for (std::size_t j = i; j < w; j++) {
+                    out.index(i + 1);
+                    out.put(' ');
+                    out.index(j + 1);
+                    out.put(' ');
+                    out.marketValue(row[j]);
+                    out.put('\n');
+                }
+            }
+            return;
+        }
+        const char separator = matrix_t_<T>::separatorOf(format);
+        const std::string fill = out.run(valInf, separator, w);
+        const std::size_t fillLength = w > 0 ? fill.size() / w : 0;
+        for (std::size_t i = 0; i < h; i++) {
+            const std::size_t lower = std::min(i, w);
+            out.write(fill.data(), lower * fillLength);
+            if (i < w) {
+                const T *row = this->data.data() + rowOffset(i);
+                for (std::size_t j = i; j < w; j++) {
+                    out.value(row[j]);
+                    out.put(separator);
+                }
+            }
+            this->endRow(out, format);
+        }
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        return m.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup,
+                        matrix_stats::kind::triangulaire_sup, this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_triangulaire_sup<T>>(this->height, this->width, T{});
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_triangulaire_sup<T>>(this->height, this->width, T{});
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        m.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup,
+                        matrix_stats::kind::triangulaire_sup, this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_triangulaire_sup<T> &out = matrix_t_<T>::template addDestination<matrix_triangulaire_sup<T>>(
+                dst, this->height, this->width);
+        const T sumValInf = m1.valInf + valInf;
+        matrix_t_<T>::addStream(m1.data.data(), this->data.data(), out.data.data(), this->data.size());
+        out.valInf = sumValInf;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_triangulaire_sup<T> &out = matrix_t_<T>::template addDestination<matrix_triangulaire_sup<T>>(
+                dst, this->height, this->width);
+        const T sumValInf = valInf + m1.getDefaultVal();
+        const T *packed = this->data.data(), *diag = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getDefaultVal();
+        const std::size_t w = this->width;
+        thread_pool::global().parallelForWeighted(
+                std::min(this->height, w), [this](std::size_t row) { return rowOffset(row) + row; },
+                thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+                    kernels::addTriangularDiagonal(packed, diag, fill, result, w, first, last);
+                });
+        out.valInf = sumValInf;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_sup, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    // alpha * (*this) + beta * m en une passe, comme matrix_dense::axpby() : les valInf sont combinées de même.
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_dense<T> &m1) const {
+        return m1.axpby(beta, alpha, *this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_triangulaire_sup<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_triangulaire_sup<T>>(this->height, this->width, T{});
+        axpbyInto(*result, alpha, beta, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_diag<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_triangulaire_sup<T>>(this->height, this->width, T{});
+        axpbyInto(*result, alpha, beta, m1);
+        return result;
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_dense<T> &m1) const {
+        m1.axpbyInto(dst, beta, alpha, *this);
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_triangulaire_sup<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_triangulaire_sup<T> &out = matrix_t_<T>::template addDestination<matrix_triangulaire_sup<T>>(
+                dst, this->height, this->width);
+        const T sumValInf = alpha * valInf + beta * m1.valInf;
+        matrix_t_<T>::axpbyStream(alpha, this->data.data(), beta, m1.data.data(), out.data.data(),
+                                  this->data.size());
+        out.valInf = sumValInf;
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_diag<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_triangulaire_sup<T> &out = matrix_t_<T>::template addDestination<matrix_triangulaire_sup<T>>(
+                dst, this->height, this->width);
+        const T sumValInf = alpha * valInf + beta * m1.getDefaultVal();
+        const T *packed = this->data.data(), *diag = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getDefaultVal();
+        const std::size_t w = this->width;
+        thread_pool::global().parallelForWeighted(
+                std::min(this->height, w), [this](std::size_t row) { return rowOffset(row) + row; },
+                thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+                    kernels::axpbyTriangularDiagonal(alpha, packed, beta, diag, fill, result, w, first, last);
+                });
+        out.valInf = sumValInf;
+    }
+
+    void scale(T alpha) override {
+        matrix_t_<T>::scale(alpha);
+        valInf *= alpha;
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(*this);
+    }
+
+    // m * (*this) : C(:,j) += A(:,l) * B(l,j) pour l <= j seulement, la partie basse de *this étant nulle.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getLayout() != dense_layout::column_major)
+            return multiplyLeft(m1.withLayout(dense_layout::column_major));
+        if (valInf != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        const std::size_t rows = std::min(k, w);
+        matrix_dense<T> result(h, w);
+        const T *a = m1.data.data();
+        for (std::size_t j = 0; j < w; j++) {
+            T *cCol = result.data.data() + j * h;
+            for (std::size_t l = 0; l <= j && l < rows; l++) {
+                const T bl = this->data[rowOffset(l) + j];
+                const T *aCol = a + l * h;
+                for (std::size_t i = 0; i < h; i++)
+                    cCol[i] += aCol[i] * bl;
+            }
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : le résultat reste triangulaire. Chaque ligne i de C est une combinaison des lignes l >= i
+    // de *this, parcourues sur leur partie stockée (colonnes l..w-1), soit environ n^3/6 multiplications.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.valInf != T{} || valInf != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.height, k = m1.width, w = this->width;
+        matrix_triangulaire_sup<T> result(h, w, T{});
+        const std::size_t rows = std::min(std::min(h, k), w);
+        const std::size_t innerRows = std::min(k, w);
+        for (std::size_t i = 0; i < rows; i++) {
+            const T *aRow = m1.data.data() + m1.rowOffset(i);
+            T *cRow = result.data.data() + result.rowOffset(i);
+            for (std::size_t l = i; l < innerRows; l++) {
+                const T al = aRow[l];
+                const T *bRow = this->data.data() + rowOffset(l);
+                for (std::size_t j = l; j < w; j++)
+                    cRow[j] += al * bRow[j];
+            }
+        }
+        return std::make_unique<matrix_triangulaire_sup<T>>(std::move(result));
+    }
+
+    // m * (*this) : mise à l'échelle des lignes stockées, le résultat reste triangulaire.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getDefaultVal() != T{} || valInf != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        matrix_triangulaire_sup<T> result(h, w, T{});
+        const std::size_t rows = std::min(std::min(h, k), w);
+        const T *d = m1.data.data();
+        for (std::size_t i = 0; i < rows; i++) {
+            const T *bRow = this->data.data() + rowOffset(i);
+            T *cRow = result.data.data() + result.rowOffset(i);
+            for (std::size_t j = i; j < w; j++)
+                cRow[j] = d[i] * bRow[j];
+        }
+        return std::make_unique<matrix_triangulaire_sup<T>>(std::move(result));
+    }
+
+    // m * (*this) : chaque élément (i, l) de m ajoute a * (ligne l stockée de *this) à la ligne i de C.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (valInf != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        const std::size_t rows = std::min(k, w);
+        matrix_dense<T> result(h, w);
+        T *c = result.data.data();
+        for (std::size_t i = 0; i < h; i++)
+            for (std::size_t p = m1.rowPtr[i]; p < m1.rowPtr[i + 1]; p++) {
+                const std::size_t l = m1.colIdx[p];
+                if (l >= rows)
+                    break;
+                const T a = m1.data[p];
+                const T *bRow = this->data.data() + rowOffset(l);
+                for (std::size_t j = l; j < w; j++)
+                    c[i + j * h] += a * bRow[j];
+            }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : la ligne l stockée de *this, multipliée par la colonne l de la bande, s'ajoute à C.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (valInf != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        const std::size_t rows = std::min(k, w);
+        matrix_dense<T> result(h, w);
+        T *c = result.data.data();
+        for (std::size_t l = 0; l < rows; l++) {
+            const matrix_column_segment<const T> aCol = m1.columnSegment(l);
+            const T *bRow = this->data.data() + rowOffset(l);
+            for (std::size_t j = l; j < w; j++) {
+                const T bl = bRow[j];
+                T *cCol = c + j * h;
+                for (std::size_t i = aCol.firstRow(); i < aCol.firstRow() + aCol.size(); i++)
+                    cCol[i] += aCol[i] * bl;
+            }
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // Résout (*this) x = b, b étant remplacé par x. La matrice doit être carrée.
+    //
+    // Avec valInf nul, c'est une remontée sur le stockage compact, sans copie. Sinon, soustraire à chaque
+    // ligne la précédente donne une matrice de Hessenberg (une seule sous-diagonale non nulle) : elle est
+    // triangularisée une fois par élimination de Gauss avec pivot partiel, en O(n^2) sur une copie compacte,
+    // puis chaque second membre suit les mêmes opérations avant la remontée.
+    void solveInPlace(matrix_span<T> b) const {
+        if (b.size() != this->height)
+            throw std::runtime_error("vector sizes are not compatible.");
+        solveColumns(b.data(), 1);
+    }
+
+    // Plusieurs seconds membres : les colonnes de b. Elles sont réparties entre les threads du pool et
+    // chacune est résolue par blocs (kernels::solveUpperPacked).
+    void solveInPlace(matrix_dense<T> &b) const {
+        if (b.getHeight() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (b.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> x = b.withLayout(dense_layout::column_major);
+            solveColumns(x.values().data(), x.getWidth());
+            b.copyValues(x);
+            return;
+        }
+        solveColumns(b.values().data(), b.getWidth());
+    }
+
+    matrix_dense<T> solve(const matrix_dense<T> &b) const {
+        matrix_dense<T> x(b);
+        solveInPlace(x);
+        return x;
+    }
+
+    // La transposée est une triangulaire inférieure dont les colonnes compactées sont les lignes de *this :
+    // elle reprend une copie du stockage de *this, sans le réordonner.
+    matrix_triangulaire_inf<T> transposed() const {
+        return matrix_triangulaire_inf<T>(static_cast<int>(this->width), static_cast<int>(this->height), valInf,
+                                          this->data);
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_triangulaire_inf<T>>(transposed());
+    }
+
+    // Position dans data du début (virtuel) de la ligne row : l'élément (row, col) est à rowOffset(row) + col.
+    std::size_t rowOffset(std::size_t row) const {
+        return row * this->width - (row * (row + 1)) / 2;
+    }
+
+    T getValInf() const {
+        return valInf;
+    }
+
+    void setValInf(T value) {
+        valInf = value;
+    }
+};
+
+template<typename T>
+class matrix_diag final : public matrix_t_<T> {
+private:
+    T defaultVal;
+
+    T fillValue() const override {
+        return defaultVal;
+    }
+
+    std::size_t fillCount() const override {
+        return this->height * this->width - this->data.size();
+    }
+
+    // y[i] = alpha * (diag[i] * x[i] + defaultVal * (total - x[i])) + beta * y[i] sur les lignes [first, last),
+    // total étant la somme de x ; au-delà de la diagonale, la ligne ne contient que defaultVal.
+    void scaleRows(const T *x, T total, T *y, T alpha, T beta, std::size_t first, std::size_t last) const {
+        const T *d = this->data.data();
+        const std::size_t n = this->data.size();
+        for (std::size_t i = first; i < last; i++) {
+            const T v = i < n ? d[i] * x[i] + defaultVal * (total - x[i]) : defaultVal * total;
+            y[i] = beta == T{} ? alpha * v : alpha * v + beta * y[i];
+        }
+    }
+
+public:
+    matrix_diag(int height, int width, T defaultVal) : matrix_t_<T>(height, width), defaultVal(defaultVal) {
+        this->data = matrix_storage<T>(std::min(height, width));
+    }
+
+    matrix_diag(int height, int width, T defaultVal, matrix_storage<T> storage)
+            : matrix_t_<T>(height, width), defaultVal(defaultVal) {
+        if (storage.size() != static_cast<std::size_t>(std::min(height, width)))
+            throw std::runtime_error("storage size does not match the matrix size.");
+        this->data = std::move(storage);
+    }
+
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::diag);
+        if (row < this->height && col < this->width) {
+            if (row != col)
+                return defaultVal;
+            else {
+                return this->data[row];
+            }
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::diag);
+        if (row < this->height && col < this->width) {
+            if (row != col)
+                return defaultVal;
+            else {
+                return this->data[row];
+            }
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+
+    matrix_span<T> diagonal() {
+        return this->values();
+    }
+
+    matrix_span<const T> diagonal() const {
+        return this->values();
+    }
+
+    matrix_diag_view<T> diagonalView() {
+        return {this->data.exclusiveData(), this->data.size(), 1, this->height, this->width, defaultVal};
+    }
+
+    matrix_diag_view<const T> diagonalView() const {
+        return {this->data.data(), this->data.size(), 1, this->height, this->width, defaultVal};
+    }
+
+    stored_range<diagonal_iterator<T>> stored() {
+        return {{this->data.data(), 0}, {this->data.data() + this->data.size(), this->data.size()}};
+    }
+
+    stored_range<diagonal_iterator<const T>> stored() const {
+        return {{this->data.data(), 0}, {this->data.data() + this->data.size(), this->data.size()}};
+    }
+
+    // Mise à l'échelle terme à terme par la diagonale. Hors diagonale, la ligne i ajoute
+    // defaultVal * (somme de x - x[i]) : la somme n'est calculée que si defaultVal est non nul.
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        const T *xs = x.data();
+        T *ys = y.data();
+        const T total = defaultVal == T{} ? T{} : thread_pool::global().parallelReduce(
+                0, this->width, thread_pool::defaultGrain, T{}, [xs](std::size_t first, std::size_t last) {
+                    return std::accumulate(xs + first, xs + last, T{});
+                });
+        thread_pool::global().parallelFor(0, this->height, thread_pool::defaultGrain,
+                                          [=](std::size_t first, std::size_t last) {
+                                              scaleRows(xs, total, ys, alpha, beta, first, last);
+                                          });
+    }
+
+    // Les vecteurs sont répartis entre les threads, chacun traité comme dans multiplyVector().
+    void multiplyVectors(const matrix_dense<T> &x, matrix_dense<T> &y, T alpha = T(1),
+                         T beta = T{}) const override {
+        this->checkVectorBatch(x, y);
+        if (!this->vectorsColumnMajor(x, y, alpha, beta))
+            return;
+        const std::size_t h = this->height, w = this->width;
+        const T *xs = x.values().data();
+        T *ys = y.values().data();
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain / std::max<std::size_t>(1, h));
+        thread_pool::global().parallelFor(0, x.getWidth(), grain, [=](std::size_t first, std::size_t last) {
+            for (std::size_t c = first; c < last; c++) {
+                const T *xc = xs + c * w;
+                T *yc = ys + c * h;
+                const T total = defaultVal == T{} ? T{} : std::accumulate(xc, xc + w, T{});
+                scaleRows(xc, total, yc, alpha, beta, 0, h);
+            }
+        });
+    }
+
+    T traceSum(reduce::summation mode) const override {
+        return reduce::parallelSum(this->data.data(), this->data.size(), mode);
+    }
+
+    // Colonne j : |diag[j]| et height - 1 fois |defaultVal|, en O(1).
+    reduce::norm_t<T> norm1(reduce::summation = reduce::summation::pairwise) const override {
+        const T *diag = this->data.data();
+        const std::size_t h = this->height, n = this->data.size();
+        const reduce::norm_t<T> fill = reduce::magnitude(defaultVal);
+        return this->maxColumn([diag, h, n, fill](std::size_t j) {
+            return j < n ? reduce::magnitude(diag[j]) + fill * static_cast<reduce::norm_t<T>>(h - 1)
+                         : fill * static_cast<reduce::norm_t<T>>(h);
+        });
+    }
+
+    // Diagonale contre celle de m ; avec defaultVal non nul, defaultVal fois la somme de m hors diagonale,
+    // obtenue par m.sum() - m.traceSum() sans parcourir les cases hors stockage de m.
+    T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const override {
+        this->checkSameSize(m);
+        const T *diag = this->data.data();
+        reduce::compensated<T> result;
+        if (const auto *other = dynamic_cast<const matrix_diag<T> *>(&m)) {
+            result.add(reduce::parallelDot(diag, other->data.data(), this->data.size(), mode));
+            result.add(defaultVal * other->defaultVal * static_cast<T>(fillCount()));
+            return result.value();
+        }
+        result.add(reduce::parallelSum<T>(this->data.size(), matrix_t_<T>::traceGrain, mode,
+                                          [diag, &m](std::size_t i) { return diag[i] * m(i, i); }));
+        if (defaultVal != T{}) {
+            result.add(defaultVal * m.sum(mode));
+            result.add(-defaultVal * m.traceSum(mode));
+        }
+        return result.value();
+    }
+
+
+    // Hors diagonale, chaque ligne est faite de deux suites de defaultVal copiées d'un seul bloc. En Matrix
+    // Market, une diagonale à defaultVal nul est écrite au format coordinate.
+    void write(matrix_writer &out, matrix_text_format format) const override {
+        const std::size_t h = this->height, w = this->width, n = this->data.size();
+        if (format == matrix_text_format::matrix_market) {
+            if (defaultVal != T{}) {
+                this->writeMarketArray(out);
+                return;
+            }
+            this->writeMarketHeader(out, true, n);
+            for (std::size_t i = 0; i < n; i++) {
+                out.index(i + 1);
+                out.put(' ');
+                out.index(i + 1);
+                out.put(' ');
+                out.marketValue(this->data[i]);
+                out.put('\n');
+            }
+            return;
+        }
+        const char separator = matrix_t_<T>::separatorOf(format);
+        const std::string fill = out.run(defaultVal, separator, w);
+        const std::size_t fillLength = w > 0 ? fill.size() / w : 0;
+        for (std::size_t i = 0; i < h; i++) {
+            if (i < n) {
+                out.write(fill.data(), i * fillLength);
+                out.value(this->data[i]);
+                out.put(separator);
+                out.write(fill.data(), (w - i - 1) * fillLength);
+            } else
+                out.write(fill.data(), w * fillLength);
+            this->endRow(out, format);
+        }
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        return m.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_diag<T>>(this->height, this->width, T{});
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        return m1.add(*this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        m.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_diag<T> &out = matrix_t_<T>::template addDestination<matrix_diag<T>>(dst, this->height, this->width);
+        const T sumDefaultVal = m1.defaultVal + defaultVal;
+        matrix_t_<T>::addStream(m1.data.data(), this->data.data(), out.data.data(), this->data.size());
+        out.defaultVal = sumDefaultVal;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::diag, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    // alpha * (*this) + beta * m en une passe, comme matrix_dense::axpby().
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_dense<T> &m1) const {
+        return m1.axpby(beta, alpha, *this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_triangulaire_sup<T> &m1) const {
+        return m1.axpby(beta, alpha, *this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> axpby(T alpha, T beta, const matrix_diag<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        auto result = std::make_unique<matrix_diag<T>>(this->height, this->width, T{});
+        axpbyInto(*result, alpha, beta, m1);
+        return result;
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_dense<T> &m1) const {
+        m1.axpbyInto(dst, beta, alpha, *this);
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_triangulaire_sup<T> &m1) const {
+        m1.axpbyInto(dst, beta, alpha, *this);
+    }
+
+    void axpbyInto(matrix_t_<T> &dst, T alpha, T beta, const matrix_diag<T> &m1) const {
+        if (m1.getHeight() != this->height || m1.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+        matrix_diag<T> &out = matrix_t_<T>::template addDestination<matrix_diag<T>>(dst, this->height, this->width);
+        const T sumDefaultVal = alpha * defaultVal + beta * m1.defaultVal;
+        matrix_t_<T>::axpbyStream(alpha, this->data.data(), beta, m1.data.data(), out.data.data(),
+                                  this->data.size());
+        out.defaultVal = sumDefaultVal;
+    }
+
+    void scale(T alpha) override {
+        matrix_t_<T>::scale(alpha);
+        defaultVal *= alpha;
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(*this);
+    }
+
+    // m * (*this) : mise à l'échelle des colonnes de m.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getLayout() != dense_layout::column_major)
+            return multiplyLeft(m1.withLayout(dense_layout::column_major));
+        if (defaultVal != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), w = this->width;
+        matrix_dense<T> result(h, w);
+        const T *a = m1.data.data();
+        for (std::size_t j = 0; j < this->data.size(); j++) {
+            const T dj = this->data[j];
+            const T *aCol = a + j * h;
+            T *cCol = result.data.data() + j * h;
+            for (std::size_t i = 0; i < h; i++)
+                cCol[i] = aCol[i] * dj;
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : mise à l'échelle des colonnes de m, le résultat reste triangulaire.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getValInf() != T{} || defaultVal != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        matrix_triangulaire_sup<T> result(h, w, T{});
+        const std::size_t rows = std::min(std::min(h, k), w);
+        const std::size_t cols = this->data.size();
+        const T *a = m1.data.data();
+        for (std::size_t i = 0; i < rows; i++) {
+            const T *aRow = a + m1.rowOffset(i);
+            for (std::size_t j = i; j < cols; j++)
+                result(i, j) = aRow[j] * this->data[j];
+        }
+        return std::make_unique<matrix_triangulaire_sup<T>>(std::move(result));
+    }
+
+    // m * (*this) : produit terme à terme des diagonales, en O(n).
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        if (m1.width != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.defaultVal != T{} || defaultVal != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        matrix_diag<T> result(m1.height, this->width, T{});
+        const std::size_t n = std::min(std::min(m1.data.size(), this->data.size()), result.data.size());
+        for (std::size_t i = 0; i < n; i++)
+            result.data[i] = m1.data[i] * this->data[i];
+        return std::make_unique<matrix_diag<T>>(std::move(result));
+    }
+
+    // m * (*this) : mise à l'échelle des colonnes de m, le résultat reste creux. Les colonnes au-delà de la
+    // diagonale de *this sont nulles et disparaissent.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (defaultVal != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t n = this->data.size();
+        const std::size_t *rowPtr = m1.rowPtr.data(), *colIdx = m1.colIdx.data();
+        const T *a = m1.data.data(), *d = this->data.data();
+        auto result = std::make_unique<matrix_csr<T>>(m1.getHeight(), this->width);
+        result->assignRows(
+                m1.getHeight(), [rowPtr](std::size_t row) { return rowPtr[row] + row; },
+                [=](std::size_t i) {
+                    return static_cast<std::size_t>(std::lower_bound(colIdx + rowPtr[i], colIdx + rowPtr[i + 1], n) -
+                                                    (colIdx + rowPtr[i]));
+                },
+                [=](std::size_t i, std::size_t *cols, T *values) {
+                    for (std::size_t p = rowPtr[i]; p < rowPtr[i + 1] && colIdx[p] < n; p++) {
+                        *cols++ = colIdx[p];
+                        *values++ = a[p] * d[colIdx[p]];
+                    }
+                });
+        return result;
+    }
+
+    // m * (*this) : mise à l'échelle des colonnes de la bande, le résultat garde la même bande.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (defaultVal != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        auto result = std::make_unique<matrix_band<T>>(m1.getHeight(), this->width, m1.getLowerBandwidth(),
+                                                       m1.getUpperBandwidth());
+        const std::size_t cols = std::min(this->data.size(), m1.getWidth());
+        for (std::size_t j = 0; j < cols; j++) {
+            const matrix_column_segment<const T> aCol = m1.columnSegment(j);
+            const matrix_column_segment<T> cCol = result->columnSegment(j);
+            const std::size_t last = std::min(aCol.firstRow() + aCol.size(), cCol.firstRow() + cCol.size());
+            for (std::size_t i = cCol.firstRow(); i < last; i++)
+                cCol[i] = aCol[i] * this->data[j];
+        }
+        return result;
+    }
+
+    // La transposée d'une diagonale a les mêmes éléments : seules les dimensions sont échangées, le stockage
+    // est copié tel quel.
+    matrix_diag<T> transposed() const {
+        return matrix_diag<T>(static_cast<int>(this->width), static_cast<int>(this->height), defaultVal, this->data);
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_diag<T>>(transposed());
+    }
+
+    // Sur place, en temps constant.
+    void transposeInPlace() {
+        std::swap(this->height, this->width);
+    }
+
+    T getDefaultVal() const {
+        return defaultVal;
+    }
+
+    void setDefaultVal(T value) {
+        defaultVal = value;
+    }
+};
+
+// Matrice creuse au format CSR (compressed sparse row) : seuls les éléments non nuls sont stockés, ligne par
+// ligne. Les éléments de la ligne i sont aux positions rowPtr[i]..rowPtr[i + 1] - 1 de colIdx (colonnes
+// strictement croissantes) et de data. La mémoire utilisée est proportionnelle au nombre d'éléments stockés.
+//
+// Résultats de add() : csr + csr et csr + diag (defaultVal nul) restent creux, csr + dense, csr + triangulaire
+// et csr + diag à defaultVal non nul sont denses.
+// Élément (row, col, value) d'une liste de triplets, pour construire une matrix_csr.
+template<typename T>
+struct csr_triplet {
+    std::size_t row;
+    std::size_t col;
+    T value;
+};
+
+template<typename T>
+class matrix_csr final : public matrix_t_<T> {
+    template<typename> friend class matrix_dense;
+
+    template<typename> friend class matrix_triangulaire_sup;
+
+    template<typename> friend class matrix_diag;
+
+    template<typename> friend class matrix_band;
+
+private:
+    std::vector<std::size_t> rowPtr;
+    std::vector<std::size_t> colIdx;
+    // Valeur renvoyée par operator() const pour un élément non stocké.
+    T zero = {};
+
+    // Position de (row, col) dans colIdx/data, ou colIdx.size() si l'élément n'est pas stocké.
+    std::size_t find(std::size_t row, std::size_t col) const {
+        auto first = colIdx.begin() + rowPtr[row], last = colIdx.begin() + rowPtr[row + 1];
+        auto it = std::lower_bound(first, last, col);
+        return it != last && *it == col ? it - colIdx.begin() : colIdx.size();
+    }
+
+    // Reconstruit la structure ligne par ligne en deux passes réparties entre les threads : count(i) donne le
+    // nombre d'éléments de la ligne i, puis fill(i, cols, values) les écrit. cumulative(i) est le travail
+    // estimé des lignes [0, i). Les opérandes lus par count et fill peuvent être *this : la nouvelle
+    // structure ne remplace l'ancienne qu'à la fin.
+    template<typename W, typename C, typename F>
+    void assignRows(std::size_t rows, W &&cumulative, C &&count, F &&fill) {
+        std::vector<std::size_t> newRowPtr(rows + 1, 0);
+        thread_pool::global().parallelForWeighted(rows, cumulative, thread_pool::defaultGrain,
+                                                  [&](std::size_t first, std::size_t last) {
+                                                      for (std::size_t i = first; i < last; i++)
+                                                          newRowPtr[i + 1] = count(i);
+                                                  });
+        std::partial_sum(newRowPtr.begin(), newRowPtr.end(), newRowPtr.begin());
+        std::vector<std::size_t> newColIdx(newRowPtr[rows]);
+        matrix_storage<T> newData(newRowPtr[rows]);
+        thread_pool::global().parallelForWeighted(rows, cumulative, thread_pool::defaultGrain,
+                                                  [&](std::size_t first, std::size_t last) {
+                                                      for (std::size_t i = first; i < last; i++)
+                                                          fill(i, newColIdx.data() + newRowPtr[i],
+                                                               newData.data() + newRowPtr[i]);
+                                                  });
+        rowPtr = std::move(newRowPtr);
+        colIdx = std::move(newColIdx);
+        this->data = std::move(newData);
+    }
+
+    // Conversion générique : deux parcours de at(i, j) ligne par ligne, en ne gardant que les non-zéros.
+    template<typename F>
+    void assignNonZeros(F &&at) {
+        const std::size_t h = this->height, w = this->width;
+        assignRows(
+                h, [w](std::size_t row) { return row * w; },
+                [&](std::size_t i) {
+                    std::size_t n = 0;
+                    for (std::size_t j = 0; j < w; j++)
+                        n += at(i, j) != T{};
+                    return n;
+                },
+                [&](std::size_t i, std::size_t *cols, T *values) {
+                    for (std::size_t j = 0; j < w; j++) {
+                        const T v = at(i, j);
+                        if (v != T{}) {
+                            *cols++ = j;
+                            *values++ = v;
+                        }
+                    }
+                });
+    }
+
+    void checkSize(const matrix_t_<T> &m) const {
+        if (m.getHeight() != this->height || m.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+    }
+
+    // out (dense, column-major) += *this, réparti par lignes.
+    void scatterInto(T *out) const {
+        const std::size_t *rp = rowPtr.data(), *ci = colIdx.data();
+        const T *values = this->data.data();
+        const std::size_t h = this->height;
+        thread_pool::global().parallelForWeighted(
+                h, [rp](std::size_t row) { return rp[row] + row; }, thread_pool::defaultGrain,
+                [=](std::size_t first, std::size_t last) {
+                    kernels::addSparseToDense(rp, ci, values, out, h, first, last);
+                });
+    }
+
+public:
+    // Matrice vide : aucun élément stocké.
+    matrix_csr(int height, int width) : matrix_t_<T>(height, width), rowPtr(this->height + 1, 0) {}
+
+    // Structure fournie directement, vérifiée : rowPtr a height + 1 entrées croissantes de 0 à nnz, et les
+    // colonnes de chaque ligne sont strictement croissantes et inférieures à width.
+    matrix_csr(int height, int width, std::vector<std::size_t> rowPtr, std::vector<std::size_t> colIdx,
+               matrix_storage<T> values)
+            : matrix_t_<T>(height, width), rowPtr(std::move(rowPtr)), colIdx(std::move(colIdx)) {
+        const std::vector<std::size_t> &rp = this->rowPtr, &ci = this->colIdx;
+        if (rp.size() != this->height + 1 || rp.front() != 0 || rp.back() != ci.size() || values.size() != ci.size())
+            throw std::runtime_error("invalid CSR structure.");
+        for (std::size_t i = 0; i < this->height; i++) {
+            if (rp[i] > rp[i + 1])
+                throw std::runtime_error("invalid CSR structure.");
+            for (std::size_t k = rp[i]; k < rp[i + 1]; k++)
+                if (ci[k] >= this->width || (k > rp[i] && ci[k] <= ci[k - 1]))
+                    throw std::runtime_error("invalid CSR structure.");
+        }
+        this->data = std::move(values);
+    }
+
+    // Construction à partir de triplets (row, col, value) dans un ordre quelconque, en O(nnz log nnz) : ils
+    // sont triés par ligne puis par colonne, et les triplets d'une même position sont additionnés.
+    matrix_csr(int height, int width, std::vector<csr_triplet<T>> triplets) : matrix_csr(height, width) {
+        for (const csr_triplet<T> &t : triplets)
+            if (t.row >= this->height || t.col >= this->width)
+                throw std::out_of_range("Out of range.");
+        std::sort(triplets.begin(), triplets.end(), [](const csr_triplet<T> &a, const csr_triplet<T> &b) {
+            return a.row != b.row ? a.row < b.row : a.col < b.col;
+        });
+        auto samePosition = [&triplets](std::size_t k) {
+            return k > 0 && triplets[k].row == triplets[k - 1].row && triplets[k].col == triplets[k - 1].col;
+        };
+        for (std::size_t k = 0; k < triplets.size(); k++)
+            if (!samePosition(k)) {
+                rowPtr[triplets[k].row + 1]++;
+                colIdx.push_back(triplets[k].col);
+            }
+        std::partial_sum(rowPtr.begin(), rowPtr.end(), rowPtr.begin());
+        matrix_storage<T> values(colIdx.size());
+        for (std::size_t k = 0, n = 0; k < triplets.size(); k++) {
+            if (!samePosition(k))
+                n++;
+            values[n - 1] += triplets[k].value;
+        }
+        this->data = std::move(values);
+    }
+
+    // Conversions depuis les autres classes : seuls les éléments non nuls sont gardés.
+    // Lecture par index() : l'élément (i, j) est à sa place dans la disposition de m, quelle qu'elle soit.
+    explicit matrix_csr(const matrix_dense<T> &m) : matrix_csr(m.getHeight(), m.getWidth()) {
+        const T *d = m.data.data();
+        assignNonZeros([d, &m](std::size_t i, std::size_t j) { return d[m.index(i, j)]; });
+    }
+
+    explicit matrix_csr(const matrix_triangulaire_sup<T> &m) : matrix_csr(m.getHeight(), m.getWidth()) {
+        if (m.getValInf() != T{}) {
+            assignNonZeros([&m](std::size_t i, std::size_t j) { return m(i, j); });
+            return;
+        }
+        const std::size_t w = this->width, rows = std::min(this->height, w);
+        assignRows(
+                this->height, [&m, rows](std::size_t row) { return m.rowOffset(std::min(row, rows)) + row; },
+                [&m, rows](std::size_t i) {
+                    std::size_t n = 0;
+                    if (i < rows)
+                        for (const T &v : m.rowSegment(i))
+                            n += v != T{};
+                    return n;
+                },
+                [&m, rows, w](std::size_t i, std::size_t *cols, T *values) {
+                    if (i >= rows)
+                        return;
+                    matrix_row_segment<const T> row = m.rowSegment(i);
+                    for (std::size_t j = i; j < w; j++)
+                        if (row[j] != T{}) {
+                            *cols++ = j;
+                            *values++ = row[j];
+                        }
+                });
+    }
+
+    explicit matrix_csr(const matrix_diag<T> &m) : matrix_csr(m.getHeight(), m.getWidth()) {
+        if (m.getDefaultVal() != T{}) {
+            assignNonZeros([&m](std::size_t i, std::size_t j) { return m(i, j); });
+            return;
+        }
+        const T *d = m.data.data();
+        const std::size_t n = m.data.size();
+        assignRows(
+                this->height, [](std::size_t row) { return row; },
+                [d, n](std::size_t i) -> std::size_t { return i < n && d[i] != T{}; },
+                [d, n](std::size_t i, std::size_t *cols, T *values) {
+                    if (i < n && d[i] != T{}) {
+                        *cols = i;
+                        *values = d[i];
+                    }
+                });
+    }
+
+    // Un élément non stocké est inséré (valeur nulle) avant d'être renvoyé : l'insertion déplace la fin du
+    // stockage et invalide les références et vues obtenues avant. Pour lire sans insérer, passer par une
+    // référence const. Chaque insertion recopie le stockage et décale colIdx et rowPtr, en O(nnz + height) :
+    // remplir une matrice élément par élément est quadratique, le constructeur à partir de triplets ne l'est pas.
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::csr);
+        if (row < this->height && col < this->width) {
+            std::size_t k = find(row, col);
+            if (k != colIdx.size())
+                return this->data[k];
+            k = std::lower_bound(colIdx.begin() + rowPtr[row], colIdx.begin() + rowPtr[row + 1], col) -
+                colIdx.begin();
+            matrix_storage<T> grown(this->data.size() + 1);
+            std::copy(this->data.begin(), this->data.begin() + k, grown.begin());
+            std::copy(this->data.begin() + k, this->data.end(), grown.begin() + k + 1);
+            this->data = std::move(grown);
+            colIdx.insert(colIdx.begin() + k, col);
+            for (std::size_t i = row + 1; i <= this->height; i++)
+                rowPtr[i]++;
+            return this->data[k];
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::csr);
+        if (row < this->height && col < this->width) {
+            const std::size_t k = find(row, col);
+            return k != colIdx.size() ? this->data[k] : zero;
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    // Positions de début de chaque ligne (height + 1 entrées) et colonnes des éléments stockés.
+    matrix_span<const std::size_t> rowPointers() const {
+        return {rowPtr.data(), rowPtr.size()};
+    }
+
+    matrix_span<const std::size_t> columnIndices() const {
+        return {colIdx.data(), colIdx.size()};
+    }
+
+    // Un produit scalaire creux par ligne ; les lignes sont réparties selon leur nombre d'éléments stockés.
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        const std::size_t *rp = rowPtr.data(), *ci = colIdx.data();
+        const T *values = this->data.data(), *xs = x.data();
+        T *ys = y.data();
+        thread_pool::global().parallelForWeighted(
+                this->height, [rp](std::size_t row) { return rp[row] + row; }, thread_pool::defaultGrain,
+                [=](std::size_t first, std::size_t last) {
+                    for (std::size_t i = first; i < last; i++) {
+                        T sum = {};
+                        for (std::size_t k = rp[i]; k < rp[i + 1]; k++)
+                            sum += values[k] * xs[ci[k]];
+                        ys[i] = beta == T{} ? alpha * sum : alpha * sum + beta * ys[i];
+                    }
+                });
+    }
+
+    // Une recherche dichotomique par ligne : O(rows * log(nnz par ligne)).
+    T traceSum(reduce::summation mode) const override {
+        return reduce::parallelSum<T>(std::min(this->height, this->width), matrix_t_<T>::traceGrain, mode,
+                                      [this](std::size_t i) {
+                                          const std::size_t k = find(i, i);
+                                          return k != colIdx.size() ? this->data[k] : T{};
+                                      });
+    }
+
+    // Les éléments stockés sont dispersés dans les colonnes : une somme compensée par colonne, en un
+    // parcours séquentiel du stockage (la sommation est toujours compensée).
+    reduce::norm_t<T> norm1(reduce::summation = reduce::summation::pairwise) const override {
+        std::vector<reduce::compensated<reduce::norm_t<T>>> columns(this->width);
+        for (std::size_t k = 0; k < colIdx.size(); k++)
+            columns[colIdx[k]].add(reduce::magnitude(this->data[k]));
+        reduce::norm_t<T> result = {};
+        for (const auto &column : columns)
+            result = std::max(result, column.value());
+        return result;
+    }
+
+    // Éléments stockés contre m, ligne par ligne : les zéros structurels ne sont pas lus.
+    T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const override {
+        this->checkSameSize(m);
+        return this->sumOver(this->height, [this, &m, mode](std::size_t i) {
+            return reduce::sum<T>(rowPtr[i], rowPtr[i + 1], [this, &m, i](std::size_t k) {
+                return this->data[k] * m(i, colIdx[k]);
+            }, mode);
+        });
+    }
+
+    // Les zéros entre deux éléments stockés sont copiés d'un seul bloc ; Matrix Market utilise le format
+    // coordinate.
+    void write(matrix_writer &out, matrix_text_format format) const override {
+        const std::size_t h = this->height, w = this->width;
+        if (format == matrix_text_format::matrix_market) {
+            this->writeMarketHeader(out, true, colIdx.size());
+            for (std::size_t i = 0; i < h; i++)
+                for (std::size_t k = rowPtr[i]; k < rowPtr[i + 1]; k++) {
+                    out.index(i + 1);
+                    out.put(' ');
+                    out.index(colIdx[k] + 1);
+                    out.put(' ');
+                    out.marketValue(this->data[k]);
+                    out.put('\n');
+                }
+            return;
+        }
+        const char separator = matrix_t_<T>::separatorOf(format);
+        const std::string zeros = out.run(T{}, separator, w);
+        const std::size_t zeroLength = w > 0 ? zeros.size() / w : 0;
+        for (std::size_t i = 0; i < h; i++) {
+            std::size_t next = 0;
+            for (std::size_t k = rowPtr[i]; k < rowPtr[i + 1]; k++) {
+                out.write(zeros.data(), (colIdx[k] - next) * zeroLength);
+                out.value(this->data[k]);
+                out.put(separator);
+                next = colIdx[k] + 1;
+            }
+            out.write(zeros.data(), (w - next) * zeroLength);
+            this->endRow(out, format);
+        }
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        return m.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        std::unique_ptr<matrix_t_<T>> result;
+        if (m1.getDefaultVal() != T{})
+            result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        else
+            result = std::make_unique<matrix_csr<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_csr<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        return m1.add(*this);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        m.addInto(dst, *this);
+    }
+
+    // Copie de la dense (sauf si dst est cette dense) puis ajout des éléments stockés.
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        if (m1.getLayout() != dense_layout::column_major || out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result = m1.withLayout(dense_layout::column_major);
+            addInto(result, result);
+            out.copyValues(result);
+            return;
+        }
+        const T *dense = m1.data.data();
+        T *result = out.data.data();
+        if (result != dense)
+            thread_pool::global().parallelFor(0, out.data.size(), thread_pool::defaultGrain,
+                                              [=](std::size_t first, std::size_t last) {
+                                                  std::copy(dense + first, dense + last, result + first);
+                                              });
+        scatterInto(result);
+    }
+
+    // La triangulaire est dépliée dans dst colonne par colonne, puis les éléments stockés sont ajoutés.
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        if (out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result(this->height, this->width);
+            addInto(result, m1);
+            out.copyValues(result);
+            return;
+        }
+        const T *packed = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getValInf();
+        const std::size_t h = this->height, w = this->width;
+        thread_pool::global().parallelFor(0, w, out.columnGrain(), [=](std::size_t first, std::size_t last) {
+            kernels::expandTriangular(packed, fill, result, h, w, first, last);
+        });
+        scatterInto(result);
+    }
+
+    // defaultVal nul : fusion de chaque ligne avec son élément diagonal, le résultat reste creux. Sinon dst
+    // est dense.
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        const T *diag = m1.data.data();
+        const std::size_t n = m1.data.size();
+        if (m1.getDefaultVal() != T{}) {
+            matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                           this->width);
+            if (out.getLayout() != dense_layout::column_major) {
+                matrix_dense<T> result(this->height, this->width);
+                addInto(result, m1);
+                out.copyValues(result);
+                return;
+            }
+            T *result = out.data.data();
+            const T fill = m1.getDefaultVal();
+            const std::size_t h = this->height;
+            std::fill(result, result + out.data.size(), fill);
+            for (std::size_t i = 0; i < n; i++)
+                result[i + i * h] = diag[i];
+            scatterInto(result);
+            return;
+        }
+        matrix_csr<T> &out = matrix_t_<T>::template addDestination<matrix_csr<T>>(dst, this->height, this->width);
+        const std::size_t *rp = rowPtr.data(), *ci = colIdx.data();
+        const T *values = this->data.data();
+        out.assignRows(
+                this->height, [rp](std::size_t row) { return rp[row] + row; },
+                [=](std::size_t i) {
+                    return i < n ? kernels::sparseUnionSize(ci + rp[i], rp[i + 1] - rp[i], &i, 1) : rp[i + 1] - rp[i];
+                },
+                [=](std::size_t i, std::size_t *cols, T *result) {
+                    if (i < n)
+                        kernels::addSparseRows(ci + rp[i], values + rp[i], rp[i + 1] - rp[i], &i, diag + i, 1,
+                                               cols, result);
+                    else {
+                        std::copy(ci + rp[i], ci + rp[i + 1], cols);
+                        std::copy(values + rp[i], values + rp[i + 1], result);
+                    }
+                });
+    }
+
+    // Fusion ligne à ligne des deux structures (union des colonnes).
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_csr<T> &out = matrix_t_<T>::template addDestination<matrix_csr<T>>(dst, this->height, this->width);
+        const std::size_t *aPtr = m1.rowPtr.data(), *aCol = m1.colIdx.data();
+        const std::size_t *bPtr = rowPtr.data(), *bCol = colIdx.data();
+        const T *a = m1.data.data(), *b = this->data.data();
+        out.assignRows(
+                this->height, [aPtr, bPtr](std::size_t row) { return aPtr[row] + bPtr[row] + row; },
+                [=](std::size_t i) {
+                    return kernels::sparseUnionSize(aCol + aPtr[i], aPtr[i + 1] - aPtr[i],
+                                                    bCol + bPtr[i], bPtr[i + 1] - bPtr[i]);
+                },
+                [=](std::size_t i, std::size_t *cols, T *values) {
+                    kernels::addSparseRows(aCol + aPtr[i], a + aPtr[i], aPtr[i + 1] - aPtr[i],
+                                           bCol + bPtr[i], b + bPtr[i], bPtr[i + 1] - bPtr[i], cols, values);
+                });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::csr, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        m1.addInto(dst, *this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(*this);
+    }
+
+    // m * (*this) : chaque élément (l, j) de *this ajoute b * (colonne l de m) à la colonne j de C.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getLayout() != dense_layout::column_major)
+            return multiplyLeft(m1.withLayout(dense_layout::column_major));
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        matrix_dense<T> result(h, w);
+        const T *a = m1.data.data();
+        T *c = result.data.data();
+        for (std::size_t l = 0; l < k; l++) {
+            const T *aCol = a + l * h;
+            for (std::size_t p = rowPtr[l]; p < rowPtr[l + 1]; p++) {
+                const T b = this->data[p];
+                T *cCol = c + colIdx[p] * h;
+                for (std::size_t i = 0; i < h; i++)
+                    cCol[i] += aCol[i] * b;
+            }
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : la colonne l de m n'a d'éléments stockés que sur les lignes 0..l.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getValInf() != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), k = m1.getWidth(), w = this->width;
+        const std::size_t rows = std::min(h, k);
+        matrix_dense<T> result(h, w);
+        const T *a = m1.data.data();
+        T *c = result.data.data();
+        for (std::size_t l = 0; l < k; l++)
+            for (std::size_t p = rowPtr[l]; p < rowPtr[l + 1]; p++) {
+                const T b = this->data[p];
+                T *cCol = c + colIdx[p] * h;
+                for (std::size_t i = 0; i <= l && i < rows; i++)
+                    cCol[i] += a[m1.rowOffset(i) + l] * b;
+            }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : mise à l'échelle des lignes, le résultat reste creux.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getDefaultVal() != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t n = m1.data.size();
+        const std::size_t *rp = rowPtr.data(), *ci = colIdx.data();
+        const T *b = this->data.data(), *d = m1.data.data();
+        auto result = std::make_unique<matrix_csr<T>>(m1.getHeight(), this->width);
+        result->assignRows(
+                m1.getHeight(), [rp, n](std::size_t row) { return rp[std::min(row, n)] + row; },
+                [=](std::size_t i) { return i < n ? rp[i + 1] - rp[i] : 0; },
+                [=](std::size_t i, std::size_t *cols, T *values) {
+                    if (i >= n)
+                        return;
+                    for (std::size_t p = rp[i]; p < rp[i + 1]; p++) {
+                        *cols++ = ci[p];
+                        *values++ = d[i] * b[p];
+                    }
+                });
+        return result;
+    }
+
+    // m * (*this), algorithme de Gustavson : la ligne i de C accumule b(l, :) * a(i, l) dans un tableau
+    // dense de la largeur du résultat, puis les colonnes touchées sont triées et recopiées.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        const std::size_t h = m1.getHeight(), w = this->width;
+        std::vector<std::size_t> cRowPtr(h + 1, 0), cColIdx;
+        std::vector<T> cValues;
+        std::vector<T> accumulator(w, T{});
+        std::vector<bool> touched(w, false);
+        std::vector<std::size_t> columns;
+        for (std::size_t i = 0; i < h; i++) {
+            columns.clear();
+            for (std::size_t p = m1.rowPtr[i]; p < m1.rowPtr[i + 1]; p++) {
+                const std::size_t l = m1.colIdx[p];
+                const T a = m1.data[p];
+                for (std::size_t q = rowPtr[l]; q < rowPtr[l + 1]; q++) {
+                    const std::size_t j = colIdx[q];
+                    if (!touched[j]) {
+                        touched[j] = true;
+                        columns.push_back(j);
+                    }
+                    accumulator[j] += a * this->data[q];
+                }
+            }
+            std::sort(columns.begin(), columns.end());
+            for (std::size_t j : columns) {
+                cColIdx.push_back(j);
+                cValues.push_back(accumulator[j]);
+                accumulator[j] = T{};
+                touched[j] = false;
+            }
+            cRowPtr[i + 1] = cColIdx.size();
+        }
+        matrix_storage<T> values(cValues.size());
+        std::copy(cValues.begin(), cValues.end(), values.begin());
+        return std::make_unique<matrix_csr<T>>(h, w, std::move(cRowPtr), std::move(cColIdx), std::move(values));
+    }
+
+    // m * (*this) : chaque élément (l, j) de *this ajoute b * (colonne l de la bande) à la colonne j de C.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        const std::size_t h = m1.getHeight(), k = m1.getWidth();
+        matrix_dense<T> result(h, this->width);
+        T *c = result.data.data();
+        for (std::size_t l = 0; l < k; l++) {
+            const matrix_column_segment<const T> aCol = m1.columnSegment(l);
+            for (std::size_t p = rowPtr[l]; p < rowPtr[l + 1]; p++) {
+                const T b = this->data[p];
+                T *cCol = c + colIdx[p] * h;
+                for (std::size_t i = aCol.firstRow(); i < aCol.firstRow() + aCol.size(); i++)
+                    cCol[i] += aCol[i] * b;
+            }
+        }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // Conversions vers les autres classes. toTriangulaireSup() et toDiag() refusent une matrice dont un
+    // élément stocké non nul est hors de leur structure.
+    matrix_dense<T> toDense() const {
+        matrix_dense<T> result(this->height, this->width);
+        scatterInto(result.data.data());
+        return result;
+    }
+
+    matrix_triangulaire_sup<T> toTriangulaireSup() const {
+        matrix_triangulaire_sup<T> result(this->height, this->width, T{});
+        for (std::size_t i = 0; i < this->height; i++)
+            for (std::size_t k = rowPtr[i]; k < rowPtr[i + 1]; k++) {
+                if (colIdx[k] >= i)
+                    result.data[result.rowOffset(i) + colIdx[k]] = this->data[k];
+                else if (this->data[k] != T{})
+                    throw std::runtime_error("matrix is not upper triangular.");
+            }
+        return result;
+    }
+
+    matrix_diag<T> toDiag() const {
+        matrix_diag<T> result(this->height, this->width, T{});
+        for (std::size_t i = 0; i < this->height; i++)
+            for (std::size_t k = rowPtr[i]; k < rowPtr[i + 1]; k++) {
+                if (colIdx[k] == i)
+                    result.data[i] = this->data[k];
+                else if (this->data[k] != T{})
+                    throw std::runtime_error("matrix is not diagonal.");
+            }
+        return result;
+    }
+
+    // Transposée (CSR de la transposée, soit le format CSC de *this) par tri par comptage : un passage compte
+    // les éléments de chaque colonne, un second les range dans l'ordre des lignes, qui donne des colonnes
+    // croissantes dans chaque ligne du résultat. Temps en O(nnz + width).
+    matrix_csr<T> transposed() const {
+        const std::size_t h = this->height, w = this->width, nnz = colIdx.size();
+        matrix_csr<T> result(static_cast<int>(w), static_cast<int>(h));
+        std::vector<std::size_t> &rp = result.rowPtr;
+        for (std::size_t k = 0; k < nnz; k++)
+            rp[colIdx[k] + 1]++;
+        std::partial_sum(rp.begin(), rp.end(), rp.begin());
+        std::vector<std::size_t> next(rp.begin(), rp.end() - 1);
+        result.colIdx.resize(nnz);
+        result.data = matrix_storage<T>(nnz);
+        for (std::size_t i = 0; i < h; i++)
+            for (std::size_t k = rowPtr[i]; k < rowPtr[i + 1]; k++) {
+                const std::size_t p = next[colIdx[k]]++;
+                result.colIdx[p] = i;
+                result.data[p] = this->data[k];
+            }
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_csr<T>>(transposed());
+    }
+};
+
+// Matrice bande : kl sous-diagonales et ku sur-diagonales autour de la diagonale, le reste est nul. Le
+// stockage est celui de LAPACK (gbmv, gbsv...) : colonne par colonne, kl + ku + 1 cases par colonne, l'élément
+// (i, j) étant à ku + i - j + j * (kl + ku + 1). Les cases qui tombent hors de la matrice (coins) restent
+// nulles. Mémoire et temps des opérations sont en O(n * (kl + ku + 1)).
+//
+// Résultats de add() : bande + bande donne la plus large des deux bandes, bande + diag (defaultVal nul) garde
+// la bande, bande + CSR est creuse, les autres sommes sont denses.
+template<typename T>
+class matrix_band final : public matrix_t_<T> {
+private:
+    std::size_t kl;
+    std::size_t ku;
+    // Valeur renvoyée par operator() const hors de la bande.
+    T zero = {};
+
+    std::size_t ld() const {
+        return kl + ku + 1;
+    }
+
+    bool inBand(std::size_t row, std::size_t col) const {
+        return row + ku >= col && row <= col + kl;
+    }
+
+    std::size_t index(std::size_t row, std::size_t col) const {
+        return ku + row - col + col * ld();
+    }
+
+    // Lignes de la bande dans la colonne col : [firstRow(col), lastRow(col)).
+    std::size_t firstRow(std::size_t col) const {
+        return col > ku ? col - ku : 0;
+    }
+
+    std::size_t lastRow(std::size_t col) const {
+        return std::min(this->height, col + kl + 1);
+    }
+
+    // Colonnes de la bande dans la ligne row : [firstCol(row), lastCol(row)).
+    std::size_t firstCol(std::size_t row) const {
+        return std::min(row > kl ? row - kl : 0, this->width);
+    }
+
+    std::size_t lastCol(std::size_t row) const {
+        return std::min(this->width, row + ku + 1);
+    }
+
+    std::size_t columnGrain() const {
+        return std::max<std::size_t>(1, thread_pool::defaultGrain / ld());
+    }
+
+    void checkSize(const matrix_t_<T> &m) const {
+        if (m.getHeight() != this->height || m.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+    }
+
+    // out (dense, column-major) += *this sur les colonnes [first, last) : un segment contigu par colonne.
+    void addColumnsTo(T *out, std::size_t first, std::size_t last) const {
+        const std::size_t h = this->height;
+        for (std::size_t j = first; j < last; j++) {
+            const std::size_t lo = firstRow(j), hi = lastRow(j);
+            if (lo < hi)
+                kernels::add(out + lo + j * h, this->data.data() + index(lo, j), out + lo + j * h, hi - lo);
+        }
+    }
+
+    // out = a + b, a et b étant des bandes (kla, kua) et (klb, kub) de la taille de out. bCount est le nombre
+    // d'éléments de b : la diagonale d'une matrice plus large que haute est une bande (0, 0) sans ses dernières
+    // colonnes, qui sont vides. Si la bande de out n'est pas la plus large des deux, out reçoit un nouveau
+    // stockage, rempli avant de remplacer l'ancien.
+    static void addBands(matrix_band<T> &out, const T *a, std::size_t kla, std::size_t kua,
+                         const T *b, std::size_t klb, std::size_t kub, std::size_t bCount) {
+        const std::size_t kl = std::max(kla, klb), ku = std::max(kua, kub);
+        if (out.kl == kl && out.ku == ku && kla == klb && kua == kub && bCount == out.data.size()) {
+            matrix_t_<T>::addStream(a, b, out.data.data(), out.data.size());
+            return;
+        }
+        const bool reshape = out.kl != kl || out.ku != ku;
+        matrix_storage<T> target(reshape ? (kl + ku + 1) * out.width : 0);
+        T *result = reshape ? target.data() : out.data.data();
+        const std::size_t h = out.height;
+        thread_pool::global().parallelFor(
+                0, out.width, std::max<std::size_t>(1, thread_pool::defaultGrain / (kl + ku + 1)),
+                [=](std::size_t first, std::size_t last) {
+                    kernels::addBand(a, kla, kua, b, klb, kub, result, kl, ku, h, first, last);
+                });
+        if (reshape) {
+            out.data = std::move(target);
+            out.kl = kl;
+            out.ku = ku;
+        }
+    }
+
+public:
+    // Les largeurs de bande sont ramenées à ce que la taille permet : kl <= height - 1, ku <= width - 1.
+    matrix_band(int height, int width, std::size_t lower, std::size_t upper)
+            : matrix_t_<T>(height, width),
+              kl(std::min<std::size_t>(lower, height > 0 ? height - 1 : 0)),
+              ku(std::min<std::size_t>(upper, width > 0 ? width - 1 : 0)) {
+        this->data = matrix_storage<T>(ld() * this->width);
+    }
+
+    // Hors de la bande, la version non const lève une exception : ces éléments ne sont pas stockés.
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::band);
+        if (row < this->height && col < this->width) {
+            if (!inBand(row, col))
+                throw std::out_of_range("Outside of the band.");
+            return this->data[index(row, col)];
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::band);
+        if (row < this->height && col < this->width)
+            return inBand(row, col) ? this->data[index(row, col)] : zero;
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    // Partie stockée de la colonne col, contiguë dans le stockage.
+    matrix_column_segment<T> columnSegment(std::size_t col) {
+        if (col >= this->width)
+            throw std::out_of_range("Out of range.");
+        const std::size_t lo = firstRow(col), hi = std::max(lo, lastRow(col));
+        return {this->data.data() + col * ld() + (ku + lo - col), lo, hi - lo};
+    }
+
+    matrix_column_segment<const T> columnSegment(std::size_t col) const {
+        if (col >= this->width)
+            throw std::out_of_range("Out of range.");
+        const std::size_t lo = firstRow(col), hi = std::max(lo, lastRow(col));
+        return {this->data.data() + col * ld() + (ku + lo - col), lo, hi - lo};
+    }
+
+    T traceSum(reduce::summation mode) const override {
+        const T *d = this->data.data() + ku;
+        const std::size_t step = ld();
+        return reduce::parallelSum<T>(std::min(this->height, this->width), matrix_t_<T>::traceGrain, mode,
+                                      [d, step](std::size_t j) { return d[j * step]; });
+    }
+
+    // Colonne j : son segment contigu de la bande.
+    reduce::norm_t<T> norm1(reduce::summation mode = reduce::summation::pairwise) const override {
+        return this->maxColumn([this, mode](std::size_t j) {
+            const T *col = this->data.data() + index(firstRow(j), j);
+            return reduce::sum<reduce::norm_t<T>>(0, lastRow(j) - std::min(firstRow(j), lastRow(j)),
+                                                  [col](std::size_t i) { return reduce::magnitude(col[i]); },
+                                                  mode).value();
+        });
+    }
+
+    // Avec une bande de mêmes largeurs, produit scalaire des stockages (les coins sont nuls des deux côtés).
+    // Sinon, segments de colonnes contre m.
+    T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const override {
+        checkSize(m);
+        const auto *other = dynamic_cast<const matrix_band<T> *>(&m);
+        if (other != nullptr && other->kl == kl && other->ku == ku)
+            return reduce::parallelDot(this->data.data(), other->data.data(), this->data.size(), mode);
+        return this->sumOver(this->width, [this, &m, mode](std::size_t j) {
+            return reduce::sum<T>(firstRow(j), std::max(firstRow(j), lastRow(j)), [this, &m, j](std::size_t i) {
+                return this->data[index(i, j)] * m(i, j);
+            }, mode);
+        });
+    }
+
+    // Les zéros de part et d'autre de la bande sont copiés d'un seul bloc par ligne ; Matrix Market utilise
+    // le format coordinate, colonne par colonne.
+    void write(matrix_writer &out, matrix_text_format format) const override {
+        const std::size_t h = this->height, w = this->width;
+        if (format == matrix_text_format::matrix_market) {
+            std::size_t stored = 0;
+            for (std::size_t j = 0; j < w; j++)
+                stored += std::max(firstRow(j), lastRow(j)) - firstRow(j);
+            this->writeMarketHeader(out, true, stored);
+            for (std::size_t j = 0; j < w; j++)
+                for (std::size_t i = firstRow(j); i < lastRow(j); i++) {
+                    out.index(i + 1);
+                    out.put(' ');
+                    out.index(j + 1);
+                    out.put(' ');
+                    out.marketValue(this->data[index(i, j)]);
+                    out.put('\n');
+                }
+            return;
+        }
+        const char separator = matrix_t_<T>::separatorOf(format);
+        const std::string zeros = out.run(T{}, separator, w);
+        const std::size_t zeroLength = w > 0 ? zeros.size() / w : 0;
+        for (std::size_t i = 0; i < h; i++) {
+            const std::size_t lo = firstCol(i), hi = std::max(lo, lastCol(i));
+            out.write(zeros.data(), lo * zeroLength);
+            for (std::size_t j = lo; j < hi; j++) {
+                out.value(this->data[index(i, j)]);
+                out.put(separator);
+            }
+            out.write(zeros.data(), (w - hi) * zeroLength);
+            this->endRow(out, format);
+        }
+    }
+
+    // y = alpha * (*this) * x + beta * y (gbmv). Chaque ligne est un produit scalaire sur ses kl + ku + 1
+    // éléments au plus, réparti entre les threads par blocs de lignes. Avec beta nul, y n'est pas lu.
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        const T *a = this->data.data(), *xs = x.data();
+        T *ys = y.data();
+        const std::size_t step = ld() - 1;
+        thread_pool::global().parallelFor(0, this->height, columnGrain(), [=](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; i++) {
+                T sum = {};
+                for (std::size_t j = firstCol(i); j < lastCol(i); j++)
+                    sum += a[ku + i + j * step] * xs[j];
+                ys[i] = beta == T{} ? alpha * sum : alpha * sum + beta * ys[i];
+            }
+        });
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        return m.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        std::unique_ptr<matrix_t_<T>> result;
+        if (m1.getDefaultVal() != T{})
+            result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        else
+            result = std::make_unique<matrix_band<T>>(this->height, this->width, kl, ku);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_csr<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_band<T>>(this->height, this->width, std::max(kl, m1.kl),
+                                                       std::max(ku, m1.ku));
+        addInto(*result, m1);
+        return result;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        m.addInto(dst, *this);
+    }
+
+    // Copie de la dense (sauf si dst est cette dense) puis ajout d'un segment par colonne.
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        if (m1.getLayout() != dense_layout::column_major || out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result = m1.withLayout(dense_layout::column_major);
+            addInto(result, result);
+            out.copyValues(result);
+            return;
+        }
+        const T *dense = m1.data.data();
+        T *result = out.data.data();
+        const std::size_t h = this->height;
+        thread_pool::global().parallelFor(0, this->width, out.columnGrain(), [=](std::size_t first, std::size_t last) {
+            if (result != dense)
+                std::copy(dense + first * h, dense + last * h, result + first * h);
+            addColumnsTo(result, first, last);
+        });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                       this->width);
+        if (out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result(this->height, this->width);
+            addInto(result, m1);
+            out.copyValues(result);
+            return;
+        }
+        const T *packed = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getValInf();
+        const std::size_t h = this->height, w = this->width;
+        thread_pool::global().parallelFor(0, w, out.columnGrain(), [=](std::size_t first, std::size_t last) {
+            kernels::expandTriangular(packed, fill, result, h, w, first, last);
+            addColumnsTo(result, first, last);
+        });
+    }
+
+    // defaultVal nul : la diagonale est une bande (0, 0) ajoutée à la bande. Sinon dst est dense.
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        if (m1.getDefaultVal() != T{}) {
+            matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height,
+                                                                                           this->width);
+            if (out.getLayout() != dense_layout::column_major) {
+                matrix_dense<T> result(this->height, this->width);
+                addInto(result, m1);
+                out.copyValues(result);
+                return;
+            }
+            T *result = out.data.data();
+            const T *diag = m1.data.data();
+            const T fill = m1.getDefaultVal();
+            const std::size_t h = this->height, n = m1.data.size();
+            thread_pool::global().parallelFor(0, this->width, out.columnGrain(),
+                                              [=](std::size_t first, std::size_t last) {
+                                                  std::fill(result + first * h, result + last * h, fill);
+                                                  for (std::size_t j = first; j < std::min(last, n); j++)
+                                                      result[j + j * h] = diag[j];
+                                                  addColumnsTo(result, first, last);
+                                              });
+            return;
+        }
+        matrix_band<T> &out = matrix_t_<T>::template addDestination<matrix_band<T>>(dst, this->height, this->width);
+        addBands(out, this->data.data(), kl, ku, m1.data.data(), 0, 0, m1.data.size());
+    }
+
+    // Fusion de chaque ligne creuse avec l'intervalle de colonnes de la bande sur cette ligne.
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_csr<T> &out = matrix_t_<T>::template addDestination<matrix_csr<T>>(dst, this->height, this->width);
+        const std::size_t *rp = m1.rowPtr.data(), *ci = m1.colIdx.data();
+        const T *values = m1.data.data(), *a = this->data.data();
+        const std::size_t step = ld() - 1, upper = ku;
+        out.assignRows(
+                this->height, [this, rp](std::size_t row) { return rp[row] + row * ld(); },
+                [=](std::size_t i) {
+                    const std::size_t lo = firstCol(i), hi = std::max(lo, lastCol(i));
+                    const std::size_t *first = ci + rp[i], *last = ci + rp[i + 1];
+                    const std::size_t inside = std::lower_bound(first, last, hi) - std::lower_bound(first, last, lo);
+                    return (hi - lo) + static_cast<std::size_t>(last - first) - inside;
+                },
+                [=](std::size_t i, std::size_t *cols, T *result) {
+                    const std::size_t lo = firstCol(i), hi = std::max(lo, lastCol(i));
+                    std::size_t p = rp[i];
+                    for (; p < rp[i + 1] && ci[p] < lo; p++) {
+                        *cols++ = ci[p];
+                        *result++ = values[p];
+                    }
+                    for (std::size_t j = lo; j < hi; j++) {
+                        T v = a[upper + i + j * step];
+                        if (p < rp[i + 1] && ci[p] == j)
+                            v += values[p++];
+                        *cols++ = j;
+                        *result++ = v;
+                    }
+                    for (; p < rp[i + 1]; p++) {
+                        *cols++ = ci[p];
+                        *result++ = values[p];
+                    }
+                });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::band, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_band<T> &out = matrix_t_<T>::template addDestination<matrix_band<T>>(dst, this->height, this->width);
+        addBands(out, m1.data.data(), m1.kl, m1.ku, this->data.data(), kl, ku, this->data.size());
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(*this);
+    }
+
+    // m * (*this) : C(:,j) += A(:,l) * B(l,j) pour les seules lignes l de la bande dans la colonne j.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getLayout() != dense_layout::column_major)
+            return multiplyLeft(m1.withLayout(dense_layout::column_major));
+        const std::size_t h = m1.getHeight(), w = this->width;
+        matrix_dense<T> result(h, w);
+        const T *a = m1.data.data();
+        T *c = result.data.data();
+        for (std::size_t j = 0; j < w; j++)
+            for (std::size_t l = firstRow(j); l < lastRow(j); l++) {
+                const T bl = this->data[index(l, j)];
+                const T *aCol = a + l * h;
+                T *cCol = c + j * h;
+                for (std::size_t i = 0; i < h; i++)
+                    cCol[i] += aCol[i] * bl;
+            }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : la colonne l de m n'a d'éléments stockés que sur les lignes 0..l.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getValInf() != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        const std::size_t h = m1.getHeight(), w = this->width;
+        const std::size_t rows = std::min(h, m1.getWidth());
+        matrix_dense<T> result(h, w);
+        const T *a = m1.data.data();
+        T *c = result.data.data();
+        for (std::size_t j = 0; j < w; j++)
+            for (std::size_t l = firstRow(j); l < lastRow(j); l++) {
+                const T bl = this->data[index(l, j)];
+                T *cCol = c + j * h;
+                for (std::size_t i = 0; i <= l && i < rows; i++)
+                    cCol[i] += a[m1.rowOffset(i) + l] * bl;
+            }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : mise à l'échelle des lignes, le résultat garde la même bande.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (m1.getDefaultVal() != T{})
+            return matrix_t_<T>::multiplyGeneric(m1, *this);
+        auto result = std::make_unique<matrix_band<T>>(m1.getHeight(), this->width, kl, ku);
+        const std::size_t n = m1.data.size();
+        for (std::size_t j = 0; j < this->width; j++) {
+            const matrix_column_segment<T> cCol = result->columnSegment(j);
+            const std::size_t last = std::min(std::min(lastRow(j), cCol.firstRow() + cCol.size()), n);
+            for (std::size_t i = std::max(firstRow(j), cCol.firstRow()); i < last; i++)
+                cCol[i] = m1.data[i] * this->data[index(i, j)];
+        }
+        return result;
+    }
+
+    // m * (*this) : chaque élément (i, l) de m ajoute a * (ligne l de la bande) à la ligne i de C.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        const std::size_t h = m1.getHeight();
+        matrix_dense<T> result(h, this->width);
+        T *c = result.data.data();
+        for (std::size_t i = 0; i < h; i++)
+            for (std::size_t p = m1.rowPtr[i]; p < m1.rowPtr[i + 1]; p++) {
+                const std::size_t l = m1.colIdx[p];
+                const T a = m1.data[p];
+                for (std::size_t j = firstCol(l); j < lastCol(l); j++)
+                    c[i + j * h] += a * this->data[index(l, j)];
+            }
+        return std::make_unique<matrix_dense<T>>(std::move(result));
+    }
+
+    // m * (*this) : le produit de deux bandes est une bande (kl1 + kl2, ku1 + ku2).
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        if (m1.width != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        auto result = std::make_unique<matrix_band<T>>(m1.height, this->width, m1.kl + kl, m1.ku + ku);
+        for (std::size_t j = 0; j < this->width; j++)
+            for (std::size_t l = firstRow(j); l < lastRow(j); l++) {
+                const T bl = this->data[index(l, j)];
+                for (std::size_t i = m1.firstRow(l); i < m1.lastRow(l); i++)
+                    result->data[result->index(i, j)] += m1.data[m1.index(i, l)] * bl;
+            }
+        return result;
+    }
+
+    // Transposée : les largeurs kl et ku sont échangées et la colonne j de la transposée reprend la ligne j de
+    // *this. Les colonnes du résultat sont réparties entre les threads.
+    matrix_band<T> transposed() const {
+        matrix_band<T> result(static_cast<int>(this->width), static_cast<int>(this->height), ku, kl);
+        const std::size_t n = ld();
+        const T *src = this->data.data();
+        T *dst = result.data.data();
+        thread_pool::global().parallelFor(0, this->height, columnGrain(),
+                                          [=](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; i++)
+                for (std::size_t j = firstCol(i); j < lastCol(i); j++)
+                    dst[kl + j - i + i * n] = src[ku + i - j + j * n];
+        });
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_band<T>>(transposed());
+    }
+
+    std::size_t getLowerBandwidth() const {
+        return kl;
+    }
+
+    std::size_t getUpperBandwidth() const {
+        return ku;
+    }
+
+    // Diagonale principale, à pas ld() dans le stockage, sans copie (matrix_view.h).
+    matrix_diag_view<T> diagonalView() {
+        return {this->data.exclusiveData() + ku, std::min(this->height, this->width), ld(), this->height, this->width,
+                T{}};
+    }
+
+    matrix_diag_view<const T> diagonalView() const {
+        return {this->data.data() + ku, std::min(this->height, this->width), ld(), this->height, this->width, T{}};
+    }
+};
+
+// Matrice triangulaire inférieure, transposée d'une matrix_triangulaire_sup : le stockage compact est le même,
+// lu par colonnes. La colonne j (j < min(height, width)) range ses lignes j..height-1 à la suite, l'élément
+// (i, j) avec i >= j étant à colOffset(j) + i ; au-dessus de la diagonale, tous les éléments valent valSup.
+//
+// Résultats de add() : inf + inf et inf + diag restent triangulaires inférieures, les autres sommes sont
+// denses. Les produits passent par la forme dense, sauf dense * inf à valSup nul qui ne lit que la partie
+// stockée.
+template<typename T>
+class matrix_triangulaire_inf final : public matrix_t_<T> {
+private:
+    T valSup;
+
+    T fillValue() const override {
+        return valSup;
+    }
+
+    std::size_t fillCount() const override {
+        return this->height * this->width - this->data.size();
+    }
+
+    // Travail cumulé des lignes [0, row) pour parallelForWeighted : min(r + 1, width) éléments stockés par
+    // ligne r, plus un par ligne.
+    auto storedBefore() const {
+        const std::size_t w = this->width;
+        return [=](std::size_t row) {
+            const std::size_t r = std::min(row, w);
+            return r * (r + 1) / 2 + (row - r) * w + row;
+        };
+    }
+
+    void checkSize(const matrix_t_<T> &m) const {
+        if (m.getHeight() != this->height || m.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+    }
+
+    // out (dense column-major, height x width) = forme dense de *this, colonnes réparties entre les threads.
+    void expandInto(T *out) const {
+        const std::size_t h = this->height, w = this->width;
+        const T *packed = this->data.data();
+        const T upper = valSup;
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain / std::max<std::size_t>(1, h));
+        thread_pool::global().parallelFor(0, w, grain, [=](std::size_t first, std::size_t last) {
+            for (std::size_t j = first; j < last; j++) {
+                T *col = out + j * h;
+                std::fill(col, col + std::min(j, h), upper);
+                if (j < h)
+                    std::copy(packed + j * h - (j * (j + 1)) / 2 + j, packed + j * h - (j * (j + 1)) / 2 + h, col + j);
+            }
+        });
+    }
+
+    // dst (dense) = m + (*this) pour un opérande sans noyau dédié : la forme dense de *this est écrite dans
+    // dst, puis m y est ajouté par son propre addInto() avec une destination dense.
+    template<typename M>
+    void addExpanded(matrix_t_<T> &dst, const M &m) const {
+        checkSize(m);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height, this->width);
+        if (out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result(this->height, this->width);
+            addExpanded(result, m);
+            out.copyValues(result);
+            return;
+        }
+        expandInto(out.data.data());
+        m.addInto(out, out);
+    }
+
+public:
+    matrix_triangulaire_inf(int height, int width, T valSup) : matrix_t_<T>(height, width), valSup(valSup) {
+        this->data = matrix_storage<T>(packedSize(height, width));
+    }
+
+    matrix_triangulaire_inf(int height, int width, T valSup, matrix_storage<T> storage)
+            : matrix_t_<T>(height, width), valSup(valSup) {
+        if (storage.size() != packedSize(height, width))
+            throw std::runtime_error("storage size does not match the matrix size.");
+        this->data = std::move(storage);
+    }
+
+    // Nombre d'éléments stockés : celui de la triangulaire sup transposée.
+    static std::size_t packedSize(std::size_t height, std::size_t width) {
+        return matrix_triangulaire_sup<T>::packedSize(width, height);
+    }
+
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::triangulaire_inf);
+        if (row < this->height && col < this->width) {
+            if (row < col)
+                return valSup;
+            return this->data[colOffset(col) + row];
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::triangulaire_inf);
+        if (row < this->height && col < this->width) {
+            if (row < col)
+                return valSup;
+            return this->data[colOffset(col) + row];
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    // Partie stockée de la colonne col : lignes col..height-1, contiguës dans le stockage compact.
+    matrix_column_segment<T> columnSegment(std::size_t col) {
+        if (col >= std::min(this->height, this->width))
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + colOffset(col) + col, col, this->height - col};
+    }
+
+    matrix_column_segment<const T> columnSegment(std::size_t col) const {
+        if (col >= std::min(this->height, this->width))
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + colOffset(col) + col, col, this->height - col};
+    }
+
+    // Forme axpy sur les colonnes compactées, restreinte aux lignes [first, last) de chaque morceau. Au-dessus
+    // de la diagonale, la ligne i ajoute valSup * (x[i + 1] + ... + x[width - 1]), cumulé de bas en haut.
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        const std::size_t h = this->height, w = this->width;
+        const T *packed = this->data.data(), *xs = x.data();
+        T *ys = y.data();
+        const T upper = valSup;
+        thread_pool::global().parallelForWeighted(h, storedBefore(), thread_pool::defaultGrain,
+                                                  [=](std::size_t first, std::size_t last) {
+            kernels::scale(beta, ys + first, last - first);
+            for (std::size_t j = 0; j < std::min(last, w); j++) {
+                const T *col = packed + j * h - (j * (j + 1)) / 2;
+                const T xj = alpha * xs[j];
+                for (std::size_t i = std::max(first, j); i < last; i++)
+                    ys[i] += col[i] * xj;
+            }
+            if (upper == T{})
+                return;
+            T suffix = std::accumulate(xs + std::min(last, w), xs + w, T{});
+            for (std::size_t i = last; i-- > first;) {
+                ys[i] += alpha * upper * suffix;
+                if (i < w)
+                    suffix += xs[i];
+            }
+        });
+    }
+
+    T traceSum(reduce::summation mode) const override {
+        const T *packed = this->data.data();
+        return reduce::parallelSum<T>(std::min(this->height, this->width), matrix_t_<T>::traceGrain, mode,
+                                      [this, packed](std::size_t i) { return packed[colOffset(i) + i]; });
+    }
+
+    // Colonne j : segment contigu des lignes j..height-1, plus valSup sur les lignes au-dessus.
+    reduce::norm_t<T> norm1(reduce::summation mode = reduce::summation::pairwise) const override {
+        const T *packed = this->data.data();
+        const std::size_t h = this->height;
+        const reduce::norm_t<T> fill = reduce::magnitude(valSup);
+        return this->maxColumn([this, packed, h, fill, mode](std::size_t j) {
+            const std::size_t upper = std::min(j, h);
+            const T *col = packed + colOffset(j);
+            reduce::compensated<reduce::norm_t<T>> column = reduce::sum<reduce::norm_t<T>>(
+                    upper, h, [col](std::size_t i) { return reduce::magnitude(col[i]); }, mode);
+            column.add(fill * static_cast<reduce::norm_t<T>>(upper));
+            return column.value();
+        });
+    }
+
+    // Comme matrix_triangulaire_sup::dot(), par colonnes compactées.
+    T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const override {
+        this->checkSameSize(m);
+        const T *packed = this->data.data();
+        if (const auto *other = dynamic_cast<const matrix_triangulaire_inf<T> *>(&m)) {
+            reduce::compensated<T> result;
+            result.add(reduce::parallelDot(packed, other->data.data(), this->data.size(), mode));
+            result.add(valSup * other->valSup * static_cast<T>(fillCount()));
+            return result.value();
+        }
+        const std::size_t h = this->height;
+        const T fill = valSup;
+        return this->sumOver(this->width, [this, &m, packed, h, fill, mode](std::size_t j) {
+            const T *col = packed + colOffset(j);
+            reduce::compensated<T> column;
+            if (j < h)
+                column = reduce::sum<T>(j, h, [&m, col, j](std::size_t i) { return col[i] * m(i, j); }, mode);
+            if (fill != T{}) {
+                reduce::compensated<T> upper = reduce::sum<T>(0, std::min(j, h), [&m, j](std::size_t i) {
+                    return m(i, j);
+                }, mode);
+                column.add(fill * upper.sum);
+                column.add(fill * upper.correction);
+            }
+            return column;
+        });
+    }
+
+    // Forme dense column-major.
+    matrix_dense<T> toDense() const {
+        matrix_dense<T> result(this->height, this->width);
+        expandInto(result.data.data());
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    // Les autres classes n'ont pas de surcharge pour matrix_triangulaire_inf : inf + inf est traité ici, sans
+    // quoi les deux opérandes se renverraient l'appel indéfiniment.
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        if (auto lower = dynamic_cast<const matrix_triangulaire_inf<T> *>(&m))
+            return add(*lower);
+        return m.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, m1.getLayout());
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf,
+                        matrix_stats::kind::triangulaire_sup, this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_triangulaire_inf<T>>(this->height, this->width, T{});
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_inf<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf,
+                        matrix_stats::kind::triangulaire_inf, this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_triangulaire_inf<T>>(this->height, this->width, T{});
+        addInto(*result, m1);
+        return result;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        if (auto lower = dynamic_cast<const matrix_triangulaire_inf<T> *>(&m))
+            addInto(dst, *lower);
+        else
+            m.addInto(dst, *this);
+    }
+
+    // Copie de m1 (sauf si dst est m1), puis ajout de valSup au-dessus de la diagonale et des colonnes
+    // compactées en dessous.
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height, this->width);
+        if (out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result(this->height, this->width);
+            addInto(result, m1);
+            out.copyValues(result);
+            return;
+        }
+        out.copyValues(m1);
+        const std::size_t h = this->height;
+        const T *packed = this->data.data();
+        T *c = out.data.data();
+        const T upper = valSup;
+        thread_pool::global().parallelFor(0, this->width, out.columnGrain(), [=](std::size_t first, std::size_t last) {
+            for (std::size_t j = first; j < last; j++) {
+                T *col = c + j * h;
+                kernels::addScalar(col, upper, col, std::min(j, h));
+                if (j < h)
+                    kernels::add(col + j, packed + j * h - (j * (j + 1)) / 2 + j, col + j, h - j);
+            }
+        });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf,
+                        matrix_stats::kind::triangulaire_sup, this->data.size() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    // Le défaut de la diagonale s'ajoute à tous les éléments hors diagonale, valSup compris.
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_triangulaire_inf<T> &out = matrix_t_<T>::template addDestination<matrix_triangulaire_inf<T>>(
+                dst, this->height, this->width);
+        const std::size_t h = this->height;
+        const T fill = m1.getDefaultVal(), sumValSup = valSup + fill;
+        const T *packed = this->data.data(), *diag = m1.data.data();
+        T *result = out.data.data();
+        thread_pool::global().parallelForWeighted(
+                m1.data.size(), [h](std::size_t col) { return col * h - (col * (col - 1)) / 2; },
+                thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+                    for (std::size_t j = first; j < last; j++) {
+                        const std::size_t offset = j * h - (j * (j + 1)) / 2;
+                        result[offset + j] = packed[offset + j] + diag[j];
+                        kernels::addScalar(packed + offset + j + 1, fill, result + offset + j + 1, h - j - 1);
+                    }
+                });
+        out.valSup = sumValSup;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_inf<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::triangulaire_inf,
+                        matrix_stats::kind::triangulaire_inf, this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_triangulaire_inf<T> &out = matrix_t_<T>::template addDestination<matrix_triangulaire_inf<T>>(
+                dst, this->height, this->width);
+        const T sumValSup = m1.valSup + valSup;
+        matrix_t_<T>::addStream(m1.data.data(), this->data.data(), out.data.data(), this->data.size());
+        out.valSup = sumValSup;
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(toDense());
+    }
+
+    // m * (*this) : C(:,j) = A(:, j..k-1) * (colonne j compactée), un produit matrice-vecteur par colonne sur
+    // les seules colonnes l >= j de A. Les colonnes de C sont pondérées par leur nombre d'éléments stockés.
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        if (m1.getWidth() != this->height)
+            throw std::runtime_error("matrix sizes are not compatible.");
+        if (valSup != T{})
+            return toDense().multiplyLeft(m1);
+        if (m1.getLayout() != dense_layout::column_major)
+            return multiplyLeft(m1.withLayout(dense_layout::column_major));
+        const std::size_t h = m1.getHeight(), k = this->height, w = this->width;
+        auto result = std::make_unique<matrix_dense<T>>(h, w);
+        const T *a = m1.data.data(), *packed = this->data.data();
+        T *c = result->data.data();
+        thread_pool::global().parallelForWeighted(
+                w, [=](std::size_t col) {
+                    const std::size_t r = std::min(col, k);
+                    return (r * k - (r * (r - 1)) / 2) * h + col;
+                },
+                thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+                    for (std::size_t j = first; j < std::min(last, k); j++)
+                        kernels::multiplyColumns(a + j * h, h, packed + j * k - (j * (j + 1)) / 2 + j, T(1),
+                                                 c + j * h, h, k - j);
+                });
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    void scale(T alpha) override {
+        matrix_t_<T>::scale(alpha);
+        valSup *= alpha;
+    }
+
+    // La transposée est la triangulaire sup de même stockage compact.
+    matrix_triangulaire_sup<T> transposed() const {
+        return matrix_triangulaire_sup<T>(static_cast<int>(this->width), static_cast<int>(this->height), valSup,
+                                          this->data);
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_triangulaire_sup<T>>(transposed());
+    }
+
+    // Position dans data du début (virtuel) de la colonne col : l'élément (row, col) est à colOffset(col) + row.
+    std::size_t colOffset(std::size_t col) const {
+        return col * this->height - (col * (col + 1)) / 2;
+    }
+
+    T getValSup() const {
+        return valSup;
+    }
+
+    void setValSup(T value) {
+        valSup = value;
+    }
+};
+
+// Matrice symétrique n x n : seule la partie j >= i est stockée, dans le format compact par lignes de
+// matrix_triangulaire_sup (l'élément (i, j) est à rowOffset(i) + j), et (i, j) avec i > j est lu en (j, i).
+// Les deux cases partagent donc un élément : écrire dans l'une modifie l'autre.
+//
+// Résultats de add() : sym + sym et sym + diag restent symétriques, les autres sommes sont denses. Les
+// produits passent par la forme dense ; le produit matrice-vecteur lit chaque élément stocké une seule fois.
+template<typename T>
+class matrix_symmetric final : public matrix_t_<T> {
+private:
+    // Travail cumulé des lignes [0, row) pour parallelForWeighted : n - r éléments stockés par ligne r, plus
+    // un par ligne.
+    auto storedBefore() const {
+        const std::size_t n = this->width;
+        return [=](std::size_t row) { return row * n - (row * (row - 1)) / 2 + row; };
+    }
+
+    void checkSize(const matrix_t_<T> &m) const {
+        if (m.getHeight() != this->height || m.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+    }
+
+    // out (dense column-major, n x n) = forme dense de *this, colonnes réparties entre les threads.
+    void expandInto(T *out) const {
+        const std::size_t n = this->width;
+        const T *packed = this->data.data();
+        const std::size_t grain = std::max<std::size_t>(1, thread_pool::defaultGrain / std::max<std::size_t>(1, n));
+        thread_pool::global().parallelFor(0, n, grain, [=](std::size_t first, std::size_t last) {
+            kernels::expandSymmetric(packed, out, n, first, last);
+        });
+    }
+
+    // dst (dense) = m + (*this) pour un opérande sans noyau dédié : la forme dense de *this est écrite dans
+    // dst, puis m y est ajouté par son propre addInto() avec une destination dense.
+    template<typename M>
+    void addExpanded(matrix_t_<T> &dst, const M &m) const {
+        checkSize(m);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height, this->width);
+        if (out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result(this->height, this->width);
+            addExpanded(result, m);
+            out.copyValues(result);
+            return;
+        }
+        expandInto(out.data.data());
+        m.addInto(out, out);
+    }
+
+    // Élément (i, j) de la ligne compactée de min(i, j).
+    std::size_t index(std::size_t row, std::size_t col) const {
+        return row <= col ? rowOffset(row) + col : rowOffset(col) + row;
+    }
+
+public:
+    explicit matrix_symmetric(int size) : matrix_t_<T>(size, size) {
+        this->data = matrix_storage<T>(packedSize(size));
+    }
+
+    matrix_symmetric(int size, matrix_storage<T> storage) : matrix_t_<T>(size, size) {
+        if (storage.size() != packedSize(size))
+            throw std::runtime_error("storage size does not match the matrix size.");
+        this->data = std::move(storage);
+    }
+
+    // Nombre d'éléments stockés : celui de la triangulaire sup carrée de même taille.
+    static std::size_t packedSize(std::size_t size) {
+        return matrix_triangulaire_sup<T>::packedSize(size, size);
+    }
+
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::symmetric);
+        if (row < this->height && col < this->width)
+            return this->data[index(row, col)];
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::symmetric);
+        if (row < this->height && col < this->width)
+            return this->data[index(row, col)];
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    // Partie stockée de la ligne row : colonnes row..n-1, contiguës dans le stockage compact.
+    matrix_row_segment<T> rowSegment(std::size_t row) {
+        if (row >= this->height)
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + rowOffset(row) + row, row, this->width - row};
+    }
+
+    matrix_row_segment<const T> rowSegment(std::size_t row) const {
+        if (row >= this->height)
+            throw std::out_of_range("Out of range.");
+        return {this->data.data() + rowOffset(row) + row, row, this->width - row};
+    }
+
+    // Les lignes compactées sont réparties en morceaux de même nombre d'éléments stockés. Chaque morceau
+    // écrit ses propres lignes de y, et les contributions de la moitié sous la diagonale dans un tampon à lui,
+    // additionné à y une fois tous les morceaux terminés. Les tampons sont ceux du thread appelant, gardés
+    // d'un appel à l'autre : passé le premier appel d'une taille donnée, le produit n'alloue plus.
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        const std::size_t n = this->width;
+        const T *packed = this->data.data(), *xs = x.data();
+        T *ys = y.data();
+        thread_pool &pool = thread_pool::global();
+        const std::size_t chunks = std::max<std::size_t>(
+                1, std::min({pool.size(), this->data.size() / thread_pool::defaultGrain, thread_pool::stackPartials}));
+        if (chunks == 1) {
+            kernels::scale(beta, ys, n);
+            kernels::multiplySymmetricRows(packed, n, xs, alpha, ys, ys, 0, n);
+            return;
+        }
+        const auto cumulative = storedBefore();
+        std::array<std::size_t, thread_pool::stackPartials + 1> bounds;
+        bounds[0] = 0;
+        bounds[chunks] = n;
+        for (std::size_t c = 1, row = 0; c < chunks; c++) {
+            const std::size_t target = cumulative(n) / chunks * c;
+            while (row < n && cumulative(row) < target)
+                row++;
+            bounds[c] = row;
+        }
+        static thread_local std::vector<T> lower;
+        if (lower.size() < chunks * n)
+            lower.resize(chunks * n);
+        T *partial = lower.data();
+        std::fill(partial, partial + chunks * n, T{});
+        pool.parallelFor(0, chunks, 1, [&, partial](std::size_t first, std::size_t last) {
+            for (std::size_t c = first; c < last; c++) {
+                kernels::scale(beta, ys + bounds[c], bounds[c + 1] - bounds[c]);
+                kernels::multiplySymmetricRows(packed, n, xs, alpha, ys, partial + c * n, bounds[c], bounds[c + 1]);
+            }
+        });
+        pool.parallelFor(0, n, thread_pool::defaultGrain / chunks, [=](std::size_t first, std::size_t last) {
+            for (std::size_t c = 0; c < chunks; c++)
+                kernels::add(ys + first, partial + c * n + first, ys + first, last - first);
+        });
+    }
+
+    T traceSum(reduce::summation mode) const override {
+        const T *packed = this->data.data();
+        return reduce::parallelSum<T>(this->width, matrix_t_<T>::traceGrain, mode,
+                                      [this, packed](std::size_t i) { return packed[rowOffset(i) + i]; });
+    }
+
+    // Somme du stockage comptée deux fois, moins la diagonale qui n'a qu'une case.
+    T sum(reduce::summation mode = reduce::summation::pairwise) const override {
+        const T stored = reduce::parallelSum(this->data.data(), this->data.size(), mode);
+        reduce::compensated<T> result;
+        result.add(stored);
+        result.add(stored);
+        result.add(-traceSum(mode));
+        return result.value();
+    }
+
+    reduce::norm_t<T> normFrobenius(reduce::summation mode = reduce::summation::pairwise) const override {
+        const T *packed = this->data.data();
+        const reduce::norm_t<T> stored = reduce::parallelSumSquares(packed, this->data.size(), mode);
+        reduce::compensated<reduce::norm_t<T>> result;
+        result.add(stored);
+        result.add(stored);
+        result.add(-reduce::parallelSum<reduce::norm_t<T>>(
+                this->width, matrix_t_<T>::traceGrain, mode,
+                [this, packed](std::size_t i) { return reduce::squaredMagnitude(packed[rowOffset(i) + i]); }));
+        return std::sqrt(result.value());
+    }
+
+    // Colonne j : les lignes 0..j-1 une par ligne compactée, puis le segment contigu de la ligne compactée j.
+    reduce::norm_t<T> norm1(reduce::summation mode = reduce::summation::pairwise) const override {
+        const T *packed = this->data.data();
+        const std::size_t n = this->width;
+        return this->maxColumn([this, packed, n, mode](std::size_t j) {
+            reduce::compensated<reduce::norm_t<T>> column = reduce::sum<reduce::norm_t<T>>(
+                    0, j, [packed, j, n](std::size_t i) {
+                        return reduce::magnitude(packed[j + i * n - (i * (i + 1)) / 2]);
+                    }, mode);
+            const T *row = packed + rowOffset(j);
+            column += reduce::sum<reduce::norm_t<T>>(j, n, [row](std::size_t i) {
+                return reduce::magnitude(row[i]);
+            }, mode);
+            return column.value();
+        });
+    }
+
+    // Avec une autre symétrique, produit scalaire des stockages compté deux fois moins celui des diagonales.
+    // Sinon, chaque élément stocké hors diagonale s(i, j) est multiplié par m(i, j) + m(j, i).
+    T dot(const matrix_t_<T> &m, reduce::summation mode = reduce::summation::pairwise) const override {
+        this->checkSameSize(m);
+        const T *packed = this->data.data();
+        if (const auto *other = dynamic_cast<const matrix_symmetric<T> *>(&m)) {
+            const T *b = other->data.data();
+            const T stored = reduce::parallelDot(packed, b, this->data.size(), mode);
+            reduce::compensated<T> result;
+            result.add(stored);
+            result.add(stored);
+            result.add(-reduce::parallelSum<T>(this->width, matrix_t_<T>::traceGrain, mode,
+                                               [this, packed, b](std::size_t i) {
+                                                   return packed[rowOffset(i) + i] * b[rowOffset(i) + i];
+                                               }));
+            return result.value();
+        }
+        const std::size_t n = this->width;
+        return this->sumOver(n, [this, &m, packed, n, mode](std::size_t i) {
+            const T *row = packed + rowOffset(i);
+            reduce::compensated<T> result = reduce::sum<T>(i + 1, n, [&m, row, i](std::size_t j) {
+                return row[j] * (m(i, j) + m(j, i));
+            }, mode);
+            result.add(row[i] * m(i, i));
+            return result;
+        });
+    }
+
+    // Ligne i : les colonnes 0..i-1 une par ligne compactée, puis le segment contigu de la ligne compactée i.
+    void write(matrix_writer &out, matrix_text_format format) const override {
+        if (format == matrix_text_format::matrix_market) {
+            this->writeMarketArray(out);
+            return;
+        }
+        const std::size_t n = this->width;
+        const T *packed = this->data.data();
+        const char separator = matrix_t_<T>::separatorOf(format);
+        for (std::size_t i = 0; i < n; i++) {
+            for (std::size_t j = 0; j < i; j++) {
+                out.value(packed[i + j * n - (j * (j + 1)) / 2]);
+                out.put(separator);
+            }
+            const T *row = packed + rowOffset(i);
+            for (std::size_t j = i; j < n; j++) {
+                out.value(row[j]);
+                out.put(separator);
+            }
+            this->endRow(out, format);
+        }
+    }
+
+    // Forme dense column-major.
+    matrix_dense<T> toDense() const {
+        matrix_dense<T> result(this->height, this->width);
+        expandInto(result.data.data());
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    // Les autres classes n'ont pas de surcharge pour matrix_symmetric : sym + sym est traité ici, ainsi que
+    // sym + triangulaire inf, qui n'a pas non plus de surcharge ailleurs. Sans cela, les deux opérandes se
+    // renverraient l'appel indéfiniment.
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        if (auto symmetric = dynamic_cast<const matrix_symmetric<T> *>(&m))
+            return add(*symmetric);
+        if (auto lower = dynamic_cast<const matrix_triangulaire_inf<T> *>(&m))
+            return add(*lower);
+        return m.add(*this);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, m1.getLayout());
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_symmetric<T>>(this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_inf<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::triangulaire_inf,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_symmetric<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::symmetric,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_symmetric<T>>(this->width);
+        addInto(*result, m1);
+        return result;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, this->statsKind(m),
+                        this->data.size() + m.getStoredSize());
+        if (auto symmetric = dynamic_cast<const matrix_symmetric<T> *>(&m))
+            addInto(dst, *symmetric);
+        else if (auto lower = dynamic_cast<const matrix_triangulaire_inf<T> *>(&m))
+            addInto(dst, *lower);
+        else
+            m.addInto(dst, *this);
+    }
+
+    // Copie de m1 (sauf si dst est m1), puis ajout des colonnes de la forme dense de *this.
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::dense,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height, this->width);
+        if (out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result(this->height, this->width);
+            addInto(result, m1);
+            out.copyValues(result);
+            return;
+        }
+        out.copyValues(m1);
+        const std::size_t n = this->width;
+        const T *packed = this->data.data();
+        T *c = out.data.data();
+        thread_pool::global().parallelFor(0, n, out.columnGrain(), [=](std::size_t first, std::size_t last) {
+            kernels::addSymmetric(packed, c, n, first, last);
+        });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::triangulaire_sup,
+                        this->data.size() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    // Même stockage compact qu'une triangulaire sup : le noyau triangulaire + diagonale s'applique tel quel,
+    // defaultVal s'ajoutant aux éléments stockés hors diagonale, donc aux deux moitiés.
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::diag,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_symmetric<T> &out = matrix_t_<T>::template addDestination<matrix_symmetric<T>>(
+                dst, this->height, this->width);
+        const T *packed = this->data.data(), *diag = m1.data.data();
+        T *result = out.data.data();
+        const T fill = m1.getDefaultVal();
+        const std::size_t n = this->width;
+        thread_pool::global().parallelForWeighted(
+                n, storedBefore(), thread_pool::defaultGrain, [=](std::size_t first, std::size_t last) {
+                    kernels::addTriangularDiagonal(packed, diag, fill, result, n, first, last);
+                });
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::csr,
+                        this->data.size() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::band,
+                        this->data.size() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_inf<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::triangulaire_inf,
+                        this->data.size() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_symmetric<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::symmetric, matrix_stats::kind::symmetric,
+                        this->data.size() + m1.getStoredSize());
+        checkSize(m1);
+        matrix_symmetric<T> &out = matrix_t_<T>::template addDestination<matrix_symmetric<T>>(
+                dst, this->height, this->width);
+        matrix_t_<T>::addStream(m1.data.data(), this->data.data(), out.data.data(), this->data.size());
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(toDense());
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    // La transposée est la matrice elle-même : une copie.
+    matrix_symmetric<T> transposed() const {
+        return *this;
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_symmetric<T>>(transposed());
+    }
+
+    // Position dans data du début (virtuel) de la ligne row : l'élément (row, col), col >= row, est à
+    // rowOffset(row) + col.
+    std::size_t rowOffset(std::size_t row) const {
+        return row * this->width - (row * (row + 1)) / 2;
+    }
+};
+
+// Matrice par blocs : les lignes sont découpées en blocs de rowSizes[bi] lignes, les colonnes en blocs de
+// colSizes[bj] colonnes, et chaque tuile (bi, bj) est une matrice quelconque de cette taille (dense,
+// diagonale, triangulaire, creuse, bande, symétrique, ou à son tour une matrix_block). Une tuile vide ne
+// stocke rien et vaut zéro partout.
+//
+// add(), trace() et multiplyVector() travaillent tuile par tuile avec les noyaux propres à chaque tuile. Les
+// tuiles légères sont réparties ensemble entre les threads du pool ; les tuiles lourdes passent une par une,
+// chacune découpée sur le pool par son propre noyau. Résultats de add() : bloc + bloc de même découpage reste
+// une matrix_block, dont chaque tuile est la somme des deux tuiles ; les autres sommes sont denses. Les
+// produits passent par la forme dense.
+//
+// La matrice n'a pas de stockage propre (values() est vide) : getStoredSize() compte les éléments des tuiles.
+// Une copie copie les tuiles ; sharedCopy() (matrix_storage.h) partage leur stockage avec celles de
+// l'original jusqu'à la première écriture.
+template<typename T>
+class matrix_block final : public matrix_t_<T> {
+private:
+    // Début de chaque bloc de lignes et de colonnes, suivi de la taille totale.
+    std::vector<std::size_t> rowStart;
+    std::vector<std::size_t> colStart;
+    // Tuiles ligne de blocs par ligne de blocs ; nullptr pour une tuile vide.
+    std::vector<std::unique_ptr<matrix_t_<T>>> tiles;
+    T zero = {};
+
+    static std::vector<std::size_t> starts(const std::vector<std::size_t> &sizes) {
+        std::vector<std::size_t> result(1, 0);
+        for (std::size_t size : sizes)
+            result.push_back(result.back() + size);
+        return result;
+    }
+
+    std::size_t tileIndex(std::size_t bi, std::size_t bj) const {
+        if (bi >= blockRows() || bj >= blockCols())
+            throw std::out_of_range("Out of range.");
+        return bi * blockCols() + bj;
+    }
+
+    // Bloc contenant l'indice i : dernier début <= i (les blocs de taille nulle sont sautés).
+    static std::size_t blockOf(const std::vector<std::size_t> &start, std::size_t i) {
+        return std::upper_bound(start.begin(), start.end(), i) - start.begin() - 1;
+    }
+
+    void checkSize(const matrix_t_<T> &m) const {
+        if (m.getHeight() != this->height || m.getWidth() != this->width)
+            throw std::runtime_error("matrix are not the same size.");
+    }
+
+    // Copie d'une tuile dans son type concret ; le stockage est partagé jusqu'à la première écriture.
+    static std::unique_ptr<matrix_t_<T>> copyTile(const matrix_t_<T> &m) {
+        if (auto dense = dynamic_cast<const matrix_dense<T> *>(&m))
+            return std::make_unique<matrix_dense<T>>(*dense);
+        if (auto triang = dynamic_cast<const matrix_triangulaire_sup<T> *>(&m))
+            return std::make_unique<matrix_triangulaire_sup<T>>(*triang);
+        if (auto diag = dynamic_cast<const matrix_diag<T> *>(&m))
+            return std::make_unique<matrix_diag<T>>(*diag);
+        if (auto csr = dynamic_cast<const matrix_csr<T> *>(&m))
+            return std::make_unique<matrix_csr<T>>(*csr);
+        if (auto band = dynamic_cast<const matrix_band<T> *>(&m))
+            return std::make_unique<matrix_band<T>>(*band);
+        if (auto lower = dynamic_cast<const matrix_triangulaire_inf<T> *>(&m))
+            return std::make_unique<matrix_triangulaire_inf<T>>(*lower);
+        if (auto symmetric = dynamic_cast<const matrix_symmetric<T> *>(&m))
+            return std::make_unique<matrix_symmetric<T>>(*symmetric);
+        if (auto block = dynamic_cast<const matrix_block<T> *>(&m))
+            return std::make_unique<matrix_block<T>>(*block);
+        throw std::runtime_error("unknown tile type.");
+    }
+
+    // Vrai si a + b est du type de a et b, et peut donc s'écrire dans dst de ce type sans le remplacer.
+    static bool sameStructure(const matrix_t_<T> &a, const matrix_t_<T> &b, const matrix_t_<T> &dst) {
+        if (typeid(a) != typeid(b) || typeid(a) != typeid(dst))
+            return false;
+        if (auto block = dynamic_cast<const matrix_block<T> *>(&a))
+            return block->samePartition(static_cast<const matrix_block<T> &>(b)) &&
+                   block->samePartition(static_cast<const matrix_block<T> &>(dst));
+        return true;
+    }
+
+    // Appelle f(k) pour k dans [0, count), work(k) étant le nombre d'éléments que f(k) parcourt. Les parts de
+    // moins de defaultGrain éléments, que leurs noyaux ne découperaient pas, sont réparties ensemble entre les
+    // threads du pool ; les autres sont traitées l'une après l'autre depuis le thread appelant, pour que leurs
+    // noyaux se découpent à leur tour sur le pool (lancés depuis un worker, ils resteraient séquentiels).
+    template<typename W, typename F>
+    static void forEachPart(std::size_t count, W &&work, F &&f) {
+        std::vector<std::size_t> light, heavy, before(1, 0);
+        for (std::size_t k = 0; k < count; k++) {
+            const std::size_t w = work(k);
+            if (w < thread_pool::defaultGrain) {
+                light.push_back(k);
+                before.push_back(before.back() + w + 1);
+            } else
+                heavy.push_back(k);
+        }
+        thread_pool::global().parallelForWeighted(
+                light.size(), [&before](std::size_t i) { return before[i]; }, thread_pool::defaultGrain,
+                [&](std::size_t first, std::size_t last) {
+                    for (std::size_t i = first; i < last; i++)
+                        f(light[i]);
+                });
+        for (std::size_t k : heavy)
+            f(k);
+    }
+
+    std::size_t tileWork(std::size_t k) const {
+        return tiles[k] ? tiles[k]->getStoredSize() : 0;
+    }
+
+    // out (column-major, ld éléments entre deux colonnes) += forme dense de *this. Une tuile dense en
+    // column-major s'ajoute directement ; les autres passent par un tampon dense où la tuile s'ajoute avec
+    // son propre addInto().
+    void addTilesTo(T *out, std::size_t ld) const {
+        forEachPart(tiles.size(), [this](std::size_t k) { return tileWork(k); }, [&](std::size_t k) {
+            if (!tiles[k])
+                return;
+            const std::size_t bi = k / blockCols(), bj = k % blockCols();
+            const std::size_t h = tiles[k]->getHeight(), w = tiles[k]->getWidth();
+            T *corner = out + colStart[bj] * ld + rowStart[bi];
+            auto dense = dynamic_cast<const matrix_dense<T> *>(tiles[k].get());
+            if (dense && dense->getLayout() == dense_layout::column_major) {
+                const T *src = dense->data.data();
+                for (std::size_t j = 0; j < w; j++)
+                    kernels::add(corner + j * ld, src + j * h, corner + j * ld, h);
+                return;
+            }
+            matrix_dense<T> expanded(static_cast<int>(h), static_cast<int>(w));
+            tiles[k]->addInto(expanded, expanded);
+            const T *src = expanded.data.data();
+            for (std::size_t j = 0; j < w; j++)
+                kernels::add(corner + j * ld, src + j * h, corner + j * ld, h);
+        });
+    }
+
+    // dst (dense) = m + (*this) pour un opérande qui n'est pas une matrix_block de même découpage : la forme
+    // dense de *this est écrite dans dst, puis m y est ajouté, par son propre addInto() sauf si c'est une
+    // matrix_block.
+    void addExpanded(matrix_t_<T> &dst, const matrix_t_<T> &m) const {
+        checkSize(m);
+        matrix_dense<T> &out = matrix_t_<T>::template addDestination<matrix_dense<T>>(dst, this->height, this->width);
+        if (out.getLayout() != dense_layout::column_major) {
+            matrix_dense<T> result(this->height, this->width);
+            addExpanded(result, m);
+            out.copyValues(result);
+            return;
+        }
+        T *c = out.data.data();
+        const std::size_t size = this->height * this->width;
+        if (auto dense = dynamic_cast<const matrix_dense<T> *>(&m))
+            out.copyValues(*dense);
+        else
+            thread_pool::global().parallelFor(0, size, thread_pool::defaultGrain,
+                                              [c](std::size_t first, std::size_t last) {
+                                                  std::fill(c + first, c + last, T{});
+                                              });
+        addTilesTo(c, this->height);
+        if (auto block = dynamic_cast<const matrix_block<T> *>(&m))
+            block->addTilesTo(c, this->height);
+        else if (!dynamic_cast<const matrix_dense<T> *>(&m))
+            m.addInto(out, out);
+    }
+
+    std::unique_ptr<matrix_t_<T>> addToDense(const matrix_t_<T> &m) const {
+        checkSize(m);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width);
+        addExpanded(*result, m);
+        return result;
+    }
+
+public:
+    matrix_block(const std::vector<std::size_t> &rowSizes, const std::vector<std::size_t> &colSizes)
+            : matrix_t_<T>(static_cast<int>(starts(rowSizes).back()), static_cast<int>(starts(colSizes).back())),
+              rowStart(starts(rowSizes)), colStart(starts(colSizes)), tiles(rowSizes.size() * colSizes.size()) {}
+
+    matrix_block(const matrix_block &other)
+            : matrix_t_<T>(other), rowStart(other.rowStart), colStart(other.colStart), tiles(other.tiles.size()) {
+        for (std::size_t k = 0; k < tiles.size(); k++)
+            if (other.tiles[k])
+                tiles[k] = copyTile(*other.tiles[k]);
+    }
+
+    matrix_block(matrix_block &&) noexcept = default;
+
+    matrix_block &operator=(const matrix_block &other) {
+        if (&other != this)
+            *this = matrix_block(other);
+        return *this;
+    }
+
+    matrix_block &operator=(matrix_block &&) noexcept = default;
+
+    std::size_t blockRows() const {
+        return rowStart.size() - 1;
+    }
+
+    std::size_t blockCols() const {
+        return colStart.size() - 1;
+    }
+
+    // Première ligne du bloc de lignes bi, première colonne du bloc de colonnes bj.
+    std::size_t blockRowStart(std::size_t bi) const {
+        return rowStart.at(bi);
+    }
+
+    std::size_t blockColStart(std::size_t bj) const {
+        return colStart.at(bj);
+    }
+
+    bool samePartition(const matrix_block<T> &m) const {
+        return rowStart == m.rowStart && colStart == m.colStart;
+    }
+
+    // Tuile (bi, bj), nullptr si elle est vide.
+    matrix_t_<T> *tile(std::size_t bi, std::size_t bj) {
+        return tiles[tileIndex(bi, bj)].get();
+    }
+
+    const matrix_t_<T> *tile(std::size_t bi, std::size_t bj) const {
+        return tiles[tileIndex(bi, bj)].get();
+    }
+
+    // Remplace la tuile (bi, bj), qui doit avoir la taille du bloc ; nullptr la vide.
+    void setTile(std::size_t bi, std::size_t bj, std::unique_ptr<matrix_t_<T>> m) {
+        const std::size_t k = tileIndex(bi, bj);
+        if (m && (m->getHeight() != rowStart[bi + 1] - rowStart[bi] ||
+                  m->getWidth() != colStart[bj + 1] - colStart[bj]))
+            throw std::runtime_error("tile size does not match the block size.");
+        tiles[k] = std::move(m);
+    }
+
+    // Place m, déplacée, en tuile (bi, bj) et renvoie la tuile dans son type concret.
+    template<typename M, typename = typename std::enable_if<std::is_base_of<matrix_t_<T>, M>::value>::type>
+    M &setTile(std::size_t bi, std::size_t bj, M m) {
+        auto owned = std::make_unique<M>(std::move(m));
+        M &result = *owned;
+        setTile(bi, bj, std::unique_ptr<matrix_t_<T>>(std::move(owned)));
+        return result;
+    }
+
+    // Une case d'une tuile vide n'est pas stockée : la version non const lève une exception.
+    T &operator()(std::size_t const &row, std::size_t const &col) override {
+        TP5_STATS_ACCESS(matrix_stats::kind::block);
+        if (row < this->height && col < this->width) {
+            const std::size_t bi = blockOf(rowStart, row), bj = blockOf(colStart, col);
+            matrix_t_<T> *m = tiles[bi * blockCols() + bj].get();
+            if (m == nullptr)
+                throw std::out_of_range("Empty tile.");
+            return (*m)(row - rowStart[bi], col - colStart[bj]);
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    const T &operator()(std::size_t const &row, std::size_t const &col) const override {
+        TP5_STATS_ACCESS(matrix_stats::kind::block);
+        if (row < this->height && col < this->width) {
+            const std::size_t bi = blockOf(rowStart, row), bj = blockOf(colStart, col);
+            const matrix_t_<T> *m = tiles[bi * blockCols() + bj].get();
+            return m ? static_cast<const matrix_t_<T> &>(*m)(row - rowStart[bi], col - colStart[bj]) : zero;
+        } else
+            throw std::out_of_range("Out of range.");
+    }
+
+    size_t getStoredSize() const override {
+        std::size_t result = 0;
+        for (const auto &m : tiles)
+            if (m)
+                result += m->getStoredSize();
+        return result;
+    }
+
+    // Somme, dans l'ordre des tuiles, des morceaux de diagonale de chaque tuile qu'elle traverse : traceSum()
+    // de la tuile pour un bloc diagonal (même début en ligne et en colonne), ses éléments sinon.
+    T traceSum(reduce::summation mode) const override {
+        auto crossing = [this](std::size_t k) {
+            const std::size_t bi = k / blockCols(), bj = k % blockCols();
+            return std::make_pair(std::max(rowStart[bi], colStart[bj]), std::min(rowStart[bi + 1], colStart[bj + 1]));
+        };
+        std::vector<std::size_t> crossed;
+        for (std::size_t k = 0; k < tiles.size(); k++)
+            if (tiles[k] && crossing(k).first < crossing(k).second)
+                crossed.push_back(k);
+        std::vector<T> parts(crossed.size(), T{});
+        forEachPart(crossed.size(), [&](std::size_t p) {
+            return crossing(crossed[p]).second - crossing(crossed[p]).first;
+        }, [&](std::size_t p) {
+            const std::size_t k = crossed[p], bi = k / blockCols(), bj = k % blockCols();
+            const matrix_t_<T> &m = *tiles[k];
+            if (rowStart[bi] == colStart[bj]) {
+                parts[p] = m.traceSum(mode);
+                return;
+            }
+            const std::size_t first = crossing(k).first, last = crossing(k).second;
+            const std::size_t row = first - rowStart[bi], col = first - colStart[bj];
+            parts[p] = reduce::sum<T>(0, last - first, [&m, row, col](std::size_t i) {
+                return m(row + i, col + i);
+            }, mode).value();
+        });
+        reduce::compensated<T> result;
+        for (const T &part : parts)
+            result.add(part);
+        return result.value();
+    }
+
+    T sum(reduce::summation mode = reduce::summation::pairwise) const override {
+        std::vector<T> parts(tiles.size(), T{});
+        forEachPart(tiles.size(), [this](std::size_t k) { return tileWork(k); }, [&](std::size_t k) {
+            if (tiles[k])
+                parts[k] = tiles[k]->sum(mode);
+        });
+        reduce::compensated<T> result;
+        for (const T &part : parts)
+            result.add(part);
+        return result.value();
+    }
+
+    reduce::norm_t<T> normFrobenius(reduce::summation mode = reduce::summation::pairwise) const override {
+        std::vector<reduce::norm_t<T>> parts(tiles.size(), reduce::norm_t<T>{});
+        forEachPart(tiles.size(), [this](std::size_t k) { return tileWork(k); }, [&](std::size_t k) {
+            if (tiles[k]) {
+                const reduce::norm_t<T> norm = tiles[k]->normFrobenius(mode);
+                parts[k] = norm * norm;
+            }
+        });
+        reduce::compensated<reduce::norm_t<T>> result;
+        for (const reduce::norm_t<T> &part : parts)
+            result.add(part);
+        return std::sqrt(result.value());
+    }
+
+    reduce::norm_t<T> normMax() const override {
+        reduce::norm_t<T> result{};
+        for (const auto &m : tiles)
+            if (m)
+                result = std::max(result, m->normMax());
+        return result;
+    }
+
+    void scale(T alpha) override {
+        forEachPart(tiles.size(), [this](std::size_t k) { return tileWork(k); }, [&](std::size_t k) {
+            if (tiles[k])
+                tiles[k]->scale(alpha);
+        });
+    }
+
+    // Chaque ligne de blocs écrit son propre morceau de y : beta s'applique avec la première tuile non vide
+    // de la ligne, les suivantes ajoutent leur produit.
+    void multiplyVector(matrix_span<const T> x, matrix_span<T> y, T alpha = T(1), T beta = T{}) const override {
+        this->checkVectors(x.size(), y.size());
+        const std::size_t cols = blockCols();
+        forEachPart(blockRows(), [&](std::size_t bi) {
+            std::size_t work = rowStart[bi + 1] - rowStart[bi];
+            for (std::size_t bj = 0; bj < cols; bj++)
+                work += tileWork(bi * cols + bj);
+            return work;
+        }, [&](std::size_t bi) {
+            const matrix_span<T> part(y.data() + rowStart[bi], rowStart[bi + 1] - rowStart[bi]);
+            bool first = true;
+            for (std::size_t bj = 0; bj < cols; bj++)
+                if (const matrix_t_<T> *m = tiles[bi * cols + bj].get()) {
+                    m->multiplyVector(matrix_span<const T>(x.data() + colStart[bj], colStart[bj + 1] - colStart[bj]),
+                                      part, alpha, first ? beta : T(1));
+                    first = false;
+                }
+            if (first)
+                kernels::scale(beta, part.data(), part.size());
+        });
+    }
+
+    // Forme dense column-major.
+    matrix_dense<T> toDense() const {
+        matrix_dense<T> result(this->height, this->width);
+        addTilesTo(result.data.data(), this->height);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.add(m2);
+    }
+
+    // Les autres classes n'ont pas de surcharge pour matrix_block : toutes les sommes avec une matrix_block
+    // sont traitées ici, sans renvoyer l'appel à m.
+    std::unique_ptr<matrix_t_<T>> add(const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, this->statsKind(m),
+                        getStoredSize() + m.getStoredSize());
+        if (auto block = dynamic_cast<const matrix_block<T> *>(&m))
+            return add(*block);
+        return addToDense(m);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::dense,
+                        getStoredSize() + m1.getStoredSize());
+        checkSize(m1);
+        auto result = std::make_unique<matrix_dense<T>>(this->height, this->width, m1.getLayout());
+        addExpanded(*result, m1);
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::triangulaire_sup,
+                        getStoredSize() + m1.getStoredSize());
+        return addToDense(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::diag,
+                        getStoredSize() + m1.getStoredSize());
+        return addToDense(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::csr,
+                        getStoredSize() + m1.getStoredSize());
+        return addToDense(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> add(const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::band,
+                        getStoredSize() + m1.getStoredSize());
+        return addToDense(m1);
+    }
+
+    // Même découpage : tuile par tuile, chaque somme par le add() de la tuile ; une tuile vide d'un côté donne
+    // une copie de l'autre, vide des deux côtés une tuile vide. Sinon, somme dense.
+    std::unique_ptr<matrix_t_<T>> add(const matrix_block<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::block,
+                        getStoredSize() + m1.getStoredSize());
+        checkSize(m1);
+        if (!samePartition(m1))
+            return addToDense(m1);
+        auto result = std::make_unique<matrix_block<T>>(*this);
+        std::vector<std::unique_ptr<matrix_t_<T>>> &out = result->tiles;
+        forEachPart(tiles.size(), [&](std::size_t k) { return tileWork(k) + m1.tileWork(k); }, [&](std::size_t k) {
+            if (tiles[k] && m1.tiles[k])
+                out[k] = tiles[k]->add(*m1.tiles[k]);
+            else if (m1.tiles[k])
+                out[k] = copyTile(*m1.tiles[k]);
+        });
+        return result;
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, this->statsKind(m),
+                        getStoredSize() + m.getStoredSize());
+        if (auto block = dynamic_cast<const matrix_block<T> *>(&m))
+            addInto(dst, *block);
+        else
+            addExpanded(dst, m);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_dense<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::dense,
+                        getStoredSize() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_triangulaire_sup<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::triangulaire_sup,
+                        getStoredSize() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_diag<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::diag,
+                        getStoredSize() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_csr<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::csr,
+                        getStoredSize() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    void addInto(matrix_t_<T> &dst, const matrix_band<T> &m1) const override {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::band,
+                        getStoredSize() + m1.getStoredSize());
+        addExpanded(dst, m1);
+    }
+
+    // Même découpage : dst est une matrix_block de ce découpage. Une tuile de dst du même type que les deux
+    // tuiles additionnées reçoit leur somme par addInto(), sans nouveau stockage ; sinon elle est remplacée par le
+    // résultat de add(), ou par une copie quand l'une des deux tuiles est vide.
+    void addInto(matrix_t_<T> &dst, const matrix_block<T> &m1) const {
+        TP5_STATS_SCOPE(matrix_stats::op::add, matrix_stats::kind::block, matrix_stats::kind::block,
+                        getStoredSize() + m1.getStoredSize());
+        checkSize(m1);
+        if (!samePartition(m1)) {
+            addExpanded(dst, m1);
+            return;
+        }
+        matrix_block<T> &out = matrix_t_<T>::template addDestination<matrix_block<T>>(dst, this->height, this->width);
+        if (!samePartition(out))
+            throw std::runtime_error("destination matrix cannot hold the result.");
+        forEachPart(tiles.size(), [&](std::size_t k) { return tileWork(k) + m1.tileWork(k); }, [&](std::size_t k) {
+            const matrix_t_<T> *a = tiles[k].get(), *b = m1.tiles[k].get();
+            std::unique_ptr<matrix_t_<T>> &c = out.tiles[k];
+            if (a && b) {
+                if (c && sameStructure(*a, *b, *c))
+                    a->addInto(*c, *b);
+                else
+                    c = a->add(*b);
+            } else if (a || b) {
+                const matrix_t_<T> *only = a ? a : b;
+                if (c.get() != only)
+                    c = copyTile(*only);
+            } else
+                c.reset();
+        });
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m1, const matrix_t_<T> &m2) override {
+        return m1.multiply(m2);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiply(const matrix_t_<T> &m) const override {
+        return m.multiplyLeft(toDense());
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_dense<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_triangulaire_sup<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_diag<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_csr<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    std::unique_ptr<matrix_t_<T>> multiplyLeft(const matrix_band<T> &m1) const override {
+        return toDense().multiplyLeft(m1);
+    }
+
+    // Découpage échangé, tuile (bj, bi) = transposée de la tuile (bi, bj).
+    matrix_block<T> transposed() const {
+        std::vector<std::size_t> rowSizes(blockCols()), colSizes(blockRows());
+        for (std::size_t bj = 0; bj < blockCols(); bj++)
+            rowSizes[bj] = colStart[bj + 1] - colStart[bj];
+        for (std::size_t bi = 0; bi < blockRows(); bi++)
+            colSizes[bi] = rowStart[bi + 1] - rowStart[bi];
+        matrix_block<T> result(rowSizes, colSizes);
+        forEachPart(tiles.size(), [this](std::size_t k) { return tileWork(k); }, [&](std::size_t k) {
+            if (tiles[k])
+                result.tiles[(k % blockCols()) * blockRows() + k / blockCols()] = tiles[k]->transpose();
+        });
+        return result;
+    }
+
+    std::unique_ptr<matrix_t_<T>> transpose() const override {
+        return std::make_unique<matrix_block<T>>(transposed());
+    }
+};
+
+// addInto(dst, m1, m2) : dst = m1 + m2 sans allocation, avec le même double dispatch que add().
+template<typename T>
+void addInto(matrix_t_<T> &dst, const matrix_t_<T> &m1, const matrix_t_<T> &m2) {
+    m1.addInto(dst, m2);
+}
+
+// axpbyInto(dst, alpha, m1, beta, m2) : dst = alpha * m1 + beta * m2 en une passe, pour tout couple de
+// matrix_dense, matrix_triangulaire_sup et matrix_diag. Le type des scalaires est celui de dst.
+template<typename T, typename M1, typename M2>
+void axpbyInto(matrix_t_<T> &dst, typename std::common_type<T>::type alpha, const M1 &m1,
+               typename std::common_type<T>::type beta, const M2 &m2) {
+    m1.axpbyInto(dst, alpha, beta, m2);
+}
+
+#endif //TP5_MATRIX_H
@@ -0,0 +1,372 @@
+#ifndef TP5_MATRIX_ASYNC_H
+#define TP5_MATRIX_ASYNC_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+#include "matrix_io.h"
+#include "thread_pool.h"
+
+// Opérations asynchrones : addAsync(), traceAsync(), multiplyAsync(), saveMatrixAsync(), loadMatrixAsync() et
+// runAsync() pour une fonction quelconque renvoient tout de suite un matrix_task<R>, dont get() attend le
+// résultat.
+//
+// Les opérations sont lancées par les threads d'un async_executor, distinct du thread_pool des noyaux : un
+// thread de l'exécuteur joue le rôle du thread appelant d'une opération synchrone, et les parallelFor de
+// l'opération se répartissent toujours sur le pool global. Deux opérations indépendantes avancent donc en
+// même temps, chacune découpée entre les threads du pool, sans que l'appelant crée de thread.
+//
+// then(f) enchaîne f sur le résultat : f est lancée par l'exécuteur quand la tâche se termine, et reçoit le
+// résultat par référence const (rien pour une tâche void). Une erreur ou une annulation se propage aux
+// tâches enchaînées sans appeler f.
+//
+// cancel() empêche une tâche qui n'a pas encore commencé de s'exécuter ; get() lève alors task_cancelled. Une
+// opération déjà lancée va jusqu'au bout (les noyaux ne s'interrompent pas) et cancel() renvoie false.
+//
+// Comme pour les expressions, les matrices passées par référence doivent exister, et ne pas être modifiées,
+// jusqu'à la fin de la tâche. Une fonction lancée par l'exécuteur (f de then(), runAsync()) ne doit pas
+// attendre une autre tâche avec get() : si tous les threads de l'exécuteur attendent, plus rien n'avance.
+
+class task_cancelled : public std::runtime_error {
+public:
+    task_cancelled() : std::runtime_error("task was cancelled.") {}
+};
+
+// Threads qui exécutent les tâches, dans l'ordre de soumission. Deux par défaut : les noyaux occupent déjà
+// tous les coeurs à travers le pool, l'exécuteur n'a besoin que de recouvrir une opération par une autre (ou
+// par une entrée-sortie).
+class async_executor {
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    // Le pool global est créé avant l'exécuteur global : il est donc détruit après, quand plus aucune tâche
+    // ne peut l'utiliser.
+    static std::unique_ptr<async_executor> &globalInstance() {
+        thread_pool::global();
+        static std::unique_ptr<async_executor> instance;
+        return instance;
+    }
+
+    static std::mutex &globalMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    void loop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    static constexpr std::size_t defaultThreads = 2;
+
+    explicit async_executor(std::size_t count = defaultThreads) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(1, count); i++)
+            threads.emplace_back([this]() { loop(); });
+    }
+
+    // Les tâches déjà soumises, et celles qu'elles enchaînent, sont exécutées avant l'arrêt.
+    ~async_executor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    async_executor(const async_executor &) = delete;
+
+    async_executor &operator=(const async_executor &) = delete;
+
+    std::size_t size() const {
+        return threads.size();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        available.notify_one();
+    }
+
+    // Exécuteur partagé par les opérations asynchrones.
+    static async_executor &global() {
+        std::lock_guard<std::mutex> lock(globalMutex());
+        std::unique_ptr<async_executor> &instance = globalInstance();
+        if (!instance)
+            instance.reset(new async_executor());
+        return *instance;
+    }
+
+    // Change le nombre de threads de l'exécuteur global, après avoir terminé ses tâches en cours. Ne doit pas
+    // être appelé depuis une tâche.
+    static void setGlobalThreadCount(std::size_t count) {
+        std::unique_ptr<async_executor> replacement(new async_executor(count));
+        std::lock_guard<std::mutex> lock(globalMutex());
+        globalInstance().swap(replacement);
+    }
+};
+
+namespace async_detail {
+
+    // État partagé entre les copies d'un matrix_task, la fonction qui le remplit et les tâches enchaînées.
+    template<typename R>
+    struct shared_state {
+        enum class status {
+            pending,
+            running,
+            finished,
+            cancelled
+        };
+
+        using value_type = typename std::conditional<std::is_void<R>::value, char, R>::type;
+
+        std::mutex mutex;
+        std::condition_variable done;
+        status current = status::pending;
+        std::optional<value_type> value;
+        std::exception_ptr error;
+        // Soumises à l'exécuteur quand la tâche se termine, annulée ou non.
+        std::vector<std::function<void()>> continuations;
+
+        bool completed() const {
+            return current == status::finished || current == status::cancelled;
+        }
+
+        // pending -> running ; faux si la tâche a été annulée avant de commencer.
+        bool start() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (current != status::pending)
+                return false;
+            current = status::running;
+            return true;
+        }
+
+        template<typename... V>
+        void finish(std::exception_ptr e, V &&... v) {
+            complete(status::finished, [&]() {
+                error = e;
+                if constexpr (sizeof...(V) > 0)
+                    value.emplace(std::forward<V>(v)...);
+            });
+        }
+
+        bool cancel() {
+            bool cancelled = false;
+            complete(status::cancelled, [&]() { cancelled = true; });
+            return cancelled;
+        }
+
+        // Ajoute une continuation, ou la soumet tout de suite si la tâche est déjà terminée.
+        void onComplete(std::function<void()> continuation) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!completed()) {
+                    continuations.push_back(std::move(continuation));
+                    return;
+                }
+            }
+            async_executor::global().submit(std::move(continuation));
+        }
+
+    private:
+        // Passe à l'état final (une annulation n'est possible que depuis pending) et soumet les continuations.
+        template<typename F>
+        void complete(status target, F &&update) {
+            std::vector<std::function<void()>> ready;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (target == status::cancelled && current != status::pending)
+                    return;
+                update();
+                current = target;
+                ready.swap(continuations);
+            }
+            done.notify_all();
+            for (std::function<void()> &continuation : ready)
+                async_executor::global().submit(std::move(continuation));
+        }
+    };
+
+    // Type renvoyé par f appelée sur le résultat d'une tâche R (sans argument si R est void).
+    template<typename F, typename R>
+    struct continuation_result {
+        using type = std::invoke_result_t<F, const R &>;
+    };
+
+    template<typename F>
+    struct continuation_result<F, void> {
+        using type = std::invoke_result_t<F>;
+    };
+
+    // Exécute f dans state, sauf si la tâche a été annulée entre-temps.
+    template<typename R, typename F>
+    void run(shared_state<R> &state, F &f) {
+        if (!state.start())
+            return;
+        try {
+            if constexpr (std::is_void<R>::value) {
+                f();
+                state.finish(nullptr, char{});
+            } else
+                state.finish(nullptr, f());
+        } catch (...) {
+            state.finish(std::current_exception());
+        }
+    }
+}
+
+// Résultat d'une opération asynchrone, partagé entre ses copies comme un std::shared_future.
+template<typename R>
+class matrix_task {
+    template<typename> friend class matrix_task;
+
+    using state_type = async_detail::shared_state<R>;
+    using status = typename state_type::status;
+
+    std::shared_ptr<state_type> state;
+
+public:
+    matrix_task() = default;
+
+    explicit matrix_task(std::shared_ptr<state_type> state) : state(std::move(state)) {}
+
+    bool valid() const {
+        return state != nullptr;
+    }
+
+    // Vrai si la tâche est terminée, avec un résultat, une erreur ou une annulation.
+    bool ready() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->completed();
+    }
+
+    bool cancelled() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->current == status::cancelled;
+    }
+
+    void wait() const {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [this]() { return state->completed(); });
+    }
+
+    template<typename Rep, typename Period>
+    bool waitFor(const std::chrono::duration<Rep, Period> &timeout) const {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        return state->done.wait_for(lock, timeout, [this]() { return state->completed(); });
+    }
+
+    // Attend la fin de la tâche et renvoie son résultat (rien pour une tâche void). Relance l'exception de
+    // l'opération, ou task_cancelled si elle a été annulée.
+    decltype(auto) get() const {
+        wait();
+        if (state->current == status::cancelled)
+            throw task_cancelled();
+        if (state->error)
+            std::rethrow_exception(state->error);
+        if constexpr (std::is_void<R>::value)
+            return;
+        else
+            return static_cast<const typename state_type::value_type &>(*state->value);
+    }
+
+    // Annule la tâche si elle n'a pas commencé. Les tâches enchaînées sont annulées à leur tour.
+    bool cancel() {
+        return state->cancel();
+    }
+
+    // Tâche qui exécute f sur le résultat de celle-ci une fois terminée.
+    template<typename F>
+    auto then(F f) const {
+        using result_type = typename async_detail::continuation_result<F, R>::type;
+        auto next = std::make_shared<async_detail::shared_state<result_type>>();
+        std::shared_ptr<state_type> previous = state;
+        previous->onComplete([previous, next, f]() mutable {
+            if (previous->current == status::cancelled) {
+                next->cancel();
+                return;
+            }
+            if (previous->error) {
+                if (next->start())
+                    next->finish(previous->error);
+                return;
+            }
+            auto call = [&]() -> result_type {
+                if constexpr (std::is_void<R>::value)
+                    return f();
+                else
+                    return f(static_cast<const typename state_type::value_type &>(*previous->value));
+            };
+            async_detail::run(*next, call);
+        });
+        return matrix_task<result_type>(next);
+    }
+};
+
+// Lance f() sur l'exécuteur global.
+template<typename F>
+matrix_task<std::invoke_result_t<F>> runAsync(F f) {
+    using result_type = std::invoke_result_t<F>;
+    auto state = std::make_shared<async_detail::shared_state<result_type>>();
+    async_executor::global().submit([state, f]() mutable { async_detail::run(*state, f); });
+    return matrix_task<result_type>(state);
+}
+
+template<typename T>
+matrix_task<std::unique_ptr<matrix_t_<T>>> addAsync(const matrix_t_<T> &m1, const matrix_t_<T> &m2) {
+    return runAsync([&m1, &m2]() { return m1.add(m2); });
+}
+
+// trace() n'est pas const : elle compte son appel dans matrix_stats.
+template<typename T>
+matrix_task<T> traceAsync(matrix_t_<T> &m) {
+    return runAsync([&m]() { return m.trace(); });
+}
+
+template<typename T>
+matrix_task<std::unique_ptr<matrix_t_<T>>> multiplyAsync(const matrix_t_<T> &m1, const matrix_t_<T> &m2) {
+    return runAsync([&m1, &m2]() { return m1.multiply(m2); });
+}
+
+template<typename T>
+matrix_task<void> saveMatrixAsync(const matrix_t_<T> &m, std::string path) {
+    return runAsync([&m, path]() { saveMatrix(m, path); });
+}
+
+template<typename T>
+matrix_task<std::unique_ptr<matrix_t_<T>>> loadMatrixAsync(std::string path, bool mapped = true) {
+    return runAsync([path, mapped]() { return loadMatrix<T>(path, mapped); });
+}
+
+#endif //TP5_MATRIX_ASYNC_H
@@ -0,0 +1,306 @@
+#ifndef TP5_MATRIX_BATCH_H
+#define TP5_MATRIX_BATCH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "matrix.h"
+#include "matrix_expr.h"
+
+// Lot de petites matrices indépendantes de même taille et de même structure (dense, triangulaire supérieure,
+// diagonale) : matrix_batch<T, S>.
+//
+// Boucler add() sur des matrix_dense coûte une allocation de data et un appel virtuel par matrice. Ici les
+// count matrices sont rangées en struct-of-arrays : l'élément stocké k de la matrice n est à
+// data[k * count + n]. Chaque élément stocké forme ainsi une « voie » de count valeurs contiguës, une par
+// matrice. Les opérations (add, trace, produit matrice-vecteur) prennent les éléments un par un, et pour
+// chacun toute une tranche du lot : la boucle interne est un flux contigu sans dépendance entre
+// itérations, vectorisé sur la dimension du lot (noyaux SSE/AVX de matrix_kernels.h ou vectorisation du
+// compilateur). Le débit suit donc la largeur SIMD et non le coût par objet.
+//
+// Dans une matrice, l'ordre des éléments stockés est celui de la classe dynamique de même structure
+// (column-major, lignes compactées, diagonale seule). valInf/defaultVal est propre à chaque matrice : ces
+// valeurs forment une voie supplémentaire, fills() (vide pour une dense).
+//
+// Le lot est découpé en tranches de batchBlock matrices : les voies d'une tranche restent en cache L1 pendant
+// qu'elles servent à tous les éléments. Les tranches sont réparties entre les threads du pool.
+template<typename T, matrix_structure S = matrix_structure::dense>
+class matrix_batch {
+    template<typename, matrix_structure> friend class matrix_batch;
+
+    static constexpr bool hasFill = S != matrix_structure::dense;
+
+    std::size_t count;
+    std::size_t height;
+    std::size_t width;
+    matrix_storage<T> data;
+    matrix_storage<T> fill;
+
+    // f(k, row, col) pour chaque élément stocké, k étant sa position dans l'ordre du stockage.
+    template<typename F>
+    void forEachStored(F &&f) const {
+        if constexpr (S == matrix_structure::dense) {
+            for (std::size_t j = 0, k = 0; j < width; j++)
+                for (std::size_t i = 0; i < height; i++)
+                    f(k++, i, j);
+        } else if constexpr (S == matrix_structure::triangulaire_sup) {
+            for (std::size_t i = 0, k = 0; i < std::min(height, width); i++)
+                for (std::size_t j = i; j < width; j++)
+                    f(k++, i, j);
+        } else {
+            for (std::size_t i = 0; i < std::min(height, width); i++)
+                f(i, i, i);
+        }
+    }
+
+    bool stored(std::size_t row, std::size_t col) const {
+        if constexpr (S == matrix_structure::dense)
+            return true;
+        else if constexpr (S == matrix_structure::triangulaire_sup)
+            return row <= col;
+        else
+            return row == col;
+    }
+
+    // Position dans une matrice de l'élément (row, col), supposé stocké.
+    std::size_t index(std::size_t row, std::size_t col) const {
+        if constexpr (S == matrix_structure::dense)
+            return row + col * height;
+        else if constexpr (S == matrix_structure::triangulaire_sup)
+            return row * width - (row * (row + 1)) / 2 + col;
+        else
+            return row;
+    }
+
+    // Voie de l'élément (row, col) : ses count valeurs, ou celles de fills() hors de la partie stockée.
+    const T *laneAt(std::size_t row, std::size_t col) const {
+        return stored(row, col) ? data.data() + index(row, col) * count : fill.data();
+    }
+
+    // Tranches [first, last) du lot, par blocs de batchBlock matrices, réparties entre les threads. work est
+    // le nombre d'éléments lus par matrice.
+    template<typename F>
+    void forEachBlock(std::size_t work, F &&f) const {
+        const std::size_t grain = std::max<std::size_t>(
+                batchBlock, thread_pool::defaultGrain / std::max<std::size_t>(1, work));
+        thread_pool::global().parallelFor(0, count, grain, [&](std::size_t first, std::size_t last) {
+            for (std::size_t block = first; block < last; block += batchBlock)
+                f(block, std::min(block + batchBlock, last));
+        });
+    }
+
+    static T fillOf(const matrix_dense<T> &) {
+        return T{};
+    }
+
+    static T fillOf(const matrix_triangulaire_sup<T> &m) {
+        return m.getValInf();
+    }
+
+    static T fillOf(const matrix_diag<T> &m) {
+        return m.getDefaultVal();
+    }
+
+    static void setFill(matrix_dense<T> &, T) {}
+
+    static void setFill(matrix_triangulaire_sup<T> &m, T value) {
+        m.setValInf(value);
+    }
+
+    static void setFill(matrix_diag<T> &m, T value) {
+        m.setDefaultVal(value);
+    }
+
+public:
+    using value_type = T;
+    using matrix_type = typename expr_result<T, S>::type;
+    static constexpr matrix_structure structure = S;
+
+    // Matrices par tranche : 256 doubles (2 Ko) par voie, soit une quinzaine de voies en L1.
+    static constexpr std::size_t batchBlock = 256;
+
+    // count matrices height x width, tous les éléments (et valInf/defaultVal) à T{}.
+    matrix_batch(std::size_t count, int height, int width)
+            : count(count), height(height), width(width), fill(hasFill ? count : 0) {
+        data = matrix_storage<T>(getStoredSize() * count);
+    }
+
+    // Nombre de matrices du lot.
+    std::size_t size() const {
+        return count;
+    }
+
+    std::size_t getHeight() const {
+        return height;
+    }
+
+    std::size_t getWidth() const {
+        return width;
+    }
+
+    // Éléments stockés par matrice.
+    std::size_t getStoredSize() const {
+        if constexpr (S == matrix_structure::dense)
+            return height * width;
+        else if constexpr (S == matrix_structure::triangulaire_sup)
+            return matrix_triangulaire_sup<T>::packedSize(height, width);
+        else
+            return std::min(height, width);
+    }
+
+    // Élément stocké k de toutes les matrices : count valeurs contiguës.
+    matrix_span<T> lane(std::size_t k) {
+        if (k >= getStoredSize())
+            throw std::out_of_range("Out of range.");
+        return {data.data() + k * count, count};
+    }
+
+    matrix_span<const T> lane(std::size_t k) const {
+        if (k >= getStoredSize())
+            throw std::out_of_range("Out of range.");
+        return {data.data() + k * count, count};
+    }
+
+    // valInf (triangulaire) ou defaultVal (diagonale) de chaque matrice ; vide pour une dense.
+    matrix_span<T> fills() {
+        return {fill.data(), fill.size()};
+    }
+
+    matrix_span<const T> fills() const {
+        return {fill.data(), fill.size()};
+    }
+
+    // Élément (row, col) de la matrice n. Comme pour les classes dynamiques, écrire hors de la partie
+    // stockée modifie valInf/defaultVal de cette matrice.
+    T &operator()(std::size_t n, std::size_t row, std::size_t col) {
+        if (n >= count || row >= height || col >= width)
+            throw std::out_of_range("Out of range.");
+        return stored(row, col) ? data[index(row, col) * count + n] : fill[n];
+    }
+
+    const T &operator()(std::size_t n, std::size_t row, std::size_t col) const {
+        if (n >= count || row >= height || col >= width)
+            throw std::out_of_range("Out of range.");
+        return stored(row, col) ? data[index(row, col) * count + n] : fill[n];
+    }
+
+    // Copie m, de même taille et de la classe dynamique de même structure, dans la matrice n.
+    void set(std::size_t n, const matrix_type &m) {
+        if (n >= count)
+            throw std::out_of_range("Out of range.");
+        if (m.getHeight() != height || m.getWidth() != width)
+            throw std::runtime_error("matrix are not the same size.");
+        forEachStored([&](std::size_t k, std::size_t i, std::size_t j) { data[k * count + n] = m(i, j); });
+        if (hasFill)
+            fill[n] = fillOf(m);
+    }
+
+    // Copie de la matrice n dans la classe dynamique de même structure.
+    matrix_type get(std::size_t n) const {
+        if (n >= count)
+            throw std::out_of_range("Out of range.");
+        matrix_type result = expr_result<T, S>::make(height, width);
+        forEachStored([&](std::size_t k, std::size_t i, std::size_t j) { result(i, j) = data[k * count + n]; });
+        if (hasFill)
+            setFill(result, fill[n]);
+        return result;
+    }
+
+    // Trace de chaque matrice : out[n] reçoit celle de la matrice n.
+    void trace(matrix_span<T> out) const {
+        if (out.size() != count)
+            throw std::runtime_error("vector sizes are not compatible.");
+        const std::size_t diagonal = std::min(height, width);
+        T *result = out.data();
+        forEachBlock(diagonal, [&](std::size_t first, std::size_t last) {
+            std::fill(result + first, result + last, T{});
+            for (std::size_t i = 0; i < diagonal; i++)
+                kernels::add(result + first, laneAt(i, i) + first, result + first, last - first);
+        });
+    }
+
+    std::vector<T> trace() const {
+        std::vector<T> result(count);
+        trace({result.data(), count});
+        return result;
+    }
+
+    // Somme matrice par matrice, de structure la plus large des deux lots, comme add().
+    template<matrix_structure SB>
+    matrix_batch<T, widestStructure(S, SB)> add(const matrix_batch<T, SB> &m) const {
+        matrix_batch<T, widestStructure(S, SB)> result(count, static_cast<int>(height), static_cast<int>(width));
+        addInto(result, *this, m);
+        return result;
+    }
+
+    // y = alpha * A x + beta * y pour chaque matrice A du lot : x est un lot de vecteurs (width x 1) et y un
+    // lot de vecteurs (height x 1), de même nombre. Avec beta nul, y n'est pas lu. Les éléments hors de la
+    // partie stockée ne sont parcourus que si valInf/defaultVal est non nul dans la tranche.
+    void multiplyVector(const matrix_batch<T, matrix_structure::dense> &x, matrix_batch<T, matrix_structure::dense> &y,
+                        T alpha = T(1), T beta = T{}) const {
+        if (x.count != count || y.count != count || x.height != width || y.height != height || x.width != 1 ||
+            y.width != 1)
+            throw std::runtime_error("vector sizes are not compatible.");
+        const T *xs = x.data.data();
+        T *ys = y.data.data();
+        forEachBlock(height * width, [&](std::size_t first, std::size_t last) {
+            const std::size_t n = last - first;
+            for (std::size_t i = 0; i < height; i++)
+                kernels::scale(beta, ys + i * count + first, n);
+            const bool fillZero = !hasFill || std::all_of(fill.data() + first, fill.data() + last,
+                                                          [](const T &v) { return v == T{}; });
+            for (std::size_t j = 0; j < width; j++) {
+                const T *xj = xs + j * count + first;
+                for (std::size_t i = 0; i < height; i++) {
+                    if (fillZero && !stored(i, j))
+                        continue;
+                    const T *a = laneAt(i, j) + first;
+                    T *yi = ys + i * count + first;
+                    for (std::size_t b = 0; b < n; b++)
+                        yi[b] += alpha * a[b] * xj[b];
+                }
+            }
+        });
+    }
+
+    template<typename U, matrix_structure SD, matrix_structure SA, matrix_structure SB>
+    friend void addInto(matrix_batch<U, SD> &dst, const matrix_batch<U, SA> &a, const matrix_batch<U, SB> &b);
+};
+
+// dst = a + b, matrice par matrice, sans allocation. dst doit avoir la structure la plus large des deux et
+// peut être a ou b : chaque voie n'est lue qu'à la position où elle est écrite.
+template<typename T, matrix_structure SD, matrix_structure SA, matrix_structure SB>
+void addInto(matrix_batch<T, SD> &dst, const matrix_batch<T, SA> &a, const matrix_batch<T, SB> &b) {
+    static_assert(SD == widestStructure(SA, SB), "destination batch cannot hold the result.");
+    if (a.count != b.count || a.height != b.height || a.width != b.width)
+        throw std::runtime_error("matrix are not the same size.");
+    if (dst.count != a.count || dst.height != a.height || dst.width != a.width)
+        throw std::runtime_error("matrix are not the same size.");
+    const std::size_t count = dst.count;
+    T *out = dst.data.data();
+    dst.forEachBlock(2 * dst.getStoredSize(), [&](std::size_t first, std::size_t last) {
+        dst.forEachStored([&](std::size_t k, std::size_t i, std::size_t j) {
+            kernels::add(a.laneAt(i, j) + first, b.laneAt(i, j) + first, out + k * count + first, last - first);
+        });
+        if (matrix_batch<T, SD>::hasFill)
+            kernels::add(a.fill.data() + first, b.fill.data() + first, dst.fill.data() + first, last - first);
+    });
+}
+
+template<typename T, matrix_structure SA, matrix_structure SB>
+matrix_batch<T, widestStructure(SA, SB)> operator+(const matrix_batch<T, SA> &a, const matrix_batch<T, SB> &b) {
+    return a.add(b);
+}
+
+template<typename T>
+using matrix_dense_batch = matrix_batch<T, matrix_structure::dense>;
+
+template<typename T>
+using matrix_triangulaire_sup_batch = matrix_batch<T, matrix_structure::triangulaire_sup>;
+
+template<typename T>
+using matrix_diag_batch = matrix_batch<T, matrix_structure::diag>;
+
+#endif //TP5_MATRIX_BATCH_H
@@ -0,0 +1,521 @@
+#ifndef TP5_MATRIX_EXPR_H
+#define TP5_MATRIX_EXPR_H
+
+#include <functional>
+#include <type_traits>
+
+#include "matrix.h"
+
+// Expressions paresseuses sur matrix_dense / matrix_triangulaire_sup / matrix_diag et sur leurs vues (matrix_view.h).
+//
+// A + B - 2 * C ne calcule rien : l'expression construit un arbre de petits objets qui référencent les
+// opérandes. evaluate(expr) ou assign(dst, expr) parcourt ensuite la destination une seule fois, sans
+// matrice temporaire ni appel virtuel. Le type du résultat est déduit à la compilation à partir des types
+// des feuilles : diag < triangulaire < dense, une somme prend la structure la plus large de ses opérandes.
+//
+// Les feuilles gardent une référence sur les matrices : une expression doit être évaluée tant que ses
+// opérandes existent (typiquement dans la même instruction).
+//
+// Chaque noeud fournit upper(i, j) pour i < j, lower(i, j) pour i > j, diagonal(i), et fill() : la valeur
+// constante hors de la partie stockée (sous la diagonale pour une triangulaire, hors diagonale pour une
+// diagonale). Le découpage par zone évite tout test par élément dans les boucles d'évaluation.
+
+enum class matrix_structure {
+    diag = 0,
+    triangulaire_sup = 1,
+    dense = 2
+};
+
+constexpr matrix_structure widestStructure(matrix_structure a, matrix_structure b) {
+    return static_cast<int>(a) > static_cast<int>(b) ? a : b;
+}
+
+template<typename T, matrix_structure S>
+struct expr_result;
+
+template<typename T>
+struct expr_result<T, matrix_structure::dense> {
+    using type = matrix_dense<T>;
+
+    static type make(std::size_t height, std::size_t width) {
+        return type(static_cast<int>(height), static_cast<int>(width));
+    }
+};
+
+template<typename T>
+struct expr_result<T, matrix_structure::triangulaire_sup> {
+    using type = matrix_triangulaire_sup<T>;
+
+    static type make(std::size_t height, std::size_t width) {
+        return type(static_cast<int>(height), static_cast<int>(width), T{});
+    }
+};
+
+template<typename T>
+struct expr_result<T, matrix_structure::diag> {
+    using type = matrix_diag<T>;
+
+    static type make(std::size_t height, std::size_t width) {
+        return type(static_cast<int>(height), static_cast<int>(width), T{});
+    }
+};
+
+template<typename M>
+class expr_leaf;
+
+// En column-major, l'élément (i, j) est lu directement ; les autres dispositions passent par index().
+template<typename T>
+class expr_leaf<matrix_dense<T>> {
+    const matrix_dense<T> *m;
+    const T *data;
+    std::size_t h;
+    std::size_t w;
+    bool columnMajor;
+
+    T at(std::size_t i, std::size_t j) const { return data[columnMajor ? i + j * h : m->index(i, j)]; }
+
+public:
+    using value_type = T;
+    static constexpr matrix_structure structure = matrix_structure::dense;
+
+    explicit expr_leaf(const matrix_dense<T> &m)
+            : m(&m), data(m.values().data()), h(m.getHeight()), w(m.getWidth()),
+              columnMajor(m.getLayout() == dense_layout::column_major) {}
+
+    std::size_t height() const { return h; }
+
+    std::size_t width() const { return w; }
+
+    T upper(std::size_t i, std::size_t j) const { return at(i, j); }
+
+    T lower(std::size_t i, std::size_t j) const { return at(i, j); }
+
+    T diagonal(std::size_t i) const { return at(i, i); }
+
+    T fill() const { return T{}; }
+};
+
+template<typename T>
+class expr_leaf<matrix_triangulaire_sup<T>> {
+    const T *data;
+    std::size_t h;
+    std::size_t w;
+    T valInf;
+
+public:
+    using value_type = T;
+    static constexpr matrix_structure structure = matrix_structure::triangulaire_sup;
+
+    explicit expr_leaf(const matrix_triangulaire_sup<T> &m)
+            : data(m.values().data()), h(m.getHeight()), w(m.getWidth()), valInf(m.getValInf()) {}
+
+    std::size_t height() const { return h; }
+
+    std::size_t width() const { return w; }
+
+    T upper(std::size_t i, std::size_t j) const { return data[j + i * w - (i * (i + 1)) / 2]; }
+
+    T lower(std::size_t, std::size_t) const { return valInf; }
+
+    T diagonal(std::size_t i) const { return data[i + i * w - (i * (i + 1)) / 2]; }
+
+    T fill() const { return valInf; }
+};
+
+template<typename T>
+class expr_leaf<matrix_diag<T>> {
+    const T *data;
+    std::size_t h;
+    std::size_t w;
+    T defaultVal;
+
+public:
+    using value_type = T;
+    static constexpr matrix_structure structure = matrix_structure::diag;
+
+    explicit expr_leaf(const matrix_diag<T> &m)
+            : data(m.values().data()), h(m.getHeight()), w(m.getWidth()),
+              defaultVal(m.getDefaultVal()) {}
+
+    std::size_t height() const { return h; }
+
+    std::size_t width() const { return w; }
+
+    T upper(std::size_t, std::size_t) const { return defaultVal; }
+
+    T lower(std::size_t, std::size_t) const { return defaultVal; }
+
+    T diagonal(std::size_t i) const { return data[i]; }
+
+    T fill() const { return defaultVal; }
+};
+
+// Vues de matrix_view.h : T peut être const, les noeuds calculent en std::remove_const<T>::type. Une vue de
+// lignes de triangulaire est pleine, une vue de diagonale reste diagonale.
+template<typename T>
+class expr_leaf<matrix_dense_view<T>> {
+    matrix_dense_view<T> v;
+
+public:
+    using value_type = typename matrix_dense_view<T>::value_type;
+    static constexpr matrix_structure structure = matrix_structure::dense;
+
+    explicit expr_leaf(const matrix_dense_view<T> &v) : v(v) {}
+
+    std::size_t height() const { return v.getHeight(); }
+
+    std::size_t width() const { return v.getWidth(); }
+
+    value_type upper(std::size_t i, std::size_t j) const { return v.at(i, j); }
+
+    value_type lower(std::size_t i, std::size_t j) const { return v.at(i, j); }
+
+    value_type diagonal(std::size_t i) const { return v.at(i, i); }
+
+    value_type fill() const { return value_type{}; }
+};
+
+template<typename T>
+class expr_leaf<matrix_triangulaire_sup_view<T>> {
+    matrix_triangulaire_sup_view<T> v;
+
+public:
+    using value_type = typename matrix_triangulaire_sup_view<T>::value_type;
+    static constexpr matrix_structure structure = matrix_structure::dense;
+
+    explicit expr_leaf(const matrix_triangulaire_sup_view<T> &v) : v(v) {}
+
+    std::size_t height() const { return v.getHeight(); }
+
+    std::size_t width() const { return v.getWidth(); }
+
+    value_type upper(std::size_t i, std::size_t j) const { return v.at(i, j); }
+
+    value_type lower(std::size_t i, std::size_t j) const { return v.at(i, j); }
+
+    value_type diagonal(std::size_t i) const { return v.at(i, i); }
+
+    value_type fill() const { return value_type{}; }
+};
+
+template<typename T>
+class expr_leaf<matrix_diag_view<T>> {
+    matrix_diag_view<T> v;
+
+public:
+    using value_type = typename matrix_diag_view<T>::value_type;
+    static constexpr matrix_structure structure = matrix_structure::diag;
+
+    explicit expr_leaf(const matrix_diag_view<T> &v) : v(v) {}
+
+    std::size_t height() const { return v.getHeight(); }
+
+    std::size_t width() const { return v.getWidth(); }
+
+    value_type upper(std::size_t, std::size_t) const { return v.getFill(); }
+
+    value_type lower(std::size_t, std::size_t) const { return v.getFill(); }
+
+    value_type diagonal(std::size_t i) const { return v[i]; }
+
+    value_type fill() const { return v.getFill(); }
+};
+
+template<typename L, typename R, typename Op>
+class expr_binary {
+    L l;
+    R r;
+    Op op;
+
+public:
+    using value_type = typename L::value_type;
+    static constexpr matrix_structure structure = widestStructure(L::structure, R::structure);
+
+    expr_binary(const L &l, const R &r, Op op = Op()) : l(l), r(r), op(op) {
+        if (l.height() != r.height() || l.width() != r.width())
+            throw std::runtime_error("matrix are not the same size.");
+    }
+
+    std::size_t height() const { return l.height(); }
+
+    std::size_t width() const { return l.width(); }
+
+    value_type upper(std::size_t i, std::size_t j) const { return op(l.upper(i, j), r.upper(i, j)); }
+
+    value_type lower(std::size_t i, std::size_t j) const { return op(l.lower(i, j), r.lower(i, j)); }
+
+    value_type diagonal(std::size_t i) const { return op(l.diagonal(i), r.diagonal(i)); }
+
+    value_type fill() const { return op(l.fill(), r.fill()); }
+};
+
+template<typename E, typename F>
+class expr_unary {
+    E e;
+    F f;
+
+public:
+    using value_type = typename E::value_type;
+    static constexpr matrix_structure structure = E::structure;
+
+    expr_unary(const E &e, F f) : e(e), f(f) {}
+
+    std::size_t height() const { return e.height(); }
+
+    std::size_t width() const { return e.width(); }
+
+    value_type upper(std::size_t i, std::size_t j) const { return f(e.upper(i, j)); }
+
+    value_type lower(std::size_t i, std::size_t j) const { return f(e.lower(i, j)); }
+
+    value_type diagonal(std::size_t i) const { return f(e.diagonal(i)); }
+
+    value_type fill() const { return f(e.fill()); }
+};
+
+template<typename T>
+struct expr_scale_op {
+    T s;
+
+    T operator()(const T &x) const { return s * x; }
+};
+
+// is_matrix_expr<X> : X est une matrice concrète ou un noeud d'expression. as_expr() enveloppe les
+// matrices dans une feuille et laisse les noeuds tels quels.
+template<typename X>
+struct is_matrix_expr : std::false_type {
+};
+
+template<typename T>
+struct is_matrix_expr<matrix_dense<T>> : std::true_type {
+};
+
+template<typename T>
+struct is_matrix_expr<matrix_triangulaire_sup<T>> : std::true_type {
+};
+
+template<typename T>
+struct is_matrix_expr<matrix_diag<T>> : std::true_type {
+};
+
+template<typename T>
+struct is_matrix_expr<matrix_dense_view<T>> : std::true_type {
+};
+
+template<typename T>
+struct is_matrix_expr<matrix_triangulaire_sup_view<T>> : std::true_type {
+};
+
+template<typename T>
+struct is_matrix_expr<matrix_diag_view<T>> : std::true_type {
+};
+
+template<typename L, typename R, typename Op>
+struct is_matrix_expr<expr_binary<L, R, Op>> : std::true_type {
+};
+
+template<typename E, typename F>
+struct is_matrix_expr<expr_unary<E, F>> : std::true_type {
+};
+
+template<typename X>
+struct expr_node {
+    using type = X;
+
+    static const X &get(const X &x) { return x; }
+};
+
+template<typename T>
+struct expr_node<matrix_dense<T>> {
+    using type = expr_leaf<matrix_dense<T>>;
+
+    static type get(const matrix_dense<T> &m) { return type(m); }
+};
+
+template<typename T>
+struct expr_node<matrix_triangulaire_sup<T>> {
+    using type = expr_leaf<matrix_triangulaire_sup<T>>;
+
+    static type get(const matrix_triangulaire_sup<T> &m) { return type(m); }
+};
+
+template<typename T>
+struct expr_node<matrix_diag<T>> {
+    using type = expr_leaf<matrix_diag<T>>;
+
+    static type get(const matrix_diag<T> &m) { return type(m); }
+};
+
+template<typename T>
+struct expr_node<matrix_dense_view<T>> {
+    using type = expr_leaf<matrix_dense_view<T>>;
+
+    static type get(const matrix_dense_view<T> &v) { return type(v); }
+};
+
+template<typename T>
+struct expr_node<matrix_triangulaire_sup_view<T>> {
+    using type = expr_leaf<matrix_triangulaire_sup_view<T>>;
+
+    static type get(const matrix_triangulaire_sup_view<T> &v) { return type(v); }
+};
+
+template<typename T>
+struct expr_node<matrix_diag_view<T>> {
+    using type = expr_leaf<matrix_diag_view<T>>;
+
+    static type get(const matrix_diag_view<T> &v) { return type(v); }
+};
+
+template<typename X>
+typename expr_node<X>::type as_expr(const X &x) {
+    return expr_node<X>::get(x);
+}
+
+template<typename A, typename B, typename = typename std::enable_if<
+        is_matrix_expr<A>::value && is_matrix_expr<B>::value>::type>
+expr_binary<typename expr_node<A>::type, typename expr_node<B>::type,
+        std::plus<typename expr_node<A>::type::value_type>>
+operator+(const A &a, const B &b) {
+    return {as_expr(a), as_expr(b)};
+}
+
+template<typename A, typename B, typename = typename std::enable_if<
+        is_matrix_expr<A>::value && is_matrix_expr<B>::value>::type>
+expr_binary<typename expr_node<A>::type, typename expr_node<B>::type,
+        std::minus<typename expr_node<A>::type::value_type>>
+operator-(const A &a, const B &b) {
+    return {as_expr(a), as_expr(b)};
+}
+
+template<typename A, typename = typename std::enable_if<is_matrix_expr<A>::value>::type>
+expr_unary<typename expr_node<A>::type, std::negate<typename expr_node<A>::type::value_type>>
+operator-(const A &a) {
+    return {as_expr(a), {}};
+}
+
+template<typename A, typename = typename std::enable_if<is_matrix_expr<A>::value>::type>
+expr_unary<typename expr_node<A>::type, expr_scale_op<typename expr_node<A>::type::value_type>>
+operator*(typename expr_node<A>::type::value_type s, const A &a) {
+    return {as_expr(a), {s}};
+}
+
+template<typename A, typename = typename std::enable_if<is_matrix_expr<A>::value>::type>
+expr_unary<typename expr_node<A>::type, expr_scale_op<typename expr_node<A>::type::value_type>>
+operator*(const A &a, typename expr_node<A>::type::value_type s) {
+    return {as_expr(a), {s}};
+}
+
+// Évaluation en une passe, colonne par colonne pour suivre le stockage column-major ; ligne par ligne en
+// row-major. En tiled, chaque élément est placé par index().
+template<typename T, typename E>
+void assignExpr(matrix_dense<T> &dst, const E &e) {
+    const std::size_t h = e.height(), w = e.width();
+    T *d = dst.values().data();
+    if (dst.getLayout() == dense_layout::row_major) {
+        for (std::size_t i = 0; i < h; i++) {
+            T *row = d + i * w;
+            for (std::size_t j = 0; j < std::min(i, w); j++)
+                row[j] = e.lower(i, j);
+            if (i < w)
+                row[i] = e.diagonal(i);
+            for (std::size_t j = i + 1; j < w; j++)
+                row[j] = e.upper(i, j);
+        }
+        return;
+    }
+    if (dst.getLayout() == dense_layout::tiled) {
+        for (std::size_t j = 0; j < w; j++)
+            for (std::size_t i = 0; i < h; i++)
+                d[dst.index(i, j)] = i < j ? e.upper(i, j) : i == j ? e.diagonal(i) : e.lower(i, j);
+        return;
+    }
+    for (std::size_t j = 0; j < w; j++) {
+        T *col = d + j * h;
+        const std::size_t diag = std::min(j, h);
+        for (std::size_t i = 0; i < diag; i++)
+            col[i] = e.upper(i, j);
+        if (j < h)
+            col[j] = e.diagonal(j);
+        for (std::size_t i = j + 1; i < h; i++)
+            col[i] = e.lower(i, j);
+    }
+}
+
+// Évaluation en une passe sur les lignes compactées.
+template<typename T, typename E>
+void assignExpr(matrix_triangulaire_sup<T> &dst, const E &e) {
+    static_assert(E::structure != matrix_structure::dense,
+                  "a dense expression cannot be stored in a matrix_triangulaire_sup.");
+    const std::size_t h = e.height(), w = e.width();
+    T *d = dst.values().data();
+    for (std::size_t i = 0; i < std::min(h, w); i++) {
+        T *row = d + dst.rowOffset(i);
+        row[i] = e.diagonal(i);
+        for (std::size_t j = i + 1; j < w; j++)
+            row[j] = e.upper(i, j);
+    }
+    dst.setValInf(e.fill());
+}
+
+template<typename T, typename E>
+void assignExpr(matrix_diag<T> &dst, const E &e) {
+    static_assert(E::structure == matrix_structure::diag,
+                  "only a diagonal expression can be stored in a matrix_diag.");
+    T *d = dst.values().data();
+    for (std::size_t i = 0; i < std::min(e.height(), e.width()); i++)
+        d[i] = e.diagonal(i);
+    dst.setDefaultVal(e.fill());
+}
+
+// Écriture dans une sous-matrice : colonne par colonne ou ligne par ligne selon le plus petit pas de la vue.
+template<typename T, typename E>
+void assignExpr(const matrix_dense_view<T> &dst, const E &e) {
+    const std::size_t h = e.height(), w = e.width();
+    auto at = [&e](std::size_t i, std::size_t j) {
+        return i < j ? e.upper(i, j) : i == j ? e.diagonal(i) : e.lower(i, j);
+    };
+    if (dst.rowStep() <= dst.colStep()) {
+        for (std::size_t j = 0; j < w; j++)
+            for (std::size_t i = 0; i < h; i++)
+                dst.at(i, j) = at(i, j);
+    } else {
+        for (std::size_t i = 0; i < h; i++)
+            for (std::size_t j = 0; j < w; j++)
+                dst.at(i, j) = at(i, j);
+    }
+}
+
+// assign(dst, expr) écrit l'expression dans une matrice existante, sans allocation. dst peut apparaître
+// dans l'expression : chaque élément n'est lu qu'à sa propre position avant d'être écrit.
+template<typename M, typename X, typename = typename std::enable_if<is_matrix_expr<X>::value>::type>
+void assign(M &dst, const X &x) {
+    auto e = as_expr(x);
+    if (dst.getHeight() != e.height() || dst.getWidth() != e.width())
+        throw std::runtime_error("matrix are not the same size.");
+    assignExpr(dst, e);
+}
+
+// Une vue se passe par valeur : assign(m.block(i, j, h, w), expr) écrit dans la matrice m. Contrairement à
+// une matrice, la destination ne doit pas recouvrir un opérande à une autre position (blocs qui se
+// chevauchent d'une même matrice).
+template<typename T, typename X, typename = typename std::enable_if<is_matrix_expr<X>::value>::type>
+void assign(matrix_dense_view<T> dst, const X &x) {
+    auto e = as_expr(x);
+    if (dst.getHeight() != e.height() || dst.getWidth() != e.width())
+        throw std::runtime_error("matrix are not the same size.");
+    assignExpr(dst, e);
+}
+
+// evaluate(expr) renvoie par valeur une matrice du type le moins coûteux pour l'expression.
+template<typename X, typename = typename std::enable_if<is_matrix_expr<X>::value>::type>
+typename expr_result<typename expr_node<X>::type::value_type, expr_node<X>::type::structure>::type
+evaluate(const X &x) {
+    using result_traits = expr_result<typename expr_node<X>::type::value_type, expr_node<X>::type::structure>;
+    auto e = as_expr(x);
+    typename result_traits::type result = result_traits::make(e.height(), e.width());
+    assignExpr(result, e);
+    return result;
+}
+
+#endif //TP5_MATRIX_EXPR_H
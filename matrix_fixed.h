@@ -0,0 +1,257 @@
+#ifndef TP5_MATRIX_FIXED_H
+#define TP5_MATRIX_FIXED_H
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "matrix.h"
+#include "matrix_expr.h"
+
+// Matrices de taille fixée à la compilation (3x3, 4x4...) : matrix_fixed<T, Rows, Cols, S>.
+//
+// Pour de très nombreuses petites matrices, l'appel virtuel de operator(), l'allocation de data et le
+// unique_ptr renvoyé par add() coûtent plus cher que le calcul. Ici la taille et la structure (dense,
+// triangulaire supérieure, diagonale) sont des paramètres template : pas de vtable, les éléments sont dans
+// un std::array à l'intérieur de l'objet, et la construction, operator() const, trace() et add() sont
+// constexpr.
+//
+// Le stockage et la signification des éléments sont ceux des classes dynamiques : column-major pour une
+// dense, lignes compactées pour une triangulaire (valInf sous la diagonale), diagonale seule pour une
+// diagonale (defaultVal ailleurs). add() prend la structure la plus large des deux opérandes, comme
+// add() et les expressions de matrix_expr.h.
+//
+// Les noyaux sont déroulés à la compilation : chaque élément stocké du résultat est calculé par une
+// expansion de paquet sur std::index_sequence, avec des indices constants.
+
+namespace fixed_layout {
+
+    template<matrix_structure S, std::size_t Rows, std::size_t Cols>
+    struct layout;
+
+    // Column-major : l'élément (i, j) est à i + j * Rows.
+    template<std::size_t Rows, std::size_t Cols>
+    struct layout<matrix_structure::dense, Rows, Cols> {
+        static constexpr std::size_t size = Rows * Cols;
+
+        static constexpr bool stored(std::size_t, std::size_t) { return true; }
+
+        static constexpr std::size_t index(std::size_t row, std::size_t col) { return row + col * Rows; }
+
+        static constexpr std::size_t rowOf(std::size_t k) { return k % Rows; }
+
+        static constexpr std::size_t colOf(std::size_t k) { return k / Rows; }
+    };
+
+    // Lignes compactées : la ligne r commence à r * Cols - r * (r - 1) / 2, en colonne r.
+    template<std::size_t Rows, std::size_t Cols>
+    struct layout<matrix_structure::triangulaire_sup, Rows, Cols> {
+        static constexpr std::size_t rows = Rows < Cols ? Rows : Cols;
+        static constexpr std::size_t size = rows * Cols - rows * (rows - 1) / 2;
+
+        static constexpr bool stored(std::size_t row, std::size_t col) { return row <= col; }
+
+        static constexpr std::size_t rowStart(std::size_t row) { return row * Cols - row * (row - 1) / 2; }
+
+        static constexpr std::size_t index(std::size_t row, std::size_t col) { return rowStart(row) + col - row; }
+
+        static constexpr std::size_t rowOf(std::size_t k) {
+            std::size_t row = 0;
+            while (row + 1 < rows && rowStart(row + 1) <= k)
+                row++;
+            return row;
+        }
+
+        static constexpr std::size_t colOf(std::size_t k) { return k - rowStart(rowOf(k)) + rowOf(k); }
+    };
+
+    template<std::size_t Rows, std::size_t Cols>
+    struct layout<matrix_structure::diag, Rows, Cols> {
+        static constexpr std::size_t size = Rows < Cols ? Rows : Cols;
+
+        static constexpr bool stored(std::size_t row, std::size_t col) { return row == col; }
+
+        static constexpr std::size_t index(std::size_t row, std::size_t) { return row; }
+
+        static constexpr std::size_t rowOf(std::size_t k) { return k; }
+
+        static constexpr std::size_t colOf(std::size_t k) { return k; }
+    };
+
+    // Valeur hors de la partie stockée (valInf, defaultVal). Une dense n'en a pas : la classe vide ne prend
+    // aucune place dans matrix_fixed (optimisation de la base vide).
+    template<typename T, bool HasFill>
+    class fill_holder {
+    protected:
+        T fill;
+
+        constexpr explicit fill_holder(T fill) : fill(fill) {}
+
+    public:
+        constexpr T fillValue() const { return fill; }
+    };
+
+    template<typename T>
+    class fill_holder<T, false> {
+    protected:
+        constexpr explicit fill_holder(T) {}
+
+    public:
+        constexpr T fillValue() const { return T{}; }
+    };
+}
+
+template<typename T, std::size_t Rows, std::size_t Cols, matrix_structure S = matrix_structure::dense>
+class matrix_fixed : public fixed_layout::fill_holder<T, S != matrix_structure::dense> {
+    template<typename, std::size_t, std::size_t, matrix_structure> friend class matrix_fixed;
+
+    using layout = fixed_layout::layout<S, Rows, Cols>;
+    using has_fill = std::integral_constant<bool, S != matrix_structure::dense>;
+    using base = fixed_layout::fill_holder<T, has_fill::value>;
+
+    std::array<T, layout::size> data;
+
+    // Élément (row, col) avec valInf/defaultVal hors de la partie stockée ; row et col sont supposés valides.
+    constexpr const T &element(std::size_t row, std::size_t col, std::true_type) const {
+        return layout::stored(row, col) ? data[layout::index(row, col)] : this->fill;
+    }
+
+    constexpr const T &element(std::size_t row, std::size_t col, std::false_type) const {
+        return data[layout::index(row, col)];
+    }
+
+    T &element(std::size_t row, std::size_t col, std::true_type) {
+        return layout::stored(row, col) ? data[layout::index(row, col)] : this->fill;
+    }
+
+    T &element(std::size_t row, std::size_t col, std::false_type) {
+        return data[layout::index(row, col)];
+    }
+
+    template<std::size_t... K>
+    static constexpr std::array<T, layout::size>
+    fromRowsStorage(const std::array<std::array<T, Cols>, Rows> &rows, std::index_sequence<K...>) {
+        return {{rows[layout::rowOf(K)][layout::colOf(K)]...}};
+    }
+
+    template<std::size_t... I>
+    constexpr T traceOf(std::index_sequence<I...>) const {
+        const T diagonal[] = {T{}, element(I, I, has_fill{})...};
+        T sum = {};
+        for (const T &v : diagonal)
+            sum += v;
+        return sum;
+    }
+
+    // Chaque élément stocké du résultat : a(i, j) + b(i, j) à indices constants, valInf/defaultVal compris.
+    template<matrix_structure SA, matrix_structure SB, std::size_t... K>
+    static constexpr std::array<T, layout::size>
+    sumStorage(const matrix_fixed<T, Rows, Cols, SA> &a, const matrix_fixed<T, Rows, Cols, SB> &b,
+               std::index_sequence<K...>) {
+        return {{(a(layout::rowOf(K), layout::colOf(K)) + b(layout::rowOf(K), layout::colOf(K)))...}};
+    }
+
+public:
+    using value_type = T;
+    static constexpr matrix_structure structure = S;
+
+    // Tous les éléments stockés à T{}, valInf/defaultVal aussi.
+    constexpr matrix_fixed() : base(T{}), data() {}
+
+    // values : les éléments stockés dans l'ordre de la classe dynamique correspondante (values()).
+    constexpr explicit matrix_fixed(const std::array<T, layout::size> &values, T fill = T{})
+            : base(fill), data(values) {}
+
+    // Construction à partir des lignes complètes ; seuls les éléments de la partie stockée sont lus.
+    static constexpr matrix_fixed fromRows(const std::array<std::array<T, Cols>, Rows> &rows, T fill = T{}) {
+        return matrix_fixed(fromRowsStorage(rows, std::make_index_sequence<layout::size>{}), fill);
+    }
+
+    static constexpr std::size_t getHeight() { return Rows; }
+
+    static constexpr std::size_t getWidth() { return Cols; }
+
+    static constexpr std::size_t getStoredSize() { return layout::size; }
+
+    // Comme pour les classes dynamiques, écrire hors de la partie stockée modifie valInf/defaultVal.
+    T &operator()(std::size_t const &row, std::size_t const &col) {
+        if (row < Rows && col < Cols)
+            return element(row, col, has_fill{});
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    constexpr const T &operator()(std::size_t const &row, std::size_t const &col) const {
+        return row < Rows && col < Cols ? element(row, col, has_fill{}) : throw std::out_of_range("Out of range.");
+    }
+
+    matrix_span<T> values() {
+        return {data.data(), data.size()};
+    }
+
+    matrix_span<const T> values() const {
+        return {data.data(), data.size()};
+    }
+
+    constexpr T trace() const {
+        return traceOf(std::make_index_sequence<(Rows < Cols ? Rows : Cols)>{});
+    }
+
+    // Somme de deux matrices de même taille, de structure la plus large des deux ; rien n'est alloué.
+    template<matrix_structure SB>
+    constexpr matrix_fixed<T, Rows, Cols, widestStructure(S, SB)>
+    add(const matrix_fixed<T, Rows, Cols, SB> &m) const {
+        using result = matrix_fixed<T, Rows, Cols, widestStructure(S, SB)>;
+        return result(result::sumStorage(*this, m, std::make_index_sequence<result::getStoredSize()>{}),
+                      this->fillValue() + m.fillValue());
+    }
+
+    // Copie dans la classe dynamique de même structure (matrix_dense, matrix_triangulaire_sup, matrix_diag).
+    typename expr_result<T, S>::type toDynamic() const {
+        typename expr_result<T, S>::type result = expr_result<T, S>::make(Rows, Cols);
+        std::copy(data.begin(), data.end(), result.values().begin());
+        copyFill(result, has_fill{});
+        return result;
+    }
+
+    // La sortie texte passe par la classe dynamique : elle alloue, mais n'est pas sur le chemin des calculs.
+    void write(matrix_writer &out, matrix_text_format format) const {
+        toDynamic().write(out, format);
+    }
+
+    void print() const {
+        matrix_writer out(std::cout, std::min(std::size_t{matrix_writer::defaultCapacity}, 16 * Rows * Cols));
+        out.precision(static_cast<int>(std::cout.precision()));
+        write(out, matrix_text_format::tsv);
+    }
+
+private:
+    static void copyFill(matrix_dense<T> &, std::false_type) {}
+
+    void copyFill(matrix_triangulaire_sup<T> &m, std::true_type) const {
+        m.setValInf(this->fill);
+    }
+
+    void copyFill(matrix_diag<T> &m, std::true_type) const {
+        m.setDefaultVal(this->fill);
+    }
+};
+
+template<typename T, std::size_t Rows, std::size_t Cols, matrix_structure SA, matrix_structure SB>
+constexpr matrix_fixed<T, Rows, Cols, widestStructure(SA, SB)>
+operator+(const matrix_fixed<T, Rows, Cols, SA> &a, const matrix_fixed<T, Rows, Cols, SB> &b) {
+    return a.add(b);
+}
+
+template<typename T, std::size_t Rows, std::size_t Cols>
+using matrix_dense_fixed = matrix_fixed<T, Rows, Cols, matrix_structure::dense>;
+
+template<typename T, std::size_t Rows, std::size_t Cols>
+using matrix_triangulaire_sup_fixed = matrix_fixed<T, Rows, Cols, matrix_structure::triangulaire_sup>;
+
+template<typename T, std::size_t Rows, std::size_t Cols>
+using matrix_diag_fixed = matrix_fixed<T, Rows, Cols, matrix_structure::diag>;
+
+#endif //TP5_MATRIX_FIXED_H
@@ -0,0 +1,274 @@
+#ifndef TP5_MATRIX_IO_H
+#define TP5_MATRIX_IO_H
+
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TP5_MATRIX_IO_MMAP 1
+#endif
+
+#include "matrix.h"
+
+// Format binaire des matrices : un en-tête de 64 octets suivi du tableau data brut, exactement dans l'ordre
+// de stockage de la classe (column-major pour dense, lignes compactées pour triangulaire, diagonale seule).
+//
+// Les valeurs sont écrites dans l'ordre des octets de la machine : un fichier écrit sur une machine d'un
+// autre boutisme est refusé à la lecture (le champ version ne correspond plus). Les données commencent à
+// l'offset 64, ce qui garde l'alignement de T quand le fichier est projeté en mémoire.
+//
+// loadMatrix() projette le fichier avec mmap et construit la matrice directement dessus : rien n'est lu
+// avant le premier accès à une page. La projection est privée : modifier la matrice chargée ne modifie pas
+// le fichier (copie à l'écriture, page par page).
+
+namespace matrix_io {
+
+    enum class file_structure : std::uint32_t {
+        dense = 0,
+        triangulaire_sup = 1,
+        diag = 2
+    };
+
+    enum class element_kind : std::uint32_t {
+        signed_integer = 0,
+        unsigned_integer = 1,
+        floating = 2,
+        complex_floating = 3
+    };
+
+    struct file_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t structure;
+        std::uint32_t elementKind;
+        std::uint32_t elementSize;
+        std::uint64_t height;
+        std::uint64_t width;
+        std::uint64_t count;
+        // valInf (triangulaire) ou defaultVal (diagonale), octets bruts de T ; zéros pour une dense.
+        unsigned char fill[16];
+    };
+
+    static_assert(sizeof(file_header) == 64, "the matrix file header must be 64 bytes.");
+
+    constexpr char fileMagic[8] = {'T', 'P', '5', 'M', 'A', 'T', 'R', 'X'};
+    constexpr std::uint32_t fileVersion = 1;
+
+    template<typename T>
+    struct element_traits {
+        static_assert(std::is_arithmetic<T>::value, "unsupported matrix element type.");
+        static constexpr element_kind kind = std::is_floating_point<T>::value ? element_kind::floating
+                                                                                : std::is_signed<T>::value
+                                                                                  ? element_kind::signed_integer
+                                                                                  : element_kind::unsigned_integer;
+    };
+
+    template<typename T>
+    struct element_traits<std::complex<T>> {
+        static constexpr element_kind kind = element_kind::complex_floating;
+    };
+
+    template<typename T>
+    file_header makeHeader(file_structure structure, std::size_t height, std::size_t width, std::size_t count,
+                           T fill) {
+        static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= 16,
+                      "matrix elements must be trivially copyable and at most 16 bytes.");
+        file_header header = {};
+        std::memcpy(header.magic, fileMagic, sizeof(header.magic));
+        header.version = fileVersion;
+        header.structure = static_cast<std::uint32_t>(structure);
+        header.elementKind = static_cast<std::uint32_t>(element_traits<T>::kind);
+        header.elementSize = sizeof(T);
+        header.height = height;
+        header.width = width;
+        header.count = count;
+        std::memcpy(header.fill, &fill, sizeof(T));
+        return header;
+    }
+
+    template<typename T>
+    void writeFile(const std::string &path, const file_header &header, matrix_span<const T> values) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("cannot open " + path + " for writing.");
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(values.data()),
+                  static_cast<std::streamsize>(values.size() * sizeof(T)));
+        if (!out)
+            throw std::runtime_error("cannot write " + path + ".");
+    }
+
+    // Vérifie l'en-tête pour le type T et renvoie la structure stockée.
+    template<typename T>
+    file_structure checkHeader(const file_header &header, std::uint64_t fileSize) {
+        if (std::memcmp(header.magic, fileMagic, sizeof(header.magic)) != 0)
+            throw std::runtime_error("not a matrix file.");
+        if (header.version != fileVersion)
+            throw std::runtime_error("unsupported matrix file version.");
+        if (header.elementKind != static_cast<std::uint32_t>(element_traits<T>::kind) ||
+            header.elementSize != sizeof(T))
+            throw std::runtime_error("matrix file element type does not match.");
+        if (header.height > static_cast<std::uint64_t>(std::numeric_limits<int>::max()) ||
+            header.width > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+            throw std::runtime_error("matrix file is truncated or corrupted.");
+
+        std::uint64_t expected;
+        switch (static_cast<file_structure>(header.structure)) {
+            case file_structure::dense:
+                expected = header.height * header.width;
+                break;
+            case file_structure::triangulaire_sup:
+                expected = matrix_triangulaire_sup<T>::packedSize(header.height, header.width);
+                break;
+            case file_structure::diag:
+                expected = std::min(header.height, header.width);
+                break;
+            default:
+                throw std::runtime_error("unknown matrix structure in file.");
+        }
+        // count vient de height et width (jusqu'à 2^62 éléments) : count * sizeof(T) peut dépasser 64 bits, et
+        // une taille repliée pourrait correspondre à un petit fichier.
+        if (header.count != expected ||
+            header.count > (std::numeric_limits<std::uint64_t>::max() - sizeof(file_header)) / sizeof(T) ||
+            fileSize != sizeof(file_header) + header.count * sizeof(T))
+            throw std::runtime_error("matrix file is truncated or corrupted.");
+        return static_cast<file_structure>(header.structure);
+    }
+
+    template<typename T>
+    std::unique_ptr<matrix_t_<T>> makeMatrix(const file_header &header, matrix_storage<T> storage) {
+        const int h = static_cast<int>(header.height), w = static_cast<int>(header.width);
+        T fill;
+        std::memcpy(&fill, header.fill, sizeof(T));
+        switch (static_cast<file_structure>(header.structure)) {
+            case file_structure::dense:
+                return std::make_unique<matrix_dense<T>>(h, w, std::move(storage));
+            case file_structure::triangulaire_sup:
+                return std::make_unique<matrix_triangulaire_sup<T>>(h, w, fill, std::move(storage));
+            default:
+                return std::make_unique<matrix_diag<T>>(h, w, fill, std::move(storage));
+        }
+    }
+
+    // Lecture complète du fichier dans un stockage alloué (sans mmap).
+    template<typename T>
+    std::unique_ptr<matrix_t_<T>> readFile(const std::string &path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+            throw std::runtime_error("cannot open " + path + ".");
+        const std::uint64_t fileSize = static_cast<std::uint64_t>(in.tellg());
+        file_header header;
+        in.seekg(0);
+        if (fileSize < sizeof(header) || !in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+            throw std::runtime_error("not a matrix file.");
+        checkHeader<T>(header, fileSize);
+        matrix_storage<T> storage(header.count);
+        if (!in.read(reinterpret_cast<char *>(storage.data()), static_cast<std::streamsize>(header.count * sizeof(T))))
+            throw std::runtime_error("cannot read " + path + ".");
+        return makeMatrix<T>(header, std::move(storage));
+    }
+
+#ifdef TP5_MATRIX_IO_MMAP
+
+    // Projection du fichier : le stockage pointe juste après l'en-tête et garde la projection vivante.
+    template<typename T>
+    std::unique_ptr<matrix_t_<T>> mapFile(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + path + ".");
+        struct stat status;
+        if (::fstat(fd, &status) != 0 || static_cast<std::uint64_t>(status.st_size) < sizeof(file_header)) {
+            ::close(fd);
+            throw std::runtime_error("not a matrix file.");
+        }
+        const std::size_t length = static_cast<std::size_t>(status.st_size);
+        void *base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+            return readFile<T>(path);
+        std::shared_ptr<void> mapping(base, [length](void *p) { ::munmap(p, length); });
+
+        const file_header &header = *static_cast<const file_header *>(base);
+        checkHeader<T>(header, length);
+        T *values = reinterpret_cast<T *>(static_cast<char *>(base) + sizeof(file_header));
+        return makeMatrix<T>(header, matrix_storage<T>(values, header.count, std::move(mapping)));
+    }
+
+#endif
+}
+
+// Le fichier est toujours en column-major : une autre disposition est convertie avant l'écriture.
+template<typename T>
+void saveMatrix(const matrix_dense<T> &m, const std::string &path) {
+    if (m.getLayout() != dense_layout::column_major) {
+        saveMatrix(m.withLayout(dense_layout::column_major), path);
+        return;
+    }
+    matrix_io::writeFile(path, matrix_io::makeHeader(matrix_io::file_structure::dense, m.getHeight(), m.getWidth(),
+                                                     m.getStoredSize(), T{}), m.values());
+}
+
+template<typename T>
+void saveMatrix(const matrix_triangulaire_sup<T> &m, const std::string &path) {
+    matrix_io::writeFile(path, matrix_io::makeHeader(matrix_io::file_structure::triangulaire_sup, m.getHeight(),
+                                                     m.getWidth(), m.getStoredSize(), m.getValInf()), m.values());
+}
+
+template<typename T>
+void saveMatrix(const matrix_diag<T> &m, const std::string &path) {
+    matrix_io::writeFile(path, matrix_io::makeHeader(matrix_io::file_structure::diag, m.getHeight(), m.getWidth(),
+                                                     m.getStoredSize(), m.getDefaultVal()), m.values());
+}
+
+template<typename T>
+void saveMatrix(const matrix_t_<T> &m, const std::string &path) {
+    if (auto dense = dynamic_cast<const matrix_dense<T> *>(&m))
+        saveMatrix(*dense, path);
+    else if (auto triang = dynamic_cast<const matrix_triangulaire_sup<T> *>(&m))
+        saveMatrix(*triang, path);
+    else if (auto diag = dynamic_cast<const matrix_diag<T> *>(&m))
+        saveMatrix(*diag, path);
+    else
+        throw std::runtime_error("cannot save this matrix type.");
+}
+
+// Charge une matrice écrite par saveMatrix. Le type concret (dense, triangulaire, diagonale) vient du fichier ;
+// T doit correspondre au type des éléments enregistrés. mapped = false force une lecture complète en mémoire,
+// utile si le fichier risque d'être modifié ou supprimé pendant que la matrice est utilisée.
+template<typename T>
+std::unique_ptr<matrix_t_<T>> loadMatrix(const std::string &path, bool mapped = true) {
+#ifdef TP5_MATRIX_IO_MMAP
+    if (mapped)
+        return matrix_io::mapFile<T>(path);
+#else
+    (void) mapped;
+#endif
+    return matrix_io::readFile<T>(path);
+}
+
+// Écrit la matrice en texte (tsv, csv ou Matrix Market) dans le fichier path, avec precision chiffres
+// significatifs pour les flottants ; par défaut, le texte le plus court qui relit exactement chaque valeur.
+template<typename T>
+void saveText(const matrix_t_<T> &m, const std::string &path, matrix_text_format format,
+              int precision = matrix_writer::shortest) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("cannot open " + path + " for writing.");
+    matrix_writer out(file);
+    out.precision(precision);
+    m.write(out, format);
+    out.flush();
+}
+
+#endif //TP5_MATRIX_IO_H
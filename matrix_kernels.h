@@ -0,0 +1,557 @@
+#ifndef TP5_MATRIX_KERNELS_H
+#define TP5_MATRIX_KERNELS_H
+
+#include <cstddef>
+#include <complex>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include "matrix_reduce.h"
+
+// Noyaux bruts sur les tableaux data des matrices : pas d'appel virtuel ni de test de bornes par élément.
+// Les versions SSE/AVX2 sont choisies à la compilation (-march=native, option TP5_NATIVE), avec une boucle
+// scalaire pour les autres types et pour la fin des tableaux. out peut être égal à a ou b.
+namespace kernels {
+
+    // out[i] = a[i] + b[i]
+    template<typename T>
+    inline void add(const T *a, const T *b, T *out, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++)
+            out[i] = a[i] + b[i];
+    }
+
+    // out[i] = a[i] + s
+    template<typename T>
+    inline void addScalar(const T *a, T s, T *out, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++)
+            out[i] = a[i] + s;
+    }
+
+    inline void add(const double *a, const double *b, double *out, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX__)
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+#elif defined(__SSE2__)
+        for (; i + 2 <= n; i += 2)
+            _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+#endif
+        for (; i < n; i++)
+            out[i] = a[i] + b[i];
+    }
+
+    inline void addScalar(const double *a, double s, double *out, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX__)
+        const __m256d vs = _mm256_set1_pd(s);
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), vs));
+#elif defined(__SSE2__)
+        const __m128d vs = _mm_set1_pd(s);
+        for (; i + 2 <= n; i += 2)
+            _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), vs));
+#endif
+        for (; i < n; i++)
+            out[i] = a[i] + s;
+    }
+
+    inline void add(const float *a, const float *b, float *out, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX__)
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#elif defined(__SSE2__)
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+#endif
+        for (; i < n; i++)
+            out[i] = a[i] + b[i];
+    }
+
+    inline void addScalar(const float *a, float s, float *out, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX__)
+        const __m256 vs = _mm256_set1_ps(s);
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), vs));
+#elif defined(__SSE2__)
+        const __m128 vs = _mm_set1_ps(s);
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), vs));
+#endif
+        for (; i < n; i++)
+            out[i] = a[i] + s;
+    }
+
+    inline void add(const int *a, const int *b, int *out, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                                _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                                 _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i))));
+#elif defined(__SSE2__)
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                             _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i))));
+#endif
+        for (; i < n; i++)
+            out[i] = a[i] + b[i];
+    }
+
+    inline void addScalar(const int *a, int s, int *out, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i vs = _mm256_set1_epi32(s);
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                                _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)), vs));
+#elif defined(__SSE2__)
+        const __m128i vs = _mm_set1_epi32(s);
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                             _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), vs));
+#endif
+        for (; i < n; i++)
+            out[i] = a[i] + s;
+    }
+
+    // std::complex<T> a la même disposition mémoire qu'un tableau T[2] : la somme terme à terme réutilise
+    // le noyau réel sur 2n valeurs.
+    template<typename T>
+    inline void add(const std::complex<T> *a, const std::complex<T> *b, std::complex<T> *out, std::size_t n) {
+        add(reinterpret_cast<const T *>(a), reinterpret_cast<const T *>(b), reinterpret_cast<T *>(out), 2 * n);
+    }
+
+    // Les noyaux mixtes ci-dessous traitent un intervalle de colonnes [first, last) (ou de lignes pour la
+    // triangulaire) pour pouvoir être répartis entre les threads du pool.
+
+    // Dense (column-major, h x w) + triangulaire sup compactée par lignes.
+    // Sous la diagonale la triangulaire vaut valInf : chaque segment de colonne est un addScalar contigu.
+    // Au-dessus, la triangulaire est lue par tuiles carrées pour que les morceaux de lignes compactées
+    // restent en cache pendant qu'on remplit les colonnes denses.
+    template<typename T>
+    inline void addDenseTriangular(const T *dense, const T *packed, T valInf, T *out,
+                                   std::size_t height, std::size_t width, std::size_t first, std::size_t last) {
+        const std::size_t tile = 64;
+        for (std::size_t j = first; j < last; j++) {
+            const std::size_t lower = std::min(j + 1, height);
+            addScalar(dense + j * height + lower, valInf, out + j * height + lower, height - lower);
+        }
+        for (std::size_t jj = first; jj < last; jj += tile) {
+            const std::size_t jEnd = std::min(jj + tile, last);
+            for (std::size_t ii = 0; ii < std::min(jEnd, height); ii += tile) {
+                const std::size_t iEnd = std::min(std::min(ii + tile, jEnd), height);
+                for (std::size_t j = jj; j < jEnd; j++) {
+                    const T *dCol = dense + j * height;
+                    T *oCol = out + j * height;
+                    for (std::size_t i = ii; i < iEnd && i <= j; i++)
+                        oCol[i] = dCol[i] + packed[j + i * width - (i * (i + 1)) / 2];
+                }
+            }
+        }
+    }
+
+    // Dense (column-major, h x w) + diagonale : defaultVal sur chaque segment de colonne hors diagonale, puis
+    // le terme diagonal. Chaque élément est lu avant d'être écrit, out peut donc être dense.
+    template<typename T>
+    inline void addDenseDiagonal(const T *dense, const T *diag, T defaultVal, T *out,
+                                 std::size_t height, std::size_t first, std::size_t last) {
+        for (std::size_t j = first; j < last; j++) {
+            const T *dCol = dense + j * height;
+            T *oCol = out + j * height;
+            if (j < height) {
+                addScalar(dCol, defaultVal, oCol, j);
+                oCol[j] = dCol[j] + diag[j];
+                addScalar(dCol + j + 1, defaultVal, oCol + j + 1, height - j - 1);
+            } else
+                addScalar(dCol, defaultVal, oCol, height);
+        }
+    }
+
+    // Triangulaire sup compactée + diagonale, lignes [first, last) : la diagonale est le premier élément de
+    // chaque ligne compactée, le reste de la ligne reçoit defaultVal.
+    template<typename T>
+    inline void addTriangularDiagonal(const T *packed, const T *diag, T defaultVal, T *out,
+                                      std::size_t width, std::size_t first, std::size_t last) {
+        for (std::size_t i = first, k = first * width - (first * (first - 1)) / 2; i < last; k += width - i, i++) {
+            out[k] = packed[k] + diag[i];
+            addScalar(packed + k + 1, defaultVal, out + k + 1, width - i - 1);
+        }
+    }
+
+    // Triangulaire sup compactée dépliée dans une dense (column-major), colonnes [first, last) : la partie
+    // stockée au-dessus de la diagonale, valInf en dessous.
+    template<typename T>
+    inline void expandTriangular(const T *packed, T valInf, T *out, std::size_t height, std::size_t width,
+                                 std::size_t first, std::size_t last) {
+        for (std::size_t j = first; j < last; j++) {
+            T *col = out + j * height;
+            const std::size_t upper = std::min(j + 1, height);
+            for (std::size_t i = 0; i < upper; i++)
+                col[i] = packed[j + i * width - (i * (i + 1)) / 2];
+            std::fill(col + upper, col + height, valInf);
+        }
+    }
+
+    // Symétrique n x n compactée par lignes comme une triangulaire sup, dépliée dans une dense (column-major),
+    // colonnes [first, last) : les lignes 0..j-1 de la colonne j sont lues une par ligne compactée, les lignes
+    // j..n-1 sont la suite contiguë de la ligne compactée j.
+    template<typename T>
+    inline void expandSymmetric(const T *packed, T *out, std::size_t n, std::size_t first, std::size_t last) {
+        for (std::size_t j = first; j < last; j++) {
+            T *col = out + j * n;
+            for (std::size_t i = 0; i < j; i++)
+                col[i] = packed[j + i * n - (i * (i + 1)) / 2];
+            const T *row = packed + j * n - (j * (j + 1)) / 2;
+            std::copy(row + j, row + n, col + j);
+        }
+    }
+
+    // Même parcours, ajouté à out.
+    template<typename T>
+    inline void addSymmetric(const T *packed, T *out, std::size_t n, std::size_t first, std::size_t last) {
+        for (std::size_t j = first; j < last; j++) {
+            T *col = out + j * n;
+            for (std::size_t i = 0; i < j; i++)
+                col[i] += packed[j + i * n - (i * (i + 1)) / 2];
+            add(col + j, packed + j * n - (j * (j + 1)) / 2 + j, col + j, n - j);
+        }
+    }
+
+    // y += alpha * S x sur les lignes [first, last) d'une symétrique compactée : chaque élément stocké s(i, j),
+    // j > i, est lu une fois pour ses deux cases. Il entre dans le produit scalaire de la ligne i, et
+    // s(i, j) * x[i] est ajouté à yt[j] pour la ligne j. yt peut être y quand un seul appel couvre toutes les
+    // lignes.
+    template<typename T>
+    inline void multiplySymmetricRows(const T *packed, std::size_t n, const T *x, T alpha, T *y, T *yt,
+                                      std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; i++) {
+            const T *row = packed + i * n - (i * (i + 1)) / 2;
+            const T xi = alpha * x[i];
+            T sum = row[i] * x[i];
+            for (std::size_t j = i + 1; j < n; j++) {
+                sum += row[j] * x[j];
+                yt[j] += row[j] * xi;
+            }
+            y[i] += alpha * sum;
+        }
+    }
+
+    // out[i] = alpha * a[i] + beta * b[i], en une passe : chaque élément est lu avant d'être écrit, out peut
+    // être a ou b.
+    template<typename T>
+    inline void axpby(T alpha, const T *a, T beta, const T *b, T *out, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++)
+            out[i] = alpha * a[i] + beta * b[i];
+    }
+
+    // out[i] = alpha * a[i] + s : s est beta fois la valeur constante de l'autre opérande sur ce segment.
+    template<typename T>
+    inline void axpbyScalar(T alpha, const T *a, T s, T *out, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++)
+            out[i] = alpha * a[i] + s;
+    }
+
+    // Versions pondérées des trois noyaux mixtes précédents : out = alpha * A + beta * B, en une seule passe
+    // sur out. Pour la triangulaire, chaque colonne est écrite d'un trait : la partie au-dessus de la diagonale
+    // lit un élément par ligne compactée (les colonnes voisines réutilisent les mêmes lignes de cache), puis le
+    // segment sous la diagonale est un axpbyScalar contigu.
+    template<typename T>
+    inline void axpbyDenseTriangular(T alpha, const T *dense, T beta, const T *packed, T valInf, T *out,
+                                     std::size_t height, std::size_t width, std::size_t first, std::size_t last) {
+        const T fill = beta * valInf;
+        for (std::size_t j = first; j < last; j++) {
+            const T *dCol = dense + j * height;
+            T *oCol = out + j * height;
+            const std::size_t upper = std::min(j + 1, height);
+            for (std::size_t i = 0; i < upper; i++)
+                oCol[i] = alpha * dCol[i] + beta * packed[j + i * width - (i * (i + 1)) / 2];
+            axpbyScalar(alpha, dCol + upper, fill, oCol + upper, height - upper);
+        }
+    }
+
+    template<typename T>
+    inline void axpbyDenseDiagonal(T alpha, const T *dense, T beta, const T *diag, T defaultVal, T *out,
+                                   std::size_t height, std::size_t first, std::size_t last) {
+        const T fill = beta * defaultVal;
+        for (std::size_t j = first; j < last; j++) {
+            const T *dCol = dense + j * height;
+            T *oCol = out + j * height;
+            if (j < height) {
+                axpbyScalar(alpha, dCol, fill, oCol, j);
+                oCol[j] = alpha * dCol[j] + beta * diag[j];
+                axpbyScalar(alpha, dCol + j + 1, fill, oCol + j + 1, height - j - 1);
+            } else
+                axpbyScalar(alpha, dCol, fill, oCol, height);
+        }
+    }
+
+    template<typename T>
+    inline void axpbyTriangularDiagonal(T alpha, const T *packed, T beta, const T *diag, T defaultVal, T *out,
+                                        std::size_t width, std::size_t first, std::size_t last) {
+        const T fill = beta * defaultVal;
+        for (std::size_t i = first, k = first * width - (first * (first - 1)) / 2; i < last; k += width - i, i++) {
+            out[k] = alpha * packed[k] + beta * diag[i];
+            axpbyScalar(alpha, packed + k + 1, fill, out + k + 1, width - i - 1);
+        }
+    }
+
+    // Bandes au format LAPACK : l'élément (i, j) d'une bande (kl, ku) est à ku + i - j + j * (kl + ku + 1).
+    // out = a + b sur les colonnes [first, last), out ayant une bande qui contient celles de a et b. Chaque
+    // case de out est lue dans a et b avant d'être écrite : out peut être a ou b si elle a la même bande.
+    template<typename T>
+    inline void addBand(const T *a, std::size_t kla, std::size_t kua, const T *b, std::size_t klb, std::size_t kub,
+                        T *out, std::size_t kl, std::size_t ku, std::size_t height,
+                        std::size_t first, std::size_t last) {
+        const std::size_t lda = kla + kua + 1, ldb = klb + kub + 1, ld = kl + ku + 1;
+        for (std::size_t j = first; j < last; j++) {
+            const std::size_t lo = j > ku ? j - ku : 0, hi = std::min(height, j + kl + 1);
+            for (std::size_t i = lo; i < hi; i++) {
+                T v = T{};
+                if (i + kua >= j && i <= j + kla)
+                    v += a[kua + i - j + j * lda];
+                if (i + kub >= j && i <= j + klb)
+                    v += b[kub + i - j + j * ldb];
+                out[ku + i - j + j * ld] = v;
+            }
+        }
+    }
+
+    // Lignes creuses : colonnes strictement croissantes, valeurs associées.
+
+    // Nombre de colonnes de l'union des lignes a et b.
+    inline std::size_t sparseUnionSize(const std::size_t *aCol, std::size_t na,
+                                       const std::size_t *bCol, std::size_t nb) {
+        std::size_t i = 0, j = 0, n = 0;
+        while (i < na && j < nb) {
+            if (aCol[i] < bCol[j])
+                i++;
+            else if (bCol[j] < aCol[i])
+                j++;
+            else {
+                i++;
+                j++;
+            }
+            n++;
+        }
+        return n + (na - i) + (nb - j);
+    }
+
+    // Fusion de deux lignes creuses : out reçoit l'union des colonnes, et la somme des valeurs là où elles
+    // se recouvrent. outCol/outVal doivent avoir sparseUnionSize() places.
+    template<typename T>
+    inline void addSparseRows(const std::size_t *aCol, const T *aVal, std::size_t na,
+                              const std::size_t *bCol, const T *bVal, std::size_t nb,
+                              std::size_t *outCol, T *outVal) {
+        std::size_t i = 0, j = 0;
+        while (i < na && j < nb) {
+            if (aCol[i] < bCol[j]) {
+                *outCol++ = aCol[i];
+                *outVal++ = aVal[i++];
+            } else if (bCol[j] < aCol[i]) {
+                *outCol++ = bCol[j];
+                *outVal++ = bVal[j++];
+            } else {
+                *outCol++ = aCol[i];
+                *outVal++ = aVal[i++] + bVal[j++];
+            }
+        }
+        for (; i < na; i++) {
+            *outCol++ = aCol[i];
+            *outVal++ = aVal[i];
+        }
+        for (; j < nb; j++) {
+            *outCol++ = bCol[j];
+            *outVal++ = bVal[j];
+        }
+    }
+
+    // Dense (column-major, hauteur height) += matrice CSR, lignes [first, last). Deux lignes différentes
+    // n'écrivent jamais au même endroit : les morceaux de lignes peuvent être traités en parallèle.
+    template<typename T>
+    inline void addSparseToDense(const std::size_t *rowPtr, const std::size_t *colIdx, const T *values, T *out,
+                                 std::size_t height, std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; i++)
+            for (std::size_t k = rowPtr[i]; k < rowPtr[i + 1]; k++)
+                out[i + colIdx[k] * height] += values[k];
+    }
+
+    // Somme des a[i] * b[i] sur quatre accumulateurs : les additions successives ne s'attendent pas.
+    template<typename T>
+    inline T dot(const T *a, const T *b, std::size_t n) {
+        T s0 = {}, s1 = {}, s2 = {}, s3 = {};
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+        for (; i < n; i++)
+            s0 += a[i] * b[i];
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // y[i] = beta * y[i]. Avec beta nul, y n'est pas lu : il peut ne pas être initialisé.
+    template<typename T>
+    inline void scale(T beta, T *y, std::size_t n) {
+        if (beta == T{}) {
+            std::fill(y, y + n, T{});
+            return;
+        }
+        for (std::size_t i = 0; i < n; i++)
+            y[i] *= beta;
+    }
+
+    // y[0, rows) += alpha * A x, A ayant cols colonnes de rows éléments contigus espacées de lda (column-major).
+    // Les colonnes sont prises quatre par quatre : y est lu et écrit une fois pour quatre colonnes de A.
+    template<typename T>
+    inline void multiplyColumns(const T *a, std::size_t lda, const T *x, T alpha, T *y, std::size_t rows,
+                                std::size_t cols) {
+        std::size_t j = 0;
+        for (; j + 4 <= cols; j += 4) {
+            const T *a0 = a + j * lda, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+            const T x0 = alpha * x[j], x1 = alpha * x[j + 1], x2 = alpha * x[j + 2], x3 = alpha * x[j + 3];
+            for (std::size_t i = 0; i < rows; i++)
+                y[i] += a0[i] * x0 + a1[i] * x1 + a2[i] * x2 + a3[i] * x3;
+        }
+        for (; j < cols; j++) {
+            const T *aj = a + j * lda;
+            const T xj = alpha * x[j];
+            for (std::size_t i = 0; i < rows; i++)
+                y[i] += aj[i] * xj;
+        }
+    }
+
+    // Remontée U x = b pour une triangulaire sup n x n compactée par lignes. Les seconds membres sont les
+    // colonnes [first, last) de x (column-major, hauteur n), remplacées par les solutions ; les pivots sont
+    // supposés non nuls.
+    //
+    // Les lignes sont traitées par blocs de bas en haut. Pour un bloc, la contribution des inconnues déjà
+    // calculées est soustraite tuile par tuile : une tuile de U reste en cache pendant qu'elle sert à tous
+    // les seconds membres, et le morceau de colonne de x correspondant pendant qu'il sert à toutes les
+    // lignes du bloc. Le bloc diagonal est ensuite résolu par remontée.
+    template<typename T>
+    inline void solveUpperPacked(const T *packed, std::size_t n, T *x, std::size_t first, std::size_t last) {
+        const std::size_t block = 64;
+        for (std::size_t rowEnd = n; rowEnd > 0;) {
+            const std::size_t rowBegin = rowEnd > block ? rowEnd - block : 0;
+            for (std::size_t jj = rowEnd; jj < n; jj += block) {
+                const std::size_t count = std::min(block, n - jj);
+                for (std::size_t c = first; c < last; c++) {
+                    T *xc = x + c * n;
+                    for (std::size_t i = rowBegin; i < rowEnd; i++)
+                        xc[i] -= dot(packed + i * n - (i * (i + 1)) / 2 + jj, xc + jj, count);
+                }
+            }
+            for (std::size_t c = first; c < last; c++) {
+                T *xc = x + c * n;
+                for (std::size_t i = rowEnd; i-- > rowBegin;) {
+                    const T *row = packed + i * n - (i * (i + 1)) / 2;
+                    xc[i] = (xc[i] - dot(row + i + 1, xc + i + 1, rowEnd - i - 1)) / row[i];
+                }
+            }
+            rowEnd = rowBegin;
+        }
+    }
+
+    // Matrice de Hessenberg supérieure n x n : la partie j >= i compactée par lignes comme une triangulaire
+    // sup, et la sous-diagonale sub (sub[i] = H(i, i - 1), sub[0] inutilisé). Élimination de Gauss avec
+    // pivot partiel : à l'étape k, seules les lignes k et k + 1 sont candidates. packed devient triangulaire
+    // (sub n'est plus lu) ; swapped[k] et factor[k] enregistrent les opérations pour applyHessenberg().
+    template<typename T>
+    inline void reduceHessenberg(T *packed, T *sub, std::size_t n, unsigned char *swapped, T *factor) {
+        for (std::size_t k = 0; k + 1 < n; k++) {
+            T *rowK = packed + k * n - (k * (k + 1)) / 2, *rowNext = packed + (k + 1) * n - ((k + 1) * (k + 2)) / 2;
+            swapped[k] = reduce::absolute(sub[k + 1]) > reduce::absolute(rowK[k]);
+            if (swapped[k]) {
+                std::swap(rowK[k], sub[k + 1]);
+                std::swap_ranges(rowK + k + 1, rowK + n, rowNext + k + 1);
+            }
+            factor[k] = rowK[k] == T{} ? T{} : sub[k + 1] / rowK[k];
+            for (std::size_t j = k + 1; j < n; j++)
+                rowNext[j] -= factor[k] * rowK[j];
+        }
+    }
+
+    // Applique aux colonnes [first, last) de x (hauteur n) les échanges et éliminations de reduceHessenberg().
+    template<typename T>
+    inline void applyHessenberg(const unsigned char *swapped, const T *factor, std::size_t n, T *x,
+                                std::size_t first, std::size_t last) {
+        for (std::size_t c = first; c < last; c++) {
+            T *xc = x + c * n;
+            for (std::size_t k = 0; k + 1 < n; k++) {
+                if (swapped[k])
+                    std::swap(xc[k], xc[k + 1]);
+                xc[k + 1] -= factor[k] * xc[k];
+            }
+        }
+    }
+
+    // Bloc de base des transpositions récursives : 32 x 32 éléments (8 Ko en double) restent en L1 pendant
+    // qu'ils sont lus par colonnes et écrits par lignes.
+    constexpr std::size_t transposeBase = 32;
+
+    // dst = transposée de src, src ayant rows lignes et cols colonnes (column-major, colonnes espacées de
+    // srcLd) et dst cols lignes et rows colonnes (espacées de dstLd). Transposition cache-oblivious : la plus
+    // grande dimension est coupée en deux jusqu'au bloc de base, quelle que soit la taille des caches.
+    template<typename T>
+    inline void transposeBlock(const T *src, std::size_t srcLd, T *dst, std::size_t dstLd, std::size_t rows,
+                               std::size_t cols) {
+        if (rows <= transposeBase && cols <= transposeBase) {
+            for (std::size_t i = 0; i < rows; i++)
+                for (std::size_t j = 0; j < cols; j++)
+                    dst[j + i * dstLd] = src[i + j * srcLd];
+        } else if (rows >= cols) {
+            const std::size_t half = rows / 2;
+            transposeBlock(src, srcLd, dst, dstLd, half, cols);
+            transposeBlock(src + half, srcLd, dst + half * dstLd, dstLd, rows - half, cols);
+        } else {
+            const std::size_t half = cols / 2;
+            transposeBlock(src, srcLd, dst, dstLd, rows, half);
+            transposeBlock(src + half * srcLd, srcLd, dst + half, dstLd, rows, cols - half);
+        }
+    }
+
+    // Échange a (rows x cols, colonnes espacées de lda) avec la transposée de b (cols x rows, espacées de
+    // ldb) : a(i, j) <-> b(j, i). Même découpage récursif que transposeBlock().
+    template<typename T>
+    inline void swapTransposed(T *a, std::size_t lda, T *b, std::size_t ldb, std::size_t rows, std::size_t cols) {
+        if (rows <= transposeBase && cols <= transposeBase) {
+            for (std::size_t j = 0; j < cols; j++)
+                for (std::size_t i = 0; i < rows; i++)
+                    std::swap(a[i + j * lda], b[j + i * ldb]);
+        } else if (rows >= cols) {
+            const std::size_t half = rows / 2;
+            swapTransposed(a, lda, b, ldb, half, cols);
+            swapTransposed(a + half, lda, b + half * ldb, ldb, rows - half, cols);
+        } else {
+            const std::size_t half = cols / 2;
+            swapTransposed(a, lda, b, ldb, rows, half);
+            swapTransposed(a + half * lda, lda, b + half, ldb, rows, cols - half);
+        }
+    }
+
+    // Transposition sur place d'une matrice carrée n x n (colonnes espacées de ld) : les deux blocs diagonaux
+    // sont transposés récursivement, les deux blocs hors diagonale échangés avec swapTransposed().
+    template<typename T>
+    inline void transposeSquare(T *a, std::size_t ld, std::size_t n) {
+        if (n <= transposeBase) {
+            for (std::size_t j = 1; j < n; j++)
+                for (std::size_t i = 0; i < j; i++)
+                    std::swap(a[i + j * ld], a[j + i * ld]);
+            return;
+        }
+        const std::size_t half = n / 2;
+        transposeSquare(a, ld, half);
+        transposeSquare(a + half + half * ld, ld, n - half);
+        swapTransposed(a + half, ld, a + half * ld, ld, n - half, half);
+    }
+}
+
+#endif //TP5_MATRIX_KERNELS_H
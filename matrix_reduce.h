@@ -0,0 +1,320 @@
+#ifndef TP5_MATRIX_REDUCE_H
+#define TP5_MATRIX_REDUCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include "thread_pool.h"
+
+// Réductions sur les éléments des matrices : sommes (trace, somme totale), sommes de carrés et de modules
+// (normes), maximum des modules, produits scalaires.
+//
+// Trois façons de sommer n termes, au choix de l'appelant (summation) :
+// - fast : quatre accumulateurs indépendants, vectorisés (AVX/SSE2 pour les tableaux de double, vectorisation
+//   du compilateur sinon). L'erreur d'arrondi croît en O(n).
+// - kahan : somme compensée de Kahan sur quatre voies indépendantes, fusionnées par Neumaier. L'erreur ne
+//   dépend plus de n, pour environ quatre fois plus d'opérations flottantes.
+// - pairwise : somme par moitiés récursives jusqu'à des blocs de pairwiseBlock termes sommés en fast. L'erreur
+//   croît en O(log n) pour le coût de fast ; c'est le mode par défaut des méthodes des matrices.
+//
+// Les versions parallèles découpent l'intervalle entre les threads du pool : chaque morceau est réduit dans le
+// mode demandé et les résultats partiels sont additionnés avec compensation (compensated), dans l'ordre des
+// morceaux. Pour les entiers les trois modes donnent le même résultat exact.
+namespace reduce {
+
+    enum class summation {
+        fast,
+        kahan,
+        pairwise
+    };
+
+    // Type des normes : la partie réelle pour std::complex<R>, double pour les entiers (la norme de Frobenius
+    // d'une matrice entière n'est pas entière).
+    template<typename T>
+    struct norm_type {
+        using type = typename std::conditional<std::is_integral<T>::value, double, T>::type;
+    };
+
+    template<typename R>
+    struct norm_type<std::complex<R>> {
+        using type = R;
+    };
+
+    template<typename T>
+    using norm_t = typename norm_type<T>::type;
+
+    // |x|, comme std::abs (réel pour std::complex). std::abs est ambigu sur les entiers non signés, qui sont déjà
+    // leur propre module.
+    template<typename T>
+    auto absolute(const T &x) {
+        if constexpr (std::is_unsigned<T>::value)
+            return x;
+        else
+            return std::abs(x);
+    }
+
+    // |x| et |x|² dans le type des normes.
+    template<typename T>
+    norm_t<T> magnitude(const T &x) {
+        if constexpr (std::is_unsigned<T>::value)
+            return static_cast<norm_t<T>>(x);
+        else
+            return static_cast<norm_t<T>>(std::abs(x));
+    }
+
+    template<typename T>
+    norm_t<T> squaredMagnitude(const T &x) {
+        return static_cast<norm_t<T>>(x) * static_cast<norm_t<T>>(x);
+    }
+
+    template<typename R>
+    R squaredMagnitude(const std::complex<R> &x) {
+        return std::norm(x);
+    }
+
+    // Somme compensée de Neumaier : correction garde ce que les additions de sum ont perdu. Sert à combiner
+    // des sommes partielles (morceaux des threads, voies de Kahan) sans reperdre la précision gagnée.
+    template<typename T>
+    struct compensated {
+        T sum = {};
+        T correction = {};
+
+        void add(const T &x) {
+            const T t = sum + x;
+            if (absolute(sum) >= absolute(x))
+                correction += (sum - t) + x;
+            else
+                correction += (x - t) + sum;
+            sum = t;
+        }
+
+        compensated &operator+=(const compensated &other) {
+            add(other.sum);
+            add(other.correction);
+            return *this;
+        }
+
+        T value() const {
+            return sum + correction;
+        }
+    };
+
+    // Maximum, avec l'interface attendue par thread_pool::parallelReduce (init += partiel).
+    template<typename R>
+    struct maximum {
+        R value = {};
+
+        maximum &operator+=(const maximum &other) {
+            value = std::max(value, other.value);
+            return *this;
+        }
+    };
+
+    constexpr std::size_t pairwiseBlock = 128;
+
+    // Somme de f(i) pour i dans [first, last), sur quatre accumulateurs : les additions successives ne
+    // s'attendent pas et la boucle se vectorise.
+    template<typename R, typename F>
+    R fastSum(std::size_t first, std::size_t last, const F &f) {
+        R s0 = {}, s1 = {}, s2 = {}, s3 = {};
+        std::size_t i = first;
+        for (; i + 4 <= last; i += 4) {
+            s0 += f(i);
+            s1 += f(i + 1);
+            s2 += f(i + 2);
+            s3 += f(i + 3);
+        }
+        for (; i < last; i++)
+            s0 += f(i);
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // Kahan sur quatre voies, chacune avec sa correction, puis fusion compensée des voies.
+    template<typename R, typename F>
+    compensated<R> kahanSum(std::size_t first, std::size_t last, const F &f) {
+        R s[4] = {}, c[4] = {};
+        std::size_t i = first;
+        for (; i + 4 <= last; i += 4)
+            for (std::size_t l = 0; l < 4; l++) {
+                const R y = f(i + l) - c[l];
+                const R t = s[l] + y;
+                c[l] = (t - s[l]) - y;
+                s[l] = t;
+            }
+        compensated<R> result;
+        for (std::size_t l = 0; l < 4; l++) {
+            result.add(s[l]);
+            result.add(-c[l]);
+        }
+        for (; i < last; i++)
+            result.add(f(i));
+        return result;
+    }
+
+    template<typename R, typename F>
+    R pairwiseSum(std::size_t first, std::size_t last, const F &f) {
+        if (last - first <= pairwiseBlock)
+            return fastSum<R>(first, last, f);
+        const std::size_t middle = first + (last - first) / 2;
+        return pairwiseSum<R>(first, middle, f) + pairwiseSum<R>(middle, last, f);
+    }
+
+    template<typename R, typename F>
+    compensated<R> sum(std::size_t first, std::size_t last, const F &f, summation mode) {
+        compensated<R> result;
+        if (first >= last)
+            return result;
+        switch (mode) {
+            case summation::kahan:
+                return kahanSum<R>(first, last, f);
+            case summation::pairwise:
+                result.add(pairwiseSum<R>(first, last, f));
+                return result;
+            default:
+                result.add(fastSum<R>(first, last, f));
+                return result;
+        }
+    }
+
+    // Sommes de tableaux contigus de double en fast : deux registres AVX (ou SSE2) d'accumulateurs.
+    inline double fastSum(const double *a, std::size_t n) {
+        std::size_t i = 0;
+        double total = 0;
+#if defined(__AVX__)
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        for (; i + 8 <= n; i += 8) {
+            s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a + i));
+            s1 = _mm256_add_pd(s1, _mm256_loadu_pd(a + i + 4));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_add_pd(s0, s1));
+        total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__SSE2__)
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        for (; i + 4 <= n; i += 4) {
+            s0 = _mm_add_pd(s0, _mm_loadu_pd(a + i));
+            s1 = _mm_add_pd(s1, _mm_loadu_pd(a + i + 2));
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, _mm_add_pd(s0, s1));
+        total = lanes[0] + lanes[1];
+#endif
+        for (; i < n; i++)
+            total += a[i];
+        return total;
+    }
+
+    inline double fastDot(const double *a, const double *b, std::size_t n) {
+        std::size_t i = 0;
+        double total = 0;
+#if defined(__AVX__)
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        for (; i + 8 <= n; i += 8) {
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+            s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_add_pd(s0, s1));
+        total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__SSE2__)
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        for (; i + 4 <= n; i += 4) {
+            s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, _mm_add_pd(s0, s1));
+        total = lanes[0] + lanes[1];
+#endif
+        for (; i < n; i++)
+            total += a[i] * b[i];
+        return total;
+    }
+
+    // Somme de a[0, n) : en fast et en pairwise, les tableaux de double passent par fastSum(const double *).
+    template<typename T>
+    compensated<T> sum(const T *a, std::size_t n, summation mode) {
+        if constexpr (std::is_same<T, double>::value) {
+            if (mode != summation::kahan) {
+                compensated<T> result;
+                if (mode == summation::fast || n <= pairwiseBlock) {
+                    result.add(fastSum(a, n));
+                    return result;
+                }
+                const std::size_t middle = n / 2;
+                result.add(sum(a, middle, mode).value() + sum(a + middle, n - middle, mode).value());
+                return result;
+            }
+        }
+        return sum<T>(0, n, [a](std::size_t i) { return a[i]; }, mode);
+    }
+
+    template<typename T>
+    compensated<T> dot(const T *a, const T *b, std::size_t n, summation mode) {
+        if constexpr (std::is_same<T, double>::value) {
+            if (mode != summation::kahan) {
+                compensated<T> result;
+                if (mode == summation::fast || n <= pairwiseBlock) {
+                    result.add(fastDot(a, b, n));
+                    return result;
+                }
+                const std::size_t middle = n / 2;
+                result.add(dot(a, b, middle, mode).value() + dot(a + middle, b + middle, n - middle, mode).value());
+                return result;
+            }
+        }
+        return sum<T>(0, n, [a, b](std::size_t i) { return a[i] * b[i]; }, mode);
+    }
+
+    // Versions réparties entre les threads du pool, par morceaux d'au moins grain termes.
+    template<typename R, typename F>
+    R parallelSum(std::size_t n, std::size_t grain, summation mode, const F &f) {
+        return thread_pool::global().parallelReduce(
+                0, n, grain, compensated<R>{},
+                [&](std::size_t first, std::size_t last) { return sum<R>(first, last, f, mode); }).value();
+    }
+
+    template<typename T>
+    T parallelSum(const T *a, std::size_t n, summation mode) {
+        return thread_pool::global().parallelReduce(
+                0, n, thread_pool::defaultGrain, compensated<T>{},
+                [=](std::size_t first, std::size_t last) { return sum(a + first, last - first, mode); }).value();
+    }
+
+    template<typename T>
+    T parallelDot(const T *a, const T *b, std::size_t n, summation mode) {
+        return thread_pool::global().parallelReduce(
+                0, n, thread_pool::defaultGrain, compensated<T>{},
+                [=](std::size_t first, std::size_t last) {
+                    return dot(a + first, b + first, last - first, mode);
+                }).value();
+    }
+
+    // Somme des |a[i]|² et maximum des |a[i]|.
+    template<typename T>
+    norm_t<T> parallelSumSquares(const T *a, std::size_t n, summation mode) {
+        return parallelSum<norm_t<T>>(n, thread_pool::defaultGrain, mode,
+                                      [a](std::size_t i) { return squaredMagnitude(a[i]); });
+    }
+
+    template<typename T>
+    norm_t<T> parallelMaxMagnitude(const T *a, std::size_t n) {
+        return thread_pool::global().parallelReduce(
+                0, n, thread_pool::defaultGrain, maximum<norm_t<T>>{},
+                [a](std::size_t first, std::size_t last) {
+                    maximum<norm_t<T>> result;
+                    for (std::size_t i = first; i < last; i++)
+                        result.value = std::max(result.value, magnitude(a[i]));
+                    return result;
+                }).value;
+    }
+}
+
+#endif //TP5_MATRIX_REDUCE_H
@@ -0,0 +1,219 @@
+#ifndef TP5_MATRIX_SPAN_H
+#define TP5_MATRIX_SPAN_H
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+// Vues sans copie sur le stockage des matrices. Contrairement à operator()(i,j), elles ne font ni appel
+// virtuel ni test de bornes par élément, et ne passent jamais par valInf/defaultVal : les boucles écrites
+// dessus peuvent être vectorisées par le compilateur. Une vue est invalidée si la matrice est détruite.
+
+// Tableau contigu : pointeur + taille (équivalent minimal de std::span, qui n'arrive qu'en C++20).
+template<typename T>
+class matrix_span {
+    T *ptr;
+    std::size_t count;
+
+public:
+    matrix_span(T *ptr, std::size_t count) : ptr(ptr), count(count) {}
+
+    // Une vue modifiable se convertit en vue en lecture seule.
+    template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    matrix_span(const matrix_span<U> &other) : ptr(other.data()), count(other.size()) {}
+
+    T *data() const { return ptr; }
+
+    std::size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    T &operator[](std::size_t i) const { return ptr[i]; }
+
+    T *begin() const { return ptr; }
+
+    T *end() const { return ptr + count; }
+};
+
+// Morceau stocké d'une ligne de matrix_triangulaire_sup : les colonnes firstCol..firstCol + size() - 1.
+// operator[] est indexé par numéro de colonne, comme operator()(row, col).
+template<typename T>
+class matrix_row_segment {
+    T *ptr;
+    std::size_t first;
+    std::size_t count;
+
+public:
+    matrix_row_segment(T *ptr, std::size_t first, std::size_t count) : ptr(ptr), first(first), count(count) {}
+
+    std::size_t firstCol() const { return first; }
+
+    std::size_t size() const { return count; }
+
+    T *data() const { return ptr; }
+
+    T &operator[](std::size_t col) const { return ptr[col - first]; }
+
+    T *begin() const { return ptr; }
+
+    T *end() const { return ptr + count; }
+};
+
+// Morceau stocké d'une colonne de matrix_band ou de matrix_triangulaire_inf : les lignes firstRow()..firstRow() + size() - 1.
+// operator[] est indexé par numéro de ligne.
+template<typename T>
+class matrix_column_segment {
+    T *ptr;
+    std::size_t first;
+    std::size_t count;
+
+public:
+    matrix_column_segment(T *ptr, std::size_t first, std::size_t count) : ptr(ptr), first(first), count(count) {}
+
+    std::size_t firstRow() const { return first; }
+
+    std::size_t size() const { return count; }
+
+    T *data() const { return ptr; }
+
+    T &operator[](std::size_t row) const { return ptr[row - first]; }
+
+    T *begin() const { return ptr; }
+
+    T *end() const { return ptr + count; }
+};
+
+// Élément stocké renvoyé par les itérateurs stored() : position et référence vers la valeur.
+template<typename T>
+struct matrix_entry {
+    std::size_t row;
+    std::size_t col;
+    T &value;
+};
+
+// Itérateurs sur les seuls éléments stockés, dans l'ordre du stockage.
+template<typename T>
+class column_major_iterator {
+    T *ptr;
+    std::size_t height;
+    std::size_t row;
+    std::size_t col;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = matrix_entry<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = matrix_entry<T>;
+
+    column_major_iterator(T *ptr, std::size_t height, std::size_t row, std::size_t col)
+            : ptr(ptr), height(height), row(row), col(col) {}
+
+    matrix_entry<T> operator*() const { return {row, col, *ptr}; }
+
+    column_major_iterator &operator++() {
+        ++ptr;
+        if (++row == height) {
+            row = 0;
+            ++col;
+        }
+        return *this;
+    }
+
+    column_major_iterator operator++(int) {
+        column_major_iterator old(*this);
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const column_major_iterator &other) const { return ptr == other.ptr; }
+
+    bool operator!=(const column_major_iterator &other) const { return ptr != other.ptr; }
+};
+
+template<typename T>
+class packed_upper_iterator {
+    T *ptr;
+    std::size_t width;
+    std::size_t row;
+    std::size_t col;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = matrix_entry<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = matrix_entry<T>;
+
+    packed_upper_iterator(T *ptr, std::size_t width, std::size_t row, std::size_t col)
+            : ptr(ptr), width(width), row(row), col(col) {}
+
+    matrix_entry<T> operator*() const { return {row, col, *ptr}; }
+
+    packed_upper_iterator &operator++() {
+        ++ptr;
+        if (++col == width) {
+            ++row;
+            col = row;
+        }
+        return *this;
+    }
+
+    packed_upper_iterator operator++(int) {
+        packed_upper_iterator old(*this);
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const packed_upper_iterator &other) const { return ptr == other.ptr; }
+
+    bool operator!=(const packed_upper_iterator &other) const { return ptr != other.ptr; }
+};
+
+template<typename T>
+class diagonal_iterator {
+    T *ptr;
+    std::size_t index;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = matrix_entry<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = matrix_entry<T>;
+
+    diagonal_iterator(T *ptr, std::size_t index) : ptr(ptr), index(index) {}
+
+    matrix_entry<T> operator*() const { return {index, index, *ptr}; }
+
+    diagonal_iterator &operator++() {
+        ++ptr;
+        ++index;
+        return *this;
+    }
+
+    diagonal_iterator operator++(int) {
+        diagonal_iterator old(*this);
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const diagonal_iterator &other) const { return ptr == other.ptr; }
+
+    bool operator!=(const diagonal_iterator &other) const { return ptr != other.ptr; }
+};
+
+template<typename It>
+class stored_range {
+    It first;
+    It last;
+
+public:
+    stored_range(It first, It last) : first(first), last(last) {}
+
+    It begin() const { return first; }
+
+    It end() const { return last; }
+};
+
+#endif //TP5_MATRIX_SPAN_H
@@ -0,0 +1,305 @@
+#ifndef TP5_MATRIX_STATS_H
+#define TP5_MATRIX_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Compteurs d'instrumentation des opérations de matrices : appels, éléments touchés, octets alloués pour les
+// stockages data et temps passé, par type d'opération (add par couple de types, trace, print, operator()).
+//
+// Ils ne sont compilés qu'avec TP5_STATS défini (option CMake du même nom). Sans lui, les points de mesure
+// TP5_STATS_* ne sont que ((void) 0) : leurs arguments ne sont pas évalués et le code des matrices est celui
+// d'un build sans instrumentation. read() renvoie alors un relevé vide.
+//
+// Chaque thread a ses propres compteurs, écrits sans synchronisation ; read() additionne ceux de tous les
+// threads vivants et ceux des threads terminés. reset() ne doit pas être appelé pendant qu'une opération
+// instrumentée est en cours sur un autre thread.
+namespace matrix_stats {
+
+    // Classes de matrix.h, dans l'ordre des types de matrix_value.
+    enum class kind : unsigned char {
+        dense,
+        triangulaire_sup,
+        diag,
+        csr,
+        band,
+        triangulaire_inf,
+        symmetric,
+        block
+    };
+
+    enum class op : unsigned char {
+        add,
+        trace,
+        print,
+        access
+    };
+
+    constexpr std::size_t kinds = 8;
+
+    inline const char *kindName(kind k) {
+        static const char *const names[kinds] = {"dense", "triang", "diag", "csr", "band", "triang-inf", "sym",
+                                                   "block"};
+        return names[static_cast<std::size_t>(k)];
+    }
+
+    // Valeurs d'un compteur. elements compte les éléments stockés lus par l'opération (un par appel pour
+    // operator()) ; le temps n'est pas mesuré pour operator(), dont l'appel coûte moins que l'horloge.
+    struct counter {
+        std::uint64_t calls = 0;
+        std::uint64_t elements = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t nanoseconds = 0;
+    };
+
+    struct entry {
+        std::string name;
+        counter value;
+    };
+
+    // Relevé des compteurs non nuls, nommés comme les entrées du benchmark : "add/dense+triang",
+    // "trace/csr", "print/diag", "operator()/band". Les allocations faites hors de toute opération mesurée
+    // sont dans "other".
+    class snapshot {
+        std::vector<entry> entries;
+
+    public:
+        explicit snapshot(std::vector<entry> entries = {}) : entries(std::move(entries)) {}
+
+        const std::vector<entry> &all() const {
+            return entries;
+        }
+
+        // Compteur de nom name, nul s'il n'a pas été relevé.
+        counter get(const std::string &name) const {
+            for (const entry &e : entries)
+                if (e.name == name)
+                    return e.value;
+            return {};
+        }
+
+        void writeJson(std::ostream &out) const {
+#if defined(TP5_STATS)
+            out << "{\n  \"enabled\": true,\n  \"operations\": [\n";
+#else
+            out << "{\n  \"enabled\": false,\n  \"operations\": [\n";
+#endif
+            for (std::size_t i = 0; i < entries.size(); i++) {
+                const counter &c = entries[i].value;
+                out << "    {\"name\": \"" << entries[i].name << "\", \"calls\": " << c.calls
+                    << ", \"elements\": " << c.elements << ", \"bytes\": " << c.bytes
+                    << ", \"ns\": " << c.nanoseconds << "}" << (i + 1 < entries.size() ? "," : "") << "\n";
+            }
+            out << "  ]\n}\n";
+        }
+    };
+
+#if defined(TP5_STATS)
+
+    constexpr bool enabled = true;
+
+    namespace detail {
+        // Emplacements : add (kinds x kinds couples), puis trace, print et operator() par classe, puis other.
+        constexpr std::size_t slots = kinds * kinds + 3 * kinds + 1;
+        constexpr std::size_t other = slots - 1;
+
+        inline std::size_t slotOf(op o, kind a, kind b) {
+            const auto i = static_cast<std::size_t>(a);
+            switch (o) {
+                case op::add:
+                    return i * kinds + static_cast<std::size_t>(b);
+                case op::trace:
+                    return kinds * kinds + i;
+                case op::print:
+                    return kinds * kinds + kinds + i;
+                default:
+                    return kinds * kinds + 2 * kinds + i;
+            }
+        }
+
+        inline std::string slotName(std::size_t slot) {
+            if (slot == other)
+                return "other";
+            if (slot < kinds * kinds)
+                return std::string("add/") + kindName(static_cast<kind>(slot / kinds)) + "+" +
+                       kindName(static_cast<kind>(slot % kinds));
+            static const char *const prefixes[3] = {"trace/", "print/", "operator()/"};
+            const std::size_t k = slot - kinds * kinds;
+            return std::string(prefixes[k / kinds]) + kindName(static_cast<kind>(k % kinds));
+        }
+
+        // Compteur écrit par un seul thread et lu par read() : chargements et écritures relaxed, sans
+        // instruction atomique de lecture-modification-écriture.
+        struct cell {
+            std::atomic<std::uint64_t> calls{0}, elements{0}, bytes{0}, nanoseconds{0};
+
+            static void bump(std::atomic<std::uint64_t> &a, std::uint64_t n) {
+                a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            void addTo(counter &c) const {
+                c.calls += calls.load(std::memory_order_relaxed);
+                c.elements += elements.load(std::memory_order_relaxed);
+                c.bytes += bytes.load(std::memory_order_relaxed);
+                c.nanoseconds += nanoseconds.load(std::memory_order_relaxed);
+            }
+
+            void clear() {
+                calls.store(0, std::memory_order_relaxed);
+                elements.store(0, std::memory_order_relaxed);
+                bytes.store(0, std::memory_order_relaxed);
+                nanoseconds.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        struct thread_counters;
+
+        // Compteurs de tous les threads vivants, et totaux des threads terminés.
+        struct registry {
+            std::mutex mutex;
+            std::vector<thread_counters *> threads;
+            counter retired[slots];
+
+            // Jamais détruit : les threads du pool global se terminent pendant la destruction des objets
+            // statiques et retirent alors leurs compteurs.
+            static registry &get() {
+                static registry *instance = new registry();
+                return *instance;
+            }
+        };
+
+        struct thread_counters {
+            cell cells[slots];
+            // Opération mesurée en cours sur ce thread (other si aucune) et profondeur des scopes imbriqués.
+            std::size_t current = other;
+            std::size_t depth = 0;
+
+            thread_counters() {
+                registry &r = registry::get();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.threads.push_back(this);
+            }
+
+            ~thread_counters() {
+                registry &r = registry::get();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                for (std::size_t s = 0; s < slots; s++)
+                    cells[s].addTo(r.retired[s]);
+                r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+            }
+
+            static thread_counters &local() {
+                thread_local thread_counters instance;
+                return instance;
+            }
+        };
+    }
+
+    // Mesure d'une opération, de la construction à la destruction. Seul le scope le plus externe d'un thread
+    // compte : une opération qui en délègue une autre (add() dont le double dispatch repasse par add()) n'est
+    // comptée qu'une fois, et les allocations faites pendant la délégation lui sont attribuées.
+    class scope {
+        detail::thread_counters &counters;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        scope(op o, kind a, std::size_t elements) : scope(o, a, a, elements) {}
+
+        scope(op o, kind a, kind b, std::size_t elements) : counters(detail::thread_counters::local()) {
+            if (counters.depth++ > 0)
+                return;
+            counters.current = detail::slotOf(o, a, b);
+            detail::cell &c = counters.cells[counters.current];
+            detail::cell::bump(c.calls, 1);
+            detail::cell::bump(c.elements, elements);
+            start = std::chrono::steady_clock::now();
+        }
+
+        ~scope() {
+            if (--counters.depth > 0)
+                return;
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            detail::cell::bump(counters.cells[counters.current].nanoseconds,
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            counters.current = detail::other;
+        }
+
+        scope(const scope &) = delete;
+
+        scope &operator=(const scope &) = delete;
+    };
+
+    inline void countAccess(kind k) {
+        detail::cell &c = detail::thread_counters::local().cells[detail::slotOf(op::access, k, k)];
+        detail::cell::bump(c.calls, 1);
+        detail::cell::bump(c.elements, 1);
+    }
+
+    // Octets alloués pour un stockage, attribués à l'opération en cours sur ce thread.
+    inline void countAllocation(std::size_t bytes) {
+        detail::thread_counters &t = detail::thread_counters::local();
+        detail::cell::bump(t.cells[t.current].bytes, bytes);
+    }
+
+    // Somme des compteurs de tous les threads.
+    inline snapshot read() {
+        detail::registry &r = detail::registry::get();
+        std::vector<counter> totals;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            totals.assign(std::begin(r.retired), std::end(r.retired));
+            for (const detail::thread_counters *t : r.threads)
+                for (std::size_t s = 0; s < detail::slots; s++)
+                    t->cells[s].addTo(totals[s]);
+        }
+        std::vector<entry> entries;
+        for (std::size_t s = 0; s < detail::slots; s++)
+            if (totals[s].calls != 0 || totals[s].bytes != 0)
+                entries.push_back({detail::slotName(s), totals[s]});
+        return snapshot(std::move(entries));
+    }
+
+    inline void reset() {
+        detail::registry &r = detail::registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::fill(std::begin(r.retired), std::end(r.retired), counter{});
+        for (detail::thread_counters *t : r.threads)
+            for (detail::cell &c : t->cells)
+                c.clear();
+    }
+
+#define TP5_STATS_SCOPE(...) matrix_stats::scope tp5StatsScope(__VA_ARGS__)
+#define TP5_STATS_ACCESS(k) matrix_stats::countAccess(k)
+#define TP5_STATS_ALLOCATION(bytes) matrix_stats::countAllocation(bytes)
+
+#else
+
+    constexpr bool enabled = false;
+
+    inline snapshot read() {
+        return snapshot();
+    }
+
+    inline void reset() {}
+
+#define TP5_STATS_SCOPE(...) ((void) 0)
+#define TP5_STATS_ACCESS(k) ((void) 0)
+#define TP5_STATS_ALLOCATION(bytes) ((void) 0)
+
+#endif
+
+    // Relevé courant au format JSON.
+    inline void writeJson(std::ostream &out) {
+        read().writeJson(out);
+    }
+}
+
+#endif //TP5_MATRIX_STATS_H
@@ -0,0 +1,152 @@
+#ifndef TP5_MATRIX_STORAGE_H
+#define TP5_MATRIX_STORAGE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "matrix_stats.h"
+
+// Stockage des éléments d'une matrice (le membre data de matrix_t_).
+//
+// Il se comporte comme le std::vector<T> qu'il remplace (data(), size(), operator[], begin()/end(), copie
+// profonde), mais peut aussi pointer dans une mémoire qu'il ne possède pas, par exemple un fichier projeté
+// en mémoire par loadMatrix() : owner garde alors cette mémoire vivante tant que le stockage existe.
+//
+// Le partage est explicite : sharedCopy(m) copie une matrice (ou tout objet qui contient des stockages) en
+// partageant les blocs de m au lieu de les recopier, en O(1). Les deux copies comptent chacune une référence ;
+// les accès en écriture (versions non const de data(), operator[], begin() et end()) détachent d'abord un
+// bloc partagé en recopiant ses éléments dans un bloc à elles, les accès const ne copient jamais.
+//
+// Ce partage a le contrat d'une copie sur écriture : un pointeur, une référence (celle que renvoie
+// operator()(i, j) d'une matrice) ou un matrix_span pris sur m avant sharedCopy(m) désignent le bloc partagé,
+// et écrire au travers modifierait aussi la copie ; il faut les redemander après. Les vues modifiables de
+// matrix_view.h prennent leur pointeur par exclusiveData() : le bloc n'est alors plus jamais partagé, et
+// sharedCopy() en recopie les éléments. Deux copies partagées peuvent être écrites depuis deux threads : le
+// détachement ne touche qu'au compteur atomique du bloc.
+
+namespace storage_sharing {
+
+    // Vrai pendant sharedCopy() : les stockages copiés par ce thread partagent leur bloc.
+    inline thread_local bool active = false;
+
+    // Active le partage le temps d'une copie, et rend l'état précédent même si la copie lève une exception.
+    class scope {
+        bool previous;
+
+    public:
+        scope() : previous(active) {
+            active = true;
+        }
+
+        ~scope() {
+            active = previous;
+        }
+
+        scope(const scope &) = delete;
+
+        scope &operator=(const scope &) = delete;
+    };
+}
+
+template<typename T>
+class matrix_storage {
+    std::shared_ptr<T> block;
+    std::size_t count = 0;
+    // Un pointeur modifiable sur le bloc est gardé par une vue : le bloc ne doit plus être partagé.
+    bool exclusive = false;
+
+    // use_count() est une lecture relâchée du compteur : la barrière acquire ordonne les écritures qui suivent
+    // après les lectures de la copie qui vient de lâcher le bloc dans un autre thread. ThreadSanitizer ne suit
+    // pas les barrières isolées et signale ce cas à tort.
+    void detach() {
+        if (block.use_count() > 1)
+            copyBlock();
+        else
+            std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    void copyBlock() {
+        matrix_storage copy(count);
+        std::copy(block.get(), block.get() + count, copy.block.get());
+        block = std::move(copy.block);
+    }
+
+public:
+    matrix_storage() = default;
+
+    // n éléments initialisés à T{}, comme std::vector<T>(n).
+    explicit matrix_storage(std::size_t n)
+            : block(n ? std::shared_ptr<T>(new T[n](), std::default_delete<T[]>()) : nullptr), count(n) {
+        TP5_STATS_ALLOCATION(n * sizeof(T));
+    }
+
+    // n éléments à l'adresse ptr, sans copie. owner libère la mémoire quand plus aucun stockage ne l'utilise.
+    matrix_storage(T *ptr, std::size_t n, std::shared_ptr<void> owner) : block(std::move(owner), ptr), count(n) {}
+
+    // Copie profonde, comme std::vector. Dans sharedCopy(), la copie partage le bloc, sauf si une vue
+    // modifiable a été prise dessus.
+    matrix_storage(const matrix_storage &other) : block(other.block), count(other.count) {
+        if (!storage_sharing::active || other.exclusive)
+            copyBlock();
+    }
+
+    matrix_storage(matrix_storage &&other) noexcept
+            : block(std::move(other.block)), count(other.count), exclusive(other.exclusive) {
+        other.count = 0;
+        other.exclusive = false;
+    }
+
+    matrix_storage &operator=(matrix_storage other) noexcept {
+        std::swap(block, other.block);
+        std::swap(count, other.count);
+        std::swap(exclusive, other.exclusive);
+        return *this;
+    }
+
+    T *data() {
+        detach();
+        return block.get();
+    }
+
+    // Comme data(), pour un pointeur gardé au-delà de l'appel (vues modifiables de matrix_view.h) : le bloc
+    // n'est plus partagé par les copies suivantes, qui ne verront donc pas les écritures faites au travers.
+    T *exclusiveData() {
+        detach();
+        exclusive = true;
+        return block.get();
+    }
+
+    const T *data() const { return block.get(); }
+
+    std::size_t size() const { return count; }
+
+    // Vrai si le bloc est partagé avec une copie faite par sharedCopy() : la prochaine écriture le recopiera.
+    bool shared() const { return block.use_count() > 1; }
+
+    T &operator[](std::size_t i) {
+        detach();
+        return block.get()[i];
+    }
+
+    const T &operator[](std::size_t i) const { return block.get()[i]; }
+
+    T *begin() { return data(); }
+
+    T *end() { return data() + count; }
+
+    const T *begin() const { return block.get(); }
+
+    const T *end() const { return block.get() + count; }
+};
+
+// Copie de m dont les stockages partagent leur bloc avec ceux de m jusqu'à la première écriture d'un côté.
+template<typename M>
+M sharedCopy(const M &m) {
+    storage_sharing::scope sharing;
+    return M(m);
+}
+
+#endif //TP5_MATRIX_STORAGE_H
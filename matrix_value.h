@@ -0,0 +1,230 @@
+#ifndef TP5_MATRIX_VALUE_H
+#define TP5_MATRIX_VALUE_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "matrix.h"
+
+// Dispatch statique : matrix_value<T> est un std::variant des types concrets, manipulé par valeur.
+//
+// add(a, b) sur deux matrix_value ne fait aucun appel virtuel et n'alloue pas de unique_ptr : std::visit
+// choisit le noyau de la paire de types dans une table construite à la compilation (une entrée par couple
+// de types), une seule fois par appel. Le noyau est le addInto() de la classe concrète, appelé sur un type
+// statique final, donc sans passer par la vtable. Le résultat est renvoyé dans un matrix_value.
+//
+// Les règles de structure du résultat sont celles de add() : sumIndex() les donne pour chaque paire. Pour
+// diag + CSR et diag + bande, le résultat dépend de defaultVal et n'est connu qu'à l'exécution.
+//
+// La hiérarchie virtuelle reste disponible : asMatrix() donne un matrix_t_<T> & sur le contenu (print(),
+// multiply()...) et toValue() copie une matrice quelconque dans un matrix_value.
+
+template<typename T>
+using matrix_value = std::variant<matrix_dense<T>, matrix_triangulaire_sup<T>, matrix_diag<T>, matrix_csr<T>,
+        matrix_band<T>>;
+
+namespace static_dispatch {
+
+    // Position du type M dans le variant V.
+    template<typename M, typename V>
+    struct index_of;
+
+    template<typename M, typename... Ts>
+    struct index_of<M, std::variant<M, Ts...>> : std::integral_constant<std::size_t, 0> {
+    };
+
+    template<typename M, typename U, typename... Ts>
+    struct index_of<M, std::variant<U, Ts...>>
+            : std::integral_constant<std::size_t, 1 + index_of<M, std::variant<Ts...>>::value> {
+    };
+
+    template<typename T, typename M>
+    constexpr std::size_t indexOf = index_of<M, matrix_value<T>>::value;
+
+    // Classe de m pour les compteurs de matrix_stats.h : les types du variant sont dans l'ordre de
+    // matrix_stats::kind.
+    template<typename T, typename M>
+    matrix_stats::kind kindOf(const M &) {
+        return static_cast<matrix_stats::kind>(indexOf<T, M>);
+    }
+
+    // Position dans matrix_value<T> du type de a + b. Par défaut dense ; les paires commutent.
+    template<typename T>
+    std::size_t sumIndex(const matrix_t_<T> &, const matrix_t_<T> &) {
+        return indexOf<T, matrix_dense<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_triangulaire_sup<T> &, const matrix_triangulaire_sup<T> &) {
+        return indexOf<T, matrix_triangulaire_sup<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_triangulaire_sup<T> &, const matrix_diag<T> &) {
+        return indexOf<T, matrix_triangulaire_sup<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_diag<T> &, const matrix_triangulaire_sup<T> &) {
+        return indexOf<T, matrix_triangulaire_sup<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_diag<T> &, const matrix_diag<T> &) {
+        return indexOf<T, matrix_diag<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_diag<T> &a, const matrix_csr<T> &) {
+        return a.getDefaultVal() != T{} ? indexOf<T, matrix_dense<T>> : indexOf<T, matrix_csr<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_csr<T> &a, const matrix_diag<T> &b) {
+        return sumIndex(b, a);
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_diag<T> &a, const matrix_band<T> &) {
+        return a.getDefaultVal() != T{} ? indexOf<T, matrix_dense<T>> : indexOf<T, matrix_band<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_band<T> &a, const matrix_diag<T> &b) {
+        return sumIndex(b, a);
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_csr<T> &, const matrix_csr<T> &) {
+        return indexOf<T, matrix_csr<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_csr<T> &, const matrix_band<T> &) {
+        return indexOf<T, matrix_csr<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_band<T> &, const matrix_csr<T> &) {
+        return indexOf<T, matrix_csr<T>>;
+    }
+
+    template<typename T>
+    std::size_t sumIndex(const matrix_band<T> &, const matrix_band<T> &) {
+        return indexOf<T, matrix_band<T>>;
+    }
+
+    // Largeurs de bande d'un opérande : une diagonale est une bande (0, 0).
+    template<typename T>
+    std::pair<std::size_t, std::size_t> bandwidths(const matrix_t_<T> &) {
+        return {0, 0};
+    }
+
+    template<typename T>
+    std::pair<std::size_t, std::size_t> bandwidths(const matrix_band<T> &m) {
+        return {m.getLowerBandwidth(), m.getUpperBandwidth()};
+    }
+
+    // Matrice vide du type d'indice index, destination de a + b.
+    template<typename T, typename A, typename B>
+    matrix_value<T> makeDestination(std::size_t index, const A &a, const B &b) {
+        const int h = static_cast<int>(a.getHeight()), w = static_cast<int>(a.getWidth());
+        switch (index) {
+            case indexOf<T, matrix_dense<T>>:
+                return matrix_dense<T>(h, w);
+            case indexOf<T, matrix_triangulaire_sup<T>>:
+                return matrix_triangulaire_sup<T>(h, w, T{});
+            case indexOf<T, matrix_diag<T>>:
+                return matrix_diag<T>(h, w, T{});
+            case indexOf<T, matrix_csr<T>>:
+                return matrix_csr<T>(h, w);
+            default: {
+                const auto ba = bandwidths<T>(a), bb = bandwidths<T>(b);
+                return matrix_band<T>(h, w, std::max(ba.first, bb.first), std::max(ba.second, bb.second));
+            }
+        }
+    }
+
+    // Vrai si dst contient déjà une matrice du type d'indice index et de la bonne taille.
+    template<typename T>
+    bool reusable(const matrix_value<T> &dst, std::size_t index, std::size_t height, std::size_t width) {
+        if (dst.index() != index)
+            return false;
+        return std::visit([&](const auto &m) { return m.getHeight() == height && m.getWidth() == width; }, dst);
+    }
+}
+
+// dst = a + b. dst est réutilisé s'il a déjà le type et la taille du résultat (pas d'allocation pour dense,
+// triangulaire, diagonale et bande de même largeur), sinon il est remplacé.
+template<typename T>
+void addInto(matrix_value<T> &dst, const matrix_value<T> &a, const matrix_value<T> &b) {
+    std::visit([&dst](const auto &x, const auto &y) {
+        if (x.getHeight() != y.getHeight() || x.getWidth() != y.getWidth())
+            throw std::runtime_error("matrix are not the same size.");
+        TP5_STATS_SCOPE(matrix_stats::op::add, static_dispatch::kindOf<T>(x), static_dispatch::kindOf<T>(y),
+                        x.getStoredSize() + y.getStoredSize());
+        const std::size_t index = static_dispatch::sumIndex<T>(x, y);
+        if (static_dispatch::reusable(dst, index, x.getHeight(), x.getWidth())) {
+            std::visit([&](auto &out) { y.addInto(out, x); }, dst);
+            return;
+        }
+        // dst peut être a ou b : le résultat est calculé à part avant de remplacer dst.
+        matrix_value<T> result = static_dispatch::makeDestination<T>(index, x, y);
+        std::visit([&](auto &out) { y.addInto(out, x); }, result);
+        dst = std::move(result);
+    }, a, b);
+}
+
+template<typename T>
+matrix_value<T> add(const matrix_value<T> &a, const matrix_value<T> &b) {
+    return std::visit([](const auto &x, const auto &y) {
+        if (x.getHeight() != y.getHeight() || x.getWidth() != y.getWidth())
+            throw std::runtime_error("matrix are not the same size.");
+        TP5_STATS_SCOPE(matrix_stats::op::add, static_dispatch::kindOf<T>(x), static_dispatch::kindOf<T>(y),
+                        x.getStoredSize() + y.getStoredSize());
+        matrix_value<T> result = static_dispatch::makeDestination<T>(static_dispatch::sumIndex<T>(x, y), x, y);
+        std::visit([&](auto &out) { y.addInto(out, x); }, result);
+        return result;
+    }, a, b);
+}
+
+template<typename T>
+matrix_value<T> operator+(const matrix_value<T> &a, const matrix_value<T> &b) {
+    return add(a, b);
+}
+
+template<typename T>
+T trace(matrix_value<T> &m) {
+    return std::visit([](auto &x) { return x.trace(); }, m);
+}
+
+template<typename T>
+matrix_t_<T> &asMatrix(matrix_value<T> &m) {
+    return std::visit([](auto &x) -> matrix_t_<T> & { return x; }, m);
+}
+
+template<typename T>
+const matrix_t_<T> &asMatrix(const matrix_value<T> &m) {
+    return std::visit([](const auto &x) -> const matrix_t_<T> & { return x; }, m);
+}
+
+// Copie d'une matrice de la hiérarchie virtuelle (par exemple le résultat de add() ou de loadMatrix()).
+template<typename T>
+matrix_value<T> toValue(const matrix_t_<T> &m) {
+    if (auto dense = dynamic_cast<const matrix_dense<T> *>(&m))
+        return *dense;
+    if (auto triang = dynamic_cast<const matrix_triangulaire_sup<T> *>(&m))
+        return *triang;
+    if (auto diag = dynamic_cast<const matrix_diag<T> *>(&m))
+        return *diag;
+    if (auto csr = dynamic_cast<const matrix_csr<T> *>(&m))
+        return *csr;
+    if (auto band = dynamic_cast<const matrix_band<T> *>(&m))
+        return *band;
+    throw std::runtime_error("unknown matrix type.");
+}
+
+#endif //TP5_MATRIX_VALUE_H
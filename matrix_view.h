@@ -0,0 +1,306 @@
+#ifndef TP5_MATRIX_VIEW_H
+#define TP5_MATRIX_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "matrix_reduce.h"
+#include "matrix_span.h"
+#include "matrix_writer.h"
+#include "thread_pool.h"
+
+// Vues sans copie sur une partie d'une matrice, obtenues par matrix_dense::block(), diagonalView() et
+// matrix_triangulaire_sup::rows(). Une vue ne possède rien : pointeur sur le premier élément, pas entre deux
+// lignes et entre deux colonnes. Elle se lit comme une matrice (operator()(i, j), trace(), print(), write())
+// et entre dans les expressions de matrix_expr.h, qui fournit aussi add() : v.add(m) vaut evaluate(v + m).
+//
+// Comme matrix_span, une vue est invalidée quand la matrice est détruite ou que son stockage est remplacé.
+// Une vue modifiable détache le stockage de la matrice et le marque exclusif (matrix_storage::exclusiveData()) :
+// même sharedCopy() recopie ensuite les éléments, et les écritures par la vue ne se voient dans aucune copie.
+
+namespace view_text {
+
+    // Écriture commune des vues, élément par élément par at(i, j), aux formats de matrix_t_::write().
+    template<typename T, typename F>
+    void write(matrix_writer &out, matrix_text_format format, std::size_t h, std::size_t w, const F &at) {
+        if (format == matrix_text_format::matrix_market) {
+            out.write("%%MatrixMarket matrix array ");
+            out.write(text_format::market_field<T>::get());
+            out.write(" general\n");
+            out.index(h);
+            out.put(' ');
+            out.index(w);
+            out.put('\n');
+            for (std::size_t j = 0; j < w; j++)
+                for (std::size_t i = 0; i < h; i++) {
+                    out.marketValue(at(i, j));
+                    out.put('\n');
+                }
+            return;
+        }
+        const char separator = format == matrix_text_format::csv ? ',' : '\t';
+        for (std::size_t i = 0; i < h; i++) {
+            for (std::size_t j = 0; j < w; j++) {
+                out.value(at(i, j));
+                out.put(separator);
+            }
+            if (format == matrix_text_format::csv && w > 0)
+                out.unput();
+            out.put('\n');
+        }
+    }
+
+    // Affichage sur std::cout au format tsv, comme matrix_t_::print().
+    template<typename V>
+    void print(const V &v) {
+        matrix_writer out(std::cout, std::min(std::size_t{matrix_writer::defaultCapacity},
+                                              16 * v.getHeight() * v.getWidth()));
+        out.precision(static_cast<int>(std::cout.precision()));
+        v.write(out, matrix_text_format::tsv);
+    }
+
+    constexpr std::size_t traceGrain = thread_pool::defaultGrain / 8;
+}
+
+template<typename T>
+class matrix_diag_view;
+
+// Sous-matrice d'une matrix_dense en column-major ou en row-major : l'élément (i, j) est à
+// ptr[i * rowStride + j * colStride]. T est const pour une vue en lecture seule.
+template<typename T>
+class matrix_dense_view {
+    T *ptr;
+    std::size_t h;
+    std::size_t w;
+    std::size_t rowStride;
+    std::size_t colStride;
+
+public:
+    using value_type = typename std::remove_const<T>::type;
+
+    matrix_dense_view(T *ptr, std::size_t height, std::size_t width, std::size_t rowStride, std::size_t colStride)
+            : ptr(ptr), h(height), w(width), rowStride(rowStride), colStride(colStride) {}
+
+    // Une vue modifiable se convertit en vue en lecture seule.
+    template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    matrix_dense_view(const matrix_dense_view<U> &other)
+            : ptr(other.data()), h(other.getHeight()), w(other.getWidth()), rowStride(other.rowStep()),
+              colStride(other.colStep()) {}
+
+    std::size_t getHeight() const { return h; }
+
+    std::size_t getWidth() const { return w; }
+
+    T *data() const { return ptr; }
+
+    std::size_t rowStep() const { return rowStride; }
+
+    std::size_t colStep() const { return colStride; }
+
+    // Accès sans test de bornes, pour les boucles.
+    T &at(std::size_t row, std::size_t col) const { return ptr[row * rowStride + col * colStride]; }
+
+    T &operator()(std::size_t const &row, std::size_t const &col) const {
+        if (row < h && col < w)
+            return at(row, col);
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    matrix_dense_view block(std::size_t row, std::size_t col, std::size_t rows, std::size_t cols) const {
+        if (row > h || col > w || rows > h - row || cols > w - col)
+            throw std::out_of_range("Out of range.");
+        return {ptr + row * rowStride + col * colStride, rows, cols, rowStride, colStride};
+    }
+
+    // Diagonale de la vue, les autres éléments valant T{}.
+    matrix_diag_view<T> diagonalView() const {
+        return {ptr, std::min(h, w), rowStride + colStride, h, w, value_type{}};
+    }
+
+    value_type trace(reduce::summation mode = reduce::summation::pairwise) const {
+        const T *p = ptr;
+        const std::size_t step = rowStride + colStride;
+        return reduce::parallelSum<value_type>(std::min(h, w), view_text::traceGrain, mode,
+                                               [p, step](std::size_t i) { return p[i * step]; });
+    }
+
+    void write(matrix_writer &out, matrix_text_format format) const {
+        view_text::write<value_type>(out, format, h, w, [this](std::size_t i, std::size_t j) { return at(i, j); });
+    }
+
+    void print() const {
+        view_text::print(*this);
+    }
+
+    // Somme avec une matrice ou une expression de même taille (matrix_expr.h).
+    template<typename X>
+    auto add(const X &m) const {
+        return evaluate(*this + m);
+    }
+};
+
+// Lignes [first, first + height) d'une matrix_triangulaire_sup, sur toute la largeur. Les lignes ne sont
+// plus alignées sur la diagonale : la vue est une matrice pleine dont les éléments sous la diagonale de la
+// matrice d'origine valent valInf. Seuls les éléments stockés se modifient, par rowSegment().
+template<typename T>
+class matrix_triangulaire_sup_view {
+    T *packed;
+    std::size_t first;
+    std::size_t h;
+    std::size_t w;
+    typename std::remove_const<T>::type valInf;
+
+    // Position de la ligne row de la matrice d'origine dans le stockage compact.
+    std::size_t rowOffset(std::size_t row) const { return row * w - (row * (row + 1)) / 2; }
+
+public:
+    using value_type = typename std::remove_const<T>::type;
+
+    matrix_triangulaire_sup_view(T *packed, std::size_t first, std::size_t height, std::size_t width,
+                                 value_type valInf)
+            : packed(packed), first(first), h(height), w(width), valInf(valInf) {}
+
+    template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    matrix_triangulaire_sup_view(const matrix_triangulaire_sup_view<U> &other)
+            : packed(other.data()), first(other.firstRow()), h(other.getHeight()), w(other.getWidth()),
+              valInf(other.getValInf()) {}
+
+    std::size_t getHeight() const { return h; }
+
+    std::size_t getWidth() const { return w; }
+
+    // Stockage compact de toute la matrice d'origine.
+    T *data() const { return packed; }
+
+    std::size_t firstRow() const { return first; }
+
+    value_type getValInf() const { return valInf; }
+
+    value_type at(std::size_t row, std::size_t col) const {
+        const std::size_t i = first + row;
+        return i > col ? valInf : packed[rowOffset(i) + col];
+    }
+
+    value_type operator()(std::size_t const &row, std::size_t const &col) const {
+        if (row < h && col < w)
+            return at(row, col);
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    // Partie stockée de la ligne row de la vue, indexée par numéro de colonne ; vide sous la diagonale.
+    matrix_row_segment<T> rowSegment(std::size_t row) const {
+        if (row >= h)
+            throw std::out_of_range("Out of range.");
+        const std::size_t i = first + row;
+        if (i >= w)
+            return {packed, w, 0};
+        return {packed + rowOffset(i) + i, i, w - i};
+    }
+
+    matrix_triangulaire_sup_view rows(std::size_t from, std::size_t to) const {
+        if (from > to || to > h)
+            throw std::out_of_range("Out of range.");
+        return {packed, first + from, to - from, w, valInf};
+    }
+
+    // La diagonale de la vue ne suit celle de la matrice d'origine que si la vue commence à la ligne 0 ;
+    // sinon elle est sous la diagonale et vaut valInf.
+    value_type trace(reduce::summation mode = reduce::summation::pairwise) const {
+        const std::size_t n = std::min(h, w);
+        if (first > 0)
+            return static_cast<value_type>(n) * valInf;
+        const T *p = packed;
+        const std::size_t width = w;
+        return reduce::parallelSum<value_type>(n, view_text::traceGrain, mode, [p, width](std::size_t i) {
+            return p[i * width - (i * (i + 1)) / 2 + i];
+        });
+    }
+
+    void write(matrix_writer &out, matrix_text_format format) const {
+        view_text::write<value_type>(out, format, h, w, [this](std::size_t i, std::size_t j) { return at(i, j); });
+    }
+
+    void print() const {
+        view_text::print(*this);
+    }
+
+    template<typename X>
+    auto add(const X &m) const {
+        return evaluate(*this + m);
+    }
+};
+
+// Diagonale d'une matrice (count éléments espacés de stride), vue comme une matrice height x width dont les
+// autres éléments valent fill : defaultVal pour une matrix_diag, T{} pour une matrix_dense ou une matrix_band.
+// operator[] donne accès aux éléments de la diagonale.
+template<typename T>
+class matrix_diag_view {
+    T *ptr;
+    std::size_t count;
+    std::size_t stride;
+    std::size_t h;
+    std::size_t w;
+    typename std::remove_const<T>::type fill;
+
+public:
+    using value_type = typename std::remove_const<T>::type;
+
+    matrix_diag_view(T *ptr, std::size_t count, std::size_t stride, std::size_t height, std::size_t width,
+                     value_type fill)
+            : ptr(ptr), count(count), stride(stride), h(height), w(width), fill(fill) {}
+
+    template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    matrix_diag_view(const matrix_diag_view<U> &other)
+            : ptr(other.data()), count(other.size()), stride(other.step()), h(other.getHeight()),
+              w(other.getWidth()), fill(other.getFill()) {}
+
+    std::size_t getHeight() const { return h; }
+
+    std::size_t getWidth() const { return w; }
+
+    T *data() const { return ptr; }
+
+    std::size_t size() const { return count; }
+
+    std::size_t step() const { return stride; }
+
+    value_type getFill() const { return fill; }
+
+    T &operator[](std::size_t i) const { return ptr[i * stride]; }
+
+    value_type operator()(std::size_t const &row, std::size_t const &col) const {
+        if (row < h && col < w)
+            return row == col ? ptr[row * stride] : fill;
+        else
+            throw std::out_of_range("Out of range.");
+    }
+
+    value_type trace(reduce::summation mode = reduce::summation::pairwise) const {
+        const T *p = ptr;
+        const std::size_t s = stride;
+        return reduce::parallelSum<value_type>(count, view_text::traceGrain, mode,
+                                               [p, s](std::size_t i) { return p[i * s]; });
+    }
+
+    void write(matrix_writer &out, matrix_text_format format) const {
+        view_text::write<value_type>(out, format, h, w, [this](std::size_t i, std::size_t j) {
+            return i == j ? ptr[i * stride] : fill;
+        });
+    }
+
+    void print() const {
+        view_text::print(*this);
+    }
+
+    template<typename X>
+    auto add(const X &m) const {
+        return evaluate(*this + m);
+    }
+};
+
+#endif //TP5_MATRIX_VIEW_H
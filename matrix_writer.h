@@ -0,0 +1,312 @@
+#ifndef TP5_MATRIX_WRITER_H
+#define TP5_MATRIX_WRITER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <complex>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define TP5_MATRIX_WRITER_FD 1
+#endif
+
+// Sortie texte des matrices.
+//
+// matrix_writer formate les nombres directement dans un grand tampon et ne l'envoie à la destination (un
+// std::ostream ou un descripteur de fichier) que par gros morceaux : pas de flush par ligne comme avec
+// std::endl, ni de passage par les facettes de locale de std::ostream pour chaque élément.
+//
+// Les entiers sont convertis à la main, deux chiffres à la fois. Les flottants passent par std::to_chars : par
+// défaut le texte le plus court qui relit exactement la valeur, ou precision(n) chiffres significatifs, comme
+// "%.*g" (print() prend la précision de std::cout, et écrit donc le même texte qu'avant).
+
+enum class matrix_text_format {
+    tsv,            // format de print() : chaque élément suivi d'une tabulation, une ligne par ligne de matrice
+    csv,            // éléments séparés par des virgules
+    matrix_market   // fichier .mtx : array (column-major) ou coordinate (éléments stockés seulement)
+};
+
+namespace text_format {
+
+    // Taille maximale du texte d'un nombre réel ou entier. to_chars écrit au plus maxValueChars / 2 caractères
+    // par flottant ; avec la précision bornée par matrix_writer::precision(), le texte ne fait jamais plus.
+    constexpr std::size_t maxValueChars = 128;
+
+    // Place à réserver pour le texte d'un élément de type T : un complexe a deux parties et trois séparateurs.
+    template<typename T>
+    struct value_chars {
+        static constexpr std::size_t value = maxValueChars;
+    };
+
+    template<typename T>
+    struct value_chars<std::complex<T>> {
+        static constexpr std::size_t value = 2 * maxValueChars + 3;
+    };
+
+    inline char *formatUnsigned(char *out, unsigned long long v) {
+        static const char digits[] =
+                "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+                "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+        char tmp[24];
+        char *p = tmp + sizeof(tmp);
+        while (v >= 100) {
+            const unsigned i = static_cast<unsigned>(v % 100) * 2;
+            v /= 100;
+            *--p = digits[i + 1];
+            *--p = digits[i];
+        }
+        if (v >= 10) {
+            *--p = digits[v * 2 + 1];
+            *--p = digits[v * 2];
+        } else
+            *--p = static_cast<char>('0' + v);
+        const std::size_t n = tmp + sizeof(tmp) - p;
+        std::memcpy(out, p, n);
+        return out + n;
+    }
+
+    // Les types caractère s'affichent comme des caractères avec std::ostream : ils passent par format()
+    // générique.
+    template<typename T>
+    struct is_number : std::integral_constant<bool, std::is_integral<T>::value &&
+                                                    !std::is_same<T, char>::value &&
+                                                    !std::is_same<T, signed char>::value &&
+                                                    !std::is_same<T, unsigned char>::value> {
+    };
+
+    template<typename T>
+    typename std::enable_if<is_number<T>::value && std::is_signed<T>::value, char *>::type
+    format(char *out, T v, int) {
+        if (v < 0) {
+            *out++ = '-';
+            return formatUnsigned(out, 0ull - static_cast<unsigned long long>(v));
+        }
+        return formatUnsigned(out, static_cast<unsigned long long>(v));
+    }
+
+    template<typename T>
+    typename std::enable_if<is_number<T>::value && !std::is_signed<T>::value, char *>::type
+    format(char *out, T v, int) {
+        return formatUnsigned(out, static_cast<unsigned long long>(v));
+    }
+
+    // Précision négative : le plus court texte qui relit v dans son propre type (0.1f s'écrit 0.1).
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, char *>::type
+    format(char *out, T v, int precision) {
+        const std::to_chars_result result =
+                precision < 0 ? std::to_chars(out, out + maxValueChars / 2, v)
+                              : std::to_chars(out, out + maxValueChars / 2, v, std::chars_format::general, precision);
+        return result.ec == std::errc() ? result.ptr : out;
+    }
+
+    template<typename T>
+    char *format(char *out, const std::complex<T> &v, int precision) {
+        *out++ = '(';
+        out = format(out, v.real(), precision);
+        *out++ = ',';
+        out = format(out, v.imag(), precision);
+        *out++ = ')';
+        return out;
+    }
+
+    // Autres types : operator<<, plus lent mais identique à l'affichage d'origine.
+    template<typename T>
+    typename std::enable_if<!std::is_arithmetic<T>::value || !is_number<T>::value && std::is_integral<T>::value,
+            char *>::type
+    format(char *out, const T &v, int precision) {
+        std::ostringstream stream;
+        stream.precision(precision);
+        stream << v;
+        const std::string text = stream.str().substr(0, maxValueChars);
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+
+    // Matrix Market écrit un complexe sous la forme "re im".
+    template<typename T>
+    char *formatMarket(char *out, const T &v, int precision) {
+        return format(out, v, precision);
+    }
+
+    template<typename T>
+    char *formatMarket(char *out, const std::complex<T> &v, int precision) {
+        out = format(out, v.real(), precision);
+        *out++ = ' ';
+        return format(out, v.imag(), precision);
+    }
+
+    template<typename T>
+    struct market_field {
+        static const char *get() { return std::is_integral<T>::value ? "integer" : "real"; }
+    };
+
+    template<typename T>
+    struct market_field<std::complex<T>> {
+        static const char *get() { return "complex"; }
+    };
+}
+
+class matrix_writer {
+    std::unique_ptr<char[]> buffer;
+    std::size_t capacity;
+    std::size_t used = 0;
+    std::ostream *stream = nullptr;
+    int fd = -1;
+    int digits = shortest;
+
+    void ensure(std::size_t n) {
+        if (capacity - used < n)
+            flushBuffer();
+    }
+
+    void flushBuffer() {
+        if (stream != nullptr) {
+            stream->write(buffer.get(), static_cast<std::streamsize>(used));
+            if (!*stream)
+                throw std::runtime_error("cannot write the matrix.");
+        }
+#ifdef TP5_MATRIX_WRITER_FD
+        else {
+            std::size_t written = 0;
+            while (written < used) {
+                const ssize_t n = ::write(fd, buffer.get() + written, used - written);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    throw std::runtime_error("cannot write the matrix.");
+                written += static_cast<std::size_t>(n);
+            }
+        }
+#endif
+        used = 0;
+    }
+
+public:
+    static constexpr std::size_t defaultCapacity = 1 << 20;
+
+    // De quoi contenir le plus long élément (un complexe) sans vider le tampon au milieu.
+    static constexpr std::size_t minCapacity = 4 * text_format::maxValueChars;
+
+    // Au-delà de max_digits10, les chiffres supplémentaires ne décrivent plus la valeur.
+    static constexpr int maxPrecision = std::numeric_limits<long double>::max_digits10;
+
+    // Précision par défaut : le texte le plus court qui relit exactement chaque flottant.
+    static constexpr int shortest = -1;
+
+    explicit matrix_writer(std::ostream &stream, std::size_t capacity = defaultCapacity)
+            : buffer(new char[std::max(capacity, minCapacity)]), capacity(std::max(capacity, minCapacity)),
+              stream(&stream) {}
+
+#ifdef TP5_MATRIX_WRITER_FD
+
+    // Écrit sur un descripteur déjà ouvert, qui n'est pas fermé par le writer.
+    explicit matrix_writer(int fd, std::size_t capacity = defaultCapacity)
+            : buffer(new char[std::max(capacity, minCapacity)]), capacity(std::max(capacity, minCapacity)),
+              fd(fd) {}
+
+#endif
+
+    matrix_writer(const matrix_writer &) = delete;
+
+    matrix_writer &operator=(const matrix_writer &) = delete;
+
+    // Le destructeur vide le tampon ; appeler flush() avant pour récupérer une éventuelle erreur d'écriture.
+    ~matrix_writer() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    void flush() {
+        flushBuffer();
+        if (stream != nullptr)
+            stream->flush();
+    }
+
+    // Nombre de chiffres significatifs des flottants, ramené dans [0, maxPrecision] ; shortest (ou toute valeur
+    // négative) revient au texte le plus court.
+    int precision() const {
+        return digits;
+    }
+
+    void precision(int value) {
+        digits = value < 0 ? shortest : std::min(value, maxPrecision);
+    }
+
+    void put(char c) {
+        ensure(1);
+        buffer[used++] = c;
+    }
+
+    // Copie n octets en passant par le tampon : après l'appel, le dernier caractère écrit est toujours dans
+    // le tampon, ce qui permet à unput() de le retirer.
+    void write(const char *text, std::size_t n) {
+        while (n > 0) {
+            ensure(1);
+            const std::size_t chunk = std::min(n, capacity - used);
+            std::memcpy(buffer.get() + used, text, chunk);
+            used += chunk;
+            text += chunk;
+            n -= chunk;
+        }
+    }
+
+    void write(const char *text) {
+        write(text, std::strlen(text));
+    }
+
+    void write(const std::string &text) {
+        write(text.data(), text.size());
+    }
+
+    // Retire le dernier caractère écrit (séparateur de fin de ligne en CSV).
+    void unput() {
+        if (used > 0)
+            used--;
+    }
+
+    template<typename T>
+    void value(const T &v) {
+        ensure(text_format::value_chars<T>::value);
+        used = text_format::format(buffer.get() + used, v, digits) - buffer.get();
+    }
+
+    template<typename T>
+    void marketValue(const T &v) {
+        ensure(text_format::value_chars<T>::value);
+        used = text_format::formatMarket(buffer.get() + used, v, digits) - buffer.get();
+    }
+
+    void index(std::size_t v) {
+        ensure(24);
+        used = text_format::formatUnsigned(buffer.get() + used, v) - buffer.get();
+    }
+
+    // Texte de v suivi de separator, répété count fois : les zones constantes (valInf, defaultVal) d'une
+    // ligne sont écrites par une seule copie d'un préfixe de cette chaîne.
+    template<typename T>
+    std::string run(const T &v, char separator, std::size_t count) const {
+        char token[text_format::value_chars<T>::value + 1];
+        char *end = text_format::format(token, v, digits);
+        *end++ = separator;
+        const std::size_t length = end - token;
+        std::string result(length * count, '\0');
+        for (std::size_t i = 0; i < count; i++)
+            std::memcpy(&result[i * length], token, length);
+        return result;
+    }
+};
+
+#endif //TP5_MATRIX_WRITER_H
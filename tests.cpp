@@ -0,0 +1,1811 @@
+/*
+
+Tests de non-régression de la hiérarchie de matrices (matrix.h), lancés par ctest.
+
+Chaque test est une fonction qui vérifie ses résultats avec CHECK ; le programme affiche les vérifications en
+échec et renvoie leur nombre. Usage : tp5_tests
+
+*/
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.h"
+#include "matrix_async.h"
+#include "matrix_batch.h"
+#include "matrix_expr.h"
+#include "matrix_fixed.h"
+#include "matrix_io.h"
+#include "matrix_stats.h"
+#include "matrix_value.h"
+#include "matrix_view.h"
+#include "matrix_writer.h"
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                 \
+    do {                                                                                 \
+        if (!(condition)) {                                                              \
+            failures++;                                                                  \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);    \
+        }                                                                                \
+    } while (0)
+
+// Compteur d'allocations, comme dans bench.cpp : operator new global remplacé.
+static std::atomic<std::size_t> allocationCount{0};
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+template<typename F>
+std::size_t allocationsOf(F &&f) {
+    const std::size_t before = allocationCount.load(std::memory_order_relaxed);
+    f();
+    return allocationCount.load(std::memory_order_relaxed) - before;
+}
+
+// Lance f et indique s'il a levé une std::runtime_error.
+template<typename F>
+bool throwsRuntimeError(F &&f) {
+    try {
+        f();
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+// Valeurs entières petites et distinctes selon seed : les sommes et produits en double restent exacts, les
+// résultats se comparent donc avec ==.
+static double valueAt(std::size_t i, std::size_t j, int seed) {
+    return static_cast<double>(static_cast<int>((i * 7 + j * 3 + seed * 5) % 11) - 5);
+}
+
+// Remplit les éléments stockés de m.
+template<typename T>
+void fill(matrix_dense<T> &m, int seed) {
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = 0; j < m.getWidth(); j++)
+            m(i, j) = static_cast<T>(valueAt(i, j, seed));
+}
+
+template<typename T>
+void fill(matrix_triangulaire_sup<T> &m, int seed) {
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = i; j < m.getWidth(); j++)
+            m(i, j) = static_cast<T>(valueAt(i, j, seed));
+}
+
+template<typename T>
+void fill(matrix_diag<T> &m, int seed) {
+    for (std::size_t i = 0; i < std::min(m.getHeight(), m.getWidth()); i++)
+        m(i, i) = static_cast<T>(valueAt(i, i, seed));
+}
+
+template<typename T>
+void fill(matrix_band<T> &m, int seed) {
+    const std::size_t kl = m.getLowerBandwidth(), ku = m.getUpperBandwidth();
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = i > kl ? i - kl : 0; j < m.getWidth() && j <= i + ku; j++)
+            m(i, j) = static_cast<T>(valueAt(i, j, seed));
+}
+
+// Matrice creuse d'environ un élément sur quatre, construite par triplets.
+template<typename T>
+matrix_csr<T> sparse(int height, int width, int seed) {
+    std::vector<csr_triplet<T>> triplets;
+    for (std::size_t i = 0; i < static_cast<std::size_t>(height); i++)
+        for (std::size_t j = 0; j < static_cast<std::size_t>(width); j++)
+            if ((i * 5 + j * 3 + seed) % 4 == 0)
+                triplets.push_back({i, j, static_cast<T>(valueAt(i, j, seed))});
+    return matrix_csr<T>(height, width, std::move(triplets));
+}
+
+// Copie dense de m, lue par operator()(i,j) : la référence des tests.
+template<typename T>
+matrix_dense<T> toDense(const matrix_t_<T> &m) {
+    matrix_dense<T> result(m.getHeight(), m.getWidth());
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = 0; j < m.getWidth(); j++)
+            result(i, j) = m(i, j);
+    return result;
+}
+
+template<typename T>
+bool sameValues(const matrix_t_<T> &a, const matrix_t_<T> &b) {
+    if (a.getHeight() != b.getHeight() || a.getWidth() != b.getWidth())
+        return false;
+    for (std::size_t i = 0; i < a.getHeight(); i++)
+        for (std::size_t j = 0; j < a.getWidth(); j++)
+            if (a(i, j) != b(i, j))
+                return false;
+    return true;
+}
+
+// Produit naïf a * b par operator()(i,j).
+template<typename T>
+matrix_dense<T> referenceProduct(const matrix_t_<T> &a, const matrix_t_<T> &b) {
+    matrix_dense<T> result(a.getHeight(), b.getWidth());
+    for (std::size_t i = 0; i < a.getHeight(); i++)
+        for (std::size_t j = 0; j < b.getWidth(); j++) {
+            T sum = {};
+            for (std::size_t l = 0; l < a.getWidth(); l++)
+                sum += a(i, l) * b(l, j);
+            result(i, j) = sum;
+        }
+    return result;
+}
+
+// Somme a + b par operator()(i,j).
+template<typename T>
+matrix_dense<T> referenceSum(const matrix_t_<T> &a, const matrix_t_<T> &b) {
+    matrix_dense<T> result(a.getHeight(), a.getWidth());
+    for (std::size_t i = 0; i < a.getHeight(); i++)
+        for (std::size_t j = 0; j < a.getWidth(); j++)
+            result(i, j) = a(i, j) + b(i, j);
+    return result;
+}
+
+// Les neuf paires de add() donnent la somme naïve, avec ou sans valeur hors du stockage. Les tailles ne sont
+// pas des multiples de la largeur des registres : la fin scalaire des noyaux vectoriels est aussi vérifiée.
+template<typename T>
+void testAdd() {
+    const int shapes[][2] = {{1, 1}, {7, 7}, {33, 17}, {17, 33}, {64, 64}};
+    for (const auto &shape : shapes) {
+        const int h = shape[0], w = shape[1];
+        matrix_dense<T> dense(h, w);
+        matrix_triangulaire_sup<T> triang(h, w, T{}), triangFilled(h, w, T(2));
+        matrix_diag<T> diag(h, w, T{}), diagFilled(h, w, T(-3));
+        fill(dense, 1);
+        fill(triang, 2);
+        fill(triangFilled, 3);
+        fill(diag, 4);
+        fill(diagFilled, 5);
+        const std::vector<const matrix_t_<T> *> operands = {&dense, &triang, &triangFilled, &diag, &diagFilled};
+        for (const matrix_t_<T> *a : operands)
+            for (const matrix_t_<T> *b : operands)
+                CHECK(sameValues(*a->add(*b), referenceSum(*a, *b)));
+        CHECK(dynamic_cast<matrix_triangulaire_sup<T> *>(triangFilled.add(diagFilled).get()) != nullptr);
+        CHECK(dynamic_cast<matrix_diag<T> *>(diag.add(diagFilled).get()) != nullptr);
+    }
+    matrix_diag<T> diag(5, 5, T{});
+    fill(diag, 6);
+    CHECK(diag.trace() == toDense(diag).trace());
+}
+
+// Les neuf paires de multiply() donnent le produit naïf, avec ou sans valeur hors du stockage, et gardent la
+// structure la moins chère quand elle est conservée.
+void testMultiply() {
+    const int n = 7;
+    matrix_dense<double> dense(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 0.0), triangFilled(n, n, 2.0);
+    matrix_diag<double> diag(n, n, 0.0), diagFilled(n, n, -3.0);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(triangFilled, 3);
+    fill(diag, 4);
+    fill(diagFilled, 5);
+    const std::vector<const matrix_t_<double> *> operands = {&dense, &triang, &triangFilled, &diag, &diagFilled};
+    for (const matrix_t_<double> *a : operands)
+        for (const matrix_t_<double> *b : operands)
+            CHECK(sameValues(*a->multiply(*b), referenceProduct(*a, *b)));
+
+    CHECK(dynamic_cast<matrix_triangulaire_sup<double> *>(triang.multiply(triang).get()) != nullptr);
+    CHECK(dynamic_cast<matrix_triangulaire_sup<double> *>(diag.multiply(triang).get()) != nullptr);
+    CHECK(dynamic_cast<matrix_diag<double> *>(diag.multiply(diag).get()) != nullptr);
+    CHECK(dynamic_cast<matrix_dense<double> *>(triangFilled.multiply(diag).get()) != nullptr);
+
+    // Formes rectangulaires, plus grandes que les blocs du noyau dense.
+    matrix_dense<double> wide(300, 150), tall(150, 70);
+    matrix_triangulaire_sup<double> triangWide(150, 200, 0.0);
+    fill(wide, 6);
+    fill(tall, 7);
+    fill(triangWide, 8);
+    CHECK(sameValues(*wide.multiply(tall), referenceProduct(wide, tall)));
+    CHECK(sameValues(*wide.multiply(triangWide), referenceProduct(wide, triangWide)));
+
+    CHECK(throwsRuntimeError([&]() { tall.multiply(wide); }));
+}
+
+// Les expressions paresseuses donnent le même résultat qu'un calcul élément par élément, dans la structure la
+// plus étroite possible, y compris quand la destination de assign() figure dans l'expression.
+void testExpressions() {
+    const int h = 9, w = 6;
+    matrix_dense<double> dense(h, w);
+    matrix_triangulaire_sup<double> triang(h, w, 1.0);
+    matrix_diag<double> diag(h, w, -2.0);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+
+    auto mixed = evaluate(dense + triang - 2.0 * diag);
+    static_assert(std::is_same<decltype(mixed), matrix_dense<double>>::value, "dense + triang is dense");
+    matrix_dense<double> expected(h, w);
+    for (std::size_t i = 0; i < h; i++)
+        for (std::size_t j = 0; j < w; j++)
+            expected(i, j) = dense(i, j) + triang(i, j) - 2.0 * diag(i, j);
+    CHECK(sameValues(mixed, expected));
+
+    auto upper = evaluate(-triang + diag * 3.0);
+    static_assert(std::is_same<decltype(upper), matrix_triangulaire_sup<double>>::value, "triang + diag is triang");
+    CHECK(upper.getValInf() == -1.0 - 6.0);
+    for (std::size_t i = 0; i < h; i++)
+        for (std::size_t j = 0; j < w; j++)
+            expected(i, j) = -triang(i, j) + diag(i, j) * 3.0;
+    CHECK(sameValues(upper, expected));
+
+    auto diagonal = evaluate(diag - diag);
+    static_assert(std::is_same<decltype(diagonal), matrix_diag<double>>::value, "diag - diag is diag");
+    CHECK(sameValues(diagonal, matrix_diag<double>(h, w, 0.0)));
+
+    for (std::size_t i = 0; i < h; i++)
+        for (std::size_t j = 0; j < w; j++)
+            expected(i, j) = dense(i, j) + dense(i, j) + triang(i, j);
+    assign(dense, dense + dense + triang);
+    CHECK(sameValues(dense, expected));
+}
+
+// addInto écrit la même somme que add() dans la destination, sans allocation, y compris quand la destination
+// est l'un des opérandes ; une destination d'un autre type ou d'une autre taille est refusée.
+void testAddInto() {
+    const int n = 37;
+    matrix_dense<double> dense(n, n), denseDst(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 2.0), triangDst(n, n, 0.0);
+    matrix_diag<double> diag(n, n, -1.0), diagDst(n, n, 0.0);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+    auto destinationFor = [&](const matrix_t_<double> &result) -> matrix_t_<double> & {
+        if (dynamic_cast<const matrix_dense<double> *>(&result) != nullptr)
+            return denseDst;
+        if (dynamic_cast<const matrix_triangulaire_sup<double> *>(&result) != nullptr)
+            return triangDst;
+        return diagDst;
+    };
+    const std::vector<const matrix_t_<double> *> operands = {&dense, &triang, &diag};
+    for (const matrix_t_<double> *a : operands)
+        for (const matrix_t_<double> *b : operands) {
+            std::unique_ptr<matrix_t_<double>> expected = a->add(*b);
+            matrix_t_<double> &dst = destinationFor(*expected);
+            CHECK(allocationsOf([&]() { addInto(dst, *a, *b); }) == 0);
+            CHECK(sameValues(dst, *expected));
+        }
+
+    matrix_dense<double> reference = referenceSum(dense, triang);
+    matrix_dense<double> accumulator(dense);
+    accumulator += triang;
+    CHECK(sameValues(accumulator, reference));
+    addInto(dense, triang, dense);
+    CHECK(sameValues(dense, reference));
+    matrix_dense<double> referenceTriang = referenceSum(triang, diag);
+    triang += diag;
+    CHECK(sameValues(triang, referenceTriang));
+
+    CHECK(throwsRuntimeError([&]() { addInto(diagDst, dense, diag); }));
+    matrix_dense<double> small(n - 1, n);
+    CHECK(throwsRuntimeError([&]() { addInto(small, dense, dense); }));
+}
+
+// Lance f et indique s'il a levé une std::out_of_range.
+template<typename F>
+bool throwsOutOfRange(F &&f) {
+    try {
+        f();
+    } catch (const std::out_of_range &) {
+        return true;
+    }
+    return false;
+}
+
+// stored() parcourt exactement les éléments stockés, avec leur position ; column(), rowSegment() et
+// diagonal() lisent et écrivent le même stockage que operator()(i,j).
+void testViews() {
+    const int h = 6, w = 9;
+    matrix_dense<double> dense(h, w);
+    matrix_triangulaire_sup<double> triang(h, w, 4.0);
+    matrix_diag<double> diag(h, w, 4.0);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+
+    std::size_t visited = 0;
+    for (auto entry : dense.stored()) {
+        CHECK(entry.value == dense(entry.row, entry.col));
+        visited++;
+    }
+    CHECK(visited == dense.getStoredSize());
+    visited = 0;
+    for (auto entry : triang.stored()) {
+        CHECK(entry.row <= entry.col && entry.value == triang(entry.row, entry.col));
+        visited++;
+    }
+    CHECK(visited == triang.getStoredSize());
+    visited = 0;
+    for (auto entry : diag.stored()) {
+        CHECK(entry.row == entry.col && entry.value == diag(entry.row, entry.col));
+        visited++;
+    }
+    CHECK(visited == diag.getStoredSize());
+
+    for (std::size_t j = 0; j < w; j++) {
+        matrix_span<const double> column = static_cast<const matrix_dense<double> &>(dense).column(j);
+        for (std::size_t i = 0; i < h; i++)
+            CHECK(column[i] == dense(i, j));
+    }
+    for (std::size_t i = 0; i < h; i++) {
+        matrix_row_segment<double> row = triang.rowSegment(i);
+        CHECK(row.firstCol() == i && row.size() == w - i);
+        for (std::size_t j = i; j < w; j++)
+            CHECK(row[j] == triang(i, j));
+    }
+
+    dense.column(2)[3] = 100.0;
+    triang.rowSegment(1)[4] = 101.0;
+    diag.diagonal()[5] = 102.0;
+    for (auto entry : triang.stored())
+        entry.value += 1.0;
+    CHECK(dense(3, 2) == 100.0 && triang(1, 4) == 102.0 && diag(5, 5) == 102.0);
+    CHECK(triang(3, 1) == 4.0 && diag(0, 1) == 4.0);
+    CHECK(dense.values().size() == h * w && dense.values()[3 + 2 * h] == 100.0);
+
+    CHECK(throwsOutOfRange([&]() { dense.column(w); }));
+    CHECK(throwsOutOfRange([&]() { triang.rowSegment(h); }));
+}
+
+// Le pool couvre chaque indice une seule fois, répartit les lignes pondérées sans trou ni recouvrement, renvoie
+// la somme des morceaux, propage une exception levée par un morceau et reste utilisable depuis un de ses
+// threads (l'appel imbriqué s'exécute en séquentiel).
+void testThreadPool() {
+    thread_pool pool(4);
+    CHECK(pool.size() == 4);
+    const std::size_t n = 100003;
+    std::vector<std::atomic<int>> hits(n);
+    pool.parallelFor(0, n, 1000, [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; i++)
+            hits[i]++;
+    });
+    bool once = true;
+    for (std::size_t i = 0; i < n; i++)
+        once = once && hits[i] == 1;
+    CHECK(once);
+
+    const std::size_t rows = 1000;
+    std::vector<std::atomic<int>> rowHits(rows);
+    pool.parallelForWeighted(rows, [](std::size_t row) { return row * (row + 1) / 2; }, 1000,
+                             [&](std::size_t first, std::size_t last) {
+                                 for (std::size_t i = first; i < last; i++)
+                                     rowHits[i]++;
+                             });
+    once = true;
+    for (std::size_t i = 0; i < rows; i++)
+        once = once && rowHits[i] == 1;
+    CHECK(once);
+
+    const std::size_t total = pool.parallelReduce(0, n, 1000, std::size_t{0}, [](std::size_t first, std::size_t last) {
+        std::size_t sum = 0;
+        for (std::size_t i = first; i < last; i++)
+            sum += i;
+        return sum;
+    });
+    CHECK(total == n * (n - 1) / 2);
+    CHECK(pool.parallelReduce(5, 5, 1, 7, [](std::size_t, std::size_t) { return 1; }) == 7);
+
+    CHECK(throwsRuntimeError([&]() {
+        pool.parallelFor(0, n, 1000, [](std::size_t first, std::size_t) {
+            if (first > 0)
+                throw std::runtime_error("chunk failed");
+        });
+    }));
+
+    std::atomic<std::size_t> nested{0};
+    pool.parallelFor(0, 4, 1, [&](std::size_t, std::size_t) {
+        pool.parallelFor(0, n, 1000, [&](std::size_t first, std::size_t last) { nested += last - first; });
+    });
+    CHECK(nested == 4 * n);
+}
+
+// add() et trace() donnent les mêmes résultats répartis entre plusieurs threads, et addInto n'alloue rien :
+// le pool distribue ses morceaux sans tas.
+void testParallelKernels() {
+    thread_pool::setGlobalThreadCount(4);
+    const int n = 512;
+    matrix_dense<double> dense(n, n), dst(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 1.0), triangDst(n, n, 0.0);
+    matrix_diag<double> diag(n, n, 2.0);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+    const std::vector<const matrix_t_<double> *> operands = {&dense, &triang, &diag};
+    for (const matrix_t_<double> *a : operands)
+        for (const matrix_t_<double> *b : operands)
+            CHECK(sameValues(*a->add(*b), referenceSum(*a, *b)));
+    double denseTrace = 0, triangTrace = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        denseTrace += dense(i, i);
+        triangTrace += triang(i, i);
+    }
+    CHECK(dense.trace() == denseTrace && triang.trace() == triangTrace);
+
+    addInto(dst, dense, dense);
+    addInto(triangDst, triang, diag);
+    CHECK(allocationsOf([&]() { addInto(dst, dense, dense); }) == 0);
+    CHECK(allocationsOf([&]() { addInto(dst, dense, triang); }) == 0);
+    CHECK(allocationsOf([&]() { addInto(triangDst, triang, diag); }) == 0);
+    CHECK(allocationsOf([&]() { return dense.trace(); }) == 0);
+    CHECK(sameValues(triangDst, referenceSum(triang, diag)));
+    thread_pool::setGlobalThreadCount(0);
+}
+
+// saveMatrix puis loadMatrix, projeté ou lu, redonne le même type et les mêmes valeurs ; modifier une matrice
+// projetée ne modifie pas le fichier. Un fichier tronqué, d'un autre type d'éléments ou dont l'en-tête annonce
+// une taille qui déborde sur 64 bits est refusé.
+void testMatrixFile() {
+    const std::string path = "tp5_tests_matrix.tmp";
+    matrix_dense<double> dense(5, 8);
+    matrix_triangulaire_sup<double> triang(8, 5, 2.5);
+    matrix_diag<double> diag(6, 4, -1.5);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+    const std::vector<const matrix_t_<double> *> matrices = {&dense, &triang, &diag};
+    for (const matrix_t_<double> *m : matrices)
+        for (bool mapped : {true, false}) {
+            saveMatrix(*m, path);
+            std::unique_ptr<matrix_t_<double>> loaded = loadMatrix<double>(path, mapped);
+            CHECK(typeid(*loaded) == typeid(*m));
+            CHECK(sameValues(*loaded, *m));
+        }
+
+    saveMatrix(dense, path);
+    {
+        std::unique_ptr<matrix_t_<double>> loaded = loadMatrix<double>(path);
+        (*loaded)(0, 0) = 1000.0;
+    }
+    CHECK(sameValues(*loadMatrix<double>(path), dense));
+    CHECK(throwsRuntimeError([&]() { loadMatrix<float>(path); }));
+
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 1));
+    }
+    CHECK(throwsRuntimeError([&]() { loadMatrix<double>(path); }));
+    CHECK(throwsRuntimeError([&]() { loadMatrix<double>(path, false); }));
+
+    // 2^30 x 2^30 complexes de 16 octets : 2^64 octets, repliés à 0 sans vérification ; l'en-tête seul aurait
+    // alors la bonne taille de fichier.
+    const std::size_t side = std::size_t{1} << 30;
+    using complex = std::complex<double>;
+    matrix_io::writeFile(path, matrix_io::makeHeader(matrix_io::file_structure::dense, side, side, side * side,
+                                                     complex{}), matrix_span<const complex>(nullptr, 0));
+    CHECK(throwsRuntimeError([&]() { loadMatrix<complex>(path); }));
+    CHECK(throwsRuntimeError([&]() { loadMatrix<complex>(path, false); }));
+    std::remove(path.c_str());
+}
+
+// Texte de m au format tsv de print(), construit avec std::ostream comme l'ancien print().
+template<typename T>
+std::string referenceTsv(const matrix_t_<T> &m) {
+    std::ostringstream stream;
+    for (std::size_t i = 0; i < m.getHeight(); i++) {
+        for (std::size_t j = 0; j < m.getWidth(); j++)
+            stream << m(i, j) << "\t";
+        stream << "\n";
+    }
+    return stream.str();
+}
+
+template<typename T>
+std::string written(const matrix_t_<T> &m, matrix_text_format format, std::size_t capacity = 0,
+                    int precision = matrix_writer::shortest) {
+    std::ostringstream stream;
+    {
+        matrix_writer out(stream, capacity);
+        out.precision(precision);
+        m.write(out, format);
+    }
+    return stream.str();
+}
+
+// Le format tsv donne le même texte que std::ostream, même avec un tampon qui se vide souvent ; csv n'a pas de
+// séparateur en fin de ligne et Matrix Market écrit les triangulaires et diagonales en coordonnées.
+void testWriter() {
+    matrix_dense<int> integers(3, 4);
+    fill(integers, 1);
+    integers(0, 0) = std::numeric_limits<int>::min();
+    integers(2, 3) = std::numeric_limits<int>::max();
+    CHECK(written(integers, matrix_text_format::tsv) == referenceTsv(integers));
+
+    matrix_dense<double> reals(40, 30);
+    for (std::size_t i = 0; i < 40; i++)
+        for (std::size_t j = 0; j < 30; j++)
+            reals(i, j) = (static_cast<double>(i) - 20.5) / (j + 3.0) * 1e3;
+    CHECK(written(reals, matrix_text_format::tsv, 1, 6) == referenceTsv(reals));
+    std::istringstream shortest(written(reals, matrix_text_format::tsv, 1));
+    bool exact = true;
+    for (std::size_t i = 0; i < 40; i++)
+        for (std::size_t j = 0; j < 30; j++) {
+            std::string text;
+            shortest >> text;
+            exact = exact && std::strtod(text.c_str(), nullptr) == reals(i, j);
+        }
+    CHECK(exact);
+    matrix_triangulaire_sup<double> triang(4, 5, 0.5);
+    matrix_diag<std::complex<double>> diag(3, 3, {1.0, -2.0});
+    fill(triang, 2);
+    fill(diag, 3);
+    CHECK(written(triang, matrix_text_format::tsv) == referenceTsv(triang));
+    CHECK(written(diag, matrix_text_format::tsv) == referenceTsv(diag));
+
+    matrix_dense<int> small(2, 2);
+    small(0, 0) = 1;
+    small(0, 1) = -2;
+    small(1, 0) = 30;
+    CHECK(written(small, matrix_text_format::csv) == "1,-2\n30,0\n");
+    CHECK(written(small, matrix_text_format::matrix_market) ==
+          "%%MatrixMarket matrix array integer general\n2 2\n1\n30\n-2\n0\n");
+    matrix_diag<int> sparse(2, 3, 0);
+    sparse(1, 1) = 7;
+    CHECK(written(sparse, matrix_text_format::matrix_market) ==
+          "%%MatrixMarket matrix coordinate integer general\n2 3 2\n1 1 0\n2 2 7\n");
+}
+
+// Une précision demandée trop grande est ramenée à max_digits10 : le texte est celui de snprintf, sans octet
+// du tampon laissé non initialisé, et un complexe tient dans la place réservée même en fin de tampon.
+void testWriterPrecision() {
+    std::ostringstream stream;
+    {
+        matrix_writer out(stream, 0);
+        out.precision(100);
+        CHECK(out.precision() == matrix_writer::maxPrecision);
+        for (int i = 0; i < 8; i++) {
+            out.value(std::complex<long double>(1.0L / 3, -2.0L / 3));
+            out.value(0.1);
+            out.put('\n');
+        }
+    }
+    char part[64];
+    std::string expected = "(";
+    std::snprintf(part, sizeof(part), "%.*Lg", matrix_writer::maxPrecision, 1.0L / 3);
+    expected += part;
+    expected += ",";
+    std::snprintf(part, sizeof(part), "%.*Lg", matrix_writer::maxPrecision, -2.0L / 3);
+    expected += part;
+    expected += ")";
+    std::snprintf(part, sizeof(part), "%.*g", matrix_writer::maxPrecision, 0.1);
+    expected += part;
+    expected += "\n";
+    std::string all;
+    for (int i = 0; i < 8; i++)
+        all += expected;
+    CHECK(stream.str() == all);
+
+    // Par défaut, le texte le plus court qui relit la valeur dans son propre type.
+    std::ostringstream shortest;
+    {
+        matrix_writer out(shortest);
+        CHECK(out.precision() == matrix_writer::shortest);
+        out.value(0.1);
+        out.put(' ');
+        out.value(0.1f);
+        out.put(' ');
+        out.value(1.0 / 3);
+        out.put(' ');
+        out.value(1e300);
+        out.put(' ');
+        out.value(-2.5L);
+        out.precision(-5);
+        CHECK(out.precision() == matrix_writer::shortest);
+    }
+    CHECK(shortest.str() == "0.1 0.1 0.3333333333333333 1e+300 -2.5");
+}
+
+// Les triplets sont triés et les doublons additionnés ; operator()(i,j) non const insère un élément absent,
+// la version const renvoie zéro sans rien insérer.
+void testCsrConstruction() {
+    matrix_csr<double> m(3, 4, {{2, 1, 5.0}, {0, 3, 1.0}, {2, 1, -2.0}, {0, 0, 4.0}, {1, 2, 0.5}});
+    CHECK(m.getStoredSize() == 4);
+    CHECK(m(0, 0) == 4.0 && m(0, 3) == 1.0 && m(1, 2) == 0.5 && m(2, 1) == 3.0);
+    const std::size_t rowPtr[] = {0, 2, 3, 4};
+    CHECK(std::equal(m.rowPointers().begin(), m.rowPointers().end(), rowPtr));
+    CHECK(static_cast<const matrix_csr<double> &>(m)(1, 1) == 0.0 && m.getStoredSize() == 4);
+    m(1, 0) = 7.0;
+    CHECK(m.getStoredSize() == 5 && m(1, 0) == 7.0 && m(1, 2) == 0.5 && m(2, 1) == 3.0);
+    CHECK(m.trace() == 4.0);
+    CHECK(throwsOutOfRange([]() { matrix_csr<double>(2, 2, {{2, 0, 1.0}}); }));
+
+    matrix_dense<double> dense(6, 5);
+    fill(dense, 1);
+    CHECK(sameValues(matrix_csr<double>(dense), dense));
+    matrix_triangulaire_sup<double> triang(6, 5, 0.0), triangFilled(6, 5, 2.0);
+    matrix_diag<double> diag(6, 5, 0.0);
+    fill(triang, 2);
+    fill(triangFilled, 3);
+    fill(diag, 4);
+    CHECK(sameValues(matrix_csr<double>(triang), triang));
+    CHECK(sameValues(matrix_csr<double>(triangFilled), triangFilled));
+    CHECK(sameValues(matrix_csr<double>(diag), diag));
+    CHECK(sameValues(matrix_csr<double>(triang).toTriangulaireSup(), triang));
+    CHECK(sameValues(matrix_csr<double>(diag).toDiag(), diag));
+    CHECK(sameValues(m.toDense(), m));
+}
+
+// Toutes les paires de add() et multiply() avec une matrice creuse donnent le résultat de la référence dense,
+// dans les deux sens, et addInto() écrit la même somme dans la destination du bon type.
+void testCsrDispatch() {
+    const int n = 23;
+    matrix_csr<double> csr = sparse<double>(n, n, 1), other = sparse<double>(n, n, 2);
+    matrix_dense<double> dense(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 0.0), triangFilled(n, n, 2.0);
+    matrix_diag<double> diag(n, n, 0.0), diagFilled(n, n, -3.0);
+    fill(dense, 3);
+    fill(triang, 4);
+    fill(triangFilled, 5);
+    fill(diag, 6);
+    fill(diagFilled, 7);
+    const std::vector<const matrix_t_<double> *> operands = {&csr, &other, &dense, &triang, &triangFilled, &diag,
+                                                             &diagFilled};
+    for (const matrix_t_<double> *m : operands) {
+        CHECK(sameValues(*csr.add(*m), referenceSum<double>(csr, *m)));
+        CHECK(sameValues(*m->add(csr), referenceSum<double>(*m, csr)));
+        CHECK(sameValues(*csr.multiply(*m), referenceProduct<double>(csr, *m)));
+        CHECK(sameValues(*m->multiply(csr), referenceProduct<double>(*m, csr)));
+
+        std::unique_ptr<matrix_t_<double>> sum = csr.add(*m);
+        if (dynamic_cast<matrix_csr<double> *>(sum.get()) != nullptr) {
+            matrix_csr<double> dst(n, n);
+            addInto(dst, *m, csr);
+            CHECK(sameValues(dst, *sum));
+        } else {
+            matrix_dense<double> dst(n, n);
+            addInto(dst, *m, csr);
+            CHECK(sameValues(dst, *sum));
+        }
+    }
+    CHECK(dynamic_cast<matrix_csr<double> *>(csr.add(other).get()) != nullptr);
+    CHECK(dynamic_cast<matrix_csr<double> *>(diag.add(csr).get()) != nullptr);
+    CHECK(dynamic_cast<matrix_csr<double> *>(csr.multiply(other).get()) != nullptr);
+    CHECK(dynamic_cast<matrix_csr<double> *>(diag.multiply(csr).get()) != nullptr);
+
+    matrix_csr<double> accumulator(csr);
+    accumulator += accumulator;
+    CHECK(sameValues(accumulator, referenceSum<double>(csr, csr)));
+}
+
+// Toutes les paires de add() et multiply() avec une matrice bande donnent le résultat de la référence dense,
+// dans les deux sens, et gardent une bande quand la structure le permet.
+void testBandDispatch() {
+    const int shapes[][2] = {{19, 19}, {14, 9}};
+    for (const auto &shape : shapes) {
+        const int h = shape[0], w = shape[1];
+        matrix_band<double> band(h, w, 2, 1), tridiagonal(h, w, 1, 1);
+        matrix_csr<double> csr = sparse<double>(h, w, 1);
+        matrix_dense<double> dense(h, w);
+        matrix_triangulaire_sup<double> triang(h, w, 0.0), triangFilled(h, w, 2.0);
+        matrix_diag<double> diag(h, w, 0.0), diagFilled(h, w, -3.0);
+        fill(band, 2);
+        fill(tridiagonal, 3);
+        fill(dense, 4);
+        fill(triang, 5);
+        fill(triangFilled, 6);
+        fill(diag, 7);
+        fill(diagFilled, 8);
+        const std::vector<const matrix_t_<double> *> operands = {&band, &tridiagonal, &csr, &dense, &triang,
+                                                                 &triangFilled, &diag, &diagFilled};
+        for (const matrix_t_<double> *m : operands) {
+            CHECK(sameValues(*band.add(*m), referenceSum<double>(band, *m)));
+            CHECK(sameValues(*m->add(band), referenceSum<double>(*m, band)));
+            if (h == w) {
+                CHECK(sameValues(*band.multiply(*m), referenceProduct<double>(band, *m)));
+                CHECK(sameValues(*m->multiply(band), referenceProduct<double>(*m, band)));
+            }
+        }
+        CHECK(dynamic_cast<matrix_band<double> *>(band.add(tridiagonal).get()) != nullptr);
+        CHECK(dynamic_cast<matrix_band<double> *>(diag.add(band).get()) != nullptr);
+        CHECK(dynamic_cast<matrix_csr<double> *>(band.add(csr).get()) != nullptr);
+
+        matrix_band<double> sum(h, w, 1, 1);
+        addInto(sum, band, tridiagonal);
+        CHECK(sum.getLowerBandwidth() == 2 && sameValues(sum, referenceSum<double>(band, tridiagonal)));
+        matrix_dense<double> denseSum(h, w);
+        addInto(denseSum, triang, band);
+        CHECK(sameValues(denseSum, referenceSum<double>(triang, band)));
+    }
+
+    const int n = 12;
+    matrix_band<double> band(n, n, 2, 3), other(n, n, 1, 0);
+    matrix_diag<double> diag(n, n, 0.0);
+    fill(band, 1);
+    fill(other, 2);
+    fill(diag, 3);
+    std::unique_ptr<matrix_t_<double>> product = band.multiply(other);
+    matrix_band<double> *productBand = dynamic_cast<matrix_band<double> *>(product.get());
+    CHECK(productBand != nullptr && productBand->getLowerBandwidth() == 3 && productBand->getUpperBandwidth() == 3);
+    CHECK(dynamic_cast<matrix_band<double> *>(diag.multiply(band).get()) != nullptr);
+
+    double trace = 0;
+    for (std::size_t i = 0; i < n; i++)
+        trace += band(i, i);
+    CHECK(band.trace() == trace);
+    const matrix_band<double> &constBand = band;
+    matrix_column_segment<const double> column = constBand.columnSegment(5);
+    CHECK(column.firstRow() == 2 && column.size() == 6 && column[7] == band(7, 5));
+    CHECK(throwsOutOfRange([&]() { band(9, 2); }));
+    CHECK(constBand(9, 2) == 0.0);
+
+    std::vector<double> x(n), y(n, 1.0), expected(n);
+    for (std::size_t j = 0; j < n; j++)
+        x[j] = valueAt(j, 0, 4);
+    for (std::size_t i = 0; i < n; i++) {
+        expected[i] = 3.0;
+        for (std::size_t j = 0; j < n; j++)
+            expected[i] += 2.0 * constBand(i, j) * x[j];
+    }
+    band.multiplyVector({x.data(), x.size()}, {y.data(), y.size()}, 2.0, 3.0);
+    CHECK(y == expected);
+}
+
+// Matrice fixe 4x3 de structure S : les lignes complètes viennent de valueAt, fromRows n'en garde que la
+// partie stockée.
+template<matrix_structure S>
+matrix_fixed<double, 4, 3, S> fixedMatrix(int seed, double fill) {
+    std::array<std::array<double, 3>, 4> rows;
+    for (std::size_t i = 0; i < 4; i++)
+        for (std::size_t j = 0; j < 3; j++)
+            rows[i][j] = valueAt(i, j, seed);
+    return matrix_fixed<double, 4, 3, S>::fromRows(rows, fill);
+}
+
+// a + b donne, sans allocation, la somme des classes dynamiques correspondantes, dans la même structure.
+template<matrix_structure SA, matrix_structure SB>
+void checkFixedSum() {
+    const matrix_fixed<double, 4, 3, SA> a = fixedMatrix<SA>(1, 2.0);
+    const matrix_fixed<double, 4, 3, SB> b = fixedMatrix<SB>(2, -1.0);
+    const auto dynamicA = a.toDynamic();
+    const auto dynamicB = b.toDynamic();
+    std::unique_ptr<matrix_t_<double>> expected = dynamicA.add(dynamicB);
+    CHECK(allocationsOf([&]() { (void) (a + b); }) == 0);
+    const auto sum = (a + b).toDynamic();
+    CHECK(typeid(sum) == typeid(*expected));
+    CHECK(sameValues(sum, *expected));
+}
+
+// Les matrices fixes ont le même contenu que les classes dynamiques, se calculent à la compilation et
+// n'ajoutent rien à la taille de leurs éléments quand elles n'ont pas de valeur hors du stockage.
+void testFixed() {
+    static_assert(sizeof(matrix_dense_fixed<double, 3, 3>) == 9 * sizeof(double), "no fill value in a dense");
+    constexpr matrix_diag_fixed<int, 3, 3> diag(std::array<int, 3>{{1, 2, 3}}, 5);
+    constexpr matrix_dense_fixed<int, 3, 3> dense(std::array<int, 9>{{1, 2, 3, 4, 5, 6, 7, 8, 9}});
+    static_assert(diag.trace() == 6 && diag(0, 1) == 5, "constexpr diagonal");
+    constexpr matrix_dense_fixed<int, 3, 3> sum = dense + diag;
+    static_assert(sum.trace() == 1 + 5 + 9 + 6 && sum(1, 0) == 2 + 5, "constexpr sum");
+
+    matrix_triangulaire_sup_fixed<double, 4, 3> triang = fixedMatrix<matrix_structure::triangulaire_sup>(3, 4.0);
+    CHECK(triang(3, 0) == 4.0 && triang(1, 2) == valueAt(1, 2, 3));
+    CHECK(triang.trace() == triang.toDynamic().trace());
+    triang(2, 1) = -4.0;
+    CHECK(triang(3, 0) == -4.0);
+
+    checkFixedSum<matrix_structure::dense, matrix_structure::dense>();
+    checkFixedSum<matrix_structure::dense, matrix_structure::triangulaire_sup>();
+    checkFixedSum<matrix_structure::dense, matrix_structure::diag>();
+    checkFixedSum<matrix_structure::triangulaire_sup, matrix_structure::dense>();
+    checkFixedSum<matrix_structure::triangulaire_sup, matrix_structure::triangulaire_sup>();
+    checkFixedSum<matrix_structure::triangulaire_sup, matrix_structure::diag>();
+    checkFixedSum<matrix_structure::diag, matrix_structure::dense>();
+    checkFixedSum<matrix_structure::diag, matrix_structure::triangulaire_sup>();
+    checkFixedSum<matrix_structure::diag, matrix_structure::diag>();
+}
+
+// add() et addInto() sur matrix_value donnent, pour les vingt-cinq paires de types, le résultat et le type de
+// add() virtuel ; addInto() dans une destination déjà du bon type n'alloue pas.
+void testStaticDispatch() {
+    const int n = 9;
+    matrix_dense<double> dense(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 2.0);
+    matrix_diag<double> diag(n, n, 0.0), diagFilled(n, n, -1.0);
+    matrix_band<double> band(n, n, 1, 2);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+    fill(diagFilled, 4);
+    fill(band, 5);
+    const std::vector<matrix_value<double>> values = {dense, triang, diag, diagFilled, sparse<double>(n, n, 6),
+                                                      band};
+    for (const matrix_value<double> &a : values)
+        for (const matrix_value<double> &b : values) {
+            std::unique_ptr<matrix_t_<double>> expected = asMatrix(a).add(asMatrix(b));
+            const matrix_value<double> sum = a + b;
+            CHECK(typeid(asMatrix(sum)) == typeid(*expected));
+            CHECK(sameValues(asMatrix(sum), *expected));
+
+            matrix_value<double> dst = toValue(*expected);
+            addInto(dst, a, b);
+            CHECK(sameValues(asMatrix(dst), *expected));
+        }
+
+    matrix_value<double> a = dense, b = triang, dst = dense;
+    CHECK(allocationsOf([&]() { addInto(dst, a, b); }) == 0);
+    CHECK(sameValues(asMatrix(dst), referenceSum<double>(dense, triang)));
+    addInto(a, a, b);
+    CHECK(sameValues(asMatrix(a), asMatrix(dst)));
+    CHECK(allocationsOf([&]() { matrix_value<double> moved = std::move(dst); }) == 0);
+
+    const matrix_value<double> wrongSize = matrix_dense<double>(n, n + 1);
+    CHECK(throwsRuntimeError([&]() { add(a, wrongSize); }));
+}
+
+// Plus grand écart entre a et b, élément par élément.
+template<typename T>
+double maxDifference(const matrix_t_<T> &a, const matrix_t_<T> &b) {
+    double result = 0;
+    for (std::size_t i = 0; i < a.getHeight(); i++)
+        for (std::size_t j = 0; j < a.getWidth(); j++)
+            result = std::max(result, static_cast<double>(std::abs(a(i, j) - b(i, j))));
+    return result;
+}
+
+// Le résidu A x - b de solve() reste de l'ordre de l'arrondi, avec et sans valeur sous la diagonale, pour des
+// tailles inférieures, égales et non multiples du bloc de 64 lignes de kernels::solveUpperPacked.
+void testTriangularSolve() {
+    const std::size_t sizes[] = {1, 5, 64, 150};
+    const double valInfs[] = {0.0, 0.5, -2.0};
+    for (std::size_t n : sizes)
+        for (double valInf : valInfs) {
+            matrix_triangulaire_sup<double> a(n, n, valInf);
+            fill(a, 1);
+            for (std::size_t i = 0; i < n; i++)
+                a(i, i) = static_cast<double>(n) + 6.0 + valueAt(i, i, 2);
+            matrix_dense<double> b(n, 3);
+            fill(b, 3);
+            const matrix_dense<double> x = a.solve(b);
+            CHECK(maxDifference(referenceProduct<double>(a, x), b) < 1e-9);
+
+            std::vector<double> column(n);
+            for (std::size_t i = 0; i < n; i++)
+                column[i] = b(i, 1);
+            a.solveInPlace({column.data(), column.size()});
+            bool sameColumn = true;
+            for (std::size_t i = 0; i < n; i++)
+                sameColumn = sameColumn && std::abs(column[i] - x(i, 1)) < 1e-12;
+            CHECK(sameColumn);
+        }
+
+    matrix_triangulaire_sup<double> singular(4, 4, 0.0);
+    fill(singular, 4);
+    singular(2, 2) = 0.0;
+    matrix_dense<double> b(4, 1);
+    CHECK(throwsRuntimeError([&]() { singular.solve(b); }));
+    CHECK(throwsRuntimeError([&]() { matrix_triangulaire_sup<double>(4, 5, 0.0).solve(b); }));
+    CHECK(throwsRuntimeError([&]() { matrix_triangulaire_sup<double>(3, 3, 1.0).solve(b); }));
+}
+
+// multiplyVector() et multiplyVectors() de m donnent alpha * m * x + beta * y calculé par la référence dense ;
+// avec beta nul, y n'est pas lu (il contient des NaN).
+void checkMatrixVector(const matrix_t_<double> &m) {
+    const std::size_t h = m.getHeight(), w = m.getWidth(), count = 5;
+    matrix_dense<double> x(w, count), y(h, count);
+    fill(x, 1);
+    fill(y, 2);
+    const matrix_dense<double> product = referenceProduct<double>(m, x);
+    matrix_dense<double> expected(h, count), batched(y);
+    for (std::size_t i = 0; i < h; i++)
+        for (std::size_t c = 0; c < count; c++)
+            expected(i, c) = 2.0 * product(i, c) + 3.0 * y(i, c);
+
+    m.multiplyVectors(x, batched, 2.0, 3.0);
+    CHECK(sameValues(batched, expected));
+    for (std::size_t c = 0; c < count; c++)
+        m.multiplyVector(x.column(c), y.column(c), 2.0, 3.0);
+    CHECK(sameValues(y, expected));
+
+    std::vector<double> single(h, std::numeric_limits<double>::quiet_NaN());
+    m.multiplyVector(x.column(0), {single.data(), single.size()});
+    bool sameColumn = true;
+    for (std::size_t i = 0; i < h; i++)
+        sameColumn = sameColumn && single[i] == product(i, 0);
+    CHECK(sameColumn);
+    matrix_dense<double> nan(h, count);
+    for (std::size_t i = 0; i < h; i++)
+        for (std::size_t c = 0; c < count; c++)
+            nan(i, c) = std::numeric_limits<double>::quiet_NaN();
+    m.multiplyVectors(x, nan);
+    CHECK(sameValues(nan, product));
+}
+
+// Produits matrice-vecteur de chaque type, avec des tailles qui dépassent les blocs de 1024 lignes et les tuiles
+// de 128 colonnes des noyaux, et des valeurs hors du stockage nulles ou non.
+void testMatrixVector() {
+    const int shapes[][2] = {{7, 5}, {130, 130}, {1100, 140}, {90, 300}};
+    for (const auto &shape : shapes) {
+        const int h = shape[0], w = shape[1];
+        matrix_dense<double> dense(h, w);
+        matrix_triangulaire_sup<double> triang(h, w, 0.0), triangFilled(h, w, -2.0);
+        matrix_diag<double> diag(h, w, 0.0), diagFilled(h, w, 3.0);
+        matrix_band<double> band(h, w, 3, 2);
+        fill(dense, 3);
+        fill(triang, 4);
+        fill(triangFilled, 5);
+        fill(diag, 6);
+        fill(diagFilled, 7);
+        fill(band, 8);
+        const matrix_csr<double> csr = sparse<double>(h, w, 9);
+        const std::vector<const matrix_t_<double> *> matrices = {&dense, &triang, &triangFilled, &diag,
+                                                                 &diagFilled, &csr, &band};
+        for (const matrix_t_<double> *m : matrices)
+            checkMatrixVector(*m);
+    }
+
+    matrix_dense<double> dense(4, 3);
+    std::vector<double> x(4), y(4);
+    CHECK(throwsRuntimeError([&]() { dense.multiplyVector({x.data(), x.size()}, {y.data(), y.size()}); }));
+}
+
+// Les trois dispositions de matrix_dense donnent les mêmes éléments et les mêmes résultats que la disposition
+// column_major, y compris à travers les conversions vers CSR et les noyaux qui passent par une copie. Les
+// tailles ne sont pas des multiples des tuiles de 64.
+void testDenseLayouts() {
+    const int h = 70, w = 90;
+    const dense_layout layouts[] = {dense_layout::column_major, dense_layout::row_major, dense_layout::tiled};
+    matrix_dense<double> reference(h, w), square(w, w);
+    fill(reference, 1);
+    fill(square, 2);
+    matrix_triangulaire_sup<double> triang(h, w, 1.0);
+    matrix_band<double> band(h, w, 2, 3);
+    fill(triang, 3);
+    fill(band, 4);
+    const matrix_csr<double> csr = sparse<double>(h, w, 5);
+    for (dense_layout layout : layouts) {
+        matrix_dense<double> dense(h, w, layout);
+        fill(dense, 1);
+        CHECK(dense.getLayout() == layout && sameValues(dense, reference));
+        CHECK(sameValues(dense.withLayout(dense_layout::column_major), reference));
+
+        const matrix_csr<double> fromDense(dense);
+        CHECK(sameValues(fromDense, reference));
+
+        const std::vector<const matrix_t_<double> *> operands = {&reference, &triang, &band, &csr};
+        for (const matrix_t_<double> *m : operands) {
+            CHECK(sameValues(*dense.add(*m), referenceSum<double>(reference, *m)));
+            CHECK(sameValues(*m->add(dense), referenceSum<double>(*m, reference)));
+        }
+        matrix_dense<double> sum(h, w, layout);
+        addInto(sum, dense, triang);
+        CHECK(sameValues(sum, referenceSum<double>(reference, triang)));
+
+        matrix_dense<double> right(w, w, layout);
+        fill(right, 2);
+        CHECK(sameValues(*dense.multiply(right), referenceProduct<double>(reference, square)));
+        CHECK(sameValues(*triang.multiply(right), referenceProduct<double>(triang, square)));
+        CHECK(sameValues(*csr.multiply(right), referenceProduct<double>(csr, square)));
+        CHECK(right.trace() == square.trace());
+
+        matrix_dense<double> x(w, 3, layout), y(h, 3, layout);
+        fill(x, 6);
+        dense.multiplyVectors(x, y);
+        CHECK(sameValues(y, referenceProduct<double>(reference, x)));
+
+        CHECK(written(dense, matrix_text_format::tsv) == referenceTsv(reference));
+        const matrix_text_format market = matrix_text_format::matrix_market;
+        CHECK(written(dense, market) == written(reference, market));
+    }
+}
+
+// t est la transposée de m, élément par élément.
+template<typename T>
+bool isTransposeOf(const matrix_t_<T> &t, const matrix_t_<T> &m) {
+    if (t.getHeight() != m.getWidth() || t.getWidth() != m.getHeight())
+        return false;
+    for (std::size_t i = 0; i < t.getHeight(); i++)
+        for (std::size_t j = 0; j < t.getWidth(); j++)
+            if (t(i, j) != m(j, i))
+                return false;
+    return true;
+}
+
+// transpose() de chaque type, rectangulaire et carré, transposed() et transposeInPlace(), et la triangulaire
+// inférieure obtenue en transposant une triangulaire supérieure dans les sommes et produits.
+void testTranspose() {
+    const int shapes[][2] = {{70, 45}, {100, 100}, {1, 33}};
+    const dense_layout layouts[] = {dense_layout::column_major, dense_layout::row_major, dense_layout::tiled};
+    for (const auto &shape : shapes) {
+        const int h = shape[0], w = shape[1];
+        matrix_triangulaire_sup<double> triang(h, w, 0.0), triangFilled(h, w, 2.0);
+        matrix_diag<double> diag(h, w, 1.0);
+        matrix_band<double> band(h, w, 3, 1);
+        fill(triang, 1);
+        fill(triangFilled, 2);
+        fill(diag, 3);
+        fill(band, 4);
+        const matrix_csr<double> csr = sparse<double>(h, w, 5);
+        const std::vector<const matrix_t_<double> *> matrices = {&triang, &triangFilled, &diag, &band, &csr};
+        for (const matrix_t_<double> *m : matrices) {
+            std::unique_ptr<matrix_t_<double>> t = m->transpose();
+            CHECK(isTransposeOf(*t, *m));
+            CHECK(sameValues(*t->transpose(), *m));
+        }
+        CHECK(typeid(*triang.transpose()) == typeid(matrix_triangulaire_inf<double>));
+        CHECK(band.transposed().getLowerBandwidth() == band.getUpperBandwidth() &&
+              band.transposed().getUpperBandwidth() == band.getLowerBandwidth());
+
+        for (dense_layout layout : layouts) {
+            matrix_dense<double> dense(h, w, layout);
+            fill(dense, 6);
+            const matrix_dense<double> t = dense.transposed();
+            CHECK(t.getLayout() == layout && isTransposeOf(t, dense));
+            if (h == w) {
+                matrix_dense<double> inPlace(dense);
+                inPlace.transposeInPlace();
+                CHECK(sameValues(inPlace, t));
+            }
+        }
+
+        matrix_diag<double> inPlace(diag);
+        inPlace.transposeInPlace();
+        CHECK(isTransposeOf(inPlace, diag));
+    }
+
+    const int n = 20;
+    matrix_triangulaire_sup<double> a(n, n, 0.0), b(n, n, 3.0);
+    matrix_diag<double> diag(n, n, 0.0);
+    matrix_dense<double> dense(n, n);
+    fill(a, 1);
+    fill(b, 2);
+    fill(diag, 3);
+    fill(dense, 4);
+    const matrix_triangulaire_inf<double> lower = a.transposed(), lowerFilled = b.transposed();
+    CHECK(typeid(*lower.add(lowerFilled)) == typeid(matrix_triangulaire_inf<double>));
+    CHECK(sameValues(*lower.add(lowerFilled), referenceSum<double>(lower, lowerFilled)));
+    CHECK(typeid(*lower.add(diag)) == typeid(matrix_triangulaire_inf<double>));
+    CHECK(sameValues(*diag.add(lower), referenceSum<double>(diag, lower)));
+    CHECK(sameValues(*lower.add(a), referenceSum<double>(lower, a)));
+    CHECK(sameValues(*dense.multiply(lower), referenceProduct<double>(dense, lower)));
+    CHECK(sameValues(*lowerFilled.multiply(dense), referenceProduct<double>(lowerFilled, dense)));
+    CHECK(sameValues(*dense.multiply(lowerFilled), referenceProduct<double>(dense, lowerFilled)));
+}
+
+// Compteurs de matrix_stats.h. Sans TP5_STATS, les opérations ne relèvent rien et les arguments des points de
+// mesure ne sont pas évalués ; avec (cible tp5_tests_stats), chaque opération est comptée une fois, avec les
+// octets de ses stockages, y compris quand elle délègue par double dispatch ou se répartit sur le pool.
+void testStats() {
+    const int n = 300;
+    matrix_dense<double> dense(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 0.0);
+    fill(dense, 1);
+    fill(triang, 2);
+    const matrix_t_<double> &base = triang;
+
+    matrix_stats::reset();
+    std::unique_ptr<matrix_t_<double>> sum = dense.add(base);
+    dense.trace();
+    double accessed = 0;
+    for (std::size_t i = 0; i < 10; i++)
+        accessed += triang(i, i);
+    const matrix_dense<double> outside(4, 4);
+    const matrix_stats::snapshot stats = matrix_stats::read();
+    std::ostringstream json;
+    stats.writeJson(json);
+
+    if (!matrix_stats::enabled) {
+        int evaluated = 0;
+        TP5_STATS_ACCESS((evaluated++, matrix_stats::kind::dense));
+        CHECK(evaluated == 0);
+        CHECK(stats.all().empty());
+        CHECK(json.str().find("\"enabled\": false") != std::string::npos);
+        return;
+    }
+    const matrix_stats::counter add = stats.get("add/dense+triang");
+    CHECK(add.calls == 1 && add.elements == dense.getStoredSize() + triang.getStoredSize());
+    CHECK(add.bytes == n * n * sizeof(double));
+    CHECK(stats.get("add/triang+dense").calls == 0);
+    CHECK(stats.get("trace/dense").calls == 1 && stats.get("trace/dense").elements == n);
+    CHECK(stats.get("operator()/triang").calls == 10);
+    CHECK(stats.get("other").bytes == 16 * sizeof(double));
+    CHECK(json.str().find("\"name\": \"add/dense+triang\"") != std::string::npos);
+
+    matrix_stats::reset();
+    CHECK(matrix_stats::read().all().empty());
+}
+
+// Lot de count matrices h x w de structure S, la matrice n remplie avec la graine n + seed et, hors du
+// stockage, la valeur n % 3 - 1.
+template<matrix_structure S>
+matrix_batch<double, S> filledBatch(std::size_t count, int h, int w, int seed) {
+    matrix_batch<double, S> batch(count, h, w);
+    for (std::size_t n = 0; n < count; n++) {
+        typename matrix_batch<double, S>::matrix_type m = expr_result<double, S>::make(h, w);
+        fill(m, static_cast<int>(n) + seed);
+        if (S != matrix_structure::dense && h > 1)
+            m(1, 0) = static_cast<double>(n % 3) - 1.0;
+        batch.set(n, m);
+    }
+    return batch;
+}
+
+// a + b et addInto() sur des lots donnent, matrice par matrice, le add() des classes dynamiques.
+template<matrix_structure SA, matrix_structure SB>
+void checkBatchSum(std::size_t count, int h, int w) {
+    const matrix_batch<double, SA> a = filledBatch<SA>(count, h, w, 1);
+    const matrix_batch<double, SB> b = filledBatch<SB>(count, h, w, 2);
+    const matrix_batch<double, widestStructure(SA, SB)> sum = a + b;
+    bool same = true;
+    for (std::size_t n = 0; n < count; n++) {
+        const std::unique_ptr<matrix_t_<double>> expected = a.get(n).add(b.get(n));
+        same = same && typeid(sum.get(n)) == typeid(*expected) && sameValues(sum.get(n), *expected);
+    }
+    CHECK(same);
+    matrix_batch<double, widestStructure(SA, SB)> dst(count, h, w);
+    CHECK(allocationsOf([&]() { addInto(dst, a, b); }) == 0);
+    CHECK(allocationsOf([&]() { addInto(dst, dst, b); }) == 0);
+    same = true;
+    for (std::size_t n = 0; n < count; n++)
+        same = same && sameValues(dst.get(n), *sum.get(n).add(b.get(n)));
+    CHECK(same);
+}
+
+// Lots de tailles inférieures, égales et non multiples de batchBlock : sommes des neuf paires de structures,
+// traces et produits matrice-vecteur comparés aux classes dynamiques.
+void testBatch() {
+    const std::size_t counts[] = {1, matrix_dense_batch<double>::batchBlock, 600};
+    for (std::size_t count : counts) {
+        checkBatchSum<matrix_structure::dense, matrix_structure::dense>(count, 3, 3);
+        checkBatchSum<matrix_structure::dense, matrix_structure::triangulaire_sup>(count, 4, 3);
+        checkBatchSum<matrix_structure::dense, matrix_structure::diag>(count, 3, 3);
+        checkBatchSum<matrix_structure::triangulaire_sup, matrix_structure::dense>(count, 3, 4);
+        checkBatchSum<matrix_structure::triangulaire_sup, matrix_structure::triangulaire_sup>(count, 4, 4);
+        checkBatchSum<matrix_structure::triangulaire_sup, matrix_structure::diag>(count, 3, 3);
+        checkBatchSum<matrix_structure::diag, matrix_structure::dense>(count, 2, 3);
+        checkBatchSum<matrix_structure::diag, matrix_structure::triangulaire_sup>(count, 3, 3);
+        checkBatchSum<matrix_structure::diag, matrix_structure::diag>(count, 4, 4);
+
+        const matrix_triangulaire_sup_batch<double> triang = filledBatch<matrix_structure::triangulaire_sup>(
+                count, 4, 3, 3);
+        const matrix_dense_batch<double> x = filledBatch<matrix_structure::dense>(count, 3, 1, 4);
+        matrix_dense_batch<double> y = filledBatch<matrix_structure::dense>(count, 4, 1, 5);
+        const matrix_dense_batch<double> yBefore = y;
+        triang.multiplyVector(x, y, 2.0, -1.0);
+        const std::vector<double> traces = triang.trace();
+        bool same = true;
+        for (std::size_t n = 0; n < count; n++) {
+            matrix_triangulaire_sup<double> m = triang.get(n);
+            matrix_dense<double> expected = yBefore.get(n);
+            m.multiplyVector(x.get(n).column(0), expected.column(0), 2.0, -1.0);
+            same = same && sameValues(y.get(n), expected) && traces[n] == m.trace();
+        }
+        CHECK(same);
+    }
+
+    matrix_diag_batch<double> diag(3, 2, 2);
+    diag(1, 0, 1) = 4.0;
+    CHECK(diag.fills()[1] == 4.0 && diag(1, 1, 0) == 4.0 && diag(0, 1, 0) == 0.0);
+    CHECK(throwsOutOfRange([&]() { diag(3, 0, 0); }));
+    CHECK(throwsRuntimeError([&]() { diag.set(0, matrix_diag<double>(3, 3, 0.0)); }));
+    const matrix_dense_batch<double> wrong(4, 2, 2);
+    CHECK(throwsRuntimeError([&]() { (void) (diag + wrong); }));
+}
+
+// alpha * a + beta * b par operator()(i,j).
+template<typename T>
+matrix_dense<T> referenceAxpby(T alpha, const matrix_t_<T> &a, T beta, const matrix_t_<T> &b) {
+    matrix_dense<T> result(a.getHeight(), a.getWidth());
+    for (std::size_t i = 0; i < a.getHeight(); i++)
+        for (std::size_t j = 0; j < a.getWidth(); j++)
+            result(i, j) = alpha * a(i, j) + beta * b(i, j);
+    return result;
+}
+
+// axpby() donne le type de add() et les valeurs de la référence ; axpbyInto() écrit de même dans une
+// destination neuve ou dans l'opérande de gauche.
+template<typename A, typename B>
+void checkAxpby(const A &a, const B &b) {
+    const std::unique_ptr<matrix_t_<double>> result = a.axpby(2.0, -3.0, b);
+    CHECK(typeid(*result) == typeid(*a.add(b)));
+    CHECK(sameValues(*result, referenceAxpby<double>(2.0, a, -3.0, b)));
+    std::unique_ptr<matrix_t_<double>> dst = a.add(b);
+    axpbyInto(*dst, 2.0, a, -3.0, b);
+    CHECK(sameValues(*dst, *result));
+    if (typeid(*result) == typeid(A)) {
+        A self(a);
+        axpbyInto(self, 2.0, self, -3.0, b);
+        CHECK(sameValues(self, *result));
+    }
+}
+
+// Les neuf paires de axpby() entre dense (dans ses trois dispositions), triangulaire et diagonale, avec des
+// valeurs hors du stockage non nulles, et scale() / operator*= de chaque classe.
+void testAxpby() {
+    const int h = 70, w = 75;
+    matrix_triangulaire_sup<double> triang(h, w, 1.5);
+    matrix_diag<double> diag(h, w, -2.0);
+    fill(triang, 1);
+    fill(diag, 2);
+    const dense_layout layouts[] = {dense_layout::column_major, dense_layout::row_major, dense_layout::tiled};
+    for (dense_layout layout : layouts) {
+        matrix_dense<double> dense(h, w, layout);
+        fill(dense, 3);
+        matrix_dense<double> other(h, w);
+        fill(other, 4);
+        checkAxpby(dense, other);
+        checkAxpby(other, dense);
+        checkAxpby(dense, triang);
+        checkAxpby(triang, dense);
+        checkAxpby(dense, diag);
+        checkAxpby(diag, dense);
+    }
+    matrix_triangulaire_sup<double> triangOther(h, w, -1.0);
+    matrix_diag<double> diagOther(h, w, 0.5);
+    fill(triangOther, 5);
+    fill(diagOther, 6);
+    checkAxpby(triang, triangOther);
+    checkAxpby(triang, diag);
+    checkAxpby(diag, triang);
+    checkAxpby(diag, diagOther);
+
+    matrix_dense<double> dense(h, w);
+    matrix_band<double> band(h, w, 2, 1);
+    fill(dense, 7);
+    fill(band, 8);
+    matrix_csr<double> csr = sparse<double>(h, w, 9);
+    const matrix_triangulaire_inf<double> lower = triang.transposed();
+    matrix_triangulaire_inf<double> scaledLower(lower);
+    const std::vector<matrix_t_<double> *> matrices = {&dense, &triang, &diag, &band, &csr, &scaledLower};
+    for (matrix_t_<double> *m : matrices) {
+        const matrix_dense<double> before = toDense(*m);
+        *m *= -0.5;
+        const matrix_t_<double> &scaledMatrix = *m;
+        bool scaled = true;
+        for (std::size_t i = 0; i < m->getHeight(); i++)
+            for (std::size_t j = 0; j < m->getWidth(); j++)
+                scaled = scaled && scaledMatrix(i, j) == -0.5 * before(i, j);
+        CHECK(scaled);
+    }
+
+    matrix_diag<double> wrongSize(h + 1, w, 0.0);
+    CHECK(throwsRuntimeError([&]() { triang.axpby(1.0, 1.0, wrongSize); }));
+}
+
+// Toutes les classes s'instancient sur un type non signé : std::abs y est ambigu, les réductions ne doivent
+// pas l'appeler.
+template class matrix_dense<unsigned>;
+
+template class matrix_triangulaire_sup<unsigned>;
+
+template class matrix_diag<unsigned>;
+
+template class matrix_csr<unsigned>;
+
+template class matrix_band<unsigned>;
+
+template class matrix_triangulaire_inf<unsigned>;
+
+template class matrix_symmetric<unsigned>;
+
+template class matrix_block<unsigned>;
+
+// Réductions de m, calculées élément par élément sur operator()(i,j) : elles doivent toutes être exactes sur
+// les petites valeurs entières des tests, sauf la racine de la norme de Frobenius.
+void checkReductions(const matrix_t_<double> &m, const matrix_t_<double> &other) {
+    double sum = 0, squares = 0, max = 0, norm1 = 0, trace = 0, dot = 0;
+    for (std::size_t j = 0; j < m.getWidth(); j++) {
+        double column = 0;
+        for (std::size_t i = 0; i < m.getHeight(); i++) {
+            const double v = m(i, j);
+            sum += v;
+            squares += v * v;
+            max = std::max(max, std::abs(v));
+            column += std::abs(v);
+            dot += v * other(i, j);
+            if (i == j)
+                trace += v;
+        }
+        norm1 = std::max(norm1, column);
+    }
+    const reduce::summation modes[] = {reduce::summation::fast, reduce::summation::kahan,
+                                        reduce::summation::pairwise};
+    for (reduce::summation mode : modes) {
+        CHECK(m.traceSum(mode) == trace);
+        CHECK(m.sum(mode) == sum);
+        CHECK(std::abs(m.normFrobenius(mode) - std::sqrt(squares)) <= 1e-12 * std::sqrt(squares));
+        CHECK(m.norm1(mode) == norm1);
+        CHECK(m.dot(other, mode) == dot);
+    }
+    CHECK(m.traceSum(reduce::summation::pairwise) == trace && m.normMax() == max);
+}
+
+// Réductions de chaque classe, avec des valeurs hors du stockage nulles ou non, et produits scalaires entre
+// toutes les paires de classes ; précision des sommes compensées sur une somme mal conditionnée.
+void testReductions() {
+    const int shapes[][2] = {{40, 40}, {37, 300}, {300, 23}};
+    for (const auto &shape : shapes) {
+        const int h = shape[0], w = shape[1];
+        matrix_dense<double> dense(h, w), rowMajor(h, w, dense_layout::row_major);
+        matrix_triangulaire_sup<double> triang(h, w, 0.0), triangFilled(h, w, -2.0);
+        matrix_diag<double> diag(h, w, 0.0), diagFilled(h, w, 3.0);
+        matrix_band<double> band(h, w, 2, 4);
+        fill(dense, 1);
+        fill(rowMajor, 2);
+        fill(triang, 3);
+        fill(triangFilled, 4);
+        fill(diag, 5);
+        fill(diagFilled, 6);
+        fill(band, 7);
+        const matrix_csr<double> csr = sparse<double>(h, w, 8);
+        const matrix_triangulaire_inf<double> lower = matrix_triangulaire_sup<double>(w, h, 1.0).transposed();
+        const std::vector<const matrix_t_<double> *> matrices = {&dense, &rowMajor, &triang, &triangFilled, &diag,
+                                                                 &diagFilled, &band, &csr, &lower};
+        for (const matrix_t_<double> *m : matrices)
+            for (const matrix_t_<double> *other : matrices)
+                checkReductions(*m, *other);
+    }
+
+    // 1 suivi de n fois 1e-16 : en somme naïve, chaque 1e-16 disparaît contre le 1 de la même voie.
+    const std::size_t n = 1 << 16;
+    matrix_dense<double> tiny(1, static_cast<int>(n) + 1);
+    tiny(0, 0) = 1.0;
+    for (std::size_t j = 1; j <= n; j++)
+        tiny(0, j) = 1e-16;
+    const double exact = 1.0 + static_cast<double>(n) * 1e-16;
+    CHECK(std::abs(tiny.sum(reduce::summation::kahan) - exact) <= 1e-16);
+    CHECK(std::abs(tiny.sum(reduce::summation::fast) - exact) > 1e-13);
+
+    matrix_dense<double> wrongSize(3, 4);
+    CHECK(throwsRuntimeError([&]() { tiny.dot(wrongSize); }));
+}
+
+// Les réductions et l'entrée/sortie binaire sur des entiers non signés.
+void testUnsigned() {
+    matrix_dense<unsigned> m(3, 3);
+    for (std::size_t i = 0; i < 3; i++)
+        for (std::size_t j = 0; j < 3; j++)
+            m(i, j) = static_cast<unsigned>(i + 2 * j);
+    CHECK(m.trace() == 0 + 3 + 6);
+    CHECK(m.sum() == 27);
+    CHECK(m.normMax() == 6.0);
+    CHECK(m.norm1() == 15.0);
+    matrix_triangulaire_sup<unsigned> triang(3, 3, 2);
+    triang(0, 1) = 4;
+    triang(2, 2) = 1;
+    CHECK(triang.sum() == 4 + 1 + 3 * 2 && triang.dot(m) == 4 * 2 + 1 * 6 + 2 * (1 + 2 + 4));
+    matrix_symmetric<unsigned> symmetric(3);
+    symmetric(0, 1) = 4;
+    symmetric(2, 2) = 1;
+    CHECK(symmetric.sum() == 9);
+
+    const std::string path = "tp5_tests_unsigned.tmp";
+    saveMatrix(m, path);
+    std::unique_ptr<matrix_t_<unsigned>> loaded = loadMatrix<unsigned>(path, false);
+    std::remove(path.c_str());
+    CHECK(loaded->getHeight() == 3 && (*loaded)(2, 1) == 4);
+}
+
+// Vues de matrix_view.h : elles lisent les éléments de la matrice d'origine, entrent dans les expressions et
+// écrivent dans la matrice par assign() et operator[].
+void testMatrixViews() {
+    const int h = 9, w = 7;
+    matrix_dense<double> dense(h, w), rowMajor(h, w, dense_layout::row_major);
+    matrix_triangulaire_sup<double> triang(h, w, -1.0);
+    matrix_diag<double> diag(h, w, 2.0);
+    matrix_band<double> band(h, w, 1, 2);
+    fill(dense, 1);
+    fill(rowMajor, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+    fill(band, 4);
+
+    const matrix_dense<double> reference = dense;
+    for (matrix_dense<double> *m : {&dense, &rowMajor}) {
+        const matrix_dense_view<double> block = m->block(2, 1, 4, 5);
+        bool same = true;
+        for (std::size_t i = 0; i < 4; i++)
+            for (std::size_t j = 0; j < 5; j++)
+                same = same && block(i, j) == reference(i + 2, j + 1);
+        CHECK(same);
+        CHECK(block.trace() == reference(2, 1) + reference(3, 2) + reference(4, 3) + reference(5, 4));
+        CHECK(block.diagonalView().trace() == block.trace());
+        CHECK(throwsOutOfRange([&]() { m->block(6, 0, 4, 1); }));
+
+        matrix_dense<double> blockCopy(4, 5), other(4, 5);
+        for (std::size_t i = 0; i < 4; i++)
+            for (std::size_t j = 0; j < 5; j++)
+                blockCopy(i, j) = reference(i + 2, j + 1);
+        fill(other, 5);
+        CHECK(sameValues(block.add(other), referenceSum<double>(blockCopy, other)));
+        CHECK(sameValues(evaluate(other + block + block), *other.add(*blockCopy.add(blockCopy))));
+        assign(m->block(0, 0, 4, 5), other);
+        CHECK((*m)(3, 4) == other(3, 4) && (*m)(4, 4) == reference(4, 4));
+    }
+    CHECK(throwsRuntimeError([&]() { matrix_dense<double>(4, 4, dense_layout::tiled).block(0, 0, 1, 1); }));
+
+    const matrix_triangulaire_sup_view<double> rows = triang.rows(3, 6);
+    bool sameRows = true;
+    for (std::size_t i = 0; i < 3; i++)
+        for (std::size_t j = 0; j < w; j++)
+            sameRows = sameRows && rows(i, j) == triang(i + 3, j);
+    CHECK(sameRows && rows.trace() == 3 * -1.0 && triang.rows(0, h).trace() == triang.trace());
+    rows.rowSegment(0)[5] = 40.0;
+    CHECK(triang(3, 5) == 40.0);
+
+    matrix_diag_view<double> diagonal = diag.diagonalView();
+    diagonal[4] = 50.0;
+    CHECK(diag(4, 4) == 50.0 && diagonal(0, 1) == 2.0 && diagonal.trace() == diag.trace());
+    matrix_diag_view<double> bandDiagonal = band.diagonalView();
+    CHECK(bandDiagonal.trace() == band.trace() && bandDiagonal(1, 0) == 0.0);
+    bandDiagonal[3] = 60.0;
+    CHECK(band(3, 3) == 60.0);
+    const matrix_diag<double> bandCopy = evaluate(bandDiagonal);
+    CHECK(bandCopy(3, 3) == 60.0 && bandCopy(0, 1) == 0.0);
+    CHECK(sameValues(evaluate(diagonal + bandDiagonal), referenceSum<double>(diag, bandCopy)));
+}
+
+// Copie sur écriture : une copie ne coûte aucune allocation, puis la première écriture dans l'une des deux
+// matrices la détache sans modifier l'autre, quel que soit le chemin d'écriture (operator(), noyau parallèle,
+// vue). Une vue modifiable rend son stockage exclusif : les copies faites ensuite ne voient pas ses écritures.
+void testCopyOnWrite() {
+    const int n = 200;
+    matrix_dense<double> dense(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 1.0);
+    matrix_diag<double> diag(n, n, 0.0);
+    matrix_band<double> band(n, n, 2, 2);
+    fill(dense, 1);
+    fill(triang, 2);
+    fill(diag, 3);
+    fill(band, 4);
+    matrix_csr<double> csr = sparse<double>(n, n, 5);
+    const std::vector<const matrix_t_<double> *> matrices = {&dense, &triang, &diag, &band, &csr};
+    for (const matrix_t_<double> *m : matrices) {
+        const matrix_dense<double> before = toDense(*m);
+        matrix_value<double> copy = toValue(*m);
+        asMatrix(copy).values()[0] += 1.0;
+        CHECK(sameValues(*m, before) && asMatrix(copy).values()[0] == m->values()[0] + 1.0);
+        matrix_value<double> other = toValue(*m);
+        asMatrix(other).scale(3.0);
+        CHECK(sameValues(*m, before));
+    }
+
+    // Une copie ordinaire est profonde : une référence ou un pointeur pris avant la copie n'écrit que dans
+    // l'original.
+    matrix_dense<double> a(4, 4);
+    double &r = a(0, 0);
+    const matrix_dense<double> b(a);
+    r = 5.0;
+    CHECK(a(0, 0) == 5.0 && b(0, 0) == 0.0);
+    matrix_dense<double> c(4, 4);
+    double *p = c.values().data();
+    matrix_dense<double> d(c);
+    c(0, 0) = 1.0;
+    p[5] = 7.0;
+    CHECK(c(1, 1) == 7.0 && d(1, 1) == 0.0);
+
+    // Deux copies écrites en même temps depuis deux threads, y compris deux copies partagées.
+    matrix_dense<double> e(4, 4);
+    matrix_dense<double> f(e), g = sharedCopy(e);
+    std::thread writer([&]() {
+        e(0, 0) = 1.0;
+        g(0, 0) = 3.0;
+    });
+    f(0, 0) = 2.0;
+    writer.join();
+    CHECK(e(0, 0) == 1.0 && f(0, 0) == 2.0 && g(0, 0) == 3.0);
+
+    // sharedCopy() ne recopie rien jusqu'à la première écriture, d'un côté comme de l'autre.
+    CHECK(allocationsOf([&]() { matrix_dense<double> shared = sharedCopy(dense); }) == 0);
+    matrix_dense<double> copy = sharedCopy(dense);
+    const matrix_dense<double> &readCopy = copy, &readDense = dense;
+    CHECK(readCopy.values().data() == readDense.values().data());
+    copy(0, 0) = 100.0;
+    CHECK(dense(0, 0) == valueAt(0, 0, 1) && copy(0, 0) == 100.0);
+    matrix_dense<double> second = sharedCopy(dense);
+    dense(1, 0) = 200.0;
+    CHECK(second(1, 0) == valueAt(1, 0, 1));
+
+    matrix_dense<double> target = sharedCopy(dense);
+    addInto(target, dense, dense);
+    CHECK(dense(5, 5) == valueAt(5, 5, 1) && target(5, 5) == 2 * valueAt(5, 5, 1));
+    matrix_triangulaire_sup<double> triangCopy = sharedCopy(triang);
+    triangCopy *= 2.0;
+    CHECK(triang(0, 3) == valueAt(0, 3, 2) && triang(3, 0) == 1.0);
+    const matrix_diag<double> transposed = diag.transposed();
+    diag(2, 2) = 300.0;
+    CHECK(transposed(2, 2) == valueAt(2, 2, 3));
+
+    matrix_dense<double> viewed(4, 4);
+    const matrix_dense<double> copyBeforeView = sharedCopy(viewed);
+    matrix_dense_view<double> block = viewed.block(0, 0, 2, 2);
+    const matrix_dense<double> copyAfterView = sharedCopy(viewed);
+    block(1, 1) = 7.0;
+    CHECK(viewed(1, 1) == 7.0 && copyBeforeView(1, 1) == 0.0 && copyAfterView(1, 1) == 0.0);
+    matrix_band<double> bandCopy = sharedCopy(band);
+    band.diagonalView()[0] = 400.0;
+    CHECK(bandCopy(0, 0) == valueAt(0, 0, 4) && band(0, 0) == 400.0);
+}
+
+template<typename T>
+void fill(matrix_symmetric<T> &m, int seed) {
+    for (std::size_t i = 0; i < m.getHeight(); i++)
+        for (std::size_t j = i; j < m.getWidth(); j++)
+            m(i, j) = static_cast<T>(valueAt(i, j, seed));
+}
+
+// matrix_symmetric : lecture miroir, sommes et produits avec toutes les classes, produit matrice-vecteur sur un
+// ou plusieurs morceaux (sans allocation une fois les tampons du thread en place), réductions et écriture.
+void testSymmetric() {
+    thread_pool::setGlobalThreadCount(4);
+    const int sizes[] = {30, 400};
+    for (int n : sizes) {
+        matrix_symmetric<double> sym(n), other(n);
+        fill(sym, 1);
+        fill(other, 2);
+        CHECK(sym(3, 1) == valueAt(1, 3, 1) && sym.getStoredSize() == matrix_symmetric<double>::packedSize(n));
+        sym(5, 2) = 9.0;
+        CHECK(sym(2, 5) == 9.0);
+
+        matrix_dense<double> dense(n, n);
+        matrix_triangulaire_sup<double> triang(n, n, 1.0);
+        matrix_diag<double> diag(n, n, -1.0);
+        matrix_band<double> band(n, n, 1, 3);
+        fill(dense, 3);
+        fill(triang, 4);
+        fill(diag, 5);
+        fill(band, 6);
+        const matrix_csr<double> csr = sparse<double>(n, n, 7);
+        const matrix_triangulaire_inf<double> lower = triang.transposed();
+        const std::vector<const matrix_t_<double> *> operands = {&other, &dense, &triang, &diag, &band, &csr, &lower};
+        for (const matrix_t_<double> *m : operands) {
+            CHECK(sameValues(*sym.add(*m), referenceSum<double>(sym, *m)));
+            CHECK(sameValues(*m->add(sym), referenceSum<double>(*m, sym)));
+            std::unique_ptr<matrix_t_<double>> dst = sym.add(*m);
+            addInto(*dst, *m, sym);
+            CHECK(sameValues(*dst, referenceSum<double>(*m, sym)));
+            checkReductions(sym, *m);
+        }
+        CHECK(typeid(*sym.add(other)) == typeid(matrix_symmetric<double>));
+        CHECK(typeid(*diag.add(sym)) == typeid(matrix_symmetric<double>));
+        CHECK(typeid(*sym.add(triang)) == typeid(matrix_dense<double>));
+        if (n <= 30) {
+            CHECK(sameValues(*sym.multiply(dense), referenceProduct<double>(sym, dense)));
+            CHECK(sameValues(*triang.multiply(sym), referenceProduct<double>(triang, sym)));
+        }
+        CHECK(sameValues(*sym.transpose(), sym));
+        CHECK(written(sym, matrix_text_format::tsv) == referenceTsv(sym));
+
+        checkMatrixVector(sym);
+        std::vector<double> x(n, 1.0), y(n);
+        sym.multiplyVector({x.data(), x.size()}, {y.data(), y.size()});
+        CHECK(allocationsOf([&]() { sym.multiplyVector({x.data(), x.size()}, {y.data(), y.size()}, 2.0, 1.0); }) == 0);
+    }
+    thread_pool::setGlobalThreadCount(0);
+}
+
+// Opérations asynchrones : résultats identiques aux versions synchrones, enchaînement par then(), propagation
+// des erreurs (de l'opération ou d'une continuation) et annulation, avant le début, pendant l'exécution et
+// après la fin. L'exécuteur n'a qu'un thread : une tâche bloquée retient celles soumises après elle.
+void testAsync() {
+    async_executor::setGlobalThreadCount(1);
+    const int n = 40;
+    matrix_dense<double> dense(n, n);
+    matrix_triangulaire_sup<double> triang(n, n, 1.0);
+    fill(dense, 1);
+    fill(triang, 2);
+
+    matrix_task<std::unique_ptr<matrix_t_<double>>> sum = addAsync<double>(dense, triang);
+    matrix_task<std::unique_ptr<matrix_t_<double>>> product = multiplyAsync<double>(dense, triang);
+    matrix_task<double> trace = traceAsync<double>(dense);
+    CHECK(sameValues(*sum.get(), referenceSum<double>(dense, triang)));
+    CHECK(sameValues(*product.get(), referenceProduct<double>(dense, triang)));
+    CHECK(trace.get() == dense.trace() && trace.ready() && !trace.cancelled());
+    matrix_task<double> doubled = sum.then([](const std::unique_ptr<matrix_t_<double>> &m) { return 2 * m->trace(); });
+    CHECK(doubled.get() == 2 * dense.trace() + 2 * triang.trace());
+
+    const std::string path = "tp5_tests_async.tmp";
+    matrix_task<std::unique_ptr<matrix_t_<double>>> saved = saveMatrixAsync<double>(triang, path).then([&path]() {
+        return loadMatrix<double>(path, false);
+    });
+    CHECK(sameValues(*saved.get(), triang));
+    CHECK(sameValues(*loadMatrixAsync<double>(path, false).get(), triang));
+    std::remove(path.c_str());
+
+    matrix_dense<double> wrongSize(n, n + 1);
+    int calls = 0;
+    matrix_task<std::unique_ptr<matrix_t_<double>>> failed = addAsync<double>(dense, wrongSize);
+    matrix_task<int> afterFailure = failed.then([&calls](const std::unique_ptr<matrix_t_<double>> &) {
+        return ++calls;
+    });
+    CHECK(throwsRuntimeError([&]() { failed.get(); }));
+    CHECK(throwsRuntimeError([&]() { afterFailure.get(); }) && calls == 0);
+
+    matrix_task<double> throwing = trace.then([](double) -> double { throw std::logic_error("continuation"); });
+    matrix_task<double> afterThrow = throwing.then([&calls](double t) { return t + ++calls; });
+    bool logicError = false;
+    try {
+        afterThrow.get();
+    } catch (const std::logic_error &) {
+        logicError = true;
+    }
+    CHECK(logicError && calls == 0 && !afterThrow.cancelled());
+
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<bool> started{false};
+    matrix_task<void> blocker = runAsync([released, &started]() {
+        started = true;
+        released.wait();
+    });
+    while (!started)
+        std::this_thread::yield();
+    matrix_task<double> queued = traceAsync<double>(dense);
+    matrix_task<double> chained = queued.then([&calls](double t) { return t + ++calls; });
+    CHECK(!queued.waitFor(std::chrono::milliseconds(1)));
+    CHECK(!blocker.cancel() && queued.cancel() && queued.cancelled());
+    CHECK(!queued.cancel());
+    release.set_value();
+    blocker.get();
+    bool cancelledThrown = false;
+    try {
+        queued.get();
+    } catch (const task_cancelled &) {
+        cancelledThrown = true;
+    }
+    chained.wait();
+    CHECK(cancelledThrown && chained.cancelled() && calls == 0);
+
+    matrix_task<double> finished = traceAsync<double>(dense);
+    finished.wait();
+    CHECK(!finished.cancel() && !finished.cancelled() && finished.get() == dense.trace());
+    CHECK(finished.then([](double t) { return t; }).get() == dense.trace());
+
+    async_executor::setGlobalThreadCount(async_executor::defaultThreads);
+}
+
+// Matrice par blocs de 70 x 70 aux tuiles variées : dense, triangulaires, diagonale, creuse, bande, vide et une
+// matrix_block imbriquée. rows et cols donnent le découpage, de trois blocs chacun.
+matrix_block<double> mixedBlock(const std::vector<std::size_t> &rows, const std::vector<std::size_t> &cols,
+                                int seed) {
+    matrix_block<double> result(rows, cols);
+    matrix_dense<double> dense(rows[0], cols[0]);
+    fill(dense, seed);
+    result.setTile(0, 0, std::move(dense));
+    matrix_triangulaire_sup<double> triang(rows[0], cols[1], 0.0);
+    fill(triang, seed + 1);
+    result.setTile(0, 1, std::move(triang));
+    result.setTile(1, 0, sparse<double>(rows[1], cols[0], seed + 2));
+    matrix_diag<double> diag(rows[1], cols[1], 0.0);
+    fill(diag, seed + 3);
+    result.setTile(1, 1, std::move(diag));
+    matrix_band<double> band(rows[1], cols[2], 2, 1);
+    fill(band, seed + 4);
+    result.setTile(1, 2, std::move(band));
+    matrix_block<double> &inner = result.setTile(2, 2, matrix_block<double>({rows[2] / 2, rows[2] - rows[2] / 2},
+                                                                             {cols[2] - 3, 3}));
+    matrix_dense<double> innerDense(rows[2] / 2, cols[2] - 3);
+    fill(innerDense, seed + 5);
+    inner.setTile(0, 0, std::move(innerDense));
+    result.setTile(2, 0, sparse<double>(rows[2], cols[0], seed + 6));
+    return result;
+}
+
+// Additions et produits avec toutes les classes, même découpage ou non, réductions et produit matrice-vecteur :
+// tout est comparé à la copie dense lue par operator()(i,j).
+void testBlock() {
+    thread_pool::setGlobalThreadCount(4);
+    const matrix_block<double> block = mixedBlock({20, 30, 20}, {25, 25, 20}, 1);
+    const matrix_block<double> same = mixedBlock({20, 30, 20}, {25, 25, 20}, 2);
+    const matrix_block<double> shifted = mixedBlock({30, 10, 30}, {10, 40, 20}, 3);
+    const matrix_dense<double> reference = toDense(block);
+    CHECK(block(5, 60) == 0.0 && block.tile(0, 2) == nullptr && block.tile(2, 2)->getStoredSize() > 0);
+    CHECK(block.samePartition(same) && !block.samePartition(shifted));
+
+    CHECK(typeid(*block.add(same)) == typeid(matrix_block<double>));
+    CHECK(sameValues(*block.add(same), referenceSum<double>(block, same)));
+    CHECK(typeid(*block.add(shifted)) == typeid(matrix_dense<double>));
+    CHECK(sameValues(*block.add(shifted), referenceSum<double>(block, shifted)));
+    CHECK(sameValues(*shifted.add(block), referenceSum<double>(shifted, block)));
+
+    matrix_dense<double> dense(70, 70);
+    matrix_triangulaire_sup<double> triang(70, 70, 1.0);
+    matrix_diag<double> diag(70, 70, -1.0);
+    matrix_band<double> band(70, 70, 3, 2);
+    fill(dense, 4);
+    fill(triang, 5);
+    fill(diag, 6);
+    fill(band, 7);
+    const matrix_csr<double> csr = sparse<double>(70, 70, 8);
+    const matrix_triangulaire_inf<double> lower = triang.transposed();
+    const std::vector<const matrix_t_<double> *> operands = {&same, &shifted, &dense, &triang, &diag, &band, &csr,
+                                                             &lower};
+    for (const matrix_t_<double> *m : operands) {
+        CHECK(sameValues(*block.add(*m), referenceSum<double>(block, *m)));
+        CHECK(sameValues(*m->add(block), referenceSum<double>(*m, block)));
+        std::unique_ptr<matrix_t_<double>> dst = block.add(*m);
+        addInto(*dst, *m, block);
+        CHECK(sameValues(*dst, referenceSum<double>(*m, block)));
+        CHECK(sameValues(*block.multiply(*m), referenceProduct<double>(block, *m)));
+        CHECK(sameValues(*m->multiply(block), referenceProduct<double>(*m, block)));
+        checkReductions(block, *m);
+    }
+
+    // addInto sur le même découpage réutilise les tuiles de dst ; le résultat reste la somme.
+    std::unique_ptr<matrix_t_<double>> sum = block.add(same);
+    addInto(*sum, same, block);
+    CHECK(sameValues(*sum, referenceSum<double>(same, block)));
+    CHECK(block.traceSum(reduce::summation::pairwise) == reference.traceSum(reduce::summation::pairwise));
+    CHECK(sameValues(block.toDense(), reference) && sameValues(*block.transpose(), *reference.transpose()));
+    CHECK(written(block, matrix_text_format::tsv) == referenceTsv(block));
+    checkMatrixVector(block);
+    checkMatrixVector(shifted);
+
+    matrix_block<double> scaled = block;
+    scaled.scale(2.0);
+    CHECK(sameValues(scaled, *reference.add(reference)) && sameValues(block, reference));
+    thread_pool::setGlobalThreadCount(0);
+}
+
+int main() {
+    testAdd<int>();
+    testAdd<float>();
+    testAdd<double>();
+    testAdd<std::complex<double>>();
+    testMultiply();
+    testExpressions();
+    testAddInto();
+    testViews();
+    testThreadPool();
+    testParallelKernels();
+    testMatrixFile();
+    testWriter();
+    testWriterPrecision();
+    testCsrConstruction();
+    testCsrDispatch();
+    testBandDispatch();
+    testFixed();
+    testStaticDispatch();
+    testTriangularSolve();
+    testMatrixVector();
+    testDenseLayouts();
+    testTranspose();
+    testStats();
+    testBatch();
+    testAxpby();
+    testReductions();
+    testUnsigned();
+    testMatrixViews();
+    testCopyOnWrite();
+    testSymmetric();
+    testAsync();
+    testBlock();
+    if (failures > 0)
+        std::printf("%d check(s) failed\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,314 @@
+#ifndef TP5_THREAD_POOL_H
+#define TP5_THREAD_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de threads simple (std::thread, sans dépendance externe) utilisé par les noyaux des matrices.
+//
+// parallelFor découpe un intervalle en morceaux d'au moins grain éléments : le thread appelant traite le
+// premier morceau, puis ceux qu'aucun thread du pool n'a encore pris, et attend les autres. Un intervalle de
+// moins de 2 * grain éléments reste entièrement sur le thread appelant, les petites opérations ne paient donc
+// pas la synchronisation. Un appel depuis un thread du pool s'exécute aussi en séquentiel.
+//
+// Distribuer un appel n'alloue rien : l'appel est décrit par un enregistrement sur la pile de l'appelant, qui
+// ne revient qu'une fois tous ses morceaux terminés, et les bornes des morceaux sont calculées à la demande.
+// Les opérations sans allocation (addInto) le restent donc avec plusieurs threads.
+class thread_pool {
+    // Appel en cours de distribution. Les morceaux 1..chunks-1 se prennent dans l'ordre ; l'enregistrement
+    // reste dans la file tant qu'il en reste à prendre.
+    struct job {
+        void (*run)(void *context, std::size_t chunk);
+        void *context;
+        std::size_t chunks;
+        std::size_t next = 1;
+        // Morceaux 1..chunks-1 pas encore terminés.
+        std::size_t pending;
+        std::exception_ptr error;
+        job *following = nullptr;
+    };
+
+    std::vector<std::thread> workers;
+    // File des appels qui ont encore des morceaux à prendre, chaînée par job::following.
+    job *head = nullptr;
+    job *tail = nullptr;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable finished;
+    bool stopping = false;
+
+    static bool &insideWorker() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    static std::unique_ptr<thread_pool> &globalInstance() {
+        static std::unique_ptr<thread_pool> instance;
+        return instance;
+    }
+
+    // Pool global déjà créé, lu sans verrou par global().
+    static std::atomic<thread_pool *> &globalPointer() {
+        static std::atomic<thread_pool *> pointer{nullptr};
+        return pointer;
+    }
+
+    static std::mutex &globalMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Prend le prochain morceau de j, mutex tenu ; j quitte la file avec son dernier morceau.
+    std::size_t claim(job &j) {
+        const std::size_t chunk = j.next++;
+        if (j.next == j.chunks) {
+            job **link = &head;
+            job *previous = nullptr;
+            while (*link != &j) {
+                previous = *link;
+                link = &(*link)->following;
+            }
+            *link = j.following;
+            if (tail == &j)
+                tail = previous;
+        }
+        return chunk;
+    }
+
+    // Exécute un morceau pris dans la file. Après la dernière décrémentation, l'appelant peut revenir et
+    // détruire j : plus rien n'y touche une fois le verrou relâché.
+    void execute(job &j, std::size_t chunk) {
+        std::exception_ptr error;
+        try {
+            j.run(j.context, chunk);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error && !j.error)
+            j.error = error;
+        if (--j.pending == 0)
+            finished.notify_all();
+    }
+
+    void workerLoop() {
+        insideWorker() = true;
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]() { return stopping || head != nullptr; });
+            if (head == nullptr)
+                return;
+            job &j = *head;
+            const std::size_t chunk = claim(j);
+            lock.unlock();
+            execute(j, chunk);
+        }
+    }
+
+    // Appelle chunk(k) pour k dans [0, chunks), réparti entre l'appelant et les threads du pool.
+    template<typename G>
+    void dispatch(std::size_t chunks, G &chunk) {
+        if (chunks == 1 || workers.empty() || insideWorker()) {
+            for (std::size_t k = 0; k < chunks; k++)
+                chunk(k);
+            return;
+        }
+
+        job j;
+        j.run = [](void *context, std::size_t k) { (*static_cast<G *>(context))(k); };
+        j.context = &chunk;
+        j.chunks = chunks;
+        j.pending = chunks - 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            (tail != nullptr ? tail->following : head) = &j;
+            tail = &j;
+        }
+        available.notify_all();
+
+        std::exception_ptr error;
+        try {
+            chunk(0);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // Les morceaux que personne n'a encore pris sont traités ici plutôt qu'attendus.
+        for (;;) {
+            std::size_t k;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (j.next == j.chunks)
+                    break;
+                k = claim(j);
+            }
+            execute(j, k);
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&j]() { return j.pending == 0; });
+        }
+        if (error)
+            std::rethrow_exception(error);
+        if (j.error)
+            std::rethrow_exception(j.error);
+    }
+
+    std::size_t chunkCount(std::size_t n, std::size_t grain) const {
+        return std::max<std::size_t>(1, std::min(size(), n / std::max<std::size_t>(grain, 1)));
+    }
+
+public:
+    // Taille de morceau par défaut, en éléments : en dessous, le coût de réveil d'un thread domine.
+    static constexpr std::size_t defaultGrain = 1 << 15;
+
+    // Nombre de sommes partielles de parallelReduce gardées sur la pile ; au-delà, un tableau est alloué.
+    static constexpr std::size_t stackPartials = 64;
+
+    // threads = 0 : autant de threads que de coeurs. Le thread appelant compte parmi eux, le pool en crée
+    // donc threads - 1.
+    explicit thread_pool(std::size_t threads = 0) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 1; i < threads; i++)
+            workers.emplace_back([this]() { workerLoop(); });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    thread_pool(const thread_pool &) = delete;
+
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    std::size_t size() const {
+        return workers.size() + 1;
+    }
+
+    // Pool partagé par les noyaux des matrices, créé au premier appel. Plusieurs threads peuvent faire ce
+    // premier appel en même temps : un seul pool est créé.
+    static thread_pool &global() {
+        if (thread_pool *pool = globalPointer().load(std::memory_order_acquire))
+            return *pool;
+        std::lock_guard<std::mutex> lock(globalMutex());
+        std::unique_ptr<thread_pool> &instance = globalInstance();
+        if (!instance) {
+            instance.reset(new thread_pool());
+            globalPointer().store(instance.get(), std::memory_order_release);
+        }
+        return *instance;
+    }
+
+    // Change le nombre de threads du pool global (0 = nombre de coeurs, 1 = tout en séquentiel). L'ancien pool
+    // est détruit : aucune opération ne doit l'utiliser pendant l'appel, ni garder la référence renvoyée par
+    // global() (c'est à l'appelant de s'en assurer, par exemple avant de lancer des tâches asynchrones).
+    static void setGlobalThreadCount(std::size_t threads) {
+        std::unique_ptr<thread_pool> replacement(new thread_pool(threads));
+        {
+            std::lock_guard<std::mutex> lock(globalMutex());
+            globalInstance().swap(replacement);
+            globalPointer().store(globalInstance().get(), std::memory_order_release);
+        }
+    }
+
+    // Exécute f(first, last) sur des morceaux contigus de bounds : le morceau k est [bounds[k], bounds[k + 1]).
+    template<typename F>
+    void parallelForBounds(const std::vector<std::size_t> &bounds, F &&f) {
+        if (bounds.size() < 2)
+            return;
+        auto chunk = [&bounds, &f](std::size_t k) { f(bounds[k], bounds[k + 1]); };
+        dispatch(bounds.size() - 1, chunk);
+    }
+
+    // Découpe [first, last) en morceaux de même taille, au plus un par thread et d'au moins grain éléments.
+    template<typename F>
+    void parallelFor(std::size_t first, std::size_t last, std::size_t grain, F &&f) {
+        const std::size_t n = last > first ? last - first : 0;
+        const std::size_t chunks = chunkCount(n, grain);
+        // Un seul morceau : appel direct (petites matrices).
+        if (chunks == 1) {
+            if (n > 0)
+                f(first, last);
+            return;
+        }
+        auto chunk = [first, n, chunks, &f](std::size_t k) {
+            f(first + n * k / chunks, first + n * (k + 1) / chunks);
+        };
+        dispatch(chunks, chunk);
+    }
+
+    // Découpe les lignes [0, rows) pour que chaque morceau ait à peu près le même poids. cumulative(i) est
+    // le poids total des lignes [0, i), croissant ; pour une triangulaire c'est le nombre d'éléments stockés
+    // avant la ligne i, ce qui évite de donner toutes les longues lignes du haut au premier thread. La borne
+    // de chaque morceau est cherchée par dichotomie ; un morceau vide n'appelle pas f.
+    template<typename C, typename F>
+    void parallelForWeighted(std::size_t rows, C &&cumulative, std::size_t grain, F &&f) {
+        const std::size_t total = cumulative(rows);
+        const std::size_t chunks = chunkCount(total, grain);
+        if (chunks == 1) {
+            if (rows > 0)
+                f(std::size_t{0}, rows);
+            return;
+        }
+        auto bound = [&cumulative, rows, total, chunks](std::size_t k) {
+            if (k == chunks)
+                return rows;
+            const std::size_t target = total * k / chunks;
+            std::size_t lo = 0, hi = rows;
+            while (lo < hi) {
+                std::size_t mid = lo + (hi - lo) / 2;
+                if (cumulative(mid) < target)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        };
+        auto chunk = [&bound, &f](std::size_t k) {
+            const std::size_t first = bound(k), last = bound(k + 1);
+            if (first < last)
+                f(first, last);
+        };
+        dispatch(chunks, chunk);
+    }
+
+    // Réduction : f(first, last) renvoie la somme partielle d'un morceau, les sommes partielles sont
+    // additionnées dans l'ordre des morceaux.
+    template<typename R, typename F>
+    R parallelReduce(std::size_t first, std::size_t last, std::size_t grain, R init, F &&f) {
+        const std::size_t n = last > first ? last - first : 0;
+        if (n == 0)
+            return init;
+        const std::size_t chunks = chunkCount(n, grain);
+        if (chunks == 1) {
+            init += f(first, last);
+            return init;
+        }
+        std::array<R, stackPartials> onStack{};
+        std::unique_ptr<R[]> onHeap(chunks > stackPartials ? new R[chunks]() : nullptr);
+        R *partials = onHeap ? onHeap.get() : onStack.data();
+        auto chunk = [first, n, chunks, partials, &f](std::size_t k) {
+            partials[k] = f(first + n * k / chunks, first + n * (k + 1) / chunks);
+        };
+        dispatch(chunks, chunk);
+        for (std::size_t k = 0; k < chunks; k++)
+            init += partials[k];
+        return init;
+    }
+};
+
+#endif //TP5_THREAD_POOL_H